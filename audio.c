@@ -0,0 +1,454 @@
+//---------------------------------------------------------
+// file:	audio.c
+//
+// brief:	Sample pool, mixer thread and output devices
+//			(see audio.h).
+//---------------------------------------------------------
+
+#include "audio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+typedef volatile LONG AtomicIndex;
+typedef HANDLE Thread;
+#define THREAD_RESULT DWORD WINAPI
+static LONG loadIndex(AtomicIndex* index) { return InterlockedCompareExchange(index, 0, 0); }
+static void storeIndex(AtomicIndex* index, LONG value) { InterlockedExchange(index, value); }
+static void sleepMs(int ms) { Sleep(ms); }
+static FILE* openFile(const char* path, const char* mode) {
+	FILE* file = NULL;
+	return (fopen_s(&file, path, mode) == 0) ? file : NULL;
+}
+#else
+#include <pthread.h>
+#include <time.h>
+typedef volatile long AtomicIndex;
+typedef pthread_t Thread;
+#define THREAD_RESULT void*
+static long loadIndex(AtomicIndex* index) { return __atomic_load_n(index, __ATOMIC_ACQUIRE); }
+static void storeIndex(AtomicIndex* index, long value) { __atomic_store_n(index, value, __ATOMIC_RELEASE); }
+static void sleepMs(int ms) {
+	struct timespec t = { ms / 1000, (ms % 1000) * 1000000L };
+	nanosleep(&t, NULL);
+}
+static FILE* openFile(const char* path, const char* mode) { return fopen(path, mode); }
+#endif
+
+#define WAVEOUT_BUFFERS 3
+
+static const char* SOUND_PATHS[SOUND_COUNT] = {
+	"Assets/BassDrum.wav",
+	"Assets/Clap.wav",
+	"Assets/Cowbell.wav",
+	"Assets/HiHat.wav",
+	"Assets/Snare.wav",
+	"Assets/Notes/a.wav",
+	"Assets/Notes/b.wav",
+	"Assets/Notes/c.wav",
+	"Assets/Notes/d.wav",
+	"Assets/Notes/e.wav",
+	"Assets/Notes/f.wav",
+	"Assets/Notes/g.wav",
+	"Assets/Piano/a.wav",
+	"Assets/Piano/b.wav",
+	"Assets/Piano/c.wav",
+	"Assets/Piano/d.wav",
+	"Assets/Piano/e.wav",
+	"Assets/Piano/f.wav",
+	"Assets/Piano/g.wav"
+};
+
+typedef struct {
+	int offset; //first stereo frame inside the pool
+	int frames;
+	double rateScale; //file sample rate / AUDIO_SAMPLE_RATE
+} SoundClip;
+
+typedef struct {
+	int sound;
+	float volume;
+	float pitch;
+} AudioCommand;
+
+typedef struct {
+	bool active;
+	int sound;
+	double position; //in source frames
+	double step;
+	float volume;
+	unsigned int startedAt; //mixer block counter, used to pick the oldest voice to steal
+} Voice;
+
+/***
+* Single producer (game thread), single consumer (mixer thread) ring.
+* Each side owns one index and only reads the other, so neither ever waits.
+***/
+typedef struct {
+	AudioCommand slots[AUDIO_QUEUE_SIZE];
+	AtomicIndex head; //written by the mixer
+	AtomicIndex tail; //written by the game
+} AudioQueue;
+
+static short* pcmPool; //every clip, interleaved stereo, back to back
+static SoundClip clips[SOUND_COUNT];
+
+static AudioQueue audioQueue;
+static Voice voices[AUDIO_MAX_VOICES];
+static AtomicIndex activeVoiceCount;
+static AtomicIndex mixerRunning;
+static bool audioOpen; //taking commands, with or without the mixer thread
+static bool threaded;
+static Thread mixerThread;
+static unsigned int mixedBlocks;
+static AudioDevice outputDevice;
+
+/* * * * * * * * *
+* WAV DECODING   *
+* * * * * * * * */
+static unsigned int readU32(const unsigned char* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24); }
+static unsigned short readU16(const unsigned char* p) { return (unsigned short)(p[0] | (p[1] << 8)); }
+
+//Reads a whole RIFF/WAVE file. Only 16-bit PCM (mono or stereo) is supported, which is
+//what every file in Assets/ uses. The returned buffer is always interleaved stereo.
+static short* loadWav(const char* path, int* framesOut, int* rateOut) {
+	FILE* file = openFile(path, "rb");
+	if (!file) return NULL;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	unsigned char* bytes = malloc(size);
+	if (!bytes || fread(bytes, 1, size, file) != (size_t)size || size < 12 || memcmp(bytes, "RIFF", 4) || memcmp(bytes + 8, "WAVE", 4)) {
+		fclose(file);
+		free(bytes);
+		return NULL;
+	}
+	fclose(file);
+
+	int channels = 0, bits = 0, rate = 0;
+	const unsigned char* data = NULL;
+	unsigned int dataSize = 0;
+	for (long i = 12; i + 8 <= size;) {
+		unsigned int chunkSize = readU32(bytes + i + 4);
+		unsigned long left = (unsigned long)(size - i - 8); //bytes after this chunk's header
+		if (!memcmp(bytes + i, "fmt ", 4) && chunkSize >= 16 && left >= 16 && readU16(bytes + i + 8) == 1) {
+			channels = readU16(bytes + i + 10);
+			rate = readU32(bytes + i + 12);
+			bits = readU16(bytes + i + 22);
+		} else if (!memcmp(bytes + i, "data", 4)) {
+			data = bytes + i + 8;
+			dataSize = (chunkSize > left) ? (unsigned int)left : chunkSize;
+		}
+		if (chunkSize >= left) break; //the last chunk, or one claiming more than the file holds
+		i += 8 + chunkSize + (chunkSize & 1);
+	}
+
+	short* pcm = NULL;
+	if (data && bits == 16 && (channels == 1 || channels == 2) && rate > 0) {
+		int frames = dataSize / (2 * channels);
+		pcm = malloc((size_t)frames * AUDIO_CHANNELS * sizeof * pcm);
+		if (pcm) {
+			for (int f = 0; f < frames; f++) {
+				short left = (short)readU16(data + f * 2 * channels);
+				short right = (channels == 2) ? (short)readU16(data + f * 4 + 2) : left;
+				pcm[f * 2] = left;
+				pcm[f * 2 + 1] = right;
+			}
+			*framesOut = frames;
+			*rateOut = rate;
+		}
+	}
+	free(bytes);
+	return pcm;
+}
+
+//Decode every clip and pack them into one pool so the mixer reads a single allocation.
+static bool loadPool(void) {
+	short* decoded[SOUND_COUNT] = { 0 };
+	int rates[SOUND_COUNT] = { 0 };
+	int totalFrames = 0;
+	int loaded = 0;
+
+	for (int i = 0; i < SOUND_COUNT; i++) {
+		int frames = 0;
+		decoded[i] = loadWav(SOUND_PATHS[i], &frames, &rates[i]);
+		clips[i].offset = totalFrames;
+		clips[i].frames = decoded[i] ? frames : 0;
+		clips[i].rateScale = decoded[i] ? (double)rates[i] / AUDIO_SAMPLE_RATE : 1;
+		totalFrames += clips[i].frames;
+		loaded += decoded[i] != NULL;
+	}
+
+	pcmPool = (totalFrames > 0) ? malloc((size_t)totalFrames * AUDIO_CHANNELS * sizeof * pcmPool) : NULL;
+	for (int i = 0; i < SOUND_COUNT; i++) {
+		if (pcmPool && decoded[i]) memcpy(pcmPool + (size_t)clips[i].offset * AUDIO_CHANNELS, decoded[i], (size_t)clips[i].frames * AUDIO_CHANNELS * sizeof * pcmPool);
+		free(decoded[i]);
+	}
+	return pcmPool && loaded > 0;
+}
+
+/* * * * * *
+* MIXING   *
+* * * * * */
+static void startVoice(const AudioCommand* cmd, unsigned int block) {
+	if (cmd->sound < 0 || cmd->sound >= SOUND_COUNT || clips[cmd->sound].frames == 0) return;
+
+	//take a free voice, or steal the one that has been playing longest
+	int chosen = 0;
+	for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+		if (!voices[i].active) {
+			chosen = i;
+			break;
+		}
+		if (voices[i].startedAt < voices[chosen].startedAt) chosen = i;
+	}
+
+	Voice* v = &voices[chosen];
+	v->active = true;
+	v->sound = cmd->sound;
+	v->position = 0;
+	v->step = clips[cmd->sound].rateScale * cmd->pitch;
+	v->volume = cmd->volume;
+	v->startedAt = block;
+}
+
+static void mixBlock(int* accum) {
+	memset(accum, 0, AUDIO_BLOCK_FRAMES * AUDIO_CHANNELS * sizeof * accum);
+	int active = 0;
+
+	for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+		Voice* v = &voices[i];
+		if (!v->active) continue;
+		const SoundClip* clip = &clips[v->sound];
+		const short* pcm = pcmPool + (size_t)clip->offset * AUDIO_CHANNELS;
+		int volume = (int)(v->volume * 256);
+
+		for (int f = 0; f < AUDIO_BLOCK_FRAMES; f++) {
+			int index = (int)v->position;
+			if (index + 1 >= clip->frames) {
+				v->active = false;
+				break;
+			}
+			//linear interpolation between neighbouring frames, 8 bits of fraction
+			int frac = (int)((v->position - index) * 256);
+			for (int c = 0; c < AUDIO_CHANNELS; c++) {
+				int a = pcm[index * AUDIO_CHANNELS + c];
+				int b = pcm[(index + 1) * AUDIO_CHANNELS + c];
+				int sample = a + (((b - a) * frac) >> 8);
+				accum[f * AUDIO_CHANNELS + c] += (sample * volume) >> 8;
+			}
+			v->position += v->step;
+		}
+		active += v->active;
+	}
+	storeIndex(&activeVoiceCount, active);
+}
+
+//Start everything the game queued since the last block, then mix the next one.
+static void nextBlock(short* out) {
+	int accum[AUDIO_BLOCK_FRAMES * AUDIO_CHANNELS];
+	long head = audioQueue.head;
+	long tail = loadIndex(&audioQueue.tail);
+	while (head != tail) {
+		startVoice(&audioQueue.slots[head & (AUDIO_QUEUE_SIZE - 1)], mixedBlocks);
+		head++;
+	}
+	storeIndex(&audioQueue.head, head);
+
+	mixBlock(accum);
+	for (int i = 0; i < AUDIO_BLOCK_FRAMES * AUDIO_CHANNELS; i++) {
+		out[i] = (short)((accum[i] > 32767) ? 32767 : (accum[i] < -32768) ? -32768 : accum[i]);
+	}
+	mixedBlocks++;
+}
+
+static THREAD_RESULT mixerMain(void* param) {
+	(void)param;
+	short out[AUDIO_BLOCK_FRAMES * AUDIO_CHANNELS];
+	while (loadIndex(&mixerRunning)) {
+		nextBlock(out);
+		outputDevice.write(&outputDevice, out, AUDIO_BLOCK_FRAMES);
+	}
+	return 0;
+}
+
+/* * * * * * *
+* PUBLIC API *
+* * * * * * */
+bool Audio_Open(void) {
+	if (audioOpen) return true;
+	if (!pcmPool && !loadPool()) return false;
+	memset(voices, 0, sizeof voices);
+	audioQueue.head = audioQueue.tail = 0;
+	activeVoiceCount = 0;
+	mixedBlocks = 0;
+	audioOpen = true;
+	return true;
+}
+
+bool Audio_Init(AudioDevice device) {
+	if (threaded) return true;
+	if (audioOpen || !Audio_Open()) return false;
+
+	outputDevice = device;
+	if (outputDevice.open && !outputDevice.open(&outputDevice)) {
+		audioOpen = false;
+		return false;
+	}
+
+	mixerRunning = 1;
+#ifdef _WIN32
+	mixerThread = CreateThread(NULL, 0, mixerMain, NULL, 0, NULL);
+	threaded = mixerThread != NULL;
+	if (threaded) SetThreadPriority(mixerThread, THREAD_PRIORITY_TIME_CRITICAL);
+#else
+	threaded = pthread_create(&mixerThread, NULL, mixerMain, NULL) == 0;
+#endif
+	if (!threaded) {
+		mixerRunning = 0;
+		audioOpen = false;
+		if (outputDevice.close) outputDevice.close(&outputDevice);
+		return false;
+	}
+	return true;
+}
+
+void Audio_Shutdown(void) {
+	if (threaded) {
+		storeIndex(&mixerRunning, 0);
+#ifdef _WIN32
+		WaitForSingleObject(mixerThread, INFINITE);
+		CloseHandle(mixerThread);
+#else
+		pthread_join(mixerThread, NULL);
+#endif
+		threaded = false;
+		if (outputDevice.close) outputDevice.close(&outputDevice);
+	}
+	audioOpen = false;
+	free(pcmPool);
+	pcmPool = NULL;
+}
+
+void Audio_Mix(short* out) {
+	if (audioOpen && !threaded) nextBlock(out);
+}
+
+bool Audio_Play(SoundId sound, float volume, float pitch) {
+	if (!audioOpen) return false;
+	long tail = audioQueue.tail;
+	long head = loadIndex(&audioQueue.head);
+	if (tail - head >= AUDIO_QUEUE_SIZE) return false; //full, drop the sound rather than wait
+
+	AudioCommand* slot = &audioQueue.slots[tail & (AUDIO_QUEUE_SIZE - 1)];
+	slot->sound = sound;
+	slot->volume = volume;
+	slot->pitch = (pitch > 0) ? pitch : 1;
+	storeIndex(&audioQueue.tail, tail + 1); //publishes the slot
+	return true;
+}
+
+int Audio_GetActiveVoices(void) {
+	return (int)loadIndex(&activeVoiceCount);
+}
+
+bool Audio_IsPlaying(SoundId sound) {
+	for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+		if (voices[i].active && voices[i].sound == (int)sound) return true;
+	}
+	return false;
+}
+
+/* * * * * * * * *
+* NULL DEVICE    *
+* * * * * * * * */
+static void nullWrite(AudioDevice* device, const short* samples, int frames) {
+	NullAudioDevice* state = device->data;
+	int peak = state->peak;
+	for (int i = 0; i < frames * AUDIO_CHANNELS; i++) {
+		int magnitude = (samples[i] < 0) ? -samples[i] : samples[i];
+		peak = (magnitude > peak) ? magnitude : peak;
+	}
+	state->peak = peak;
+	state->framesWritten += frames;
+	if (state->realtime) sleepMs(frames * 1000 / AUDIO_SAMPLE_RATE);
+}
+
+AudioDevice Audio_NullDevice(NullAudioDevice* state) {
+	AudioDevice device = { NULL, nullWrite, NULL, state };
+	return device;
+}
+
+/* * * * * * * * * *
+* WAVEOUT DEVICE  *
+* * * * * * * * * */
+#ifdef _WIN32
+typedef struct {
+	HWAVEOUT handle;
+	HANDLE doneEvent;
+	WAVEHDR headers[WAVEOUT_BUFFERS];
+	short buffers[WAVEOUT_BUFFERS][AUDIO_BLOCK_FRAMES * AUDIO_CHANNELS];
+	int next;
+} WaveOutState;
+
+static WaveOutState waveOut;
+
+static bool waveOutOpenDevice(AudioDevice* device) {
+	WaveOutState* state = device->data;
+	WAVEFORMATEX format = { 0 };
+	format.wFormatTag = WAVE_FORMAT_PCM;
+	format.nChannels = AUDIO_CHANNELS;
+	format.nSamplesPerSec = AUDIO_SAMPLE_RATE;
+	format.wBitsPerSample = 16;
+	format.nBlockAlign = format.nChannels * format.wBitsPerSample / 8;
+	format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+
+	state->doneEvent = CreateEventA(NULL, FALSE, FALSE, NULL);
+	if (!state->doneEvent) return false;
+	if (waveOutOpen(&state->handle, WAVE_MAPPER, &format, (DWORD_PTR)state->doneEvent, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR) {
+		CloseHandle(state->doneEvent);
+		return false;
+	}
+
+	for (int i = 0; i < WAVEOUT_BUFFERS; i++) {
+		memset(&state->headers[i], 0, sizeof state->headers[i]);
+		state->headers[i].lpData = (LPSTR)state->buffers[i];
+		state->headers[i].dwBufferLength = sizeof state->buffers[i];
+		waveOutPrepareHeader(state->handle, &state->headers[i], sizeof state->headers[i]);
+		state->headers[i].dwFlags |= WHDR_DONE; //every buffer starts out free
+	}
+	state->next = 0;
+	return true;
+}
+
+static void waveOutWriteDevice(AudioDevice* device, const short* samples, int frames) {
+	WaveOutState* state = device->data;
+	WAVEHDR* header = &state->headers[state->next];
+	//wait until the card has finished with the oldest buffer
+	while (!(header->dwFlags & WHDR_DONE)) WaitForSingleObject(state->doneEvent, 50);
+
+	memcpy(state->buffers[state->next], samples, frames * AUDIO_CHANNELS * sizeof * samples);
+	header->dwBufferLength = frames * AUDIO_CHANNELS * sizeof * samples;
+	header->dwFlags &= ~WHDR_DONE;
+	waveOutWrite(state->handle, header, sizeof * header);
+	state->next = (state->next + 1) % WAVEOUT_BUFFERS;
+}
+
+static void waveOutCloseDevice(AudioDevice* device) {
+	WaveOutState* state = device->data;
+	waveOutReset(state->handle);
+	for (int i = 0; i < WAVEOUT_BUFFERS; i++) waveOutUnprepareHeader(state->handle, &state->headers[i], sizeof state->headers[i]);
+	waveOutClose(state->handle);
+	CloseHandle(state->doneEvent);
+}
+
+AudioDevice Audio_WaveOutDevice(void) {
+	AudioDevice device = { waveOutOpenDevice, waveOutWriteDevice, waveOutCloseDevice, &waveOut };
+	return device;
+}
+#endif
@@ -0,0 +1,86 @@
+//---------------------------------------------------------
+// file:	audio.h
+//
+// brief:	Low-latency sound effects for gameplay events.
+//			Every sample in Assets/ is decoded once at startup
+//			into one shared PCM pool, then mixed on a dedicated
+//			thread. The game thread only pushes commands into a
+//			wait-free queue, so playing a sound never loads,
+//			allocates or blocks. The mixer can also be run
+//			without the thread, a block at a time, to test it.
+//---------------------------------------------------------
+#pragma once
+
+#include <stdbool.h>
+
+#define AUDIO_SAMPLE_RATE 44100
+#define AUDIO_CHANNELS 2
+#define AUDIO_BLOCK_FRAMES 512 //~11.6ms per mixed block
+#define AUDIO_MAX_VOICES 16
+#define AUDIO_QUEUE_SIZE 64 //sounds that can wait for the mixer, must be a power of two
+
+typedef enum {
+	SOUND_BASSDRUM,
+	SOUND_CLAP,
+	SOUND_COWBELL,
+	SOUND_HIHAT,
+	SOUND_SNARE,
+	SOUND_NOTE_A,
+	SOUND_NOTE_B,
+	SOUND_NOTE_C,
+	SOUND_NOTE_D,
+	SOUND_NOTE_E,
+	SOUND_NOTE_F,
+	SOUND_NOTE_G,
+	SOUND_PIANO_A,
+	SOUND_PIANO_B,
+	SOUND_PIANO_C,
+	SOUND_PIANO_D,
+	SOUND_PIANO_E,
+	SOUND_PIANO_F,
+	SOUND_PIANO_G,
+	SOUND_COUNT
+} SoundId;
+
+/***
+* Where mixed blocks go. write() is called from the mixer thread with interleaved
+* 16-bit stereo and is expected to block until the device can take more, which is
+* what paces the mixer.
+***/
+typedef struct AudioDevice {
+	bool (*open)(struct AudioDevice* device);
+	void (*write)(struct AudioDevice* device, const short* samples, int frames);
+	void (*close)(struct AudioDevice* device);
+	void* data;
+} AudioDevice;
+
+//Discards output but keeps real-time pacing, and counts what it was given.
+//Used when no sound card is available, and to run the mixer headless.
+typedef struct {
+	bool realtime; //sleep for the duration of every block, like a sound card would
+	volatile long long framesWritten;
+	volatile int peak; //loudest absolute sample seen
+} NullAudioDevice;
+
+AudioDevice Audio_NullDevice(NullAudioDevice* state);
+#ifdef _WIN32
+AudioDevice Audio_WaveOutDevice(void);
+#endif
+
+//Decode every sample and start the mixer thread. Returns false if no sample could be loaded
+//or the device/thread could not be started; Audio_Play is then a harmless no-op.
+bool Audio_Init(AudioDevice device);
+//Decode every sample and take sounds, but mix only when Audio_Mix is called: no thread and
+//no device. Audio_Shutdown closes it like it stops the thread.
+bool Audio_Open(void);
+void Audio_Shutdown(void);
+//Start the sounds queued since the last block and mix the next AUDIO_BLOCK_FRAMES frames into
+//out, interleaved. Only after Audio_Open; with the mixer thread running it does nothing.
+void Audio_Mix(short* out);
+
+//Queue a sound from the game thread. Never blocks; returns false if the queue is full.
+bool Audio_Play(SoundId sound, float volume, float pitch);
+
+int Audio_GetActiveVoices(void);
+//Whether a voice is playing the sound, as of the last block mixed. Only exact without the thread.
+bool Audio_IsPlaying(SoundId sound);
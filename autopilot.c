@@ -0,0 +1,415 @@
+//---------------------------------------------------------
+// file:	autopilot.c
+//
+// brief:	Flow field navigator (see autopilot.h).
+//---------------------------------------------------------
+
+#include "autopilot.h"
+#include "collision.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#define AUTOPILOT_STRAIGHT 10 //cost of a step to a side neighbour, tenths of a cell
+#define AUTOPILOT_DIAGONAL 14
+#define AUTOPILOT_CLEARANCE 30 //cells closer than this to a cloud, in tenths, cost extra to cross
+#define AUTOPILOT_LOOKAHEAD 10 //frames ahead the flow is read, the plane can't turn on the spot
+#define AUTOPILOT_GAIN 0.2f //rotation per frame asked for, per radian off course
+
+static const int NEIGHBOUR_X[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+static const int NEIGHBOUR_Y[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+
+bool Autopilot_Init(Autopilot* pilot, float west, float north, float width, float height, float cellSize, int maxClouds, int maxGoals) {
+	memset(pilot, 0, sizeof * pilot);
+	pilot->west = west;
+	pilot->north = north;
+	pilot->cellSize = cellSize;
+	pilot->cols = (int)ceilf(width / cellSize);
+	pilot->rows = (int)ceilf(height / cellSize);
+	pilot->cols = (pilot->cols < 1) ? 1 : pilot->cols;
+	pilot->rows = (pilot->rows < 1) ? 1 : pilot->rows;
+	int cells = pilot->cols * pilot->rows;
+	pilot->heapCapacity = 9 * cells; //every seed, then a push per cost that went down, at most once per neighbour
+	pilot->blocked = calloc(cells, sizeof * pilot->blocked);
+	pilot->penalty = calloc(cells, sizeof * pilot->penalty);
+	pilot->cost = malloc(cells * sizeof * pilot->cost);
+	pilot->source = malloc(cells * sizeof * pilot->source);
+	pilot->region = malloc(cells * sizeof * pilot->region);
+	pilot->heap = malloc((size_t)pilot->heapCapacity * 2 * sizeof * pilot->heap);
+	pilot->clouds = malloc(maxClouds * sizeof * pilot->clouds);
+	pilot->goals = malloc(maxGoals * sizeof * pilot->goals);
+	pilot->removed = malloc(maxGoals * sizeof * pilot->removed);
+	if (!pilot->blocked || !pilot->penalty || !pilot->cost || !pilot->source || !pilot->region || !pilot->heap
+		|| !pilot->clouds || !pilot->goals || !pilot->removed) {
+		Autopilot_Free(pilot);
+		return false;
+	}
+	pilot->cloudCapacity = maxClouds;
+	pilot->goalCapacity = maxGoals;
+	pilot->cloudsChanged = true;
+	return true;
+}
+
+void Autopilot_Free(Autopilot* pilot) {
+	free(pilot->blocked);
+	free(pilot->penalty);
+	free(pilot->cost);
+	free(pilot->source);
+	free(pilot->region);
+	free(pilot->heap);
+	free(pilot->clouds);
+	free(pilot->goals);
+	free(pilot->removed);
+	memset(pilot, 0, sizeof * pilot);
+}
+
+void Autopilot_SetClouds(Autopilot* pilot, const Cloud* clouds, int count, float widthScalar, float heightScalar, float margin) {
+	pilot->cloudCount = (count < pilot->cloudCapacity) ? count : pilot->cloudCapacity;
+	for (int i = 0; i < pilot->cloudCount; i++) {
+		TextureRect texture = CLOUD_TEXTURE_POSITIONS[clouds[i].img_id];
+		pilot->clouds[i].x = clouds[i].x + clouds[i].size * texture.w / 2;
+		pilot->clouds[i].y = clouds[i].y + clouds[i].size * texture.h / 2;
+		pilot->clouds[i].a = clouds[i].size * texture.w * widthScalar / 2;
+		pilot->clouds[i].b = clouds[i].size * texture.h * heightScalar / 2;
+	}
+	pilot->margin = margin;
+	pilot->cloudsChanged = true;
+}
+
+void Autopilot_ClearGoals(Autopilot* pilot) {
+	pilot->goalCount = 0;
+	pilot->activeGoals = 0;
+	pilot->removedCount = 0;
+	pilot->goalsChanged = true;
+}
+
+int Autopilot_AddGoal(Autopilot* pilot, float x, float y) {
+	if (pilot->goalCount >= pilot->goalCapacity) return -1;
+	AutopilotGoal goal = { x, y, true };
+	pilot->goals[pilot->goalCount] = goal;
+	pilot->activeGoals++;
+	pilot->goalsChanged = true;
+	return pilot->goalCount++;
+}
+
+void Autopilot_RemoveGoal(Autopilot* pilot, int goal) {
+	if (goal < 0 || goal >= pilot->goalCount || !pilot->goals[goal].active) return;
+	pilot->goals[goal].active = false;
+	pilot->activeGoals--;
+	if (!pilot->goalsChanged) pilot->removed[pilot->removedCount++] = goal; //a whole rebuild is coming anyway otherwise
+}
+
+static int cellOf(const Autopilot* pilot, float x, float y) {
+	int col = (int)floorf((x - pilot->west) / pilot->cellSize);
+	int row = (int)floorf((y - pilot->north) / pilot->cellSize);
+	col = (col < 0) ? 0 : (col >= pilot->cols) ? pilot->cols - 1 : col;
+	row = (row < 0) ? 0 : (row >= pilot->rows) ? pilot->rows - 1 : row;
+	return row * pilot->cols + col;
+}
+
+/* * * * * * * * * *
+* WALLS AND ROOM   *
+* * * * * * * * * */
+//A cell is a wall if its center is inside a hit shape grown by half its diagonal, so a path
+//between open cell centers never cuts a corner of a cloud.
+static void rasterizeClouds(Autopilot* pilot) {
+	memset(pilot->blocked, 0, (size_t)pilot->cols * pilot->rows);
+	float grow = pilot->margin + pilot->cellSize * 0.7071f;
+	for (int i = 0; i < pilot->cloudCount; i++) {
+		AutopilotCloud cloud = pilot->clouds[i];
+		float reach = fmaxf(cloud.a, cloud.b) + grow;
+		int c0 = (int)floorf((cloud.x - reach - pilot->west) / pilot->cellSize);
+		int c1 = (int)floorf((cloud.x + reach - pilot->west) / pilot->cellSize);
+		int r0 = (int)floorf((cloud.y - reach - pilot->north) / pilot->cellSize);
+		int r1 = (int)floorf((cloud.y + reach - pilot->north) / pilot->cellSize);
+		c0 = (c0 < 0) ? 0 : c0;
+		r0 = (r0 < 0) ? 0 : r0;
+		c1 = (c1 >= pilot->cols) ? pilot->cols - 1 : c1;
+		r1 = (r1 >= pilot->rows) ? pilot->rows - 1 : r1;
+		for (int row = r0; row <= r1; row++) {
+			for (int col = c0; col <= c1; col++) {
+				float x = pilot->west + (col + 0.5f) * pilot->cellSize - cloud.x;
+				float y = pilot->north + (row + 0.5f) * pilot->cellSize - cloud.y;
+				if (Collision_PointInCloud(x, y, cloud.a, cloud.b, grow)) pilot->blocked[row * pilot->cols + col] = 1;
+			}
+		}
+	}
+}
+
+//Two pass chamfer distance to the nearest wall, in tenths of a cell, into cost as scratch.
+static void measureClearance(Autopilot* pilot) {
+	int cols = pilot->cols, rows = pilot->rows;
+	int* d = pilot->cost;
+	for (int i = 0; i < cols * rows; i++) d[i] = pilot->blocked[i] ? 0 : INT_MAX / 2;
+	for (int row = 0; row < rows; row++) {
+		for (int col = 0; col < cols; col++) {
+			int* c = &d[row * cols + col];
+			if (col > 0 && c[-1] + AUTOPILOT_STRAIGHT < *c) *c = c[-1] + AUTOPILOT_STRAIGHT;
+			if (row > 0 && c[-cols] + AUTOPILOT_STRAIGHT < *c) *c = c[-cols] + AUTOPILOT_STRAIGHT;
+			if (row > 0 && col > 0 && c[-cols - 1] + AUTOPILOT_DIAGONAL < *c) *c = c[-cols - 1] + AUTOPILOT_DIAGONAL;
+			if (row > 0 && col < cols - 1 && c[-cols + 1] + AUTOPILOT_DIAGONAL < *c) *c = c[-cols + 1] + AUTOPILOT_DIAGONAL;
+		}
+	}
+	for (int row = rows - 1; row >= 0; row--) {
+		for (int col = cols - 1; col >= 0; col--) {
+			int* c = &d[row * cols + col];
+			if (col < cols - 1 && c[1] + AUTOPILOT_STRAIGHT < *c) *c = c[1] + AUTOPILOT_STRAIGHT;
+			if (row < rows - 1 && c[cols] + AUTOPILOT_STRAIGHT < *c) *c = c[cols] + AUTOPILOT_STRAIGHT;
+			if (row < rows - 1 && col < cols - 1 && c[cols + 1] + AUTOPILOT_DIAGONAL < *c) *c = c[cols + 1] + AUTOPILOT_DIAGONAL;
+			if (row < rows - 1 && col > 0 && c[cols - 1] + AUTOPILOT_DIAGONAL < *c) *c = c[cols - 1] + AUTOPILOT_DIAGONAL;
+		}
+	}
+	for (int i = 0; i < cols * rows; i++) pilot->penalty[i] = (unsigned char)((d[i] < AUTOPILOT_CLEARANCE) ? AUTOPILOT_CLEARANCE - d[i] : 0);
+}
+
+/* * * * * * * * * *
+* COST TO A GOAL   *
+* * * * * * * * * */
+static void heapPush(Autopilot* pilot, int cost, int cell) {
+	if (pilot->heapCount == pilot->heapCapacity) return; //can't happen, see Init
+	int* h = pilot->heap;
+	int i = pilot->heapCount++;
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+		if (h[2 * parent] <= cost) break;
+		h[2 * i] = h[2 * parent];
+		h[2 * i + 1] = h[2 * parent + 1];
+		i = parent;
+	}
+	h[2 * i] = cost;
+	h[2 * i + 1] = cell;
+}
+
+static void heapPop(Autopilot* pilot, int* cost, int* cell) {
+	int* h = pilot->heap;
+	*cost = h[0];
+	*cell = h[1];
+	int lastCost = h[2 * --pilot->heapCount];
+	int lastCell = h[2 * pilot->heapCount + 1];
+	int i = 0;
+	for (;;) {
+		int child = 2 * i + 1;
+		if (child >= pilot->heapCount) break;
+		if (child + 1 < pilot->heapCount && h[2 * (child + 1)] < h[2 * child]) child++;
+		if (h[2 * child] >= lastCost) break;
+		h[2 * i] = h[2 * child];
+		h[2 * i + 1] = h[2 * child + 1];
+		i = child;
+	}
+	h[2 * i] = lastCost;
+	h[2 * i + 1] = lastCell;
+}
+
+//Neighbour k of cell, or -1 if it's off the grid or a diagonal that squeezes between two walls.
+//Whether the neighbour is a wall itself is up to the caller: a plane may leave one, not enter.
+static int neighbour(const Autopilot* pilot, int cell, int k) {
+	int col = cell % pilot->cols + NEIGHBOUR_X[k];
+	int row = cell / pilot->cols + NEIGHBOUR_Y[k];
+	if (col < 0 || col >= pilot->cols || row < 0 || row >= pilot->rows) return -1;
+	if (k >= 4 && (pilot->blocked[cell + NEIGHBOUR_X[k]] || pilot->blocked[cell + NEIGHBOUR_Y[k] * pilot->cols])) return -1;
+	return row * pilot->cols + col;
+}
+
+//Dijkstra from whatever is in the heap. Stale entries, pushed before a cheaper way was found, are skipped.
+static void relax(Autopilot* pilot) {
+	while (pilot->heapCount) {
+		int cost, cell;
+		heapPop(pilot, &cost, &cell);
+		if (cost > pilot->cost[cell]) continue;
+		for (int k = 0; k < 8; k++) {
+			int next = neighbour(pilot, cell, k);
+			if (next < 0 || pilot->blocked[next]) continue;
+			int nextCost = cost + ((k < 4) ? AUTOPILOT_STRAIGHT : AUTOPILOT_DIAGONAL) + pilot->penalty[next];
+			if (nextCost >= pilot->cost[next]) continue;
+			pilot->cost[next] = nextCost;
+			pilot->source[next] = pilot->source[cell];
+			heapPush(pilot, nextCost, next);
+		}
+	}
+}
+
+static void seed(Autopilot* pilot, int cell, int source) {
+	pilot->cost[cell] = 0;
+	pilot->source[cell] = source;
+	heapPush(pilot, 0, cell);
+}
+
+static void integrate(Autopilot* pilot) {
+	int cells = pilot->cols * pilot->rows;
+	for (int i = 0; i < cells; i++) pilot->cost[i] = INT_MAX;
+	memset(pilot->source, 0xff, cells * sizeof * pilot->source); //-1
+	pilot->heapCount = 0;
+	if (pilot->activeGoals) {
+		for (int i = 0; i < pilot->goalCount; i++) {
+			if (pilot->goals[i].active) seed(pilot, cellOf(pilot, pilot->goals[i].x, pilot->goals[i].y), i);
+		}
+	} else {
+		//nothing to collect, head for the nearest edge and a new world
+		for (int i = 0; i < cells; i++) {
+			int col = i % pilot->cols, row = i / pilot->cols;
+			if (col == 0 || row == 0 || col == pilot->cols - 1 || row == pilot->rows - 1) seed(pilot, i, -1);
+		}
+	}
+	relax(pilot);
+}
+
+/***
+* Only the cells whose cost led to the collected coin get worse; the rest are already as
+* cheap as the remaining coins make them. So the coin's basin is cut out by a flood fill,
+* each of its cells takes the best offer from a neighbour outside it, and Dijkstra runs on
+* from those: the work is the basin's size, not the world's.
+***/
+static void repair(Autopilot* pilot, int goal) {
+	int start = cellOf(pilot, pilot->goals[goal].x, pilot->goals[goal].y);
+	if (pilot->source[start] != goal) return; //another coin in the same cell got there first, this one owns nothing
+	int count = 0;
+	pilot->region[count++] = start;
+	pilot->source[start] = -2; //in the region, so it isn't added twice
+	for (int i = 0; i < count; i++) {
+		for (int k = 0; k < 8; k++) {
+			int col = pilot->region[i] % pilot->cols + NEIGHBOUR_X[k];
+			int row = pilot->region[i] / pilot->cols + NEIGHBOUR_Y[k];
+			if (col < 0 || col >= pilot->cols || row < 0 || row >= pilot->rows) continue;
+			int next = row * pilot->cols + col;
+			if (pilot->source[next] != goal) continue;
+			pilot->source[next] = -2;
+			pilot->region[count++] = next;
+		}
+	}
+	for (int i = 0; i < count; i++) pilot->cost[pilot->region[i]] = INT_MAX;
+
+	pilot->heapCount = 0;
+	//a coin still left inside the region starts from 0 again
+	for (int i = 0; i < pilot->goalCount; i++) {
+		int cell = cellOf(pilot, pilot->goals[i].x, pilot->goals[i].y);
+		if (pilot->goals[i].active && pilot->source[cell] == -2) seed(pilot, cell, i);
+	}
+	for (int i = 0; i < count; i++) {
+		int cell = pilot->region[i];
+		if (pilot->cost[cell] == 0 || pilot->blocked[cell]) continue; //seeded, or a wall nothing enters
+		int best = INT_MAX, bestSource = -1;
+		for (int k = 0; k < 8; k++) {
+			//the step from outside in is the reverse of this one, and just as allowed
+			int from = neighbour(pilot, cell, k);
+			if (from < 0 || pilot->source[from] == -2 || pilot->cost[from] == INT_MAX) continue;
+			int offer = pilot->cost[from] + ((k < 4) ? AUTOPILOT_STRAIGHT : AUTOPILOT_DIAGONAL) + pilot->penalty[cell];
+			if (offer < best) {
+				best = offer;
+				bestSource = pilot->source[from];
+			}
+		}
+		pilot->cost[cell] = best;
+		pilot->source[cell] = bestSource;
+		if (best != INT_MAX) heapPush(pilot, best, cell);
+	}
+	//walls in the region that no offer reached
+	for (int i = 0; i < count; i++) {
+		if (pilot->source[pilot->region[i]] == -2) pilot->source[pilot->region[i]] = -1;
+	}
+	relax(pilot);
+}
+
+AutopilotUpdate Autopilot_Update(Autopilot* pilot) {
+	if (!pilot->cost) return AUTOPILOT_IDLE;
+	if (pilot->cloudsChanged) {
+		rasterizeClouds(pilot);
+		measureClearance(pilot);
+		pilot->cloudsChanged = false;
+		pilot->goalsChanged = true;
+	}
+	if (pilot->goalsChanged || (pilot->removedCount && !pilot->activeGoals)) {
+		integrate(pilot);
+		pilot->goalsChanged = false;
+		pilot->removedCount = 0;
+		return AUTOPILOT_REBUILT;
+	}
+	if (!pilot->removedCount) return AUTOPILOT_IDLE;
+	for (int i = 0; i < pilot->removedCount; i++) repair(pilot, pilot->removed[i]);
+	pilot->removedCount = 0;
+	return AUTOPILOT_REPAIRED;
+}
+
+/* * * * * * * *
+* FOLLOWING   *
+* * * * * * * */
+//Toward the cheapest neighbour. An edge cell that is a goal itself points out of the world.
+static bool cellFlow(const Autopilot* pilot, int cell, float* dx, float* dy) {
+	int cost = pilot->cost[cell];
+	if (cost == INT_MAX) return false;
+	if (cost == 0 && pilot->source[cell] == -1) {
+		int col = cell % pilot->cols, row = cell / pilot->cols;
+		*dx = (float)((col == pilot->cols - 1) - (col == 0));
+		*dy = (float)((row == pilot->rows - 1) - (row == 0));
+		return *dx || *dy;
+	}
+	int best = cost, bestK = -1;
+	for (int k = 0; k < 8; k++) {
+		int next = neighbour(pilot, cell, k);
+		if (next >= 0 && !pilot->blocked[next] && pilot->cost[next] < best) {
+			best = pilot->cost[next];
+			bestK = k;
+		}
+	}
+	if (bestK < 0) return false;
+	float length = (bestK < 4) ? 1 : 0.7071f;
+	*dx = NEIGHBOUR_X[bestK] * length;
+	*dy = NEIGHBOUR_Y[bestK] * length;
+	return true;
+}
+
+//The flows of the four nearest cell centers, blended by distance, so the way turns smoothly
+//from cell to cell. Next to a coin, straight at it.
+bool Autopilot_Direction(Autopilot* pilot, float x, float y, float* dx, float* dy) {
+	Autopilot_Update(pilot);
+	int here = cellOf(pilot, x, y);
+	int goal = pilot->source[here];
+	if (goal >= 0 && pilot->cost[here] <= 2 * AUTOPILOT_STRAIGHT) {
+		float toX = pilot->goals[goal].x - x;
+		float toY = pilot->goals[goal].y - y;
+		float length = sqrtf(toX * toX + toY * toY);
+		if (length > 0) {
+			*dx = toX / length;
+			*dy = toY / length;
+			return true;
+		}
+	}
+
+	float fx = (x - pilot->west) / pilot->cellSize - 0.5f;
+	float fy = (y - pilot->north) / pilot->cellSize - 0.5f;
+	int col0 = (int)floorf(fx), row0 = (int)floorf(fy);
+	float tx = fx - col0, ty = fy - row0;
+	float sumX = 0, sumY = 0;
+	for (int corner = 0; corner < 4; corner++) {
+		int col = col0 + (corner & 1), row = row0 + (corner >> 1);
+		if (col < 0 || col >= pilot->cols || row < 0 || row >= pilot->rows) continue;
+		float weight = ((corner & 1) ? tx : 1 - tx) * ((corner >> 1) ? ty : 1 - ty);
+		float flowX, flowY;
+		if (weight > 0 && cellFlow(pilot, row * pilot->cols + col, &flowX, &flowY)) {
+			sumX += flowX * weight;
+			sumY += flowY * weight;
+		}
+	}
+	float length = sqrtf(sumX * sumX + sumY * sumY);
+	if (length < 1e-4f) return false;
+	*dx = sumX / length;
+	*dy = sumY / length;
+	return true;
+}
+
+int Autopilot_Steer(Autopilot* pilot, float x, float y, float headingX, float headingY, float speed, float rotationAngle, float increment, float cap) {
+	float toX, toY;
+	float aheadX = x + headingX * speed * AUTOPILOT_LOOKAHEAD;
+	float aheadY = y + headingY * speed * AUTOPILOT_LOOKAHEAD;
+	if (!Autopilot_Direction(pilot, aheadX, aheadY, &toX, &toY) && !Autopilot_Direction(pilot, x, y, &toX, &toY)) return 0;
+
+	//positive is the way a positive rotationAngle turns the heading
+	float error = atan2f(headingX * toY - headingY * toX, headingX * toX + headingY * toY);
+	float wanted = fminf(fmaxf(error * AUTOPILOT_GAIN, -cap), cap);
+	float options[3] = { fmaxf(rotationAngle - increment, -cap), 0, fminf(rotationAngle + increment, cap) };
+	int key = 0;
+	for (int k = -1; k <= 1; k += 2) {
+		if (fabsf(options[k + 1] - wanted) < fabsf(options[key + 1] - wanted)) key = k;
+	}
+	return key;
+}
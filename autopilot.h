@@ -0,0 +1,83 @@
+//---------------------------------------------------------
+// file:	autopilot.h
+//
+// brief:	Flow field navigator for planes nobody is holding
+//			the keys of: the pause menu's attract mode and the
+//			server's bots. A coarse grid over the Bounds world
+//			holds every cell's cost to reach the nearest coin
+//			around the clouds, and Steer turns the way down it
+//			into the left/right keys a player would press.
+//---------------------------------------------------------
+#pragma once
+
+#include "world.h"
+#include <stdbool.h>
+
+typedef enum {
+	AUTOPILOT_IDLE, //nothing changed
+	AUTOPILOT_REPAIRED, //coins were collected, only the cells that led to them were redone
+	AUTOPILOT_REBUILT //new clouds or coins, the whole grid was redone
+} AutopilotUpdate;
+
+typedef struct {
+	float x, y; //center, world units
+	float a, b; //semi-axes of the collision ellipse
+} AutopilotCloud;
+
+typedef struct {
+	float x, y;
+	bool active;
+} AutopilotGoal;
+
+/***
+* The world only changes through SetClouds, ClearGoals/AddGoal and RemoveGoal, which just
+* note what changed; the next Update or Steer does the work. New clouds or coins mean a new
+* world and redo the whole grid, a collected coin only redoes the cells that were heading
+* for it. With no coins left, the way out of the world is the goal, through the edge that
+* warps in a new one.
+*
+* cost holds each cell's distance in tenths of a cell, with extra for passing close to a
+* cloud so the plane leaves itself room to turn.
+***/
+typedef struct {
+	float west, north; //world position of cell (0, 0)
+	float cellSize;
+	int cols, rows;
+	unsigned char* blocked; //cell center inside a hit shape, grown by half a cell
+	unsigned char* penalty; //added to every step into the cell, for how close it is to a cloud
+	int* cost; //to the nearest goal, INT_MAX where none is reachable
+	int* source; //goal the cost leads to, -1 for the world's edge
+	int* heap; //binary min heap of (cost, cell) pairs, a cell may be in it more than once
+	int heapCount, heapCapacity; //pairs
+	int* region; //scratch for RemoveGoal's repair
+
+	AutopilotCloud* clouds;
+	int cloudCount, cloudCapacity;
+	float margin;
+	AutopilotGoal* goals;
+	int goalCount, goalCapacity, activeGoals;
+	int* removed; //goals collected since the last Update
+	int removedCount;
+	bool cloudsChanged, goalsChanged;
+} Autopilot;
+
+bool Autopilot_Init(Autopilot* pilot, float west, float north, float width, float height, float cellSize, int maxClouds, int maxGoals);
+void Autopilot_Free(Autopilot* pilot);
+
+//The clouds' hit shapes, as the collision loop sees them.
+void Autopilot_SetClouds(Autopilot* pilot, const Cloud* clouds, int count, float widthScalar, float heightScalar, float margin);
+//A new set of coins: clear, then add each. Goals are numbered from 0 in the order they're added.
+void Autopilot_ClearGoals(Autopilot* pilot);
+int Autopilot_AddGoal(Autopilot* pilot, float x, float y);
+void Autopilot_RemoveGoal(Autopilot* pilot, int goal);
+
+AutopilotUpdate Autopilot_Update(Autopilot* pilot);
+//The way to fly from (x, y), a unit vector. False when there is none, inside a wall of clouds.
+bool Autopilot_Direction(Autopilot* pilot, float x, float y, float* dx, float* dy);
+/***
+* Which key to hold this frame, -1 left, 1 right or 0 neither, for a plane at (x, y) flying
+* along heading at speed. Holding a key moves rotationAngle by increment, letting go snaps
+* it back to 0, and a turn is never sharper than cap: the key picked is the one that brings
+* rotationAngle closest to the turn the flow asks for.
+***/
+int Autopilot_Steer(Autopilot* pilot, float x, float y, float headingX, float headingY, float speed, float rotationAngle, float increment, float cap);
@@ -0,0 +1,66 @@
+//---------------------------------------------------------
+// file:	camera.c
+//
+// brief:	World to screen transform with zoom and shake
+//			(see camera.h).
+//---------------------------------------------------------
+
+#include "camera.h"
+
+#define CAMERA_TRAUMA_DECAY 0.03f //trauma lost per frame, a full shake settles in about half a second
+
+//xorshift32, the shake runs on the simulation thread and is no business of CP_Random's
+static float shakeRandom(Camera* camera) {
+	camera->rng ^= camera->rng << 13;
+	camera->rng ^= camera->rng >> 17;
+	camera->rng ^= camera->rng << 5;
+	return (float)(camera->rng >> 8) / (float)(1 << 23) - 1; //-1 to 1
+}
+
+void Camera_Init(Camera* camera, float viewWidth, float viewHeight) {
+	camera->x = viewWidth / 2;
+	camera->y = viewHeight / 2;
+	camera->zoom = 1;
+	camera->viewWidth = viewWidth;
+	camera->viewHeight = viewHeight;
+	camera->trauma = 0;
+	camera->shakeX = 0;
+	camera->shakeY = 0;
+	camera->rng = 0x9E3779B9u;
+}
+
+void Camera_Shake(Camera* camera, float trauma) {
+	camera->trauma += trauma;
+	camera->trauma = (camera->trauma > 1) ? 1 : camera->trauma;
+}
+
+void Camera_Update(Camera* camera, float x, float y, float zoom, float amplitude) {
+	camera->x = x;
+	camera->y = y;
+	camera->zoom = (zoom > 0) ? zoom : 1;
+	float offset = amplitude * camera->trauma * camera->trauma;
+	camera->shakeX = offset * shakeRandom(camera);
+	camera->shakeY = offset * shakeRandom(camera);
+	camera->trauma -= CAMERA_TRAUMA_DECAY;
+	camera->trauma = (camera->trauma < 0) ? 0 : camera->trauma;
+}
+
+DrawTransform Camera_Transform(const Camera* camera) {
+	DrawTransform transform;
+	transform.scale = camera->zoom;
+	transform.offsetX = camera->viewWidth / 2 + camera->shakeX - camera->x * camera->zoom;
+	transform.offsetY = camera->viewHeight / 2 + camera->shakeY - camera->y * camera->zoom;
+	return transform;
+}
+
+void Camera_ToScreen(const Camera* camera, float x, float y, float* screenX, float* screenY) {
+	*screenX = (x - camera->x) * camera->zoom + camera->viewWidth / 2 + camera->shakeX;
+	*screenY = (y - camera->y) * camera->zoom + camera->viewHeight / 2 + camera->shakeY;
+}
+
+void Camera_ViewRect(const Camera* camera, float* left, float* top, float* width, float* height) {
+	*width = camera->viewWidth / camera->zoom;
+	*height = camera->viewHeight / camera->zoom;
+	*left = camera->x - *width / 2;
+	*top = camera->y - *height / 2;
+}
@@ -0,0 +1,40 @@
+//---------------------------------------------------------
+// file:	camera.h
+//
+// brief:	Where the view looks in the world. Everything in
+//			the world is drawn at its world position, and the
+//			camera's one transform, applied by the draw list
+//			around the world layers, turns that into screen
+//			pixels. Zoom and screen shake are part of the
+//			transform, so no draw does any math for them.
+//---------------------------------------------------------
+#pragma once
+
+#include "drawlist.h"
+#include <stdint.h>
+
+/***
+* Shake is trauma from 0 to 1: a hit adds to it, it wears off by itself, and the view moves
+* by the square of it times the shake amplitude, so small knocks barely show and big ones
+* rattle. The offset is only in the transform, x and y stay where the camera follows.
+***/
+typedef struct {
+	float x, y; //world point at the center of the view
+	float zoom; //screen pixels per world pixel
+	float viewWidth, viewHeight; //screen pixels
+	float trauma;
+	float shakeX, shakeY; //this frame's offset, screen pixels
+	uint32_t rng;
+} Camera;
+
+void Camera_Init(Camera* camera, float viewWidth, float viewHeight);
+void Camera_Shake(Camera* camera, float trauma);
+//Once a frame: look at (x, y) at zoom, and move the shake on a frame. amplitude is the offset
+//at full trauma, screen pixels, 0 never shakes.
+void Camera_Update(Camera* camera, float x, float y, float zoom, float amplitude);
+
+//For DrawList_SetCamera: screen = world * scale + offset.
+DrawTransform Camera_Transform(const Camera* camera);
+void Camera_ToScreen(const Camera* camera, float x, float y, float* screenX, float* screenY);
+//The world rect on screen, shake aside.
+void Camera_ViewRect(const Camera* camera, float* left, float* top, float* width, float* height);
@@ -0,0 +1,224 @@
+//---------------------------------------------------------
+// file:	checkpoint.c
+//
+// brief:	Checkpoint writer thread (see checkpoint.h).
+//---------------------------------------------------------
+
+#include "checkpoint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+typedef CRITICAL_SECTION Lock;
+typedef CONDITION_VARIABLE Condition;
+#define THREAD_RESULT DWORD WINAPI
+static void lockCreate(Lock* lock) { InitializeCriticalSection(lock); }
+static void lockEnter(Lock* lock) { EnterCriticalSection(lock); }
+static void lockLeave(Lock* lock) { LeaveCriticalSection(lock); }
+static void lockFree(Lock* lock) { DeleteCriticalSection(lock); }
+static void conditionCreate(Condition* condition) { InitializeConditionVariable(condition); }
+static void conditionWait(Condition* condition, Lock* lock) { SleepConditionVariableCS(condition, lock, INFINITE); }
+static void conditionSignal(Condition* condition) { WakeConditionVariable(condition); }
+static void conditionFree(Condition* condition) { (void)condition; }
+static FILE* openFile(const char* path, const char* mode) {
+	FILE* file = NULL;
+	return (fopen_s(&file, path, mode) == 0) ? file : NULL;
+}
+static void syncFile(FILE* file) { _commit(_fileno(file)); }
+static bool replaceFile(const char* from, const char* to) { return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0; }
+#else
+#include <pthread.h>
+#include <unistd.h>
+typedef pthread_mutex_t Lock;
+typedef pthread_cond_t Condition;
+#define THREAD_RESULT void*
+static void lockCreate(Lock* lock) { pthread_mutex_init(lock, NULL); }
+static void lockEnter(Lock* lock) { pthread_mutex_lock(lock); }
+static void lockLeave(Lock* lock) { pthread_mutex_unlock(lock); }
+static void lockFree(Lock* lock) { pthread_mutex_destroy(lock); }
+static void conditionCreate(Condition* condition) { pthread_cond_init(condition, NULL); }
+static void conditionWait(Condition* condition, Lock* lock) { pthread_cond_wait(condition, lock); }
+static void conditionSignal(Condition* condition) { pthread_cond_signal(condition); }
+static void conditionFree(Condition* condition) { pthread_cond_destroy(condition); }
+static FILE* openFile(const char* path, const char* mode) { return fopen(path, mode); }
+static void syncFile(FILE* file) { fsync(fileno(file)); }
+static bool replaceFile(const char* from, const char* to) { return rename(from, to) == 0; }
+#endif
+
+static const char MAGIC[4] = { 'H', 'A', 'C', 'P' };
+
+typedef enum {
+	CHECKPOINT_IDLE,
+	CHECKPOINT_SAVE,
+	CHECKPOINT_DISCARD
+} CheckpointJob;
+
+typedef struct {
+	unsigned char* data;
+	int size, capacity;
+} Buffer;
+
+/***
+* The game fills pending under the lock; the writer swaps it with its own buffer and
+* writes outside the lock. So a save costs the game one copy, and the lock is never
+* held across the disk.
+***/
+static struct {
+	bool started;
+	bool running;
+	char path[260];
+	char tempPath[268];
+	Lock lock;
+	Condition wake;
+	CheckpointJob job;
+	Buffer pending;
+	Buffer writing;
+#ifdef _WIN32
+	HANDLE thread;
+#else
+	pthread_t thread;
+#endif
+} writer;
+
+static uint32_t checksum(const unsigned char* data, int size) {
+	uint32_t hash = 2166136261u;
+	for (int i = 0; i < size; i++) hash = (hash ^ data[i]) * 16777619u;
+	return hash;
+}
+
+/* * * * * * *
+* WRITER    *
+* * * * * * */
+static void writeCheckpoint(const Buffer* buffer) {
+	//write a new file next to the old one and swap it in, never touching the old one in place
+	FILE* file = openFile(writer.tempPath, "wb");
+	if (!file) return;
+	CheckpointHeader header;
+	memcpy(header.magic, MAGIC, sizeof MAGIC);
+	header.version = CHECKPOINT_VERSION;
+	header.size = (uint32_t)buffer->size;
+	header.checksum = checksum(buffer->data, buffer->size);
+	bool ok = fwrite(&header, sizeof header, 1, file) == 1 && fwrite(buffer->data, 1, buffer->size, file) == (size_t)buffer->size;
+	ok = fflush(file) == 0 && ok;
+	syncFile(file); //the contents must be on disk before the name points at them
+	fclose(file);
+	if (!ok || !replaceFile(writer.tempPath, writer.path)) remove(writer.tempPath);
+}
+
+static THREAD_RESULT writerMain(void* param) {
+	(void)param;
+	for (;;) {
+		lockEnter(&writer.lock);
+		while (writer.running && writer.job == CHECKPOINT_IDLE) conditionWait(&writer.wake, &writer.lock);
+		CheckpointJob job = writer.job;
+		writer.job = CHECKPOINT_IDLE;
+		if (job == CHECKPOINT_SAVE) {
+			Buffer swap = writer.writing;
+			writer.writing = writer.pending;
+			writer.pending = swap;
+		}
+		lockLeave(&writer.lock);
+
+		if (job == CHECKPOINT_SAVE) writeCheckpoint(&writer.writing);
+		else if (job == CHECKPOINT_DISCARD) remove(writer.path);
+		else break; //stopped with nothing left to do
+	}
+	return 0;
+}
+
+/* * * * * * *
+* PUBLIC API *
+* * * * * * */
+int Checkpoint_Load(const char* path, void* out, int capacity) {
+	FILE* file = openFile(path, "rb");
+	if (!file) return -1;
+	CheckpointHeader header;
+	int size = -1;
+	if (fread(&header, sizeof header, 1, file) == 1 && !memcmp(header.magic, MAGIC, sizeof MAGIC)
+		&& header.version == CHECKPOINT_VERSION && header.size <= CHECKPOINT_MAX_SIZE && (int)header.size <= capacity
+		&& fread(out, 1, header.size, file) == header.size && header.checksum == checksum(out, (int)header.size)) {
+		size = (int)header.size;
+	}
+	fclose(file);
+	return size;
+}
+
+bool Checkpoint_Start(const char* path) {
+	if (writer.started) return true;
+	size_t length = strlen(path);
+	if (length >= sizeof writer.path) return false;
+	memcpy(writer.path, path, length + 1);
+	snprintf(writer.tempPath, sizeof writer.tempPath, "%s.tmp", path);
+	lockCreate(&writer.lock);
+	conditionCreate(&writer.wake);
+	writer.job = CHECKPOINT_IDLE;
+	writer.running = true;
+#ifdef _WIN32
+	writer.thread = CreateThread(NULL, 0, writerMain, NULL, 0, NULL);
+	bool started = writer.thread != NULL;
+#else
+	bool started = pthread_create(&writer.thread, NULL, writerMain, NULL) == 0;
+#endif
+	if (!started) {
+		writer.running = false;
+		conditionFree(&writer.wake);
+		lockFree(&writer.lock);
+		return false;
+	}
+	writer.started = true;
+	return true;
+}
+
+void Checkpoint_Stop(void) {
+	if (!writer.started) return;
+	lockEnter(&writer.lock);
+	writer.running = false;
+	conditionSignal(&writer.wake);
+	lockLeave(&writer.lock);
+#ifdef _WIN32
+	WaitForSingleObject(writer.thread, INFINITE);
+	CloseHandle(writer.thread);
+#else
+	pthread_join(writer.thread, NULL);
+#endif
+	conditionFree(&writer.wake);
+	lockFree(&writer.lock);
+	free(writer.pending.data);
+	free(writer.writing.data);
+	memset(&writer.pending, 0, sizeof writer.pending);
+	memset(&writer.writing, 0, sizeof writer.writing);
+	writer.started = false;
+}
+
+bool Checkpoint_Save(const void* data, int size) {
+	if (!writer.started || size < 0 || size > CHECKPOINT_MAX_SIZE) return false;
+	lockEnter(&writer.lock);
+	Buffer* pending = &writer.pending;
+	if (pending->capacity < size) {
+		unsigned char* grown = realloc(pending->data, size);
+		if (!grown) {
+			lockLeave(&writer.lock);
+			return false;
+		}
+		pending->data = grown;
+		pending->capacity = size;
+	}
+	memcpy(pending->data, data, size);
+	pending->size = size;
+	writer.job = CHECKPOINT_SAVE;
+	conditionSignal(&writer.wake);
+	lockLeave(&writer.lock);
+	return true;
+}
+
+void Checkpoint_Discard(void) {
+	if (!writer.started) return;
+	lockEnter(&writer.lock);
+	writer.job = CHECKPOINT_DISCARD; //also drops a save that hasn't been written yet
+	conditionSignal(&writer.wake);
+	lockLeave(&writer.lock);
+}
@@ -0,0 +1,38 @@
+//---------------------------------------------------------
+// file:	checkpoint.h
+//
+// brief:	Suspend/resume file for the current run. The game
+//			hands over an encoded snapshot and goes on; a
+//			writer thread puts it on disk with an atomic
+//			replace, so a crash or a kill at any point leaves
+//			either the old checkpoint or the new one.
+//---------------------------------------------------------
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_PATH "checkpoint.bin"
+#define CHECKPOINT_MAX_SIZE (1024 * 1024) //larger files are not a checkpoint of ours
+
+//Written in front of the payload.
+typedef struct {
+	char magic[4]; //"HACP"
+	uint32_t version;
+	uint32_t size; //payload bytes
+	uint32_t checksum; //FNV-1a of the payload
+} CheckpointHeader;
+
+//Read a checkpoint synchronously. Returns the payload size, or -1 if there is no
+//valid checkpoint or it doesn't fit in capacity.
+int Checkpoint_Load(const char* path, void* out, int capacity);
+
+//Start the writer thread for path. Saves and discards are applied in the order made.
+bool Checkpoint_Start(const char* path);
+//Finish the pending save or discard, then stop the thread.
+void Checkpoint_Stop(void);
+//Copy the payload and return; a save still waiting for the writer is replaced by this one.
+bool Checkpoint_Save(const void* data, int size);
+//Delete the checkpoint, e.g. when the run it holds is over.
+void Checkpoint_Discard(void);
@@ -0,0 +1,184 @@
+//---------------------------------------------------------
+// file:	collectibles.c
+//
+// brief:	Grid-indexed collectible store (see collectibles.h).
+//---------------------------------------------------------
+
+#include "collectibles.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define COLLECTIBLES_MAX_K 64
+
+bool Collectibles_Init(CollectibleStore* store, int capacity) {
+	memset(store, 0, sizeof * store);
+	store->items = malloc(capacity * sizeof * store->items);
+	store->cellItems = malloc(capacity * sizeof * store->cellItems);
+	if (!store->items || !store->cellItems) {
+		Collectibles_Free(store);
+		return false;
+	}
+	store->capacity = capacity;
+	return true;
+}
+
+void Collectibles_Free(CollectibleStore* store) {
+	free(store->items);
+	free(store->cellItems);
+	free(store->cellStart);
+	memset(store, 0, sizeof * store);
+}
+
+void Collectibles_Clear(CollectibleStore* store) {
+	store->count = 0;
+	store->remaining = 0;
+}
+
+int Collectibles_Add(CollectibleStore* store, float x, float y) {
+	if (store->count >= store->capacity) return -1;
+	Collectible* c = &store->items[store->count];
+	c->x = x;
+	c->y = y;
+	c->collected = false;
+	store->remaining++;
+	return store->count++;
+}
+
+static int cellOf(const CollectibleStore* store, float x, float y) {
+	int col = (int)floorf((x - store->originX) / store->cellSize);
+	int row = (int)floorf((y - store->originY) / store->cellSize);
+	col = (col < 0) ? 0 : (col >= store->cols) ? store->cols - 1 : col;
+	row = (row < 0) ? 0 : (row >= store->rows) ? store->rows - 1 : row;
+	return row * store->cols + col;
+}
+
+bool Collectibles_Build(CollectibleStore* store, float west, float north, float width, float height, float cellSize) {
+	int cols = (int)ceilf(width / cellSize);
+	int rows = (int)ceilf(height / cellSize);
+	cols = (cols < 1) ? 1 : cols;
+	rows = (rows < 1) ? 1 : rows;
+
+	//the cell table only grows, so rebuilding the same world every wrap never allocates
+	if (cols * rows + 1 > store->cellCapacity) {
+		int* grown = realloc(store->cellStart, (cols * rows + 1) * sizeof * grown);
+		if (!grown) return false;
+		store->cellStart = grown;
+		store->cellCapacity = cols * rows + 1;
+	}
+	store->originX = west;
+	store->originY = north;
+	store->cellSize = cellSize;
+	store->cols = cols;
+	store->rows = rows;
+
+	//counting sort: count per cell, prefix sum into start offsets, then scatter
+	int cells = cols * rows;
+	memset(store->cellStart, 0, (cells + 1) * sizeof * store->cellStart);
+	for (int i = 0; i < store->count; i++) store->cellStart[cellOf(store, store->items[i].x, store->items[i].y) + 1]++;
+	for (int c = 0; c < cells; c++) store->cellStart[c + 1] += store->cellStart[c];
+	for (int i = 0; i < store->count; i++) {
+		int c = cellOf(store, store->items[i].x, store->items[i].y);
+		//cellStart[c] temporarily walks forward as the insert cursor...
+		store->cellItems[store->cellStart[c]++] = i;
+	}
+	//...so shift everything back by one cell to restore the start offsets
+	memmove(store->cellStart + 1, store->cellStart, cells * sizeof * store->cellStart);
+	store->cellStart[0] = 0;
+	return true;
+}
+
+void Collectibles_Collect(CollectibleStore* store, int index) {
+	if (index < 0 || index >= store->count || store->items[index].collected) return;
+	store->items[index].collected = true;
+	store->remaining--;
+}
+
+//Walks the cells covering the rectangle; radius <= 0 keeps everything inside it.
+static int queryCells(CollectibleStore* store, float left, float top, float right, float bottom, float x, float y, float radius, int* out, int maxOut) {
+	if (!store->cellStart || store->count == 0) return 0;
+	int first = cellOf(store, left, top);
+	int last = cellOf(store, right, bottom);
+	int found = 0;
+
+	for (int row = first / store->cols; row <= last / store->cols; row++) {
+		for (int col = first % store->cols; col <= last % store->cols; col++) {
+			int c = row * store->cols + col;
+			for (int k = store->cellStart[c]; k < store->cellStart[c + 1]; k++) {
+				int i = store->cellItems[k];
+				const Collectible* item = &store->items[i];
+				if (item->collected || item->x < left || item->x > right || item->y < top || item->y > bottom) continue;
+				if (radius > 0 && (item->x - x) * (item->x - x) + (item->y - y) * (item->y - y) >= radius * radius) continue;
+				if (found == maxOut) return found;
+				out[found++] = i;
+			}
+		}
+	}
+	return found;
+}
+
+int Collectibles_QueryRect(CollectibleStore* store, float left, float top, float right, float bottom, int* out, int maxOut) {
+	return queryCells(store, left, top, right, bottom, 0, 0, 0, out, maxOut);
+}
+
+int Collectibles_QueryRadius(CollectibleStore* store, float x, float y, float radius, int* out, int maxOut) {
+	return queryCells(store, x - radius, y - radius, x + radius, y + radius, x, y, radius, out, maxOut);
+}
+
+/***
+* Visit the grid in square rings around the query cell, keeping the k best so far.
+* Once the k-th best is closer than anything outside the rings searched so far could be,
+* no further ring can improve the answer.
+***/
+int Collectibles_Nearest(CollectibleStore* store, float x, float y, int k, int* out) {
+	float bestDistance[COLLECTIBLES_MAX_K];
+	int found = 0;
+	k = (k > COLLECTIBLES_MAX_K) ? COLLECTIBLES_MAX_K : k;
+	if (!store->cellStart || store->remaining == 0 || k <= 0) return 0;
+
+	int center = cellOf(store, x, y);
+	int centerCol = center % store->cols;
+	int centerRow = center / store->cols;
+	int maxRing = (store->cols > store->rows) ? store->cols : store->rows;
+
+	for (int ring = 0; ring <= maxRing; ring++) {
+		for (int row = centerRow - ring; row <= centerRow + ring; row++) {
+			if (row < 0 || row >= store->rows) continue;
+			//inner rows of the ring only have their two end cells
+			int step = (row == centerRow - ring || row == centerRow + ring) ? 1 : 2 * ring;
+			for (int col = centerCol - ring; col <= centerCol + ring; col += step) {
+				if (col < 0 || col >= store->cols) continue;
+				int c = row * store->cols + col;
+				for (int s = store->cellStart[c]; s < store->cellStart[c + 1]; s++) {
+					int i = store->cellItems[s];
+					if (store->items[i].collected) continue;
+					float dx = store->items[i].x - x;
+					float dy = store->items[i].y - y;
+					float d = dx * dx + dy * dy;
+					if (found == k && d >= bestDistance[k - 1]) continue;
+
+					//insertion into the sorted best list
+					int slot = (found < k) ? found++ : k - 1;
+					while (slot > 0 && bestDistance[slot - 1] > d) {
+						bestDistance[slot] = bestDistance[slot - 1];
+						out[slot] = out[slot - 1];
+						slot--;
+					}
+					bestDistance[slot] = d;
+					out[slot] = i;
+				}
+			}
+		}
+
+		if (found == k) {
+			//distance from the query point to the edge of the searched square
+			float left = x - (store->originX + (centerCol - ring) * store->cellSize);
+			float right = store->originX + (centerCol + ring + 1) * store->cellSize - x;
+			float top = y - (store->originY + (centerRow - ring) * store->cellSize);
+			float bottom = store->originY + (centerRow + ring + 1) * store->cellSize - y;
+			float edge = fminf(fminf(left, right), fminf(top, bottom));
+			if (edge > 0 && edge * edge >= bestDistance[k - 1]) break;
+		}
+	}
+	return found;
+}
@@ -0,0 +1,53 @@
+//---------------------------------------------------------
+// file:	collectibles.h
+//
+// brief:	Store for many collectibles (coins) in one world,
+//			indexed by a uniform grid so pickup checks and
+//			"k nearest to the player" queries only touch the
+//			cells around the query point.
+//---------------------------------------------------------
+#pragma once
+
+#include <stdbool.h>
+
+typedef struct {
+	float x; //world position of the center
+	float y;
+	bool collected;
+} Collectible;
+
+/***
+* Items are added, then Collectibles_Build sorts them into grid cells (a counting sort
+* into one flat array, so a cell is just a start/end range). Positions never change
+* between builds; collecting an item only flips its flag.
+***/
+typedef struct {
+	Collectible* items;
+	int count;
+	int capacity;
+	int remaining; //not collected yet
+
+	float originX, originY; //world position of cell (0, 0)
+	float cellSize;
+	int cols, rows;
+	int* cellStart; //cols * rows + 1 entries; cell c holds cellItems[cellStart[c] .. cellStart[c + 1])
+	int* cellItems;
+	int cellCapacity;
+} CollectibleStore;
+
+bool Collectibles_Init(CollectibleStore* store, int capacity);
+void Collectibles_Free(CollectibleStore* store);
+
+void Collectibles_Clear(CollectibleStore* store);
+int Collectibles_Add(CollectibleStore* store, float x, float y); //returns the index, or -1 when full
+//Index everything added since the last Clear. cellSize should be around the typical query radius.
+bool Collectibles_Build(CollectibleStore* store, float west, float north, float width, float height, float cellSize);
+
+void Collectibles_Collect(CollectibleStore* store, int index);
+
+//Uncollected items within radius of (x, y). Returns how many were written to out (at most maxOut).
+int Collectibles_QueryRadius(CollectibleStore* store, float x, float y, float radius, int* out, int maxOut);
+//Uncollected items whose centers lie inside the rectangle.
+int Collectibles_QueryRect(CollectibleStore* store, float left, float top, float right, float bottom, int* out, int maxOut);
+//The k nearest uncollected items to (x, y), closest first. Returns how many were found (at most k).
+int Collectibles_Nearest(CollectibleStore* store, float x, float y, int k, int* out);
@@ -0,0 +1,68 @@
+//---------------------------------------------------------
+// file:	collision.c
+//
+// brief:	Swept point vs inflated ellipse (see collision.h).
+//---------------------------------------------------------
+
+#include "collision.h"
+#include <math.h>
+
+#define SWEEP_MIN_STEP 2.0f //pixels; far below the 35px hit margin
+
+bool Collision_PointInCloud(float x, float y, float a, float b, float margin) {
+	/*
+	r = ab / root(a * a * sin^2(theta) + b * b * cos^2(theta))
+	with cos(theta) = x / distance and sin(theta) = y / distance, which
+	lets the angle cancel out instead of going through acos/sin/cos.
+	*/
+	float distanceSquared = x * x + y * y;
+	if (distanceSquared == 0) return true;
+	float radius = a * b * sqrtf(distanceSquared / (a * a * y * y + b * b * x * x));
+	return radius + margin > sqrtf(distanceSquared);
+}
+
+//Lower bound on the distance from a point to the cloud's hit shape.
+//The hit shape always fits inside the ellipse with semi-axes (a + margin, b + margin),
+//and squashing that ellipse into a circle along its long axis never stretches distances,
+//so the distance to that circle can't overshoot the real shape.
+static float distanceLowerBound(float x, float y, float a, float b, float margin) {
+	float outerA = a + margin;
+	float outerB = b + margin;
+	if (outerA >= outerB) {
+		float sx = x * outerB / outerA;
+		return sqrtf(sx * sx + y * y) - outerB;
+	}
+	float sy = y * outerA / outerB;
+	return sqrtf(x * x + sy * sy) - outerA;
+}
+
+float Collision_SweepCloud(float startX, float startY, float endX, float endY, float a, float b, float margin) {
+	float dx = endX - startX;
+	float dy = endY - startY;
+	float lengthSquared = dx * dx + dy * dy;
+
+	//Broad phase: the closest point of the motion to the cloud center has to be inside its bounding circle.
+	float bound = ((a > b) ? a : b) + margin;
+	float closest = (lengthSquared > 0) ? -(startX * dx + startY * dy) / lengthSquared : 0;
+	closest = (closest < 0) ? 0 : (closest > 1) ? 1 : closest;
+	float cx = startX + dx * closest;
+	float cy = startY + dy * closest;
+	if (cx * cx + cy * cy >= bound * bound) return -1;
+
+	if (lengthSquared == 0) return Collision_PointInCloud(startX, startY, a, b, margin) ? 0.0f : -1.0f;
+
+	//Conservative advancement: move forward by a distance the shape is guaranteed to be
+	//at least that far away, so the first hit can't be stepped over. It walks all the way
+	//to the end of the motion; the minimum step bounds that at length / SWEEP_MIN_STEP
+	//points, which a motion grazing the long flat side of a wide cloud can come close to.
+	float length = sqrtf(lengthSquared);
+	float t = 0;
+	while (t < 1) {
+		float x = startX + dx * t;
+		float y = startY + dy * t;
+		if (Collision_PointInCloud(x, y, a, b, margin)) return t;
+		float step = distanceLowerBound(x, y, a, b, margin);
+		t += ((step > SWEEP_MIN_STEP) ? step : SWEEP_MIN_STEP) / length;
+	}
+	return Collision_PointInCloud(endX, endY, a, b, margin) ? 1.0f : -1.0f;
+}
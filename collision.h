@@ -0,0 +1,20 @@
+//---------------------------------------------------------
+// file:	collision.h
+//
+// brief:	Continuous collision between the plane and cloud
+//			ellipses, so fast planes can't skip over clouds.
+//---------------------------------------------------------
+#pragma once
+
+#include <stdbool.h>
+
+/***
+* A cloud's hit shape is the one game_update has always used: the ellipse with semi-axes
+* a and b, pushed outwards along every ray from its center by margin pixels.
+* All positions are relative to the ellipse center.
+***/
+bool Collision_PointInCloud(float x, float y, float a, float b, float margin);
+
+//Sweep a point from (startX, startY) to (endX, endY) against a cloud.
+//Returns the fraction of the motion at which it first hits, or -1 if it never does.
+float Collision_SweepCloud(float startX, float startY, float endX, float endY, float a, float b, float margin);
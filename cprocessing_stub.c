@@ -0,0 +1,119 @@
+//---------------------------------------------------------
+// file:	cprocessing_stub.c
+//
+// brief:	Headless CProcessing for HotAirTests (see
+//			cprocessing_stub.h). HotAirTests is built with
+//			CPROCESSING_EXPORTS, so these are the definitions
+//			cprocessing.h declares rather than imports.
+//---------------------------------------------------------
+
+#include "cprocessing_stub.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+struct CP_Image_Struct {
+	int width, height;
+	CP_Color* pixels;
+};
+
+StubCounts stubCounts;
+
+void Stub_Reset() {
+	memset(&stubCounts, 0, sizeof stubCounts);
+}
+
+/* * * * * * * *
+* SETTINGS *
+* * * * * * * */
+void CP_Settings_Fill(CP_Color c) { (void)c; stubCounts.settings++; }
+void CP_Settings_NoFill(void) { stubCounts.settings++; }
+void CP_Settings_Stroke(CP_Color c) { (void)c; stubCounts.settings++; }
+void CP_Settings_NoStroke(void) { stubCounts.settings++; }
+void CP_Settings_StrokeWeight(float weight) { (void)weight; stubCounts.settings++; }
+void CP_Settings_RectMode(CP_POSITION_MODE mode) { (void)mode; stubCounts.settings++; }
+void CP_Settings_ImageMode(CP_POSITION_MODE mode) { (void)mode; stubCounts.settings++; }
+void CP_Settings_TextSize(float size) { (void)size; stubCounts.settings++; }
+void CP_Settings_TextAlignment(CP_TEXT_ALIGN_HORIZONTAL h, CP_TEXT_ALIGN_VERTICAL v) { (void)h; (void)v; stubCounts.settings++; }
+void CP_Settings_ApplyMatrix(CP_Matrix matrix) { (void)matrix; stubCounts.settings++; stubCounts.matrices++; }
+void CP_Settings_ResetMatrix(void) { stubCounts.settings++; }
+void CP_Settings_Save(void) { stubCounts.settings++; }
+void CP_Settings_Restore(void) { stubCounts.settings++; }
+
+CP_Color CP_Color_Create(int r, int g, int b, int a) {
+	CP_Color c = { { (unsigned char)r, (unsigned char)g, (unsigned char)b, (unsigned char)a } };
+	return c;
+}
+
+CP_Matrix CP_Matrix_Set(float m00, float m01, float m02, float m10, float m11, float m12, float m20, float m21, float m22) {
+	CP_Matrix m = { { { m00, m01, m02 }, { m10, m11, m12 }, { m20, m21, m22 } } };
+	return m;
+}
+
+/* * * * * * * *
+* GRAPHICS *
+* * * * * * * */
+static void drawn(float w, float h) {
+	stubCounts.draws++;
+	stubCounts.pixelsCovered += fabsf(w * h);
+}
+
+void CP_Graphics_DrawRect(float x, float y, float w, float h) { (void)x; (void)y; drawn(w, h); }
+void CP_Graphics_DrawCircle(float x, float y, float d) { (void)x; (void)y; drawn(d, d * 0.785398f); }
+void CP_Graphics_DrawEllipseAdvanced(float x, float y, float w, float h, float degrees) { (void)x; (void)y; (void)degrees; drawn(w, h * 0.785398f); }
+void CP_Graphics_DrawTriangleAdvanced(float x1, float y1, float x2, float y2, float x3, float y3, float degrees) {
+	(void)degrees;
+	drawn(fabsf((x2 - x1) * (y3 - y1) - (x3 - x1) * (y2 - y1)) / 2, 1);
+}
+void CP_Font_DrawText(const char* text, float x, float y) { (void)text; (void)x; (void)y; stubCounts.draws++; }
+
+/* * * * * *
+* IMAGES *
+* * * * * */
+CP_Image CP_Image_CreateFromData(int w, int h, unsigned char* pixelDataInput) {
+	CP_Image image = calloc(1, sizeof * image);
+	if (!image) return NULL;
+	image->pixels = malloc((size_t)w * h * sizeof * image->pixels);
+	if (!image->pixels) {
+		free(image);
+		return NULL;
+	}
+	image->width = w;
+	image->height = h;
+	memcpy(image->pixels, pixelDataInput, (size_t)w * h * sizeof * image->pixels);
+	stubCounts.uploads++;
+	stubCounts.uploadedPixels += (int64_t)w * h;
+	return image;
+}
+
+void CP_Image_Free(CP_Image* img) {
+	if (!*img) return;
+	free((*img)->pixels);
+	free(*img);
+	*img = NULL;
+}
+
+int CP_Image_GetWidth(CP_Image img) { return img->width; }
+int CP_Image_GetHeight(CP_Image img) { return img->height; }
+
+void CP_Image_GetPixelData(CP_Image img, CP_Color* pixelDataOutput) {
+	memcpy(pixelDataOutput, img->pixels, (size_t)img->width * img->height * sizeof * pixelDataOutput);
+}
+
+void CP_Image_UpdatePixelData(CP_Image img, CP_Color* pixelDataInput) {
+	memcpy(img->pixels, pixelDataInput, (size_t)img->width * img->height * sizeof * img->pixels);
+	stubCounts.uploads++;
+	stubCounts.uploadedPixels += (int64_t)img->width * img->height;
+}
+
+void CP_Image_Draw(CP_Image img, float x, float y, float w, float h, int alpha) {
+	(void)x; (void)y; (void)alpha;
+	drawn(w, h);
+	stubCounts.texelsRead += (double)img->width * img->height;
+}
+
+void CP_Image_DrawSubImage(CP_Image img, float x, float y, float w, float h, float u0, float v0, float u1, float v1, int alpha) {
+	(void)img; (void)x; (void)y; (void)alpha;
+	drawn(w, h);
+	stubCounts.texelsRead += fabsf((u1 - u0) * (v1 - v0));
+}
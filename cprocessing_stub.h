@@ -0,0 +1,27 @@
+//---------------------------------------------------------
+// file:	cprocessing_stub.h
+//
+// brief:	CProcessing for HotAirTests: just the calls the
+//			minimap, mip chain, camera and draw list make, so
+//			they run headless. Images are pixel buffers in
+//			memory, everything else only counts itself, which
+//			is what the benchmarks report next to their times.
+//---------------------------------------------------------
+#pragma once
+
+#include "cprocessing.h"
+#include <stdint.h>
+
+typedef struct {
+	int settings; //CP_Settings_* calls
+	int matrices; //...of which CP_Settings_ApplyMatrix
+	int draws; //shapes, images and text
+	int uploads; //images created or updated from pixels
+	int64_t uploadedPixels;
+	double pixelsCovered; //screen area of the rects, ellipses and images drawn
+	double texelsRead; //image area the images were drawn from
+} StubCounts;
+
+extern StubCounts stubCounts;
+
+void Stub_Reset();
@@ -0,0 +1,416 @@
+//---------------------------------------------------------
+// file:	drawlist.c
+//
+// brief:	Sorted per-frame draw command buffer (see drawlist.h).
+//---------------------------------------------------------
+
+#include "drawlist.h"
+#include <stdlib.h>
+#include <string.h>
+
+//key layout, high to low: layer (8 bits), texture (8), state (16), command index (32)
+#define KEY_LAYER_SHIFT 56
+#define KEY_TEXTURE_SHIFT 48
+#define KEY_STATE_SHIFT 32
+#define STATE_SLOTS (DRAW_LIST_MAX_STATES * 2)
+
+bool DrawList_Init(DrawList* list, int capacity) {
+	memset(list, 0, sizeof * list);
+	list->commands = malloc(capacity * sizeof * list->commands);
+	list->keys = malloc(capacity * sizeof * list->keys);
+	list->scratch = malloc(capacity * sizeof * list->scratch);
+	if (!list->commands || !list->keys || !list->scratch) {
+		DrawList_Free(list);
+		return false;
+	}
+	list->capacity = capacity;
+	DrawList_Begin(list, 0, 0);
+	return true;
+}
+
+void DrawList_Free(DrawList* list) {
+	free(list->commands);
+	free(list->keys);
+	free(list->scratch);
+	memset(list, 0, sizeof * list);
+}
+
+void DrawList_Begin(DrawList* list, float viewWidth, float viewHeight) {
+	list->count = 0;
+	list->sorted = false;
+	list->viewWidth = viewWidth;
+	list->viewHeight = viewHeight;
+	list->firstWorldLayer = 1;
+	list->lastWorldLayer = 0;
+	list->textureCount = 0;
+	if (list->stateCount) memset(list->stateSlots, 0, sizeof list->stateSlots);
+	list->stateCount = 0;
+	list->bytesUsed = 0;
+	memset(&list->current, 0, sizeof list->current);
+	list->current.fill.a = 255;
+	list->currentState = -1;
+	memset(&list->stats, 0, sizeof list->stats);
+}
+
+void DrawList_SetCamera(DrawList* list, DrawTransform camera, int firstLayer, int lastLayer) {
+	list->camera = camera;
+	list->firstWorldLayer = firstLayer;
+	list->lastWorldLayer = lastLayer;
+	list->worldLeft = -camera.offsetX / camera.scale;
+	list->worldTop = -camera.offsetY / camera.scale;
+	list->worldRight = (list->viewWidth - camera.offsetX) / camera.scale;
+	list->worldBottom = (list->viewHeight - camera.offsetY) / camera.scale;
+}
+
+static bool inWorld(const DrawList* list, int layer) {
+	return layer >= list->firstWorldLayer && layer <= list->lastWorldLayer;
+}
+
+void DrawList_ViewRect(const DrawList* list, int layer, float* left, float* top, float* right, float* bottom) {
+	bool world = inWorld(list, layer);
+	*left = world ? list->worldLeft : 0;
+	*top = world ? list->worldTop : 0;
+	*right = world ? list->worldRight : list->viewWidth;
+	*bottom = world ? list->worldBottom : list->viewHeight;
+}
+
+/* * * * * * * * *
+* RENDER STATE  *
+* * * * * * * * */
+static int internState(DrawList* list, const DrawState* state) {
+	//FNV-1a over the 16 bytes, the state table is cleared every frame so it never fills with stale entries
+	const unsigned char* bytes = (const unsigned char*)state;
+	uint32_t hash = 2166136261u;
+	for (int i = 0; i < (int)sizeof * state; i++) hash = (hash ^ bytes[i]) * 16777619u;
+	for (int slot = hash & (STATE_SLOTS - 1); ; slot = (slot + 1) & (STATE_SLOTS - 1)) {
+		int index = list->stateSlots[slot] - 1;
+		if (index < 0) {
+			if (list->stateCount == DRAW_LIST_MAX_STATES) return -1;
+			index = list->stateCount++;
+			list->states[index] = *state;
+			list->stateSlots[slot] = (unsigned short)(index + 1);
+			return index;
+		}
+		if (!memcmp(&list->states[index], state, sizeof * state)) return index;
+	}
+}
+
+static int currentState(DrawList* list) {
+	if (list->currentState < 0) {
+		DrawState state = list->current;
+		if (!state.stroke.a) state.strokeWeight = 0; //the weight of a missing stroke doesn't matter
+		list->currentState = internState(list, &state);
+	}
+	return list->currentState;
+}
+
+void DrawList_Fill(DrawList* list, CP_Color color) {
+	if (!memcmp(&list->current.fill, &color, sizeof color)) return;
+	list->current.fill = color;
+	list->currentState = -1;
+}
+
+void DrawList_Stroke(DrawList* list, CP_Color color) {
+	if (!color.a) memset(&color, 0, sizeof color); //an invisible stroke is NoStroke
+	list->current.stroke = color;
+	list->currentState = -1;
+}
+
+void DrawList_NoStroke(DrawList* list) {
+	memset(&list->current.stroke, 0, sizeof list->current.stroke);
+	list->currentState = -1;
+}
+
+void DrawList_StrokeWeight(DrawList* list, float weight) {
+	list->current.strokeWeight = weight;
+	list->currentState = -1;
+}
+
+/* * * * * * *
+* RECORDING *
+* * * * * * */
+static int textureId(DrawList* list, CP_Image image) {
+	//a frame uses a handful of images, the last one found is nearly always the one asked for
+	for (int i = list->textureCount; i > 0; i--) {
+		if (list->textures[i] == image) return i;
+	}
+	if (list->textureCount == DRAW_LIST_MAX_TEXTURES) return -1;
+	list->textures[++list->textureCount] = image;
+	return list->textureCount;
+}
+
+static DrawCommand* record(DrawList* list, int layer, DrawKind kind, int texture, int state) {
+	if (list->count == list->capacity || layer < 0 || layer >= DRAW_LIST_MAX_LAYERS || texture < 0 || state < 0) {
+		list->stats.dropped++;
+		return NULL;
+	}
+	int index = list->count++;
+	list->sorted = false;
+	list->keys[index] = ((uint64_t)layer << KEY_LAYER_SHIFT) | ((uint64_t)texture << KEY_TEXTURE_SHIFT) | ((uint64_t)state << KEY_STATE_SHIFT) | (uint32_t)index;
+	DrawCommand* command = &list->commands[index];
+	command->kind = kind;
+	command->state = state;
+	list->stats.commands++;
+	return command;
+}
+
+static int copyBytes(DrawList* list, const void* data, int size) {
+	int offset = (list->bytesUsed + 7) & ~7; //callback data may hold pointers
+	if (size < 0 || offset + size > DRAW_LIST_BYTES) return -1;
+	memcpy((unsigned char*)list->bytes + offset, data, size);
+	list->bytesUsed = offset + size;
+	return offset;
+}
+
+static bool outsideView(DrawList* list, int layer, float x, float y, float w, float h) {
+	float left, top, right, bottom;
+	DrawList_ViewRect(list, layer, &left, &top, &right, &bottom);
+	if (x + w < left || y + h < top || x > right || y > bottom) {
+		list->stats.commands++;
+		list->stats.culled++;
+		return true;
+	}
+	return false;
+}
+
+void DrawList_Rect(DrawList* list, int layer, float x, float y, float w, float h) {
+	if (outsideView(list, layer, x, y, w, h)) return;
+	DrawCommand* command = record(list, layer, DRAW_RECT, 0, currentState(list));
+	if (!command) return;
+	command->data.shape.x = x;
+	command->data.shape.y = y;
+	command->data.shape.w = w;
+	command->data.shape.h = h;
+	command->data.shape.degrees = 0;
+}
+
+void DrawList_Ellipse(DrawList* list, int layer, float x, float y, float w, float h, float degrees) {
+	DrawCommand* command = record(list, layer, DRAW_ELLIPSE, 0, currentState(list));
+	if (!command) return;
+	command->data.shape.x = x;
+	command->data.shape.y = y;
+	command->data.shape.w = w;
+	command->data.shape.h = h;
+	command->data.shape.degrees = degrees;
+}
+
+void DrawList_Triangle(DrawList* list, int layer, float x1, float y1, float x2, float y2, float x3, float y3, float degrees) {
+	DrawCommand* command = record(list, layer, DRAW_TRIANGLE, 0, currentState(list));
+	if (!command) return;
+	command->data.triangle.x1 = x1;
+	command->data.triangle.y1 = y1;
+	command->data.triangle.x2 = x2;
+	command->data.triangle.y2 = y2;
+	command->data.triangle.x3 = x3;
+	command->data.triangle.y3 = y3;
+	command->data.triangle.degrees = degrees;
+}
+
+void DrawList_SubImage(DrawList* list, int layer, CP_Image image, float x, float y, float w, float h, float u0, float v0, float u1, float v1, int alpha) {
+	if (outsideView(list, layer, x, y, w, h)) return;
+	//images don't use the fill or stroke, so they all share state 0 and sort by texture alone
+	DrawCommand* command = record(list, layer, DRAW_SUB_IMAGE, textureId(list, image), 0);
+	if (!command) return;
+	command->data.image.image = image;
+	command->data.image.x = x;
+	command->data.image.y = y;
+	command->data.image.w = w;
+	command->data.image.h = h;
+	command->data.image.u0 = u0;
+	command->data.image.v0 = v0;
+	command->data.image.u1 = u1;
+	command->data.image.v1 = v1;
+	command->data.image.alpha = alpha;
+}
+
+void DrawList_Image(DrawList* list, int layer, CP_Image image, float x, float y, float w, float h, int alpha) {
+	if (outsideView(list, layer, x, y, w, h)) return;
+	DrawCommand* command = record(list, layer, DRAW_IMAGE, textureId(list, image), 0);
+	if (!command) return;
+	command->data.image.image = image;
+	command->data.image.x = x;
+	command->data.image.y = y;
+	command->data.image.w = w;
+	command->data.image.h = h;
+	command->data.image.alpha = alpha;
+}
+
+void DrawList_Text(DrawList* list, int layer, TextAtlas* atlas, const char* text, float x, float y, float size, CP_Color color) {
+	//the atlas keeps one image per size and color, so the state doubles as the texture here
+	DrawState state = { 0 };
+	state.fill = color;
+	state.textSize = size;
+	int offset = copyBytes(list, text, (int)strlen(text) + 1);
+	DrawCommand* command = record(list, layer, DRAW_TEXT, 0, (offset < 0) ? -1 : internState(list, &state));
+	if (!command) return;
+	command->data.text.atlas = atlas;
+	command->data.text.offset = offset;
+	command->data.text.x = x;
+	command->data.text.y = y;
+	command->data.text.size = size;
+	command->data.text.color = color;
+}
+
+void DrawList_Callback(DrawList* list, int layer, DrawCallback callback, const void* data, int size) {
+	int offset = copyBytes(list, data, size);
+	DrawCommand* command = record(list, layer, DRAW_CALLBACK, 0, (offset < 0) ? -1 : 0);
+	if (!command) return;
+	command->data.callback.callback = callback;
+	command->data.callback.offset = offset;
+}
+
+/* * * * * * *
+* SUBMITTING *
+* * * * * * */
+static void sortKeys(DrawList* list) {
+	//LSD radix sort on the top 32 bits, a byte per pass; stable, so the index bits never need sorting.
+	//Most frames use few layers, textures and states, so most passes find one bucket and are skipped.
+	uint64_t* from = list->keys;
+	uint64_t* to = list->scratch;
+	for (int shift = 32; shift < 64; shift += 8) {
+		int counts[256] = { 0 };
+		for (int i = 0; i < list->count; i++) counts[(from[i] >> shift) & 255]++;
+		if (counts[(from[0] >> shift) & 255] == list->count) continue;
+		int offset = 0;
+		for (int b = 0; b < 256; b++) {
+			int count = counts[b];
+			counts[b] = offset;
+			offset += count;
+		}
+		for (int i = 0; i < list->count; i++) to[counts[(from[i] >> shift) & 255]++] = from[i];
+		uint64_t* swap = from;
+		from = to;
+		to = swap;
+	}
+	if (from != list->keys) memcpy(list->keys, from, list->count * sizeof * list->keys);
+}
+
+void DrawList_Sort(DrawList* list) {
+	if (!list->sorted && list->count) sortKeys(list);
+	list->sorted = true;
+}
+
+/***
+* What Submit has set CProcessing to. Nothing is known at the start of a Submit, the frame
+* or a previous screen may have left any state behind.
+***/
+typedef struct {
+	bool fillKnown, strokeKnown, weightKnown, textSizeKnown;
+	CP_Color fill, stroke;
+	float strokeWeight, textSize;
+} StateTracker;
+
+static bool sameColor(CP_Color a, CP_Color b) {
+	return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static void setFill(DrawListStats* stats, StateTracker* tracker, CP_Color fill) {
+	if (tracker->fillKnown && sameColor(tracker->fill, fill)) return;
+	CP_Settings_Fill(fill);
+	tracker->fill = fill;
+	tracker->fillKnown = true;
+	stats->stateChanges++;
+}
+
+static void setShapeState(DrawListStats* stats, StateTracker* tracker, const DrawState* state) {
+	setFill(stats, tracker, state->fill);
+	if (!tracker->strokeKnown || !sameColor(tracker->stroke, state->stroke)) {
+		if (state->stroke.a) CP_Settings_Stroke(state->stroke);
+		else CP_Settings_NoStroke();
+		tracker->stroke = state->stroke;
+		tracker->strokeKnown = true;
+		stats->stateChanges++;
+	}
+	if (state->stroke.a && (!tracker->weightKnown || tracker->strokeWeight != state->strokeWeight)) {
+		CP_Settings_StrokeWeight(state->strokeWeight);
+		tracker->strokeWeight = state->strokeWeight;
+		tracker->weightKnown = true;
+		stats->stateChanges++;
+	}
+}
+
+void DrawList_Submit(DrawList* list) {
+	DrawList_Sort(list);
+
+	StateTracker tracker = { 0 };
+	CP_Image bound = NULL;
+	int boundText = -1; //state of the last atlas text, it picks the glyph image
+	bool transformed = false; //the camera matrix is applied
+	DrawListStats* stats = &list->stats;
+	stats->drawCalls = stats->stateChanges = stats->textureSwitches = 0;
+	for (int i = 0; i < list->count; i++) {
+		const DrawCommand* command = &list->commands[(uint32_t)list->keys[i]];
+		const DrawState* state = &list->states[command->state];
+		//keys are in layer order, so this switches at most twice a frame for a range of world layers
+		if (inWorld(list, (int)(list->keys[i] >> KEY_LAYER_SHIFT)) != transformed) {
+			transformed = !transformed;
+			if (transformed) {
+				DrawTransform* c = &list->camera;
+				CP_Settings_ApplyMatrix(CP_Matrix_Set(c->scale, 0, c->offsetX, 0, c->scale, c->offsetY, 0, 0, 1));
+			} else {
+				CP_Settings_ResetMatrix();
+			}
+			stats->stateChanges++;
+		}
+		switch (command->kind) {
+		case DRAW_RECT:
+			setShapeState(stats, &tracker, state);
+			CP_Graphics_DrawRect(command->data.shape.x, command->data.shape.y, command->data.shape.w, command->data.shape.h);
+			break;
+		case DRAW_ELLIPSE:
+			setShapeState(stats, &tracker, state);
+			CP_Graphics_DrawEllipseAdvanced(command->data.shape.x, command->data.shape.y, command->data.shape.w, command->data.shape.h, command->data.shape.degrees);
+			break;
+		case DRAW_TRIANGLE:
+			setShapeState(stats, &tracker, state);
+			CP_Graphics_DrawTriangleAdvanced(command->data.triangle.x1, command->data.triangle.y1, command->data.triangle.x2, command->data.triangle.y2,
+				command->data.triangle.x3, command->data.triangle.y3, command->data.triangle.degrees);
+			break;
+		case DRAW_IMAGE:
+		case DRAW_SUB_IMAGE:
+			if (command->data.image.image != bound) stats->textureSwitches++;
+			bound = command->data.image.image;
+			boundText = -1;
+			if (command->kind == DRAW_IMAGE) {
+				CP_Image_Draw(bound, command->data.image.x, command->data.image.y, command->data.image.w, command->data.image.h, command->data.image.alpha);
+			} else {
+				CP_Image_DrawSubImage(bound, command->data.image.x, command->data.image.y, command->data.image.w, command->data.image.h,
+					command->data.image.u0, command->data.image.v0, command->data.image.u1, command->data.image.v1, command->data.image.alpha);
+			}
+			stats->drawCalls++;
+			continue;
+		case DRAW_TEXT: {
+			const char* text = (const char*)list->bytes + command->data.text.offset;
+			if (command->data.text.atlas && command->data.text.atlas->loaded) {
+				//one glyph image per size and color, every glyph of the string is a draw from it
+				TextAtlas_DrawText(command->data.text.atlas, text, command->data.text.x, command->data.text.y, command->data.text.size, command->data.text.color,
+					CP_TEXT_ALIGN_H_CENTER, CP_TEXT_ALIGN_V_MIDDLE);
+				if (command->state != boundText) stats->textureSwitches++;
+				boundText = command->state;
+				bound = NULL;
+				for (const char* c = text; *c; c++) stats->drawCalls += (*c > ' ' && *c <= TEXT_ATLAS_LAST_CHAR);
+				continue;
+			}
+			setFill(stats, &tracker, state->fill);
+			if (!tracker.textSizeKnown || tracker.textSize != state->textSize) {
+				CP_Settings_TextSize(state->textSize);
+				tracker.textSize = state->textSize;
+				tracker.textSizeKnown = true;
+				stats->stateChanges++;
+			}
+			CP_Font_DrawText(text, command->data.text.x, command->data.text.y);
+			break;
+		}
+		case DRAW_CALLBACK:
+			command->data.callback.callback((unsigned char*)list->bytes + command->data.callback.offset);
+			bound = NULL;
+			boundText = -1;
+			stats->drawCalls++;
+			continue;
+		}
+		bound = NULL;
+		boundText = -1;
+		stats->drawCalls++;
+	}
+	if (transformed) CP_Settings_ResetMatrix();
+}
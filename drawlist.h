@@ -0,0 +1,147 @@
+//---------------------------------------------------------
+// file:	drawlist.h
+//
+// brief:	Per-frame draw command buffer. A frame records its
+//			draws with a layer instead of calling CProcessing
+//			directly; Submit then draws them sorted by layer,
+//			texture and render state, so each texture is used
+//			in one run per layer and CP_Settings_* is only
+//			called when the state actually changes. A range
+//			of layers can be in world coordinates, drawn
+//			through one camera matrix.
+//---------------------------------------------------------
+#pragma once
+
+#include "cprocessing.h"
+#include "textatlas.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DRAW_LIST_MAX_LAYERS 256
+#define DRAW_LIST_MAX_TEXTURES 255
+#define DRAW_LIST_MAX_STATES 4096
+#define DRAW_LIST_BYTES (16 * 1024) //text and callback data per frame
+
+typedef enum {
+	DRAW_RECT,
+	DRAW_ELLIPSE,
+	DRAW_TRIANGLE,
+	DRAW_IMAGE,
+	DRAW_SUB_IMAGE,
+	DRAW_TEXT,
+	DRAW_CALLBACK
+} DrawKind;
+
+//Called during Submit with a copy of the data it was recorded with. It must leave the
+//CProcessing settings as it found them (CP_Settings_Save/Restore).
+typedef void (*DrawCallback)(const void* data);
+
+/***
+* The render state a shape is drawn with. A stroke with zero alpha means NoStroke, so two
+* states that look the same compare equal byte for byte.
+***/
+typedef struct {
+	CP_Color fill;
+	CP_Color stroke;
+	float strokeWeight;
+	float textSize; //only used by text drawn without an atlas
+} DrawState;
+
+//Where world layers land on screen: screen = world * scale + offset.
+typedef struct {
+	float scale;
+	float offsetX, offsetY;
+} DrawTransform;
+
+typedef struct {
+	DrawKind kind;
+	int state;
+	union {
+		struct { float x, y, w, h, degrees; } shape; //rect and ellipse
+		struct { float x1, y1, x2, y2, x3, y3, degrees; } triangle;
+		struct { CP_Image image; float x, y, w, h, u0, v0, u1, v1; int alpha; } image;
+		struct { TextAtlas* atlas; int offset; float x, y, size; CP_Color color; } text;
+		struct { DrawCallback callback; int offset; } callback;
+	} data;
+} DrawCommand;
+
+typedef struct {
+	int commands; //recorded this frame
+	int culled; //recorded but entirely outside the view
+	int dropped; //didn't fit in the list
+	int drawCalls;
+	int stateChanges; //CP_Settings_* calls made by Submit
+	int textureSwitches; //runs of draws from the same image
+} DrawListStats;
+
+/***
+* Every command gets a 64 bit key: layer, texture, state, then the order it was recorded
+* in. Sorting the keys alone is enough, the low 32 bits point back at the command, and
+* because the sort is stable, draws with equal layer, texture and state keep their order.
+* So only draws in the same layer may be reordered against each other, and everything
+* inside one layer must be fine to draw in any order of texture and state.
+***/
+typedef struct {
+	DrawCommand* commands;
+	uint64_t* keys;
+	uint64_t* scratch; //second buffer for the radix sort
+	int count, capacity;
+	bool sorted; //keys are in draw order, nothing was recorded since the last sort
+	float viewWidth, viewHeight;
+	DrawTransform camera;
+	int firstWorldLayer, lastWorldLayer; //drawn through camera, none when first > last
+	float worldLeft, worldTop, worldRight, worldBottom; //the view, in world coordinates
+
+	CP_Image textures[DRAW_LIST_MAX_TEXTURES + 1]; //[0] is "no texture"
+	int textureCount;
+
+	DrawState states[DRAW_LIST_MAX_STATES];
+	int stateCount;
+	unsigned short stateSlots[DRAW_LIST_MAX_STATES * 2]; //open addressing, state index + 1
+	DrawState current; //what the next shape is drawn with
+	int currentState; //index of current, -1 until a shape uses it
+
+	uint64_t bytes[DRAW_LIST_BYTES / sizeof(uint64_t)]; //text and callback data, 8 byte aligned for the callbacks
+	int bytesUsed;
+
+	DrawListStats stats; //of the last Submit
+} DrawList;
+
+bool DrawList_Init(DrawList* list, int capacity);
+void DrawList_Free(DrawList* list);
+//Start a frame: empty the list, and cull rects and images outside (0, 0) to (viewWidth, viewHeight).
+//The recording state starts as a black fill with no stroke, and every layer in screen coordinates.
+void DrawList_Begin(DrawList* list, float viewWidth, float viewHeight);
+/***
+* Record layers firstLayer to lastLayer in world coordinates from here on. Submit applies
+* camera as one matrix before the first of them and resets it after the last, so keep them
+* next to each other in the layer order; culling maps the view back into the world instead
+* of every draw into the screen. A callback in a world layer draws under the matrix too.
+***/
+void DrawList_SetCamera(DrawList* list, DrawTransform camera, int firstLayer, int lastLayer);
+//The part of layer's coordinates that is on screen, for callers that can skip work on what isn't.
+void DrawList_ViewRect(const DrawList* list, int layer, float* left, float* top, float* right, float* bottom);
+//Put the recorded draws in order. Submit does it when needed; calling it ahead of time lets
+//the thread that records a frame sort it too, leaving only the drawing to Submit.
+void DrawList_Sort(DrawList* list);
+//Draw everything recorded since Begin. The list keeps its draws until the next Begin, so the
+//same frame can be submitted again.
+void DrawList_Submit(DrawList* list);
+
+//Render state for the shapes recorded after it, as the CP_Settings_* equivalents.
+void DrawList_Fill(DrawList* list, CP_Color color);
+void DrawList_Stroke(DrawList* list, CP_Color color);
+void DrawList_NoStroke(DrawList* list);
+void DrawList_StrokeWeight(DrawList* list, float weight);
+
+//Same arguments as the CP_Graphics_* and CP_Image_* calls, plus the layer. Rects and images
+//are positioned by their top left corner, as main.c sets CP_POSITION_CORNER.
+void DrawList_Rect(DrawList* list, int layer, float x, float y, float w, float h);
+void DrawList_Ellipse(DrawList* list, int layer, float x, float y, float w, float h, float degrees);
+void DrawList_Triangle(DrawList* list, int layer, float x1, float y1, float x2, float y2, float x3, float y3, float degrees);
+void DrawList_Image(DrawList* list, int layer, CP_Image image, float x, float y, float w, float h, int alpha);
+void DrawList_SubImage(DrawList* list, int layer, CP_Image image, float x, float y, float w, float h, float u0, float v0, float u1, float v1, int alpha);
+//Text centered on (x, y). The string is copied. Without a loaded atlas it falls back to CP_Font_DrawText.
+void DrawList_Text(DrawList* list, int layer, TextAtlas* atlas, const char* text, float x, float y, float size, CP_Color color);
+//For draws the list can't describe, like the minimap. size bytes of data are copied.
+void DrawList_Callback(DrawList* list, int layer, DrawCallback callback, const void* data, int size);
@@ -0,0 +1,105 @@
+//---------------------------------------------------------
+// file:	governor.c
+//
+// brief:	Frame budget governor (see governor.h).
+//---------------------------------------------------------
+
+#include "governor.h"
+#include <string.h>
+
+#define GOVERNOR_OVER 1.2f //the slowest tenth of the frames past this much of the budget steps down, a vsync miss is 2
+#define GOVERNOR_UNDER 1.05f //and under this much for raiseWait frames steps up
+#define GOVERNOR_SETTLE (GOVERNOR_WINDOW / 2) //frames after a change before it's judged, the first ones still show the old level
+#define GOVERNOR_RAISE_WAIT 120 //frames under budget before the first step up
+#define GOVERNOR_RAISE_WAIT_MAX 7680 //about two minutes at 60 fps
+#define GOVERNOR_PROBE 120 //a step up taken back within this many frames doubles the wait
+#define GOVERNOR_HITCH 4 //frames longer than this many budgets count as this many, a load or a dragged window isn't the scene's fault
+
+//Cheapest to dearest: each step is the one that loses the least for what it saves.
+static const QualityLevers LEVELS[GOVERNOR_LEVELS] = {
+	//scenery dropped, effects, full flash, HUD detail, cloud level
+	{ 0, 1, true, true, 0 },
+	{ 0, 0.5f, true, true, 0 },
+	{ 1, 0.5f, true, true, 0 },
+	{ 2, 0.5f, false, true, 0 },
+	{ 2, 0.25f, false, false, 0 },
+	{ 3, 0.25f, false, false, 1 },
+	{ 4, 0.25f, false, false, 1 }
+};
+
+void Governor_Init(Governor* governor, float budget) {
+	memset(governor, 0, sizeof * governor);
+	governor->budget = budget;
+	governor->raiseWait = GOVERNOR_RAISE_WAIT;
+}
+
+void Governor_SetBudget(Governor* governor, float budget) {
+	governor->budget = budget;
+	governor->sampleCount = 0;
+	governor->framesSinceChange = 0;
+	governor->framesUnder = 0;
+	if (budget <= 0) governor->level = 0;
+}
+
+//90th percentile of the latest count samples. Sorting at most 60 floats is nothing next to a frame.
+static float slowFrame(const Governor* governor, int count) {
+	float sorted[GOVERNOR_WINDOW];
+	for (int i = 0; i < count; i++) {
+		float value = governor->samples[(governor->next - 1 - i + GOVERNOR_WINDOW) % GOVERNOR_WINDOW];
+		int j = i;
+		for (; j > 0 && sorted[j - 1] > value; j--) sorted[j] = sorted[j - 1];
+		sorted[j] = value;
+	}
+	return count ? sorted[count * 9 / 10] : 0;
+}
+
+static GovernorDecision change(Governor* governor, GovernorDecision decision) {
+	if (decision == GOVERNOR_LOWER) {
+		//a step up that didn't hold: wait longer before the next try
+		if (governor->probing && governor->framesSinceChange < GOVERNOR_PROBE) {
+			governor->raiseWait *= 2;
+			if (governor->raiseWait > GOVERNOR_RAISE_WAIT_MAX) governor->raiseWait = GOVERNOR_RAISE_WAIT_MAX;
+		}
+		governor->level++;
+		governor->probing = false;
+	} else {
+		governor->level--;
+		governor->probing = true;
+	}
+	governor->sampleCount = 0;
+	governor->framesSinceChange = 0;
+	governor->framesUnder = 0;
+	governor->lastDecision = decision;
+	return decision;
+}
+
+GovernorDecision Governor_Frame(Governor* governor, float seconds) {
+	if (governor->budget <= 0) return GOVERNOR_HOLD;
+	if (seconds > governor->budget * GOVERNOR_HITCH) seconds = governor->budget * GOVERNOR_HITCH;
+	governor->samples[governor->next] = seconds;
+	governor->next = (governor->next + 1) % GOVERNOR_WINDOW;
+	if (governor->sampleCount < GOVERNOR_WINDOW) governor->sampleCount++;
+	governor->framesSinceChange++;
+	//a step up that lasted the probe is where it belongs, the next one starts from the short wait
+	if (governor->probing && governor->framesSinceChange >= GOVERNOR_PROBE) {
+		governor->probing = false;
+		governor->raiseWait = GOVERNOR_RAISE_WAIT;
+	}
+
+	if (governor->framesSinceChange < GOVERNOR_SETTLE) return GOVERNOR_HOLD;
+	governor->slowFrame = slowFrame(governor, governor->sampleCount);
+	if (governor->slowFrame > governor->budget * GOVERNOR_OVER && governor->level < GOVERNOR_LEVELS - 1) return change(governor, GOVERNOR_LOWER);
+
+	governor->framesUnder = (governor->slowFrame < governor->budget * GOVERNOR_UNDER) ? governor->framesUnder + 1 : 0;
+	if (governor->level > 0 && governor->framesUnder >= governor->raiseWait) return change(governor, GOVERNOR_RAISE);
+	return GOVERNOR_HOLD;
+}
+
+QualityLevers Governor_Levers(const Governor* governor) {
+	return LEVELS[governor->level];
+}
+
+float Governor_Sample(const Governor* governor, int age) {
+	if (age < 0 || age >= GOVERNOR_WINDOW) return 0;
+	return governor->samples[(governor->next - 1 - age + 2 * GOVERNOR_WINDOW) % GOVERNOR_WINDOW];
+}
@@ -0,0 +1,65 @@
+//---------------------------------------------------------
+// file:	governor.h
+//
+// brief:	Adaptive quality. Watches the last frames' times
+//			and trades looks for speed a step at a time to
+//			stay inside a frame budget: fewer scenery clouds,
+//			fewer particles and a smaller hit flash, a leaner
+//			HUD, and smaller cloud textures. No CProcessing
+//			calls, the caller measures the frames.
+//---------------------------------------------------------
+#pragma once
+
+#include <stdbool.h>
+
+#define GOVERNOR_WINDOW 60 //frames judged at once
+#define GOVERNOR_LEVELS 7 //quality steps, 0 is everything on
+
+//What a quality level turns down. main.c reads these while recording a frame.
+typedef struct {
+	int sceneryDropped; //scenery cloud layers left out, the faintest ones first
+	float effects; //fraction of each particle burst spawned
+	bool fullFlash; //hit flash over the whole screen, or only a frame around its edges
+	bool hudDetail; //the speed and direction lines
+	int cloudLevel; //smallest mip level the gameplay clouds are drawn from
+} QualityLevers;
+
+typedef enum {
+	GOVERNOR_HOLD,
+	GOVERNOR_LOWER, //over budget, one step down
+	GOVERNOR_RAISE //under budget long enough, one step back up
+} GovernorDecision;
+
+/***
+* Steps down as soon as the slowest tenth of the frames since the last change is over the
+* budget, and only back up once it has been comfortably under it for raiseWait frames. The
+* band between the two (GOVERNOR_OVER and GOVERNOR_UNDER) and the wait keep it from flipping
+* between two levels, and when a step up has to be taken back within a couple of seconds, it
+* waits twice as long before trying that again.
+*
+* A vsynced frame takes the whole budget however little work is in it, so frame times can't
+* tell how much room there is; going up is a probe, and the doubling wait keeps a level the
+* machine can't hold from being probed every few seconds.
+***/
+typedef struct {
+	float budget; //seconds per frame, 0 leaves everything at level 0
+	float samples[GOVERNOR_WINDOW]; //ring of the latest frame times
+	int next; //where the next sample goes
+	int sampleCount; //since the last change, up to GOVERNOR_WINDOW
+	int level;
+	int framesSinceChange;
+	int framesUnder; //judged frames in a row comfortably under budget
+	int raiseWait; //frames under budget before a step up
+	bool probing; //the last change was a step up that hasn't held for long yet
+	float slowFrame; //90th percentile of the samples, seconds, as of the last Frame
+	GovernorDecision lastDecision; //the last change it made, HOLD before the first
+} Governor;
+
+void Governor_Init(Governor* governor, float budget);
+//A new budget keeps the level, the next frames judge it again.
+void Governor_SetBudget(Governor* governor, float budget);
+//Once a frame with the time the last one took. Returns what it did about it.
+GovernorDecision Governor_Frame(Governor* governor, float seconds);
+QualityLevers Governor_Levers(const Governor* governor);
+//A sample from the ring, age 0 the latest, for graphs. 0 for frames not seen yet.
+float Governor_Sample(const Governor* governor, int age);
@@ -0,0 +1,530 @@
+//---------------------------------------------------------
+// file:	leaderboard.c
+//
+// brief:	Memory-mapped skip list and its service thread
+//			(see leaderboard.h).
+//---------------------------------------------------------
+
+#include "leaderboard.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define PAGE_BYTES 4096
+#define GROW_BYTES (64 * 1024) //the file grows in multiples of this, doubling each time
+#define MAX_DIRTY_PAGES 64
+
+/***
+* The file is an array of 32-bit words. The first page is the header; the rest is an arena
+* of skip list nodes, only ever appended to. A node at word offset o is:
+*	o + 0: score, o + 1: seconds, o + 2: date, o + 3: level,
+*	then level pairs of (next node offset, span), where span counts the nodes the link skips.
+* The head node sits right after the header with every level.
+***/
+#define NODE_SCORE 0
+#define NODE_SECONDS 1
+#define NODE_DATE 2
+#define NODE_LEVEL 3
+#define NODE_LINKS 4
+#define HEADER_WORDS (PAGE_BYTES / 4)
+#define HEAD_NODE HEADER_WORDS
+#define JOURNAL_WRITES (2 * LEADERBOARD_MAX_LEVEL + 3)
+
+typedef struct {
+	uint32_t offset; //word to overwrite
+	uint32_t value;
+} JournalWrite;
+
+/***
+* An insert writes its new node past the end of the arena, then lists every word it will
+* change in place in the journal, forces both to disk, applies the list, forces that, and
+* only then marks the transaction applied. Opening a file whose journal is one transaction
+* ahead and intact replays it; a journal torn mid-write means the insert never happened.
+***/
+typedef struct {
+	char magic[4]; //"HALB"; written last when the file is created
+	uint32_t version;
+	uint32_t sequence; //transactions applied
+	uint32_t count;
+	uint32_t levels; //levels in use
+	uint32_t used; //words of the file in use
+	uint32_t journalSequence; //sequence + 1 while a transaction is in flight
+	uint32_t journalCount;
+	uint32_t journalChecksum;
+	JournalWrite journal[JOURNAL_WRITES];
+} FileHeader;
+
+#define HEADER_FIELD(field) (uint32_t)(offsetof(FileHeader, field) / 4)
+
+static const char MAGIC[4] = { 'H', 'A', 'L', 'B' };
+
+struct Leaderboard {
+#ifdef _WIN32
+	HANDLE file, mapping;
+#else
+	int file;
+#endif
+	uint32_t* words;
+	uint64_t bytes; //mapped size
+	uint32_t rng;
+	int dirtyCount;
+	uint32_t dirty[MAX_DIRTY_PAGES]; //pages written since the last barrier
+};
+
+/* * * * * * *
+* PLATFORM *
+* * * * * * */
+#ifdef _WIN32
+static bool openFile(Leaderboard* board, const char* path, uint64_t* size) {
+	board->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER length;
+	if (board->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(board->file, &length)) return false;
+	*size = (uint64_t)length.QuadPart;
+	return true;
+}
+
+static void closeFile(Leaderboard* board) {
+	if (board->file != INVALID_HANDLE_VALUE && board->file) CloseHandle(board->file);
+}
+
+static bool mapFile(Leaderboard* board, uint64_t bytes) {
+	LARGE_INTEGER length;
+	length.QuadPart = (LONGLONG)bytes;
+	if (!SetFilePointerEx(board->file, length, NULL, FILE_BEGIN) || !SetEndOfFile(board->file)) return false;
+	board->mapping = CreateFileMappingA(board->file, NULL, PAGE_READWRITE, (DWORD)(bytes >> 32), (DWORD)bytes, NULL);
+	if (!board->mapping) return false;
+	board->words = MapViewOfFile(board->mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)bytes);
+	if (!board->words) {
+		CloseHandle(board->mapping);
+		board->mapping = NULL;
+		return false;
+	}
+	board->bytes = bytes;
+	return true;
+}
+
+static void unmapFile(Leaderboard* board) {
+	if (board->words) UnmapViewOfFile(board->words);
+	if (board->mapping) CloseHandle(board->mapping);
+	board->words = NULL;
+	board->mapping = NULL;
+}
+
+static void flushPage(Leaderboard* board, uint32_t page) {
+	FlushViewOfFile((char*)board->words + (size_t)page * PAGE_BYTES, PAGE_BYTES);
+}
+
+static void syncFile(Leaderboard* board) {
+	FlushFileBuffers(board->file);
+}
+#else
+static bool openFile(Leaderboard* board, const char* path, uint64_t* size) {
+	struct stat info;
+	board->file = open(path, O_RDWR | O_CREAT, 0644);
+	if (board->file < 0 || fstat(board->file, &info) != 0) return false;
+	*size = (uint64_t)info.st_size;
+	return true;
+}
+
+static void closeFile(Leaderboard* board) {
+	if (board->file >= 0) close(board->file);
+}
+
+static bool mapFile(Leaderboard* board, uint64_t bytes) {
+	if (ftruncate(board->file, (off_t)bytes) != 0) return false;
+	void* words = mmap(NULL, (size_t)bytes, PROT_READ | PROT_WRITE, MAP_SHARED, board->file, 0);
+	if (words == MAP_FAILED) return false;
+	board->words = words;
+	board->bytes = bytes;
+	return true;
+}
+
+static void unmapFile(Leaderboard* board) {
+	if (board->words) munmap(board->words, (size_t)board->bytes);
+	board->words = NULL;
+}
+
+static void flushPage(Leaderboard* board, uint32_t page) {
+	msync((char*)board->words + (size_t)page * PAGE_BYTES, PAGE_BYTES, MS_SYNC);
+}
+
+static void syncFile(Leaderboard* board) {
+	fsync(board->file);
+}
+#endif
+
+/* * * * * * * * * *
+* DURABILITY *
+* * * * * * * * * */
+static void markDirty(Leaderboard* board, uint32_t offset, uint32_t words) {
+	uint32_t first = offset * 4 / PAGE_BYTES;
+	uint32_t last = (offset + words - 1) * 4 / PAGE_BYTES;
+	for (uint32_t page = first; page <= last; page++) {
+		bool known = false;
+		for (int i = 0; i < board->dirtyCount && !known; i++) known = board->dirty[i] == page;
+		if (known) continue;
+		if (board->dirtyCount == MAX_DIRTY_PAGES) {
+			//can't happen for one insert (two pages per level at most), but stay correct if it does
+			for (int i = 0; i < board->dirtyCount; i++) flushPage(board, board->dirty[i]);
+			board->dirtyCount = 0;
+		}
+		board->dirty[board->dirtyCount++] = page;
+	}
+}
+
+//Everything written so far is on disk when this returns.
+static void barrier(Leaderboard* board) {
+	for (int i = 0; i < board->dirtyCount; i++) flushPage(board, board->dirty[i]);
+	board->dirtyCount = 0;
+	syncFile(board);
+}
+
+static uint32_t checksum(const FileHeader* header) {
+	//FNV-1a over the journal, so a half-written one is never replayed
+	uint32_t hash = 2166136261u;
+	const uint32_t* words = (const uint32_t*)header->journal;
+	uint32_t count = header->journalCount * 2;
+	hash = (hash ^ header->journalSequence) * 16777619u;
+	hash = (hash ^ header->journalCount) * 16777619u;
+	for (uint32_t i = 0; i < count && i < JOURNAL_WRITES * 2; i++) hash = (hash ^ words[i]) * 16777619u;
+	return hash;
+}
+
+static void applyJournal(Leaderboard* board) {
+	FileHeader* header = (FileHeader*)board->words;
+	uint32_t limit = (uint32_t)(board->bytes / 4);
+	for (uint32_t i = 0; i < header->journalCount; i++) {
+		const JournalWrite* write = &header->journal[i];
+		if (write->offset >= limit) continue;
+		board->words[write->offset] = write->value;
+		markDirty(board, write->offset, 1);
+	}
+	barrier(board);
+	header->sequence = header->journalSequence;
+	markDirty(board, 0, HEADER_WORDS);
+	barrier(board);
+}
+
+/* * * * * * * * *
+* SKIP LIST *
+* * * * * * * * */
+static uint32_t nodeWords(uint32_t level) { return NODE_LINKS + 2 * level; }
+static uint32_t* next(Leaderboard* board, uint32_t node, uint32_t level) { return &board->words[node + NODE_LINKS + 2 * level]; }
+static uint32_t* span(Leaderboard* board, uint32_t node, uint32_t level) { return &board->words[node + NODE_LINKS + 2 * level + 1]; }
+
+static uint32_t randomLevel(Leaderboard* board) {
+	//each level holds a quarter of the nodes of the one below
+	uint32_t level = 1;
+	for (;;) {
+		board->rng ^= board->rng << 13;
+		board->rng ^= board->rng >> 17;
+		board->rng ^= board->rng << 5;
+		if (level == LEADERBOARD_MAX_LEVEL || (board->rng & 3)) return level;
+		level++;
+	}
+}
+
+static bool grow(Leaderboard* board, uint64_t needed) {
+	uint64_t bytes = board->bytes * 2;
+	while (bytes < needed) bytes *= 2;
+	if (bytes > (uint64_t)UINT32_MAX * 4) return false;
+	barrier(board); //dirty pages are lost track of once unmapped
+	unmapFile(board);
+	if (mapFile(board, bytes)) {
+		syncFile(board); //the new length
+		return true;
+	}
+	return mapFile(board, board->bytes);
+}
+
+static void createFile(Leaderboard* board) {
+	FileHeader* header = (FileHeader*)board->words;
+	memset(board->words, 0, (size_t)(HEADER_WORDS + nodeWords(LEADERBOARD_MAX_LEVEL)) * 4);
+	header->version = LEADERBOARD_VERSION;
+	header->levels = 1;
+	header->used = HEADER_WORDS + nodeWords(LEADERBOARD_MAX_LEVEL);
+	board->words[HEAD_NODE + NODE_LEVEL] = LEADERBOARD_MAX_LEVEL;
+	markDirty(board, 0, header->used);
+	barrier(board);
+	memcpy(header->magic, MAGIC, sizeof MAGIC);
+	markDirty(board, 0, 1);
+	barrier(board);
+}
+
+Leaderboard* Leaderboard_Open(const char* path) {
+	Leaderboard* board = calloc(1, sizeof * board);
+	if (!board) return NULL;
+	board->rng = (uint32_t)time(NULL) | 1;
+	uint64_t size;
+	if (!openFile(board, path, &size)) {
+		closeFile(board);
+		free(board);
+		return NULL;
+	}
+	uint64_t bytes = (size < GROW_BYTES) ? GROW_BYTES : size;
+	if (!mapFile(board, bytes)) {
+		Leaderboard_Close(board);
+		return NULL;
+	}
+
+	FileHeader* header = (FileHeader*)board->words;
+	static const char EMPTY[4] = { 0 };
+	if (!memcmp(header->magic, EMPTY, sizeof EMPTY)) {
+		createFile(board); //new, or its creation never finished
+	} else if (memcmp(header->magic, MAGIC, sizeof MAGIC) || header->version != LEADERBOARD_VERSION || header->used > bytes / 4) {
+		Leaderboard_Close(board); //not a leaderboard this build can read; leave it alone
+		return NULL;
+	} else if (header->journalSequence == header->sequence + 1 && header->journalCount <= JOURNAL_WRITES
+		&& header->journalChecksum == checksum(header)) {
+		applyJournal(board); //the last insert was cut short after its journal was safe
+	}
+	return board;
+}
+
+void Leaderboard_Close(Leaderboard* board) {
+	if (!board) return;
+	if (board->words) barrier(board);
+	unmapFile(board);
+	closeFile(board);
+	free(board);
+}
+
+uint32_t Leaderboard_Count(Leaderboard* board) {
+	return ((FileHeader*)board->words)->count;
+}
+
+uint32_t Leaderboard_Insert(Leaderboard* board, const LeaderboardEntry* entry) {
+	uint32_t level = randomLevel(board);
+	uint32_t size = nodeWords(level);
+	FileHeader* header = (FileHeader*)board->words;
+	if (((uint64_t)header->used + size) * 4 > board->bytes) {
+		if (!grow(board, ((uint64_t)header->used + size) * 4)) return 0;
+		header = (FileHeader*)board->words;
+	}
+
+	//find the last node at every level that stays ahead of the new score
+	uint32_t update[LEADERBOARD_MAX_LEVEL];
+	uint32_t rankAt[LEADERBOARD_MAX_LEVEL];
+	uint32_t rank = 0;
+	uint32_t x = HEAD_NODE;
+	uint32_t levels = header->levels;
+	for (int i = (int)levels - 1; i >= 0; i--) {
+		uint32_t n;
+		while ((n = *next(board, x, i)) && (int32_t)board->words[n + NODE_SCORE] >= entry->score) {
+			rank += *span(board, x, i);
+			x = n;
+		}
+		update[i] = x;
+		rankAt[i] = rank;
+	}
+	for (uint32_t i = levels; i < level; i++) {
+		update[i] = HEAD_NODE;
+		rankAt[i] = 0;
+	}
+
+	//the new node goes past the end of the arena, where nothing reads it until the commit
+	uint32_t node = header->used;
+	board->words[node + NODE_SCORE] = (uint32_t)entry->score;
+	board->words[node + NODE_SECONDS] = entry->seconds;
+	board->words[node + NODE_DATE] = entry->date;
+	board->words[node + NODE_LEVEL] = level;
+	for (uint32_t i = 0; i < level; i++) {
+		//levels the list didn't use yet have the head pointing at the end, past every node
+		uint32_t skipped = (i < levels) ? *span(board, update[i], i) : header->count;
+		*next(board, node, i) = (i < levels) ? *next(board, update[i], i) : 0;
+		*span(board, node, i) = skipped - (rank - rankAt[i]);
+	}
+	markDirty(board, node, size);
+
+	JournalWrite* journal = header->journal;
+	uint32_t writes = 0;
+	for (uint32_t i = 0; i < level; i++) {
+		journal[writes++] = (JournalWrite){ update[i] + NODE_LINKS + 2 * i, node };
+		journal[writes++] = (JournalWrite){ update[i] + NODE_LINKS + 2 * i + 1, rank - rankAt[i] + 1 };
+	}
+	for (uint32_t i = level; i < levels; i++) {
+		journal[writes++] = (JournalWrite){ update[i] + NODE_LINKS + 2 * i + 1, *span(board, update[i], i) + 1 };
+	}
+	journal[writes++] = (JournalWrite){ HEADER_FIELD(count), header->count + 1 };
+	journal[writes++] = (JournalWrite){ HEADER_FIELD(levels), (level > levels) ? level : levels };
+	journal[writes++] = (JournalWrite){ HEADER_FIELD(used), header->used + size };
+	header->journalCount = writes;
+	header->journalSequence = header->sequence + 1;
+	header->journalChecksum = checksum(header);
+	markDirty(board, 0, HEADER_WORDS);
+	barrier(board);
+
+	applyJournal(board);
+	return rank + 1;
+}
+
+int Leaderboard_Top(Leaderboard* board, int count, LeaderboardEntry* out) {
+	int found = 0;
+	for (uint32_t n = *next(board, HEAD_NODE, 0); n && found < count; n = *next(board, n, 0)) {
+		out[found].score = (int32_t)board->words[n + NODE_SCORE];
+		out[found].seconds = board->words[n + NODE_SECONDS];
+		out[found].date = board->words[n + NODE_DATE];
+		found++;
+	}
+	return found;
+}
+
+/* * * * * * *
+* SERVICE   *
+* * * * * * */
+#ifdef _WIN32
+typedef CRITICAL_SECTION Lock;
+typedef CONDITION_VARIABLE Condition;
+typedef HANDLE Thread;
+#define THREAD_RESULT DWORD WINAPI
+static void lockCreate(Lock* lock) { InitializeCriticalSection(lock); }
+static void lockEnter(Lock* lock) { EnterCriticalSection(lock); }
+static void lockLeave(Lock* lock) { LeaveCriticalSection(lock); }
+static void lockFree(Lock* lock) { DeleteCriticalSection(lock); }
+static void conditionCreate(Condition* condition) { InitializeConditionVariable(condition); }
+static void conditionWait(Condition* condition, Lock* lock) { SleepConditionVariableCS(condition, lock, INFINITE); }
+static void conditionSignal(Condition* condition) { WakeConditionVariable(condition); }
+static void conditionFree(Condition* condition) { (void)condition; }
+static bool threadStart(Thread* thread, LPTHREAD_START_ROUTINE main) { return (*thread = CreateThread(NULL, 0, main, NULL, 0, NULL)) != NULL; }
+static void threadJoin(Thread thread) {
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+#else
+typedef pthread_mutex_t Lock;
+typedef pthread_cond_t Condition;
+typedef pthread_t Thread;
+#define THREAD_RESULT void*
+static void lockCreate(Lock* lock) { pthread_mutex_init(lock, NULL); }
+static void lockEnter(Lock* lock) { pthread_mutex_lock(lock); }
+static void lockLeave(Lock* lock) { pthread_mutex_unlock(lock); }
+static void lockFree(Lock* lock) { pthread_mutex_destroy(lock); }
+static void conditionCreate(Condition* condition) { pthread_cond_init(condition, NULL); }
+static void conditionWait(Condition* condition, Lock* lock) { pthread_cond_wait(condition, lock); }
+static void conditionSignal(Condition* condition) { pthread_cond_signal(condition); }
+static void conditionFree(Condition* condition) { pthread_cond_destroy(condition); }
+static bool threadStart(Thread* thread, void* (*main)(void*)) { return pthread_create(thread, NULL, main, NULL) == 0; }
+static void threadJoin(Thread thread) { pthread_join(thread, NULL); }
+#endif
+
+/***
+* The game thread only ever takes the lock to queue a score or copy the view, and the
+* service thread never holds it across file access, so a death screen frame can't end
+* up waiting on a page fault or a flush.
+***/
+static struct {
+	bool started;
+	bool running;
+	char path[260];
+	Thread thread;
+	Lock lock;
+	Condition wake;
+	LeaderboardEntry queue[LEADERBOARD_QUEUE_SIZE];
+	uint32_t queued, taken;
+	LeaderboardView view;
+} service;
+
+static void publish(Leaderboard* board, uint32_t rank) {
+	LeaderboardView view = { 0 };
+	view.ready = board != NULL;
+	if (board) {
+		view.count = Leaderboard_Count(board);
+		view.topCount = Leaderboard_Top(board, LEADERBOARD_VIEW_TOP, view.top);
+	}
+	lockEnter(&service.lock);
+	view.submitted = service.taken;
+	view.lastRank = service.taken ? rank : 0;
+	service.view = view;
+	lockLeave(&service.lock);
+}
+
+static THREAD_RESULT serviceMain(void* param) {
+	(void)param;
+	Leaderboard* board = Leaderboard_Open(service.path);
+	publish(board, 0);
+	for (;;) {
+		lockEnter(&service.lock);
+		while (service.running && service.taken == service.queued) conditionWait(&service.wake, &service.lock);
+		if (service.taken == service.queued) {
+			lockLeave(&service.lock);
+			break; //stopped, and everything queued is saved
+		}
+		LeaderboardEntry entry = service.queue[service.taken & (LEADERBOARD_QUEUE_SIZE - 1)];
+		lockLeave(&service.lock);
+
+		uint32_t rank = board ? Leaderboard_Insert(board, &entry) : 0;
+		lockEnter(&service.lock);
+		service.taken++;
+		lockLeave(&service.lock);
+		publish(board, rank);
+	}
+	Leaderboard_Close(board);
+	return 0;
+}
+
+bool Leaderboard_StartService(const char* path) {
+	if (service.started) return true;
+	size_t length = strlen(path);
+	if (length >= sizeof service.path) return false;
+	memcpy(service.path, path, length + 1);
+	lockCreate(&service.lock);
+	conditionCreate(&service.wake);
+	service.queued = service.taken = 0;
+	memset(&service.view, 0, sizeof service.view);
+	service.running = true;
+	if (!threadStart(&service.thread, serviceMain)) {
+		service.running = false;
+		conditionFree(&service.wake);
+		lockFree(&service.lock);
+		return false;
+	}
+	service.started = true;
+	return true;
+}
+
+void Leaderboard_StopService(void) {
+	if (!service.started) return;
+	lockEnter(&service.lock);
+	service.running = false;
+	conditionSignal(&service.wake);
+	lockLeave(&service.lock);
+	threadJoin(service.thread);
+	conditionFree(&service.wake);
+	lockFree(&service.lock);
+	service.started = false;
+}
+
+uint32_t Leaderboard_Submit(const LeaderboardEntry* entry) {
+	if (!service.started) return 0;
+	uint32_t id = 0;
+	lockEnter(&service.lock);
+	if (service.queued - service.taken < LEADERBOARD_QUEUE_SIZE) {
+		service.queue[service.queued & (LEADERBOARD_QUEUE_SIZE - 1)] = *entry;
+		id = ++service.queued;
+		conditionSignal(&service.wake);
+	}
+	lockLeave(&service.lock);
+	return id;
+}
+
+void Leaderboard_GetView(LeaderboardView* view) {
+	if (!service.started) {
+		memset(view, 0, sizeof * view);
+		return;
+	}
+	lockEnter(&service.lock);
+	*view = service.view;
+	lockLeave(&service.lock);
+}
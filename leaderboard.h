@@ -0,0 +1,65 @@
+//---------------------------------------------------------
+// file:	leaderboard.h
+//
+// brief:	Persistent high-score table. Scores live in a
+//			memory-mapped file as an indexable skip list, so
+//			an insert or a rank touches O(log n) nodes and
+//			the file is only ever appended to or patched in
+//			place. Every insert is one transaction, made
+//			atomic by a redo journal in the file header.
+//			A service thread owns the file so the game never
+//			waits on the disk.
+//---------------------------------------------------------
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LEADERBOARD_VERSION 1
+#define LEADERBOARD_MAX_LEVEL 12 //4^12 entries before the skip list stops being O(log n)
+#define LEADERBOARD_VIEW_TOP 5 //entries the death screen shows
+#define LEADERBOARD_QUEUE_SIZE 8 //submissions waiting for the service thread; power of two
+#define LEADERBOARD_PATH "leaderboard.bin"
+
+typedef struct {
+	int32_t score;
+	uint32_t seconds; //game time of the run
+	uint32_t date; //seconds since 1970 when the run ended
+} LeaderboardEntry;
+
+/* * * * * * * *
+* FILE ACCESS *
+* * * * * * * */
+typedef struct Leaderboard Leaderboard;
+
+//Open or create the file, replaying the journal if the last insert was cut short.
+Leaderboard* Leaderboard_Open(const char* path);
+void Leaderboard_Close(Leaderboard* board);
+
+//Add a score and commit it to disk. Returns its rank, 1 for the best, or 0 on failure.
+//Equal scores rank in the order they were set.
+uint32_t Leaderboard_Insert(Leaderboard* board, const LeaderboardEntry* entry);
+//Copy the best count entries, best first. Returns how many there were.
+int Leaderboard_Top(Leaderboard* board, int count, LeaderboardEntry* out);
+uint32_t Leaderboard_Count(Leaderboard* board);
+
+/* * * * * * *
+* SERVICE   *
+* * * * * * */
+//What the game thread can see of the table; refreshed after every commit.
+typedef struct {
+	bool ready; //the file is open
+	uint32_t count;
+	uint32_t submitted; //submissions committed so far
+	uint32_t lastRank; //rank of the newest committed submission, 0 before the first
+	int topCount;
+	LeaderboardEntry top[LEADERBOARD_VIEW_TOP];
+} LeaderboardView;
+
+//Start the service thread, which opens the file. Never blocks on the disk.
+bool Leaderboard_StartService(const char* path);
+void Leaderboard_StopService(void);
+//Queue a score from the game thread. Returns its submission number (compare against
+//LeaderboardView.submitted), or 0 if the queue is full.
+uint32_t Leaderboard_Submit(const LeaderboardEntry* entry);
+void Leaderboard_GetView(LeaderboardView* view);
@@ -13,73 +13,40 @@
 //---------------------------------------------------------
 
 #include "cprocessing.h"
+#include "world.h"
+#include "particles.h"
+#include "audio.h"
+#include "textatlas.h"
+#include "collision.h"
+#include "collectibles.h"
+#include "minimap.h"
+#include "snapshot.h"
+#include "telemetry.h"
+#include "leaderboard.h"
+#include "checkpoint.h"
+#include "tuning.h"
+#include "drawlist.h"
+#include "pipeline.h"
+#include "texture.h"
+#include "mipmap.h"
+#include "parallax.h"
+#include "placement.h"
+#include "autopilot.h"
+#include "camera.h"
+#include "governor.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
+#include <time.h>
 #define PI 3.14159265358979323846264
 
-CP_Image cloudTexture, redhitFlash, coinIMG;
-
 CP_Color BLACK, BLUE;
-float ww, wh; //window width and window height
-
-bool isIFraming, coinTriggered;
-char buffer[50] = { 0 };
-char guide[50] = { 0 };
-char playText[15] = { 0 };
-
-float globalX, globalY;
-
-CP_Vector directionVector, centerVector;
-float rotationAngle, rotationIncrement, rotationCap;
-
-float speed, speedMin, speedIncrement, drag, speedBonus;
-
-float iFrameDuration, iFrameStart, flashAlpha;
-int remainingLives, score;
-
-float buttonWidth, buttonHeight, buttonCornerRadius;
-CP_Color buttonDefaultColor, buttonHoverColor, buttonOnPressColor;
-CP_Image menuBackground;
-bool printBackground;
-bool playButtonHovered, resetButtonHovered, quitButtonHovered;
-
-typedef struct {
-	float size;
-	float x;
-	float y;
-	int img_id; //0 to 12 variations
-} Cloud;
 
 int CLOUD_ARR_SIZE = 20;
-Cloud* activeClouds;
-
-typedef struct {
-	float w;
-	float h;
-	float x0;
-	float y0;
-	float x1;
-	float y1;
-} TextureRect;
-
-//These values "cut" the CloudTextures.png image into subimages to randomize clouds
-TextureRect CLOUD_TEXTURE_POSITIONS[] = {
-	{111,  73,   5,  18, 116,  91},	//0
-	{122,  58, 142,  23, 264,  81},	//1
-	{ 90,  48, 288,  26, 378,  74},	//2
-	{104,  46, 410,  30, 514,  76},	//3
-	{135,  86, 543,  10, 678,  96},	//4
-	{ 91,  69, 724,  13, 815,  82},	//5
-	{112,  59,   8, 120, 120, 179},	//6
-	{176,  70, 138, 112, 314, 182},	//7
-	{126,  69, 342, 115, 468, 184},	//8
-	{199, 100, 494, 112, 693, 183},	//9
-	{137,  70, 718, 110, 845, 180}, //10
-	{187,  93,  10, 209, 287, 302},	//11
-	{184,  84, 339, 203, 523, 287}	//12
-};
 
 typedef struct {
 	float north;
@@ -90,15 +57,186 @@ typedef struct {
 	float height;
 } Bounds;
 
-Bounds bounds;
+#define COIN_CAPACITY 4096
+#define COIN_COUNT 40 //coins spawned per world
+#define COIN_SIZE 80
+#define COIN_CELL_SIZE 256
+#define COIN_INDICATORS 3 //arrows are only drawn for the closest few off screen coins
+
+#define CLOUD_MIP_LEVELS 4
+#define CLOUD_DRAW_LEVELS 3 //the closest clouds in the atlas are 14 pixels apart, drawing from level 3 would filter them into each other
+#define CLOUD_CANVAS_CAPACITY 64 //clouds on screen at once that the low resolution pass takes
 
-CP_Vector activeCoin;
-CP_Vector mappedCoinVector;
-float coinYPos, coinVelocity, coinCap, coinAlpha, coinFadeSpeed;
+#define CLOUD_SAFE_RADIUS 300 //no cloud is placed closer to the plane than this
+#define CLOUD_SAFE_FRAMES 30 //or than it flies in this many frames, whichever is further
+
+#define AUTOPILOT_CELL 64 //grid of the demo's flow field, world pixels
+
+#define CAMERA_HIT_TRAUMA 0.8f //how hard a cloud hit shakes the view, out of 1
+
+#define FLASH_EDGE 0.12f //the hit flash's frame, when it can't cover the screen, as a fraction of each side
+
+#define CLOUD_LAYER_COUNT 6
+#define CLOUD_LAYER_GAMEPLAY 5 //the ones before it are scenery behind it
+
+//Farthest first. Only the gameplay layer collides; the scenery is cached (see parallax.h), so its
+//density costs nothing per frame. Composited from level 2 or 3, scenery is a bit soft, like haze.
+const ParallaxLayerDesc CLOUD_LAYERS[CLOUD_LAYER_COUNT] = {
+	//parallax, scale, clouds per screen, alpha, cache level, refresh frames, collides
+	{ 0.15f, 0.3f, 30, 110, 3, 240, false },
+	{ 0.25f, 0.4f, 22, 140, 3, 180, false },
+	{ 0.4f, 0.5f, 16, 170, 2, 120, false },
+	{ 0.55f, 0.65f, 10, 200, 2, 90, false },
+	{ 0.7f, 0.8f, 6, 225, 2, 60, false },
+	{ 1, 1, 20 / 9.0f, 255, 0, 0, true } //CLOUD_ARR_SIZE over the 3x3 screen world, the server's SIM_CLOUDS
+};
+
+#define MINIMAP_WIDTH 240
+#define MINIMAP_MARGIN 20
+
+#define PARTICLE_CAPACITY 100000
+#define DRAW_LIST_CAPACITY (PARTICLE_CAPACITY + 1024) //every particle plus the rest of a frame
+
+//gameUpdate's draws, bottom to top. Inside a layer the draw list may reorder by texture and fill.
+//LAYER_CLOUDS to LAYER_PARTICLES are in world coordinates, drawn through the camera; the rest
+//are screen pixels.
+typedef enum {
+	LAYER_SKY, //the scenery cloud layers, one each
+	LAYER_CLOUDS = LAYER_SKY + CLOUD_LAYER_GAMEPLAY,
+	LAYER_PLAYER,
+	LAYER_COINS,
+	LAYER_PARTICLES,
+	LAYER_INDICATORS,
+	LAYER_HUD,
+	LAYER_MINIMAP,
+	LAYER_FLASH,
+	LAYER_OVERLAY_PANEL, //debug readouts, over everything: their backgrounds,
+	LAYER_OVERLAY_GRAPH, //what is plotted on them,
+	LAYER_OVERLAY //and the marks and text over the plots
+} DrawLayer;
+
+#define SPEED_MILESTONE_STEP 10
+#define SPEED_SAMPLE_SECONDS 0.5f
+
+/***
+* What game_update reads and writes every frame. The scalars come first so a frame's
+* physics, collision and HUD touch a handful of cache lines; the stores after them only
+* hold pointers and counts, their data lives on the heap.
+***/
+typedef struct {
+	WorldOrigin origin; //chunk globalX/Y and every world position are relative to
+	float globalX, globalY;
+	float lastGlobalX, lastGlobalY; //globalX/Y when collision was last checked, the start of this frame's sweep
+	CP_Vector directionVector, centerVector;
+	float rotationAngle;
+	float speed;
+	int remainingLives, score;
+	int speedMilestone; //speed / SPEED_MILESTONE_STEP as of the last frame
+	bool isIFraming;
+	bool runStarted; //a frame of this run has been played, so it's worth suspending
+	bool attract; //the autopilot is flying the pause menu's demo, not the player
+	float iFrameStart, flashAlpha;
+	float coinYPos, coinVelocity;
+	float timeOfRestart;
+	float nextSpeedSample; //game time of the next TELEMETRY_SPEED event
+	float ww, wh; //window width and window height
+	float now; //CP_System_GetSeconds() as of this tick, sampled by the main thread
+	float layerScrollX[CLOUD_LAYER_COUNT], layerScrollY[CLOUD_LAYER_COUNT]; //globalX/Y of each scenery layer, inside its tile
+	int frame; //CP_System_GetFrameCount() as of this tick
+	Bounds bounds;
+	Camera camera; //looks at the plane, set at the start of every frame
+	Governor governor; //kept from run to run, the machine doesn't change
+	QualityLevers quality; //the governor's levels as of this frame
+	bool showGovernor; //F8 overlay
+	DrawListStats drawStats; //what drawing the frame before cost, for the overlay
+
+	//The tuning file as this game applies it (see applyTuning).
+	float rotationIncrement, rotationCap;
+	float speedMin, speedBonus;
+	float iFrameDuration;
+	float coinCap, pickupRadius;
+	float collisionMargin, widthScalar, heightScalar;
+	float cloudLodSpeed, cloudLowResSpeed;
+	float cameraZoom, cameraShake;
+	uint32_t rng; //simRandom's, seeded on the main thread by loadGame
+
+	Cloud* activeClouds;
+	CollectibleStore coins;
+	Minimap minimap;
+	ParticlePool effects;
+	Autopilot navigator; //the way to the coins, kept up with every world; only the demo asks it
+} GameSim;
+
+//The pause and death screens; nothing here is touched while flying.
+typedef struct {
+	char buffer[50];
+	char guide[50];
+	float buttonWidth, buttonHeight, buttonCornerRadius;
+	CP_Color buttonDefaultColor, buttonHoverColor, buttonOnPressColor;
+	CP_Image menuBackground;
+	bool printBackground;
+	bool playButtonHovered, resetButtonHovered, quitButtonHovered;
+	float deathAlpha;
+	int dminutes, dseconds;
+	uint32_t leaderboardTicket; //this run's submission to the leaderboard, 0 if it couldn't be queued
+	LeaderboardView leaderboard;
+} GameUi;
+
+//What a tick reads from the keyboard and the clock. Gathered on the main thread, the only
+//one that may call CProcessing's input and time functions.
+typedef struct {
+	bool left, right; //held as of the latest frame
+	bool snapshot; //F10 was released since the last tick that got this input
+	bool governorOverlay; //the same for F8
+	float frameSeconds; //how long the frame before took, for the governor
+	DrawListStats drawStats; //of the last frame the main thread submitted
+	float seconds;
+	int frame;
+} GameInput;
+
+//Everything a tick hands the main thread: the frame to draw, and whether the run ended on it.
+typedef struct {
+	DrawList draws; //recorded and sorted by the tick, only submitted by the main thread
+	bool died;
+} FramePacket;
 
-float deathAlpha;
-int dminutes, dseconds;
-float timeOfRestart;
+/***
+* One whole game. Every game, death and pause function takes it explicitly, so several can
+* live side by side; the CProcessing states at the bottom of the file run mainGame. The hot
+* simulation comes first, then the screens, then what is only touched on load, restart or F10.
+*
+* While pipelined (see gameUpdate) the sim, the ui's guide and the snapshots belong to the
+* simulation thread between a Post and the next Drain or Stop.
+***/
+typedef struct {
+	GameSim sim;
+	GameUi ui;
+	FramePacket packets[PIPELINE_PACKETS]; //the serial loop only uses the first
+	Pipeline* pipeline; //running only while pipelined in play
+	GameInput nextInput; //gathered frame by frame until a tick takes it
+
+	CP_Image cloudTexture, redhitFlash, coinIMG;
+	int flashWidth, flashHeight; //redhitFlash's, for drawing its edges alone
+	MipChain cloudMips; //cloudTexture and its smaller levels
+	MipCanvas cloudCanvases[CLOUD_DRAW_LEVELS]; //per level, made by the main thread the first time it is needed; [0] is never used
+	ParallaxLayer cloudLayers[CLOUD_LAYER_COUNT]; //generated once, then only the main thread touches their caches
+	uint32_t tuningVersion; //which edit of the tuning file this game has applied
+	uint32_t telemetryRun; //which run of this launch the events belong to
+
+	//frameStartSnapshot is the state before an F10 frame's update, the baseline it deltas against.
+	Snapshot frameStartSnapshot, currentSnapshot, decodedSnapshot;
+	Collectible restoredCoins[COIN_CAPACITY];
+} GameContext;
+
+GameContext mainGame; //the game on screen
+bool pipelined = true; //F7 switches between simulating a frame ahead on a worker and on the main thread
+
+//Shared by every game.
+Tuning tuning; //the constants from TUNING_PATH
+TextAtlas hudFont;
+NullAudioDevice silentOutput = { true };
+unsigned char* checkpointBytes; //read at launch, freed once the run is resumed
+int checkpointSize;
 
 
 ////////////////////////////
@@ -160,6 +298,7 @@ float finishingSeconds = 0;
 /////////////////////////
 
 void logo_init();
+void resume_init();
 void logo_update();
 void logo_exit();
 void game_init();
@@ -172,7 +311,11 @@ void pause_init();
 void pause_update();
 void pause_exit();
 
-void logo_init() {
+/* * * * * * * * * * * *
+* PROGRAM-WIDE SETUP *
+* * * * * * * * * * * */
+void initProgram() {
+	//Everything that lives for the whole program, whether it starts at the splash or resumes a run.
 	RED = CP_Color_Create(220, 17, 39, 255);
 	DARK_RED = CP_Color_Create(133, 0, 34, 255);
 	WHITE = CP_Color_Create(255, 255, 255, 255);
@@ -180,14 +323,38 @@ void logo_init() {
 	BLACK = CP_Color_Create(0, 0, 0, 255);
 	BLUE = CP_Color_Create(32, 192, 255, 255);
 
-	logo = CP_Image_Load("Assets/DigiPen_BLACK.png");
-
-	sprintf_s(playText, _countof(playText), "PLAY!");
+	//Decode every sound now so gameplay never waits on a file.
+	//Without a sound card, the mixer still runs against a silent device.
+	if (!Audio_Init(Audio_WaveOutDevice())) Audio_Init(Audio_NullDevice(&silentOutput));
+	Telemetry_Init(TELEMETRY_PATH);
+	Leaderboard_StartService(LEADERBOARD_PATH);
+	Checkpoint_Start(CHECKPOINT_PATH);
+	//Read the tuning file once now; after that a watcher thread picks up every save.
+	Tuning_Load(TUNING_PATH, &tuning);
+	Tuning_Watch(TUNING_PATH, &tuning);
+
+	//Same for text: build the glyph atlas once, and every size/color combination the game draws.
+	//If the font can't be loaded, drawText falls back to the default CProcessing font.
+	if (TextAtlas_Load(&hudFont, "Assets/fonts/AlloyInk-nRLyO.ttf", "a Alloy Ink")) {
+		TextAtlas_Prepare(&hudFont, 40, BLACK);
+		TextAtlas_Prepare(&hudFont, 60, BLACK);
+		TextAtlas_Prepare(&hudFont, 50, WHITE);
+		TextAtlas_Prepare(&hudFont, 100, WHITE);
+		TextAtlas_Prepare(&hudFont, 100, BLUE);
+		TextAtlas_Prepare(&hudFont, 70, BLUE);
+		TextAtlas_Prepare(&hudFont, 50, BLUE);
+		TextAtlas_Prepare(&hudFont, 40, BLUE);
+	}
 
 	CP_System_Fullscreen();
 	//CP_System_SetWindowSize(1000, 1000);
 }
 
+void logo_init() {
+	initProgram();
+	logo = Texture_Load("Assets/DigiPen_BLACK.png");
+}
+
 void logo_update() {
 	CP_Graphics_ClearBackground(RED);
 	int width = CP_System_GetWindowWidth();
@@ -287,80 +454,111 @@ void logo_exit() {
 	CP_Image_Free(&logo);
 }
 
-void initGlobalVariables() {
-	isIFraming = false;
+/* * * * * *
+* DRAW TEXT *
+ * * * * * */
+void drawText(const char* text, float x, float y, float size, CP_Color color) {
+	//Every string in the game is centered on (x, y).
+	if (hudFont.loaded) {
+		TextAtlas_DrawText(&hudFont, text, x, y, size, color, CP_TEXT_ALIGN_H_CENTER, CP_TEXT_ALIGN_V_MIDDLE);
+		return;
+	}
+	CP_Settings_Fill(color);
+	CP_Settings_TextSize(size);
+	CP_Font_DrawText(text, x, y);
+}
+
+void applyTuning(GameSim* s) {
+	//Everything except the starting speed can change in the middle of a run.
+	s->rotationIncrement = tuning.rotationIncrement; //the increment changes based on speed - the faster you are, the harder it is to turn.
+	s->rotationCap = tuning.rotationCap;
+	s->speedMin = tuning.speedMin;
+	s->speedBonus = tuning.speedBonus;
+	s->iFrameDuration = tuning.iFrameDuration;
+	s->coinCap = tuning.coinCap;
+	s->pickupRadius = tuning.pickupRadius;
+	s->collisionMargin = tuning.collisionMargin;
+	s->widthScalar = tuning.widthScalar;
+	s->heightScalar = tuning.heightScalar;
+	s->cloudLodSpeed = tuning.cloudLodSpeed;
+	s->cloudLowResSpeed = tuning.cloudLowResSpeed;
+	s->cameraZoom = tuning.cameraZoom;
+	s->cameraShake = tuning.cameraShake;
+	Governor_SetBudget(&s->governor, tuning.frameBudget / 1000);
+}
+
+void initGlobalVariables(GameContext* game) {
+	GameSim* s = &game->sim;
+	GameUi* ui = &game->ui;
+	s->isIFraming = false;
 
-	activeClouds = malloc(CLOUD_ARR_SIZE * sizeof * activeClouds);
+	if (!s->activeClouds) s->activeClouds = malloc(CLOUD_ARR_SIZE * sizeof * s->activeClouds);
 
-	globalX = 0;
-	globalY = -bounds.height / 2 + 100;
-	directionVector = CP_Vector_Set(0, 1);
+	s->origin.chunkX = 0;
+	s->origin.chunkY = 0;
+	s->globalX = 0;
+	s->globalY = -s->bounds.height / 2 + 100;
+	s->lastGlobalX = s->globalX;
+	s->lastGlobalY = s->globalY;
+	s->directionVector = CP_Vector_Set(0, 1);
 
-	rotationAngle = 0;
-	rotationIncrement = 0.03f; //the increment changes based on speed - the faster you are, the harder it is to turn.
-	rotationCap = 0.06f;
+	applyTuning(s);
+	s->rotationAngle = 0;
 
-	speed = 10;
-	speedMin = 8;
-	speedIncrement = 0.25f;
-	drag = 0.1f;
-	speedBonus = 3;
+	s->speed = tuning.speed;
+	s->speedMilestone = (int)(s->speed / SPEED_MILESTONE_STEP);
 
-	iFrameDuration = 1;
-	iFrameStart = 0;
-	flashAlpha = 0;
+	s->iFrameStart = 0;
+	s->flashAlpha = 0;
 
-	remainingLives = 3;
-	score = 0;
+	s->remainingLives = 3;
+	s->score = 0;
 
-	coinVelocity = 1;
-	coinYPos = 0;
-	coinCap = 10;
-	coinAlpha = 255;
-	coinFadeSpeed = 1;
-	coinTriggered = false;
+	s->coinVelocity = 1;
+	s->coinYPos = 0;
 
-	sprintf_s(guide, _countof(guide), "Collect the coin for points!");
+	sprintf_s(ui->guide, _countof(ui->guide), "Collect the coins for points!");
 
 }
 
-void initBounds() {
-	bounds.north = -wh;
-	bounds.east = 2 * ww;
-	bounds.south = 2 * wh;
-	bounds.west = -ww;
-	bounds.width = bounds.east - bounds.west;
-	bounds.height = bounds.south - bounds.north;
+void initBounds(GameSim* s) {
+	s->bounds.north = -s->wh;
+	s->bounds.east = 2 * s->ww;
+	s->bounds.south = 2 * s->wh;
+	s->bounds.west = -s->ww;
+	s->bounds.width = s->bounds.east - s->bounds.west;
+	s->bounds.height = s->bounds.south - s->bounds.north;
 }
 
 /* * * * * * *
 * DRAW PLAYER *
  * * * * * * */
-void drawPlayer(CP_Color c) {
-	CP_Settings_Fill(c);
-	CP_Settings_NoStroke();
+void drawPlayer(GameSim* s, DrawList* list, CP_Color c) {
+	DrawList_Fill(list, c);
+	DrawList_NoStroke(list);
 
 	float bodyW = 30;
 	float bodyH = 70;
 	float bodyOffsetMult = 10;
-	CP_Vector bodyOffsetVector = CP_Vector_Set(bodyOffsetMult * directionVector.x, bodyOffsetMult * directionVector.y);
-	centerVector = CP_Vector_Set(ww / 2 - bodyOffsetVector.x, wh / 2 - bodyOffsetVector.y);
+	CP_Vector bodyOffsetVector = CP_Vector_Set(bodyOffsetMult * s->directionVector.x, bodyOffsetMult * s->directionVector.y);
+	s->centerVector = CP_Vector_Set(s->ww / 2 - bodyOffsetVector.x, s->wh / 2 - bodyOffsetVector.y);
 	float wingW = 70;
 	float wingYOffset = 9;
 	float wingH = 50;
 
-	float centerX = ww / 2;
-	float centerY = wh / 2;
+	//The middle of the view, in the world that's where the camera looks.
+	float centerX = s->camera.x;
+	float centerY = s->camera.y;
 
-	float bodyAngle = acos(directionVector.y) * 180 / PI;
-	bodyAngle = (directionVector.x <= 0) ? bodyAngle : -bodyAngle;
+	float bodyAngle = acos(s->directionVector.y) * 180 / PI;
+	bodyAngle = (s->directionVector.x <= 0) ? bodyAngle : -bodyAngle;
 
 \
-	if (!isIFraming || CP_System_GetFrameCount() % 10 < 5) {
+	if (!s->isIFraming || s->frame % 10 < 5) {
 		//Only draw the body if we're not iFraming OR if we are iFraming, the only draw the body every other frame (flash).
 
-		CP_Graphics_DrawEllipseAdvanced(centerX - bodyOffsetVector.x, centerY - bodyOffsetVector.y, bodyW, bodyH, bodyAngle);
-		CP_Graphics_DrawTriangleAdvanced(
+		DrawList_Ellipse(list, LAYER_PLAYER, centerX - bodyOffsetVector.x, centerY - bodyOffsetVector.y, bodyW, bodyH, bodyAngle);
+		DrawList_Triangle(list, LAYER_PLAYER,
 			centerX - wingW / 2,				//x1
 			centerY + wingH / 2 - wingYOffset,	//y1
 			centerX,							//x2
@@ -375,163 +573,693 @@ void drawPlayer(CP_Color c) {
 /* * * * * * * * * * * * *
 * RANDOMLY CREATE CLOUDS *
 * * * * * * * * * * * * */
-void createClouds() {
-	//This for loop simply assigns random positions and images to the clouds array.
+//xorshift32 like the camera's. The simulation can run on the pipeline's worker, where
+//CP_Random is off limits, so everything it randomizes comes from here.
+static float simRandom(void* state) {
+	GameSim* s = state;
+	s->rng ^= s->rng << 13;
+	s->rng ^= s->rng >> 17;
+	s->rng ^= s->rng << 5;
+	return (float)(s->rng >> 8) / (float)(1 << 24); //0 to 1
+}
+
+static float simRange(GameSim* s, float min, float max) {
+	return min + (max - min) * simRandom(s);
+}
+
+void createClouds(GameSim* s) {
+	//Spread the clouds out so none overlap or block the way, and none spawn on the plane.
 	//It is recalled every time the player warps through the screen.
+	CloudPlacement placement;
+	placement.left = s->bounds.west + s->ww / 2;
+	placement.right = s->bounds.east - s->ww / 2 - 200;
+	placement.top = s->bounds.north + s->wh / 2;
+	placement.bottom = s->bounds.south - s->wh / 2 - 100;
+	placement.size = CLOUD_LAYERS[CLOUD_LAYER_GAMEPLAY].scale;
+	placement.widthScalar = s->widthScalar;
+	placement.heightScalar = s->heightScalar;
+	placement.margin = s->collisionMargin;
+	placement.gap = s->collisionMargin; //a plane's width of room, on top of the margins
+	placement.types = 12; //Should be 13 but the last cloud in the texture pack isn't great for collision.
+	placement.safeX = s->ww / 2 - s->globalX;
+	placement.safeY = s->wh / 2 - s->globalY;
+	placement.safeRadius = fmaxf(CLOUD_SAFE_RADIUS, s->speed * CLOUD_SAFE_FRAMES);
+	placement.random = simRandom;
+	placement.randomState = s;
+	int placed = Placement_Clouds(&placement, s->activeClouds, CLOUD_ARR_SIZE);
+
+	//Only a window too small to fit them all gets here, the old way then.
+	for (int i = placed; i < CLOUD_ARR_SIZE; i++) {
+		s->activeClouds[i].size = CLOUD_LAYERS[CLOUD_LAYER_GAMEPLAY].scale;
+		s->activeClouds[i].x = simRange(s, s->bounds.west + s->ww / 2, s->bounds.east - s->ww / 2 - 200);
+		s->activeClouds[i].y = simRange(s, s->bounds.north + s->wh / 2, s->bounds.south - s->wh / 2 - 100);
+		s->activeClouds[i].img_id = (int)(simRandom(s) * 12); //Should be 0 to 12 but the last cloud in the texture pack isn't great for collision.
+	}
+	Autopilot_SetClouds(&s->navigator, s->activeClouds, CLOUD_ARR_SIZE, s->widthScalar, s->heightScalar, s->collisionMargin);
+}
+
+/* * * * * * * * * * * * *
+* RANDOMLY CREATE COINS *
+* * * * * * * * * * * * */
+void createCoins(GameSim* s) {
+	//Same spawn area as the clouds. Coins are stored by their center in world space.
+	//The navigator's goals are added in the same order, so a goal is its coin's index.
+	Collectibles_Clear(&s->coins);
+	Autopilot_ClearGoals(&s->navigator);
+	for (int i = 0; i < COIN_COUNT; i++) {
+		float x = simRange(s, s->bounds.west + s->ww / 2, s->bounds.east - s->ww / 2 - 200);
+		float y = simRange(s, s->bounds.north + s->wh / 2, s->bounds.south - s->wh / 2 - 100);
+		Collectibles_Add(&s->coins, x + COIN_SIZE, y + COIN_SIZE);
+		Autopilot_AddGoal(&s->navigator, x + COIN_SIZE, y + COIN_SIZE);
+	}
+	Collectibles_Build(&s->coins, s->bounds.west, s->bounds.north, s->bounds.width, s->bounds.height, COIN_CELL_SIZE);
+}
+
+/* * * * * * *
+* TELEMETRY *
+* * * * * * */
+void logEvent(GameContext* game, TelemetryEventType type, int cloud) {
+	GameSim* s = &game->sim;
+	if (s->attract) return; //the demo isn't anybody's run
+	//only fills 32 bytes and hands them to the writer thread, cheap enough to call anywhere in a frame
+	TelemetryEvent event;
+	event.type = (uint16_t)type;
+	event.cloud = (int16_t)cloud;
+	event.run = game->telemetryRun;
+	event.time = s->now - s->timeOfRestart;
+	event.speed = s->speed;
+	event.score = s->score;
+	event.lives = s->remainingLives;
+	event.x = s->globalX;
+	event.y = s->globalY;
+	Telemetry_Emit(&event);
+}
+
+/* * * * *
+* SOUND *
+* * * * */
+//Audio_Play for the simulation. The demo flies on silently behind the pause menu.
+void playSound(const GameSim* s, SoundId sound, float volume, float pitch) {
+	if (s->attract) return;
+	Audio_Play(sound, volume, pitch);
+}
+
+/* * * * * * * * * *
+* BUILD THE MINIMAP *
+ * * * * * * * * * */
+void buildMinimap(GameSim* s) {
+	//Called once per world, after the clouds and coins are placed. Frames only draw the result,
+	//possibly on the other thread, so the whole rebuild is one edit.
+	Minimap_BeginEdit(&s->minimap);
+	Minimap_BeginWorld(&s->minimap, s->bounds.west, s->bounds.north, s->bounds.width, s->bounds.height);
 	for (int i = 0; i < CLOUD_ARR_SIZE; i++) {
-		activeClouds[i].size = 1;
-		activeClouds[i].x = CP_Random_RangeFloat(bounds.west + ww / 2, bounds.east - ww / 2 - 200);
-		activeClouds[i].y = CP_Random_RangeFloat(bounds.north + wh / 2, bounds.south - wh / 2 - 100);
-		activeClouds[i].img_id = CP_Random_RangeInt(0, 11); //Should be 0 to 12 but the last cloud in the texture pack isn't great for collision.
+		TextureRect currentTexture = CLOUD_TEXTURE_POSITIONS[s->activeClouds[i].img_id];
+		Minimap_AddCloud(&s->minimap, s->activeClouds[i].x, s->activeClouds[i].y, s->activeClouds[i].size * currentTexture.w, s->activeClouds[i].size * currentTexture.h);
+	}
+	for (int i = 0; i < s->coins.count; i++) {
+		if (!s->coins.items[i].collected) Minimap_AddCoin(&s->minimap, s->coins.items[i].x, s->coins.items[i].y);
 	}
+	Minimap_EndEdit(&s->minimap);
+}
+
+/* * * * * * * * * * *
+* CAPTURE GAME STATE *
+* * * * * * * * * * */
+void captureSnapshot(GameSim* s, Snapshot* snap) {
+	SnapshotState state = { 0 };
+	state.origin = s->origin;
+	state.globalX = s->globalX;
+	state.globalY = s->globalY;
+	state.directionX = s->directionVector.x;
+	state.directionY = s->directionVector.y;
+	state.rotationAngle = s->rotationAngle;
+	state.speed = s->speed;
+	state.remainingLives = s->remainingLives;
+	state.score = s->score;
+	state.isIFraming = s->isIFraming;
+	state.gameTime = s->now - s->timeOfRestart;
+	state.iFrameStart = s->iFrameStart - s->timeOfRestart;
+	state.flashAlpha = s->flashAlpha;
+	state.coinYPos = s->coinYPos;
+	state.coinVelocity = s->coinVelocity;
+	state.clouds = s->activeClouds;
+	state.cloudCount = CLOUD_ARR_SIZE;
+	state.coins = s->coins.items;
+	state.coinCount = s->coins.count;
+	Snapshot_Capture(snap, &state, s->frame);
 }
 
 /* * * * * * * * * * * *
-* RANDOMLY CREATE COIN *
+* RESTORE GAME STATE *
 * * * * * * * * * * * */
-void createCoin() {
-	activeCoin.x = CP_Random_RangeFloat(bounds.west + ww / 2, bounds.east - ww / 2 - 200);
-	activeCoin.y = CP_Random_RangeFloat(bounds.north + wh / 2, bounds.south - wh / 2 - 100);
-	mappedCoinVector = CP_Vector_Set(activeCoin.x + globalX, activeCoin.y + globalY);
-	coinAlpha = 255;
-	coinTriggered = false;
+bool restoreSnapshot(GameContext* game, const Snapshot* snap) {
+	GameSim* s = &game->sim;
+	SnapshotState state = { 0 };
+	state.clouds = s->activeClouds;
+	state.cloudCapacity = CLOUD_ARR_SIZE;
+	state.coins = game->restoredCoins;
+	state.coinCapacity = COIN_CAPACITY;
+	if (!Snapshot_Restore(snap, &state)) return false;
+
+	s->origin = state.origin;
+	s->globalX = s->lastGlobalX = state.globalX; //don't sweep from wherever we were before
+	s->globalY = s->lastGlobalY = state.globalY;
+	s->directionVector = CP_Vector_Set(state.directionX, state.directionY);
+	s->rotationAngle = state.rotationAngle;
+	s->speed = state.speed;
+	s->speedMilestone = (int)(s->speed / SPEED_MILESTONE_STEP);
+	s->remainingLives = state.remainingLives;
+	s->score = state.score;
+	s->isIFraming = state.isIFraming;
+	s->timeOfRestart = s->now - state.gameTime;
+	s->iFrameStart = s->timeOfRestart + state.iFrameStart;
+	s->flashAlpha = state.flashAlpha;
+	s->coinYPos = state.coinYPos;
+	s->coinVelocity = state.coinVelocity;
+
+	//The coins go back through the store so the grid is rebuilt for their positions.
+	Collectibles_Clear(&s->coins);
+	Autopilot_ClearGoals(&s->navigator);
+	for (int i = 0; i < state.coinCount; i++) {
+		int index = Collectibles_Add(&s->coins, game->restoredCoins[i].x, game->restoredCoins[i].y);
+		int goal = Autopilot_AddGoal(&s->navigator, game->restoredCoins[i].x, game->restoredCoins[i].y);
+		if (game->restoredCoins[i].collected) {
+			Collectibles_Collect(&s->coins, index);
+			Autopilot_RemoveGoal(&s->navigator, goal);
+		}
+	}
+	Autopilot_SetClouds(&s->navigator, s->activeClouds, CLOUD_ARR_SIZE, s->widthScalar, s->heightScalar, s->collisionMargin);
+	Collectibles_Build(&s->coins, s->bounds.west, s->bounds.north, s->bounds.width, s->bounds.height, COIN_CELL_SIZE);
+	buildMinimap(s);
+	return true;
 }
 
-/* * * * * *
-* DRAW COIN *
- * * * * * */
-void drawCoin(float initialX, float initialY, float size) {
-	mappedCoinVector.x = initialX + globalX + size / 2;
-	mappedCoinVector.y = initialY + globalY + coinYPos + size / 2;
-	CP_Image_Draw(coinIMG, mappedCoinVector.x, mappedCoinVector.y, size, size, coinAlpha);
-	coinYPos += coinVelocity;
-	if (coinYPos > coinCap || coinYPos < -coinCap) coinVelocity *= -1;
+/* * * * * * * * * * * *
+* SUSPEND AND RESUME *
+* * * * * * * * * * * */
+//A checkpoint is the window size the world was laid out for, then a snapshot keyframe.
+void saveCheckpoint(GameContext* game) {
+	GameSim* s = &game->sim;
+	//Only the capture and encode happen here; the writer thread does the disk.
+	captureSnapshot(s, &game->currentSnapshot);
+	int32_t screen[2] = { (int32_t)s->ww, (int32_t)s->wh };
+	int capacity = (int)sizeof screen + Snapshot_MaxEncodedSize(&game->currentSnapshot);
+	unsigned char* bytes = malloc(capacity);
+	if (!bytes) return;
+	memcpy(bytes, screen, sizeof screen);
+	int size = Snapshot_Encode(&game->currentSnapshot, NULL, bytes + sizeof screen, capacity - (int)sizeof screen);
+	if (size >= 0) Checkpoint_Save(bytes, (int)sizeof screen + size);
+	free(bytes);
+}
 
-	double x = centerVector.x - mappedCoinVector.x - size / 2;
-	double y = centerVector.y - mappedCoinVector.y - size / 2;
+bool resumeCheckpoint(GameContext* game) {
+	GameSim* s = &game->sim;
+	int32_t screen[2];
+	if (checkpointSize < (int)sizeof screen) return false;
+	memcpy(screen, checkpointBytes, sizeof screen);
+	//The bounds come from the window size, so the clouds only make sense on the same screen.
+	if (screen[0] != (int32_t)s->ww || screen[1] != (int32_t)s->wh) return false;
+	return Snapshot_Decode(checkpointBytes + sizeof screen, checkpointSize - (int)sizeof screen, NULL, &game->decodedSnapshot)
+		&& restoreSnapshot(game, &game->decodedSnapshot);
+}
 
-	double distance = sqrt(x * x + y * y);
+/* * * * * * *
+* DRAW CLOUDS *
+ * * * * * * */
+//The clouds a frame sends through the low resolution canvas, for drawCloudCanvas.
+typedef struct {
+	MipCanvas* canvas;
+	const MipChain* chain;
+	int screenWidth, screenHeight, level;
+	DrawTransform camera; //the canvas covers the screen, so the clouds are placed on it by hand
+	int count;
+	struct { float x, y; int img_id; } clouds[CLOUD_CANVAS_CAPACITY]; //world position, only count of them are recorded
+} CloudCanvasDraw;
+
+//Runs during Submit, on the main thread, which owns the canvases. It's recorded in the world
+//cloud layer but draws in screen pixels, so it sets the camera matrix aside while it does.
+void drawCloudCanvas(const void* data) {
+	const CloudCanvasDraw* draw = data;
+	MipCanvas* canvas = draw->canvas;
+	CP_Settings_Save();
+	CP_Settings_ResetMatrix();
+	if (!canvas->image) MipCanvas_Init(canvas, draw->screenWidth, draw->screenHeight, draw->level);
+	MipCanvas_Clear(canvas);
+	for (int i = 0; i < draw->count; i++) {
+		TextureRect texture = CLOUD_TEXTURE_POSITIONS[draw->clouds[i].img_id];
+		float x = draw->clouds[i].x * draw->camera.scale + draw->camera.offsetX;
+		float y = draw->clouds[i].y * draw->camera.scale + draw->camera.offsetY;
+		if (canvas->image) {
+			MipCanvas_Composite(canvas, draw->chain, x, y, texture.x0, texture.y0, texture.x1, texture.y1);
+		} else {
+			//no memory for the canvas, draw them one by one instead
+			float shrink = 1.0f / (1 << draw->level);
+			CP_Image_DrawSubImage(draw->chain->images[draw->level], x, y, texture.w, texture.h, texture.x0 * shrink, texture.y0 * shrink, texture.x1 * shrink, texture.y1 * shrink, 255);
+		}
+	}
+	if (canvas->image) MipCanvas_Draw(canvas, 255);
+	CP_Settings_Restore();
+}
+
+//What a frame hands the main thread to draw one scenery layer.
+typedef struct {
+	ParallaxLayer* layer;
+	const MipChain* chain;
+	float scrollX, scrollY;
+	int frame;
+	float viewWidth, viewHeight;
+} CloudLayerDraw;
+
+void drawCloudLayerCallback(const void* data) {
+	const CloudLayerDraw* draw = data;
+	ParallaxLayer_Draw(draw->layer, draw->chain, draw->scrollX, draw->scrollY, draw->frame, draw->viewWidth, draw->viewHeight);
+}
+
+//The whole layer is one callback: the cache belongs to the main thread, this one only says where.
+void drawCloudLayer(GameContext* game, DrawList* list, int index) {
+	GameSim* s = &game->sim;
+	CloudLayerDraw draw = { &game->cloudLayers[index], &game->cloudMips, s->layerScrollX[index], s->layerScrollY[index], s->frame, s->ww, s->wh };
+	DrawList_Callback(list, LAYER_SKY + index, drawCloudLayerCallback, &draw, sizeof draw);
+}
 
-	//Lock the X and Y value of the triangle's tip based to the edge of the screen if the coin is off screen... with some padding.
+/***
+* Each cloud is drawn from the mip level that fits its size and how fast the screen moves: at
+* cloudLodSpeed px/frame a cloud smears over as many pixels as one of its texels is wide at
+* level 0, twice that is level 1 and so on, and nobody can see the detail the higher levels
+* would add. The atlas's rects are in pixels of level 0, so they shrink with the level.
+*
+* Both are measured on screen, so they take the camera's zoom into account.
+*
+* From cloudLowResSpeed on, clouds drawn at their texture's size are composited into a canvas at their
+* level's resolution on the main thread instead, then drawn stretched, once per group of
+* overlapping clouds. That only fills less where clouds overlap, and costs an upload of the
+* whole canvas every frame, so the tuning file ships with it off.
+***/
+void drawClouds(GameContext* game, DrawList* list) {
+	GameSim* s = &game->sim;
+	const MipChain* chain = &game->cloudMips;
+	float zoom = s->camera.zoom;
+	float left, top, right, bottom;
+	DrawList_ViewRect(list, LAYER_CLOUDS, &left, &top, &right, &bottom);
+	float blur = (s->cloudLodSpeed > 0) ? s->speed * zoom / s->cloudLodSpeed : 1;
+	int canvasLevel = (s->cloudLowResSpeed > 0 && s->speed >= s->cloudLowResSpeed) ? MipChain_SelectLevel(chain, 1, blur) : 0;
+	if (canvasLevel >= CLOUD_DRAW_LEVELS) canvasLevel = CLOUD_DRAW_LEVELS - 1;
+	CloudCanvasDraw canvasDraw;
+	canvasDraw.count = 0;
+
+	for (int i = 0; i < CLOUD_ARR_SIZE; i++) {
+		Cloud currentCloud = s->activeClouds[i];
+		TextureRect currentTexture = CLOUD_TEXTURE_POSITIONS[currentCloud.img_id];
+		float w = currentCloud.size * currentTexture.w;
+		float h = currentCloud.size * currentTexture.h;
+		if (currentCloud.x > right || currentCloud.y > bottom || currentCloud.x + w < left || currentCloud.y + h < top) continue;
+
+		if (canvasLevel > 0 && currentCloud.size * zoom == 1 && canvasDraw.count < CLOUD_CANVAS_CAPACITY) {
+			canvasDraw.clouds[canvasDraw.count].x = currentCloud.x;
+			canvasDraw.clouds[canvasDraw.count].y = currentCloud.y;
+			canvasDraw.clouds[canvasDraw.count].img_id = currentCloud.img_id;
+			canvasDraw.count++;
+			continue;
+		}
+		int level = MipChain_SelectLevel(chain, currentCloud.size * zoom, blur);
+		if (level < s->quality.cloudLevel && chain->levelCount > s->quality.cloudLevel) level = s->quality.cloudLevel;
+		if (level >= CLOUD_DRAW_LEVELS) level = CLOUD_DRAW_LEVELS - 1;
+		CP_Image image = chain->levelCount ? chain->images[level] : game->cloudTexture;
+		float shrink = 1.0f / (1 << level);
+		DrawList_SubImage(list, LAYER_CLOUDS, image, currentCloud.x, currentCloud.y, w, h, currentTexture.x0 * shrink, currentTexture.y0 * shrink, currentTexture.x1 * shrink, currentTexture.y1 * shrink, 255);
+	}
+
+	if (canvasDraw.count) {
+		canvasDraw.canvas = &game->cloudCanvases[canvasLevel];
+		canvasDraw.chain = chain;
+		canvasDraw.screenWidth = (int)s->ww;
+		canvasDraw.screenHeight = (int)s->wh;
+		canvasDraw.level = canvasLevel;
+		canvasDraw.camera = Camera_Transform(&s->camera);
+		int size = (int)(offsetof(CloudCanvasDraw, clouds) + canvasDraw.count * sizeof * canvasDraw.clouds);
+		DrawList_Callback(list, LAYER_CLOUDS, drawCloudCanvas, &canvasDraw, size);
+	}
+}
+
+/* * * * * * * * * * * * * * *
+* DRAW COIN INDICATOR ARROW *
+* * * * * * * * * * * * * * */
+void drawCoinIndicator(GameSim* s, DrawList* list, float coinX, float coinY) {
+	//Lock the tip of the triangle to the edge of the screen... with some padding.
 	float hPadding = 100;
 	float vPadding = 70;
-	float triangleX = (mappedCoinVector.x + size / 2 > ww - hPadding) ? ww - hPadding : (mappedCoinVector.x + size / 2 < hPadding) ? hPadding : mappedCoinVector.x + size / 2;
-	float triangleY = (mappedCoinVector.y + size / 2 > wh - vPadding) ? wh - vPadding : (mappedCoinVector.y + size / 2 < vPadding) ? vPadding : mappedCoinVector.y + size / 2;
+	float triangleX = fminf(fmaxf(coinX, hPadding), s->ww - hPadding);
+	float triangleY = fminf(fmaxf(coinY, vPadding), s->wh - vPadding);
 	float triangleW = 60;
 	float triangleH = 50;
 
-	CP_Vector tv = CP_Vector_Normalize(CP_Vector_Subtract(centerVector, mappedCoinVector));
+	float playerX, playerY;
+	Camera_ToScreen(&s->camera, s->centerVector.x - s->globalX, s->centerVector.y - s->globalY, &playerX, &playerY);
+	CP_Vector tv = CP_Vector_Normalize(CP_Vector_Set(playerX - coinX, playerY - coinY));
 
-	float triangleR = acos(tv.y) * 180 / PI;
+	float triangleR = acosf(tv.y) * 180 / (float)PI;
 	triangleR = (tv.x <= 0) ? triangleR : -triangleR;
 
-	CP_Settings_Fill(CP_Color_Create(220, 220, 100, 255));
-	CP_Settings_Stroke(BLACK);
-	CP_Settings_StrokeWeight(2.0);
-
-	if (!coinTriggered)
-		if (mappedCoinVector.x + size / 2 > ww || mappedCoinVector.x + size / 2 < 0 || mappedCoinVector.y + size / 2 > wh || mappedCoinVector.y + size / 2 < 0)
-			CP_Graphics_DrawTriangleAdvanced(triangleX, triangleY, triangleX - triangleW / 2, triangleY + triangleH, triangleX + triangleW / 2, triangleY + triangleH, triangleR);
+	DrawList_Triangle(list, LAYER_INDICATORS, triangleX, triangleY, triangleX - triangleW / 2, triangleY + triangleH, triangleX + triangleW / 2, triangleY + triangleH, triangleR);
+}
 
-	if (distance < 75 && !coinTriggered) {
-		//Collect coin
-		score += speed;
-		speed += speedBonus;
-		coinAlpha = 0;
-		sprintf_s(guide, _countof(guide), "Explore for a new coin!");
-		coinTriggered = true;
+/* * * * * * *
+* DRAW COINS *
+ * * * * * * */
+void drawCoins(GameContext* game, DrawList* list) {
+	GameSim* s = &game->sim;
+	GameUi* ui = &game->ui;
+	int found[COIN_CAPACITY];
+	float size = COIN_SIZE;
+	float playerX = s->centerVector.x - s->globalX;
+	float playerY = s->centerVector.y - s->globalY;
+
+	//Only the coins inside the camera's view are drawn.
+	float viewX, viewY, viewW, viewH;
+	Camera_ViewRect(&s->camera, &viewX, &viewY, &viewW, &viewH);
+	int visible = Collectibles_QueryRect(&s->coins, viewX - size, viewY - size - s->coinCap, viewX + viewW + size, viewY + viewH + size + s->coinCap, found, COIN_CAPACITY);
+	for (int i = 0; i < visible; i++) {
+		Collectible* coin = &s->coins.items[found[i]];
+		DrawList_Image(list, LAYER_COINS, game->coinIMG, coin->x - size / 2, coin->y - size / 2 + s->coinYPos, size, size, 255);
+	}
+	s->coinYPos += s->coinVelocity;
+	if (s->coinYPos > s->coinCap || s->coinYPos < -s->coinCap) s->coinVelocity *= -1;
+
+	DrawList_Fill(list, CP_Color_Create(220, 220, 100, 255));
+	DrawList_Stroke(list, BLACK);
+	DrawList_StrokeWeight(list, 2.0);
+
+	int nearest = Collectibles_Nearest(&s->coins, playerX, playerY, COIN_INDICATORS, found);
+	for (int i = 0; i < nearest; i++) {
+		float coinX, coinY;
+		Camera_ToScreen(&s->camera, s->coins.items[found[i]].x, s->coins.items[found[i]].y + s->coinYPos, &coinX, &coinY);
+		if (coinX > s->ww || coinX < 0 || coinY > s->wh || coinY < 0) drawCoinIndicator(s, list, coinX, coinY);
 	}
 
-	CP_Settings_Fill(BLACK);
+	//Pickup only looks at the grid cells around the player.
+	int touched = Collectibles_QueryRadius(&s->coins, playerX, playerY, s->pickupRadius, found, COIN_CAPACITY);
+	for (int i = 0; i < touched; i++) {
+		Collectible* coin = &s->coins.items[found[i]];
+		Collectibles_Collect(&s->coins, found[i]);
+		Autopilot_RemoveGoal(&s->navigator, found[i]);
+		Minimap_BeginEdit(&s->minimap);
+		Minimap_RemoveCoin(&s->minimap, coin->x, coin->y);
+		Minimap_EndEdit(&s->minimap);
+		s->score += s->speed;
+		s->speed += s->speedBonus;
+		logEvent(game, TELEMETRY_COIN, -1);
+		playSound(s, SOUND_COWBELL, 0.8f, 1);
+		Particles_Burst(&s->effects, coin->x, coin->y + s->coinYPos, (int)(80 * s->quality.effects), 2, 9, 45, CP_Color_Create(255, 215, 0, 255));
+	}
+	if (touched && s->coins.remaining == 0) sprintf_s(ui->guide, _countof(ui->guide), "Explore for new coins!");
 }
 
-void game_init() {
-	cloudTexture = CP_Image_Load("Assets/cloudtextures.png");
-	redhitFlash = CP_Image_Load("Assets/redhit.png");
-	coinIMG = CP_Image_Load("Assets/coin.png");
-	BLACK.a = 255;
-
-	ww = CP_System_GetWindowWidth();
-	wh = CP_System_GetWindowHeight();
+void loadGame(GameContext* game) {
+	GameSim* s = &game->sim;
+	//Loaded on the first game only, a restart reuses them. Each comes from its .tex when
+	//HotAirTextures has made one, skipping the PNG decode (see texture.h).
+	if (!game->cloudTexture) {
+		game->cloudTexture = Texture_Load("Assets/cloudtextures.png");
+		MipChain_Build(&game->cloudMips, game->cloudTexture, CLOUD_MIP_LEVELS); //if it fails, clouds are drawn from cloudTexture alone
+		game->redhitFlash = Texture_Load("Assets/redhit.png");
+		game->flashWidth = game->redhitFlash ? CP_Image_GetWidth(game->redhitFlash) : 0;
+		game->flashHeight = game->redhitFlash ? CP_Image_GetHeight(game->redhitFlash) : 0;
+		game->coinIMG = Texture_Load("Assets/coin.png");
+	}
 
-	initBounds();
-	initGlobalVariables();
+	s->ww = CP_System_GetWindowWidth();
+	s->wh = CP_System_GetWindowHeight();
+	s->now = CP_System_GetSeconds();
+	s->frame = CP_System_GetFrameCount();
+
+	initBounds(s);
+	if (!s->governor.raiseWait) Governor_Init(&s->governor, tuning.frameBudget / 1000); //before the tuning is applied, which sets the budget
+	initGlobalVariables(game);
+	Camera_Init(&s->camera, s->ww, s->wh);
+	s->rng = (uint32_t)CP_Random_RangeInt(1, INT_MAX); //xorshift never leaves 0
+
+	//The coin store is allocated once and refilled on every restart.
+	if (!s->coins.capacity) Collectibles_Init(&s->coins, COIN_CAPACITY);
+	if (!s->navigator.cost) Autopilot_Init(&s->navigator, s->bounds.west, s->bounds.north, s->bounds.width, s->bounds.height, AUTOPILOT_CELL, CLOUD_ARR_SIZE, COIN_CAPACITY);
+	if (!game->cloudLayers[0].desc.scale) {
+		for (int i = 0; i < CLOUD_LAYER_COUNT; i++) ParallaxLayer_Generate(&game->cloudLayers[i], &CLOUD_LAYERS[i], &game->cloudMips, (int)s->ww, (int)s->wh, i * 7);
+	}
+	if (!s->minimap.image) Minimap_Init(&s->minimap, MINIMAP_WIDTH, s->bounds.width, s->bounds.height);
+	if (!game->frameStartSnapshot.words) {
+		Snapshot_Init(&game->frameStartSnapshot, CLOUD_ARR_SIZE, COIN_CAPACITY);
+		Snapshot_Init(&game->currentSnapshot, CLOUD_ARR_SIZE, COIN_CAPACITY);
+		Snapshot_Init(&game->decodedSnapshot, CLOUD_ARR_SIZE, COIN_CAPACITY);
+	}
 
-	createClouds();
-	createCoin();
+	//The pool lives for the whole program, a restart just empties it.
+	if (!s->effects.capacity) Particles_Init(&s->effects, PARTICLE_CAPACITY, simRandom, s);
+	Particles_Clear(&s->effects);
+	for (int i = 0; i < PIPELINE_PACKETS; i++) {
+		if (!game->packets[i].draws.commands) DrawList_Init(&game->packets[i].draws, DRAW_LIST_CAPACITY);
+	}
+	memset(&game->nextInput, 0, sizeof game->nextInput);
 
 	CP_Settings_Fill(BLACK);
 	CP_Settings_TextAlignment(CP_TEXT_ALIGN_H_CENTER, CP_TEXT_ALIGN_V_MIDDLE);
 	CP_Settings_ImageMode(CP_POSITION_CORNER);
 }
 
-void game_update() {
+void startRun(GameContext* game) {
+	GameSim* s = &game->sim;
+	s->runStarted = false;
+	s->attract = false;
+	game->telemetryRun++;
+	s->nextSpeedSample = 0;
+	logEvent(game, TELEMETRY_RUN_START, -1);
+}
 
-	// DRAW BACKGROUND (Sky)
-	CP_Graphics_ClearBackground(BLUE);
-	CP_Settings_Fill(BLACK);
-	CP_System_ShowCursor(false);
+void gameInit(GameContext* game) {
+	GameSim* s = &game->sim;
+	loadGame(game);
+	createClouds(s);
+	createCoins(s);
+	buildMinimap(s);
+	Checkpoint_Discard(); //a new run, the suspended one is gone
+	startRun(game);
+}
 
+void resumeInit(GameContext* game) {
+	GameSim* s = &game->sim;
+	GameUi* ui = &game->ui;
+	//Straight from launch into the suspended run: no splash, and only the assets gameplay draws.
+	initProgram();
+	loadGame(game);
+	bool resumed = resumeCheckpoint(game);
+	free(checkpointBytes);
+	checkpointBytes = NULL;
+	if (!resumed) {
+		//Unreadable, or made on another screen: start a new run in the pause menu, where the splash would have left us.
+		createClouds(s);
+		createCoins(s);
+		buildMinimap(s);
+		Checkpoint_Discard();
+		startRun(game);
+		CP_Engine_SetNextGameState(pause_init, pause_update, pause_exit);
+		return;
+	}
+	startRun(game);
+	s->runStarted = true;
+	//MSVC's clock() is wall time since the process started, so this is launch to the first resumed frame.
+	sprintf_s(ui->guide, _countof(ui->guide), "Resumed in %d ms", (int)(clock() * 1000 / CLOCKS_PER_SEC));
+}
+
+//Minimap_Draw's arguments, copied into the draw list so the minimap is drawn in its layer.
+typedef struct {
+	Minimap* map;
+	float x, y;
+	float playerX, playerY;
+	float viewX, viewY, viewW, viewH;
+} MinimapDraw;
+
+void drawMinimap(const void* data) {
+	const MinimapDraw* draw = data;
+	Minimap_Draw(draw->map, draw->x, draw->y, draw->playerX, draw->playerY, draw->viewX, draw->viewY, draw->viewW, draw->viewH);
+}
+
+//The hit flash's image around the screen's edges only, for when the governor can't afford
+//blending it over every pixel. Each strip is cut from the same edge of the image.
+void drawFlashEdges(GameContext* game, DrawList* list) {
+	GameSim* s = &game->sim;
+	float w = (float)game->flashWidth;
+	float h = (float)game->flashHeight;
+	float edgeX = s->ww * FLASH_EDGE, edgeY = s->wh * FLASH_EDGE;
+	float texX = w * FLASH_EDGE, texY = h * FLASH_EDGE;
+	int alpha = (int)s->flashAlpha;
+	DrawList_SubImage(list, LAYER_FLASH, game->redhitFlash, 0, 0, s->ww, edgeY, 0, 0, w, texY, alpha);
+	DrawList_SubImage(list, LAYER_FLASH, game->redhitFlash, 0, s->wh - edgeY, s->ww, edgeY, 0, h - texY, w, h, alpha);
+	DrawList_SubImage(list, LAYER_FLASH, game->redhitFlash, 0, edgeY, edgeX, s->wh - 2 * edgeY, 0, texY, texX, h - texY, alpha);
+	DrawList_SubImage(list, LAYER_FLASH, game->redhitFlash, s->ww - edgeX, edgeY, edgeX, s->wh - 2 * edgeY, w - texX, texY, w, h - texY, alpha);
+}
+
+/* * * * * * * * * *
+* GOVERNOR OVERLAY *
+* * * * * * * * * */
+//F8: what the governor decided and the frame times it decided on, one bar per frame, and
+//what the draw list made of the frame before.
+//The bars, the budget line and the text use different fills and overlap, so each goes in
+//its own layer; inside one layer the draw list would be free to draw the panel over them.
+void drawGovernor(GameSim* s, DrawList* list) {
+	const Governor* g = &s->governor;
+	float left = 20, bottom = s->wh - 20;
+	float barWidth = 5, msHeight = 4; //pixels per bar, per millisecond
+	float budgetMs = g->budget * 1000;
+	DrawList_Fill(list, CP_Color_Create(255, 255, 255, 160));
+	DrawList_Rect(list, LAYER_OVERLAY_PANEL, left, bottom - 330, GOVERNOR_WINDOW * barWidth + 20, 330);
+
+	for (int age = 0; age < GOVERNOR_WINDOW; age++) {
+		float ms = Governor_Sample(g, age) * 1000;
+		float height = fminf(ms, 4 * budgetMs) * msHeight;
+		DrawList_Fill(list, (ms > budgetMs) ? CP_Color_Create(220, 17, 39, 255) : CP_Color_Create(40, 160, 60, 255));
+		DrawList_Rect(list, LAYER_OVERLAY_GRAPH, left + 10 + (GOVERNOR_WINDOW - 1 - age) * barWidth, bottom - 10 - height, barWidth - 1, height);
+	}
+	DrawList_Fill(list, BLACK);
+	DrawList_Rect(list, LAYER_OVERLAY, left + 10, bottom - 10 - budgetMs * msHeight, GOVERNOR_WINDOW * barWidth, 1);
+
+	static const char* DECISIONS[] = { "holding", "lowered", "raised" };
+	char line[64];
+	float x = left + 10 + GOVERNOR_WINDOW * barWidth / 2;
+	sprintf_s(line, _countof(line), "Quality %d/%d, %s %d ago", GOVERNOR_LEVELS - 1 - g->level, GOVERNOR_LEVELS - 1, DECISIONS[g->lastDecision], g->framesSinceChange);
+	DrawList_Text(list, LAYER_OVERLAY, &hudFont, line, x, bottom - 310, 40, BLACK);
+	sprintf_s(line, _countof(line), "Slow %.1f of %.1f ms", g->slowFrame * 1000, budgetMs);
+	DrawList_Text(list, LAYER_OVERLAY, &hudFont, line, x, bottom - 270, 40, BLACK);
+	sprintf_s(line, _countof(line), "Sky -%d, effects %d%%, mip %d", s->quality.sceneryDropped, (int)(s->quality.effects * 100), s->quality.cloudLevel);
+	DrawList_Text(list, LAYER_OVERLAY, &hudFont, line, x, bottom - 230, 40, BLACK);
+	sprintf_s(line, _countof(line), "%s flash, %s HUD", s->quality.fullFlash ? "Full" : "Edge", s->quality.hudDetail ? "full" : "lean");
+	DrawList_Text(list, LAYER_OVERLAY, &hudFont, line, x, bottom - 190, 40, BLACK);
+	const DrawListStats* d = &s->drawStats;
+	sprintf_s(line, _countof(line), "Draws %d, states %d, tex %d", d->drawCalls, d->stateChanges, d->textureSwitches);
+	DrawList_Text(list, LAYER_OVERLAY, &hudFont, line, x, bottom - 150, 40, BLACK);
+	sprintf_s(line, _countof(line), "Cmds %d, culled %d, lost %d", d->commands, d->culled, d->dropped);
+	DrawList_Text(list, LAYER_OVERLAY, &hudFont, line, x, bottom - 110, 40, BLACK);
+}
+
+/***
+* One frame of the game: move, collide, and record the frame into packet->draws. It never
+* calls CProcessing's input, time, settings or drawing functions, so it can run on the
+* simulation thread while the main thread draws the frame before it.
+*
+* Returns false without touching packet once the run is over, for the tick that was already
+* queued when the death happened.
+***/
+bool simulateFrame(GameContext* game, const GameInput* input, FramePacket* packet) {
+	GameSim* s = &game->sim;
+	GameUi* ui = &game->ui;
+	DrawList* list = &packet->draws;
+	if (s->remainingLives <= 0) return false;
+
+	DrawList_Begin(list, s->ww, s->wh);
+	packet->died = false;
+	s->now = input->seconds;
+	s->frame = input->frame;
+	s->runStarted = !s->attract; //the demo flying isn't a run to suspend
+
+	//A saved tuning file takes effect from this frame on.
+	if (Tuning_Poll(&game->tuningVersion, &tuning)) applyTuning(s);
+	Governor_Frame(&s->governor, input->frameSeconds);
+	s->quality = Governor_Levers(&s->governor);
+	s->showGovernor ^= input->governorOverlay;
+	s->drawStats = input->drawStats;
+
+	//only F10 reads the baseline, so only its frames pay for taking it
+	if (input->snapshot) captureSnapshot(s, &game->frameStartSnapshot);
+
+	//Everything in the world is recorded at its world position from here on, the camera places it.
+	Camera_Update(&s->camera, s->ww / 2 - s->globalX, s->wh / 2 - s->globalY, s->cameraZoom, s->cameraShake);
+	DrawList_SetCamera(list, Camera_Transform(&s->camera), LAYER_CLOUDS, LAYER_PARTICLES);
 
 	/*************\
 	| DRAW CLOUDS |
 	\*************/
+	//Drawn ahead of the collision loop, which may end the frame early on a death.
+	for (int i = 0; i < CLOUD_LAYER_COUNT; i++) {
+		if (CLOUD_LAYERS[i].collides) {
+			drawClouds(game, list);
+		} else if (i >= s->quality.sceneryDropped) { //the faintest layers are first
+			drawCloudLayer(game, list, i);
+		}
+	}
+
+	/******************\
+	| CLOUD COLLISIONS |
+	\******************/
+	//the plane's world position where this frame's sweep starts and ends
+	float sweepStartX = s->centerVector.x - s->lastGlobalX;
+	float sweepStartY = s->centerVector.y - s->lastGlobalY;
+	float sweepEndX = s->centerVector.x - s->globalX;
+	float sweepEndY = s->centerVector.y - s->globalY;
 	for (int i = 0; i < CLOUD_ARR_SIZE; i++) {
-		Cloud currentCloud = activeClouds[i];
+		Cloud currentCloud = s->activeClouds[i];
 		TextureRect currentTexture = CLOUD_TEXTURE_POSITIONS[currentCloud.img_id];
-		CP_Image_DrawSubImage(cloudTexture, currentCloud.x + globalX, currentCloud.y + globalY, currentCloud.size * currentTexture.w, currentCloud.size * currentTexture.h, currentTexture.x0, currentTexture.y0, currentTexture.x1, currentTexture.y1, 255);
-
-		float widthScalar = 0.8f;
-		float heightScalar = 0.7f;
-
-		CP_Vector currentCloudVector = CP_Vector_Set(currentCloud.x + globalX + currentTexture.w / 2, currentCloud.y + globalY + currentTexture.h / 2);
+		float widthScalar = s->widthScalar;
+		float heightScalar = s->heightScalar;
 
 		/*
 		to get the radius of the cloud ellipse collision:
 		r = ab / root(a * a * sin^2(theta) + b * b * cos^2(theta))
 		where:
-			a = currentTexture.w * 0.75 / 2
-			b = cloud height / 2
+			a = currentCloud.size * currentTexture.w * widthScalar / 2
+			b = currentCloud.size * currentTexture.h * heightScalar / 2
 			theta = horiztonal angle towards ship
 
-		To get the horizontal angle towards the ship:
-			acos(plane.y-cloud.y / distance) * 180 / PI
+		The plane can move further than a whole cloud in one frame once speed gets high,
+		so instead of only testing where the plane is now, sweep it along everything it
+		covered since the last check (see collision.c).
 		*/
 
-		double a = currentTexture.w * widthScalar / 2;
-		double b = currentTexture.h * heightScalar / 2;
-		double x = centerVector.x - currentCloudVector.x;
-		double y = centerVector.y - currentCloudVector.y;
-		double distance = sqrt(x * x + y * y);
-		double t = acos(x / distance);
-		double ellipseRadiusTowardsPlayer = a * b / sqrt(a * a * sin(t) * sin(t) + b * b * cos(t) * cos(t));
+		float a = currentCloud.size * currentTexture.w * widthScalar / 2;
+		float b = currentCloud.size * currentTexture.h * heightScalar / 2;
+		float cloudCenterX = currentCloud.x + currentCloud.size * currentTexture.w / 2;
+		float cloudCenterY = currentCloud.y + currentCloud.size * currentTexture.h / 2;
+		float startX = sweepStartX - cloudCenterX;
+		float startY = sweepStartY - cloudCenterY;
+		float endX = sweepEndX - cloudCenterX;
+		float endY = sweepEndY - cloudCenterY;
 
 		//COLISION
-		if (!isIFraming && ellipseRadiusTowardsPlayer + 35 > distance) {
-			remainingLives--;
-			if (remainingLives <= 0) {
+		if (!s->isIFraming && Collision_SweepCloud(startX, startY, endX, endY, a, b, s->collisionMargin) >= 0) {
+			s->remainingLives--;
+			logEvent(game, (s->remainingLives <= 0) ? TELEMETRY_DEATH : TELEMETRY_HIT, currentCloud.img_id);
+			playSound(s, SOUND_BASSDRUM, 1, 1);
+			playSound(s, (s->remainingLives <= 0) ? SOUND_CLAP : SOUND_SNARE, 0.7f, 1);
+			Particles_Burst(&s->effects, sweepEndX, sweepEndY, (int)(120 * s->quality.effects), 3, 12, 40, CP_Color_Create(220, 17, 39, 255));
+			Camera_Shake(&s->camera, CAMERA_HIT_TRAUMA);
+			if (s->remainingLives <= 0) {
 				//PLAYER DIED
-				//instead of running iFrames, let's swap to the death gamestate
-				CP_Engine_SetNextGameState(death_init, death_update, death_exit);
-				return;
+				//instead of running iFrames, the main thread swaps to the death gamestate
+				packet->died = true; //the death screen fades in over this frame
+				DrawList_Sort(list);
+				return true;
 			}
-			speed *= 2;
-			isIFraming = true;
-			flashAlpha = 255;
-			iFrameStart = CP_System_GetSeconds();
+			s->speed *= 2;
+			s->isIFraming = true;
+			s->flashAlpha = 255;
+			s->iFrameStart = s->now;
 		}
 	}
+	s->lastGlobalX = s->globalX;
+	s->lastGlobalY = s->globalY;
 
 
 	/*************\
 	| DRAW PLAYER |
 	\*************/
-	drawPlayer(BLACK);
+	drawPlayer(s, list, BLACK);
 
-	/***********\
-	| DRAW COIN |
-	\***********/
-	drawCoin(activeCoin.x, activeCoin.y, 80);
+	/************\
+	| DRAW COINS |
+	\************/
+	drawCoins(game, list);
+
+	/****************\
+	| DRAW PARTICLES |
+	\****************/
+	Particles_Update(&s->effects);
+	Particles_Draw(&s->effects, list, LAYER_PARTICLES, 8);
 
 	/*******************************************************\
 	| CALCULATE VELOCITY, POSITION, ROTATION, AND DIRECTION |
@@ -539,17 +1267,17 @@ void game_update() {
 
 	//x2 = cosAx1 − sinAy1
 	//y2 = sinAx1 + cosAy1
-	double newVX = cos(rotationAngle) * directionVector.x - sin(rotationAngle) * directionVector.y;
-	double newVY = sin(rotationAngle) * directionVector.x + cos(rotationAngle) * directionVector.y;
+	double newVX = cos(s->rotationAngle) * s->directionVector.x - sin(s->rotationAngle) * s->directionVector.y;
+	double newVY = sin(s->rotationAngle) * s->directionVector.x + cos(s->rotationAngle) * s->directionVector.y;
 
-	directionVector.x = newVX;
-	directionVector.y = newVY;
+	s->directionVector.x = newVX;
+	s->directionVector.y = newVY;
 
-	directionVector = CP_Vector_Normalize(directionVector);
+	s->directionVector = CP_Vector_Normalize(s->directionVector);
 
-	rotationAngle = (rotationAngle > rotationCap) ? rotationCap : (rotationAngle < -rotationCap) ? -rotationCap : rotationAngle;
+	s->rotationAngle = (s->rotationAngle > s->rotationCap) ? s->rotationCap : (s->rotationAngle < -s->rotationCap) ? -s->rotationCap : s->rotationAngle;
 
-	speed = (speed < speedMin) ? speedMin : speed;
+	s->speed = (s->speed < s->speedMin) ? s->speedMin : s->speed;
 	/*
 	The statements above are known as Ternary Operators:
 
@@ -576,56 +1304,97 @@ void game_update() {
 	There are more negatives than positives, but I really enjoy the compactness.
 	*/
 
-	globalX += directionVector.x * speed;
-	globalY += directionVector.y * speed;
+	//Play the next note of the piano scale every time speed climbs past another milestone.
+	int milestone = (int)(s->speed / SPEED_MILESTONE_STEP);
+	if (milestone > s->speedMilestone) playSound(s, SOUND_PIANO_A + milestone % 7, 0.6f, 1);
+	s->speedMilestone = milestone;
+
+	float gameTime = s->now - s->timeOfRestart;
+	if (gameTime >= s->nextSpeedSample) {
+		logEvent(game, TELEMETRY_SPEED, -1);
+		s->nextSpeedSample = gameTime + SPEED_SAMPLE_SECONDS;
+	}
 
-	if (globalX > bounds.width / 2 || globalX < -bounds.width / 2) {
-		//if we're out of bounds, teleport to the opposite boundary.
-		globalX *= -1;
-		createClouds(); //no clouds are visible, great time to randomize them!
-		createCoin();
-		sprintf_s(guide, _countof(guide), "");
+	s->globalX += s->directionVector.x * s->speed;
+	s->globalY += s->directionVector.y * s->speed;
+	for (int i = 0; i < CLOUD_LAYER_COUNT; i++) {
+		ParallaxLayer_Scroll(&game->cloudLayers[i], &s->layerScrollX[i], &s->layerScrollY[i], s->directionVector.x * s->speed, s->directionVector.y * s->speed);
 	}
 
-	if (globalY > bounds.height / 2 || globalY < -bounds.height / 2) {
-		globalY *= -1;
-		createClouds();
-		createCoin();
-		sprintf_s(guide, _countof(guide), "");
+	float shiftX, shiftY;
+	if (WorldOrigin_Rebase(&s->origin, &s->globalX, &s->globalY, s->bounds.width, s->bounds.height, &shiftX, &shiftY)) {
+		//if we're out of bounds, the origin moves to the chunk we're in and a new world is built
+		//there. Only the effects around the plane live on across it, so they're all that moves.
+		if (shiftX) s->lastGlobalX = s->globalX; //don't sweep across the teleport
+		if (shiftY) s->lastGlobalY = s->globalY;
+		Particles_Move(&s->effects, -shiftX, -shiftY);
+		logEvent(game, TELEMETRY_WORLD, -1);
+		createClouds(s); //no clouds are visible, great time to randomize them!
+		createCoins(s);
+		buildMinimap(s);
+		sprintf_s(ui->guide, _countof(ui->guide), "");
 	}
 
 	/***********\
 	| DRAW TEXT |
 	\***********/
-	CP_Settings_TextSize(40.0f);
-
-	sprintf_s(buffer, _countof(buffer), "Speed: %.0f", speed);
-	CP_Font_DrawText(buffer, 200, 250);
-
-	sprintf_s(buffer, _countof(buffer), "Direction: %.0f", acos(directionVector.y) * 180 / PI);
-	CP_Font_DrawText(buffer, 200, 200);
-
-	sprintf_s(buffer, _countof(buffer), "Game Time: %.1f", CP_System_GetSeconds() - timeOfRestart);
-	CP_Font_DrawText(buffer, 200, 50);
+	if (s->quality.hudDetail) {
+		sprintf_s(ui->buffer, _countof(ui->buffer), "Speed: %.0f", s->speed);
+		DrawList_Text(list, LAYER_HUD, &hudFont, ui->buffer, 200, 250, 40, BLACK);
 
-	sprintf_s(buffer, _countof(buffer), "Score: %d", score);
-	CP_Font_DrawText(buffer, 200, 150);
-
-	sprintf_s(buffer, _countof(buffer), "Lives: %d", remainingLives);
-	CP_Font_DrawText(buffer, 200, 100);
+		sprintf_s(ui->buffer, _countof(ui->buffer), "Direction: %.0f", acos(s->directionVector.y) * 180 / PI);
+		DrawList_Text(list, LAYER_HUD, &hudFont, ui->buffer, 200, 200, 40, BLACK);
+	}
 
-	CP_Settings_TextSize(60.0f);
-	CP_Font_DrawText(guide, ww / 2, 100);
+	sprintf_s(ui->buffer, _countof(ui->buffer), "Game Time: %.1f", gameTime);
+	DrawList_Text(list, LAYER_HUD, &hudFont, ui->buffer, 200, 50, 40, BLACK);
+
+	sprintf_s(ui->buffer, _countof(ui->buffer), "Score: %d", s->score);
+	DrawList_Text(list, LAYER_HUD, &hudFont, ui->buffer, 200, 150, 40, BLACK);
+
+	sprintf_s(ui->buffer, _countof(ui->buffer), "Lives: %d", s->remainingLives);
+	DrawList_Text(list, LAYER_HUD, &hudFont, ui->buffer, 200, 100, 40, BLACK);
+
+	DrawList_Text(list, LAYER_HUD, &hudFont, ui->guide, s->ww / 2, 100, 60, BLACK);
+
+	/**************\
+	| DRAW MINIMAP |
+	\**************/
+	//The window shows the camera's view, the player sits at centerVector.
+	float viewX, viewY, viewW, viewH;
+	Camera_ViewRect(&s->camera, &viewX, &viewY, &viewW, &viewH);
+	MinimapDraw minimap = { &s->minimap, s->ww - s->minimap.width - MINIMAP_MARGIN, s->wh - s->minimap.height - MINIMAP_MARGIN,
+		s->centerVector.x - s->globalX, s->centerVector.y - s->globalY, viewX, viewY, viewW, viewH };
+	DrawList_Callback(list, LAYER_MINIMAP, drawMinimap, &minimap, sizeof minimap);
+
+	if (s->showGovernor) drawGovernor(s, list);
+
+	//F10 round trips the game state: capture, encode as a keyframe and as a delta
+	//against the start of this frame, decode both, and play on from the decoded copy.
+	if (input->snapshot) {
+		captureSnapshot(s, &game->currentSnapshot);
+		int capacity = Snapshot_MaxEncodedSize(&game->currentSnapshot);
+		unsigned char* bytes = malloc(capacity);
+		if (bytes) {
+			int keyframeSize = Snapshot_Encode(&game->currentSnapshot, NULL, bytes, capacity);
+			bool keyframeOk = Snapshot_Decode(bytes, keyframeSize, NULL, &game->decodedSnapshot) && Snapshot_Equal(&game->decodedSnapshot, &game->currentSnapshot);
+			int deltaSize = Snapshot_Encode(&game->currentSnapshot, &game->frameStartSnapshot, bytes, capacity);
+			bool deltaOk = Snapshot_Decode(bytes, deltaSize, &game->frameStartSnapshot, &game->decodedSnapshot) && Snapshot_Equal(&game->decodedSnapshot, &game->currentSnapshot);
+			if (keyframeOk && deltaOk) restoreSnapshot(game, &game->decodedSnapshot);
+			sprintf_s(ui->guide, _countof(ui->guide), "Snapshot %d B, delta %d B, %s", keyframeSize, deltaSize, (keyframeOk && deltaOk) ? "OK" : "MISMATCH");
+			free(bytes);
+		}
+	}
 
 	/*********\
 	| CONTROL |
 	\*********/
-	if (CP_Input_KeyDown(KEY_A) || CP_Input_KeyDown(KEY_LEFT)) {
-		rotationAngle -= rotationIncrement;
-	} else if (CP_Input_KeyDown(KEY_D) || CP_Input_KeyDown(KEY_RIGHT)) {
-		rotationAngle += rotationIncrement;
+	if (input->left) {
+		s->rotationAngle -= s->rotationIncrement;
+	} else if (input->right) {
+		s->rotationAngle += s->rotationIncrement;
 	} else {
-		rotationAngle = 0;
+		s->rotationAngle = 0;
 	}
 
 	/**********\
@@ -633,29 +1402,147 @@ void game_update() {
 	\**********/
 	//When the player gets hit by a cloud:
 	// Flash the screen, time the iframes, increase turbulence, decrease speed, mark a "HIT"
-	if (isIFraming) {
+	if (s->isIFraming) {
 		//We just got hit! 
-		CP_Image_Draw(redhitFlash, 0, 0, ww, wh, flashAlpha);
-		flashAlpha -= 10;
-		rotationAngle += CP_Random_RangeFloat(-1, 1) / 2;
-
-		if (CP_System_GetSeconds() >= iFrameStart + iFrameDuration) {
-			isIFraming = false;
-			speed /= 4;
-			flashAlpha = 0;
+		if (s->quality.fullFlash) {
+			DrawList_Image(list, LAYER_FLASH, game->redhitFlash, 0, 0, s->ww, s->wh, s->flashAlpha);
+		} else {
+			drawFlashEdges(game, list);
+		}
+		s->flashAlpha -= 10;
+		s->rotationAngle += simRange(s, -1, 1) / 2;
+
+		if (s->now >= s->iFrameStart + s->iFrameDuration) {
+			s->isIFraming = false;
+			s->speed /= 4;
+			s->flashAlpha = 0;
 		}
 	}
 
+	DrawList_Sort(list); //here rather than in Submit, so the main thread only draws
+	return true;
+}
+
+bool tickGame(void* context, const void* input, void* packet) {
+	return simulateFrame(context, input, packet);
+}
+
+void gatherInput(GameInput* input) {
+	input->left = CP_Input_KeyDown(KEY_A) || CP_Input_KeyDown(KEY_LEFT);
+	input->right = CP_Input_KeyDown(KEY_D) || CP_Input_KeyDown(KEY_RIGHT);
+	input->snapshot |= CP_Input_KeyReleased(KEY_F10); //kept until a tick has seen it
+	input->governorOverlay |= CP_Input_KeyReleased(KEY_F8);
+	input->frameSeconds = CP_System_GetDt();
+	input->seconds = CP_System_GetSeconds();
+	input->frame = CP_System_GetFrameCount();
+}
+
+/***
+* Pipelined, the simulation runs on its own thread one frame ahead: while this frame draws
+* the packet of the last tick, the worker is already simulating the next one from the input
+* just posted. The main thread keeps CProcessing, which must stay on the thread that owns the
+* window. Input reaches the screen a frame later than in the serial loop.
+***/
+void gameUpdate(GameContext* game) {
+	GameUi* ui = &game->ui;
+	gatherInput(&game->nextInput);
+	bool leaving = CP_Input_KeyReleased(KEY_ESCAPE);
+
+	if (CP_Input_KeyReleased(KEY_F7)) {
+		pipelined = !pipelined;
+		Pipeline_Stop(&game->pipeline); //restarted below if still pipelined
+		sprintf_s(ui->guide, _countof(ui->guide), pipelined ? "Pipelined" : "Serial");
+	}
+	if (pipelined && !game->pipeline) {
+		void* packets[PIPELINE_PACKETS] = { &game->packets[0], &game->packets[1], &game->packets[2] };
+		game->pipeline = Pipeline_Start(tickGame, game, packets, sizeof(GameInput));
+		//The first frame waits for its own tick, from then on the worker stays one ahead.
+		if (game->pipeline && Pipeline_Post(game->pipeline, &game->nextInput)) {
+			game->nextInput.snapshot = game->nextInput.governorOverlay = false;
+			Pipeline_Drain(game->pipeline);
+		}
+	}
+
+	FramePacket* packet;
+	if (game->pipeline) {
+		packet = Pipeline_Acquire(game->pipeline);
+		if (!packet) return;
+		//No tick past a death or into the pause menu; a busy worker gets this input merged into the next frame's.
+		if (!leaving && !packet->died && Pipeline_Post(game->pipeline, &game->nextInput)) game->nextInput.snapshot = game->nextInput.governorOverlay = false;
+	} else {
+		//Not started or couldn't start a thread: the same tick, right here.
+		packet = &game->packets[0];
+		simulateFrame(game, &game->nextInput, packet);
+		game->nextInput.snapshot = game->nextInput.governorOverlay = false;
+	}
+
+	// DRAW BACKGROUND (Sky)
+	CP_Graphics_ClearBackground(BLUE);
+	CP_System_ShowCursor(false);
+	DrawList_Submit(&packet->draws);
+	game->nextInput.drawStats = packet->draws.stats;
+
+	if (packet->died) {
+		//PLAYER DIED
+		CP_Engine_SetNextGameState(death_init, death_update, death_exit);
+		return;
+	}
+
+	//F9 times the glyph atlas against CP_Font_DrawText on the HUD strings above.
+	if (CP_Input_KeyReleased(KEY_F9) && hudFont.loaded) {
+		double atlasRate, fontRate, missMs;
+		if (game->pipeline) Pipeline_Drain(game->pipeline); //the guide is the simulation's
+		TextAtlas_Benchmark(&hudFont, 200, &atlasRate, &fontRate, &missMs);
+		sprintf_s(ui->guide, _countof(ui->guide), "Atlas %.0f Font %.0f /ms, miss %.1f ms", atlasRate, fontRate, missMs);
+	}
+
 	/************\
 	| PAUSE MENU |
 	\************/
-	if (CP_Input_KeyReleased(KEY_ESCAPE)) {
+	if (leaving) {
 		CP_Engine_SetNextGameState(pause_init, pause_update, pause_exit);
 	}
 }
 
-void game_exit() {
+void gameExit(GameContext* game) {
+	//Every other state runs on the main thread alone.
+	Pipeline_Stop(&game->pipeline);
+}
 
+/***
+* ATTRACT MODE
+*
+* Until a run has started, the pause menu has the autopilot fly the world behind it. Each
+* frame is simulated right here on the main thread, with the keys the autopilot would hold
+* instead of the keyboard's. Nothing is logged or suspended, and a crash just starts the
+* demo over in a new world.
+***/
+void flyAttract(GameContext* game) {
+	GameSim* s = &game->sim;
+	GameInput input = { 0 };
+	gatherInput(&input);
+	input.snapshot = false;
+
+	//The plane moves through the world against directionVector, see globalX/Y.
+	float playerX = s->ww / 2 - s->globalX;
+	float playerY = s->wh / 2 - s->globalY;
+	int key = Autopilot_Steer(&s->navigator, playerX, playerY, -s->directionVector.x, -s->directionVector.y, s->speed, s->rotationAngle, s->rotationIncrement, s->rotationCap);
+	input.left = key < 0;
+	input.right = key > 0;
+
+	FramePacket* packet = &game->packets[0];
+	input.drawStats = packet->draws.stats; //the demo's frame before, until simulateFrame begins this one
+	simulateFrame(game, &input, packet);
+	CP_Graphics_ClearBackground(BLUE);
+	DrawList_Submit(&packet->draws);
+
+	if (packet->died) {
+		initGlobalVariables(game);
+		createClouds(s);
+		createCoins(s);
+		buildMinimap(s);
+		Particles_Clear(&s->effects);
+	}
 }
 
 void buttonPlay() { CP_Engine_SetNextGameState(NULL, game_update, game_exit); }
@@ -692,129 +1579,197 @@ void drawButton(const char* text, float x, float y, float w, float h, float corn
 
 	CP_Settings_Stroke(BLACK);
 	CP_Graphics_DrawRectAdvanced(x, y, w, h, 0, cornerRadius);
-	CP_Settings_TextSize(50.0f);
-	CP_Settings_Fill(WHITE);
-	CP_Font_DrawText(text, x + w / 2, y + h / 2);
+	drawText(text, x + w / 2, y + h / 2, 50, WHITE);
 }
 
-void death_init() {
-	deathAlpha = 0;
-	int timeOfDeath = CP_System_GetSeconds() - timeOfRestart;
-	dminutes = timeOfDeath / 60;
-	dseconds = timeOfDeath % 60;
+void deathInit(GameContext* game) {
+	GameSim* s = &game->sim;
+	GameUi* ui = &game->ui;
+	ui->deathAlpha = 0;
+	int timeOfDeath = CP_System_GetSeconds() - s->timeOfRestart;
+	ui->dminutes = timeOfDeath / 60;
+	ui->dseconds = timeOfDeath % 60;
+	logEvent(game, TELEMETRY_RUN_END, -1);
+	Checkpoint_Discard(); //nothing left to resume
+	//The service thread saves it; the death screen picks the rank up once it's committed.
+	LeaderboardEntry entry = { s->score, (uint32_t)timeOfDeath, (uint32_t)time(NULL) };
+	ui->leaderboardTicket = Leaderboard_Submit(&entry);
 	CP_Settings_TextAlignment(CP_TEXT_ALIGN_H_CENTER, CP_TEXT_ALIGN_V_MIDDLE);
 	CP_System_ShowCursor(true);
-	buttonDefaultColor = CP_Color_Create(128, 0, 0, 255);
-	buttonHoverColor = CP_Color_Create(255, 0, 128, 255);
-	buttonOnPressColor = CP_Color_Create(255, 0, 0, 255);
+	ui->buttonDefaultColor = CP_Color_Create(128, 0, 0, 255);
+	ui->buttonHoverColor = CP_Color_Create(255, 0, 128, 255);
+	ui->buttonOnPressColor = CP_Color_Create(255, 0, 0, 255);
 }
 
-void death_update() {
-	BLACK.a = deathAlpha;
-	CP_Settings_Fill(BLACK);
-	CP_Graphics_DrawRect(0, 0, ww, wh);
-
-	drawPlayer(CP_Color_Create(255, 255, 255, deathAlpha * 5));
-
-	CP_Settings_Fill(BLUE);
-	CP_Settings_TextSize(100.0f);
-
-	CP_Font_DrawText("Game Over!", ww / 2, 150);
-
-	CP_Settings_TextSize(70.0f);
-
-	sprintf_s(buffer, _countof(buffer), "Score: %d", score);
-	CP_Font_DrawText(buffer, ww / 2, 250);
-
-	sprintf_s(buffer, _countof(buffer), "Gametime: %dm%ds", dminutes, dseconds);
-	CP_Font_DrawText(buffer, ww / 2, 320);
-
+void deathUpdate(GameContext* game) {
+	GameSim* s = &game->sim;
+	GameUi* ui = &game->ui;
+	CP_Color fade = BLACK; //BLACK is shared by every game, so fade a copy
+	fade.a = ui->deathAlpha;
+	CP_Settings_Fill(fade);
+	CP_Graphics_DrawRect(0, 0, s->ww, s->wh);
+
+	DrawList* list = &game->packets[0].draws;
+	DrawList_Begin(list, s->ww, s->wh);
+	DrawList_SetCamera(list, Camera_Transform(&s->camera), LAYER_CLOUDS, LAYER_PARTICLES);
+	drawPlayer(s, list, CP_Color_Create(255, 255, 255, ui->deathAlpha * 5));
+	DrawList_Submit(list);
+
+	drawText("Game Over!", s->ww / 2, 150, 100, BLUE);
+
+	sprintf_s(ui->buffer, _countof(ui->buffer), "Score: %d", s->score);
+	drawText(ui->buffer, s->ww / 2, 250, 70, BLUE);
+
+	sprintf_s(ui->buffer, _countof(ui->buffer), "Gametime: %dm%ds", ui->dminutes, ui->dseconds);
+	drawText(ui->buffer, s->ww / 2, 320, 70, BLUE);
+
+	Leaderboard_GetView(&ui->leaderboard);
+	if (ui->leaderboard.ready && ui->leaderboardTicket) {
+		if (ui->leaderboard.submitted >= ui->leaderboardTicket) {
+			//later submissions can't exist while this screen is up, so the newest rank is ours
+			sprintf_s(ui->buffer, _countof(ui->buffer), "Rank #%u of %u", ui->leaderboard.lastRank, ui->leaderboard.count);
+		} else {
+			sprintf_s(ui->buffer, _countof(ui->buffer), "Saving score...");
+		}
+		drawText(ui->buffer, s->ww / 2, 390, 50, BLUE);
+	}
+	for (int i = 0; i < ui->leaderboard.topCount; i++) {
+		LeaderboardEntry* e = &ui->leaderboard.top[i];
+		sprintf_s(ui->buffer, _countof(ui->buffer), "%d. %d  (%um%us)", i + 1, e->score, e->seconds / 60, e->seconds % 60);
+		drawText(ui->buffer, s->ww / 2, 440 + 45 * i, 40, BLUE);
+	}
 
 	drawButton("Restart",
-		ww / 2 - buttonWidth / 2, wh - 350 - buttonHeight / 2,
-		buttonWidth, buttonHeight, buttonCornerRadius,
-		buttonDefaultColor, buttonHoverColor, buttonOnPressColor,
-		&resetButtonHovered, buttonPlayForced);
+		s->ww / 2 - ui->buttonWidth / 2, s->wh - 350 - ui->buttonHeight / 2,
+		ui->buttonWidth, ui->buttonHeight, ui->buttonCornerRadius,
+		ui->buttonDefaultColor, ui->buttonHoverColor, ui->buttonOnPressColor,
+		&ui->resetButtonHovered, buttonPlayForced);
 
 	drawButton("Quit",
-		ww / 2 - buttonWidth / 2, wh - 200 - buttonHeight / 2,
-		buttonWidth, buttonHeight, buttonCornerRadius,
-		buttonDefaultColor, buttonHoverColor, buttonOnPressColor,
-		&quitButtonHovered, buttonQuit);
+		s->ww / 2 - ui->buttonWidth / 2, s->wh - 200 - ui->buttonHeight / 2,
+		ui->buttonWidth, ui->buttonHeight, ui->buttonCornerRadius,
+		ui->buttonDefaultColor, ui->buttonHoverColor, ui->buttonOnPressColor,
+		&ui->quitButtonHovered, buttonQuit);
 
-	deathAlpha += 2;
+	ui->deathAlpha += 2;
 
 	if (CP_Input_KeyReleased(KEY_R)) {
 		CP_Engine_SetNextGameState(game_init, game_update, game_exit);
 	}
 }
 
-void death_exit() {
-	timeOfRestart = CP_System_GetSeconds();
+void deathExit(GameContext* game) {
+	GameSim* s = &game->sim;
+	s->timeOfRestart = CP_System_GetSeconds();
 }
 
-void pause_init() {
-	buttonWidth = 270;
-	buttonHeight = 100;
-	buttonCornerRadius = 20;
-	buttonDefaultColor = CP_Color_Create(60, 60, 120, 200);
-	buttonHoverColor = CP_Color_Create(50, 0, 50, 25);
-	buttonOnPressColor = CP_Color_Create(100, 0, 0, 200);
+void pauseInit(GameContext* game) {
+	GameSim* s = &game->sim;
+	GameUi* ui = &game->ui;
+	ui->buttonWidth = 270;
+	ui->buttonHeight = 100;
+	ui->buttonCornerRadius = 20;
+	ui->buttonDefaultColor = CP_Color_Create(60, 60, 120, 200);
+	ui->buttonHoverColor = CP_Color_Create(50, 0, 50, 25);
+	ui->buttonOnPressColor = CP_Color_Create(100, 0, 0, 200);
 
 	CP_System_ShowCursor(true);
+	//Suspend the run, so closing the game from here doesn't lose it.
+	if (s->runStarted) saveCheckpoint(game);
+	s->attract = !s->runStarted;
 
 	//Draw the transparent box, then take a screenshot of it then redraw the screenshot. 
 	//This way, when my button hover changes size, I'm able to "unhover" the button
 	//while still maintaining the visual data behind the menu
 	CP_Settings_Fill(CP_Color_Create(50, 50, 50, 200));
-	CP_Graphics_DrawRect(ww / 4, wh / 4, ww / 2, wh / 2);
-	menuBackground = CP_Image_Screenshot(ww / 4, wh / 4, ww / 2, wh / 2);
-	printBackground = true;
-	playButtonHovered = false;
-	resetButtonHovered = false;
-	quitButtonHovered = false;
-}
-
-void pause_update() {
-	if (playButtonHovered || resetButtonHovered || quitButtonHovered) {
-		printBackground = true;
-	}
-	if (!playButtonHovered && !resetButtonHovered && !quitButtonHovered && printBackground) {
-		CP_Image_Draw(menuBackground, ww / 4, wh / 4, ww / 2, wh / 2, 255);
-		printBackground = false;
-		playButtonHovered = false;
-		resetButtonHovered = false;
-		quitButtonHovered = false;
-	}
-	CP_Settings_Fill(WHITE);
+	CP_Graphics_DrawRect(s->ww / 4, s->wh / 4, s->ww / 2, s->wh / 2);
+	ui->menuBackground = CP_Image_Screenshot(s->ww / 4, s->wh / 4, s->ww / 2, s->wh / 2);
+	ui->printBackground = true;
+	ui->playButtonHovered = false;
+	ui->resetButtonHovered = false;
+	ui->quitButtonHovered = false;
+}
+
+void pauseUpdate(GameContext* game) {
+	GameSim* s = &game->sim;
+	GameUi* ui = &game->ui;
+	if (s->attract) {
+		//The whole screen is redrawn every frame, box and all.
+		flyAttract(game);
+		CP_Settings_Fill(CP_Color_Create(50, 50, 50, 200));
+		CP_Settings_NoStroke();
+		CP_Graphics_DrawRect(s->ww / 4, s->wh / 4, s->ww / 2, s->wh / 2);
+	} else {
+		if (ui->playButtonHovered || ui->resetButtonHovered || ui->quitButtonHovered) {
+			ui->printBackground = true;
+		}
+		if (!ui->playButtonHovered && !ui->resetButtonHovered && !ui->quitButtonHovered && ui->printBackground) {
+			CP_Image_Draw(ui->menuBackground, s->ww / 4, s->wh / 4, s->ww / 2, s->wh / 2, 255);
+			ui->printBackground = false;
+			ui->playButtonHovered = false;
+			ui->resetButtonHovered = false;
+			ui->quitButtonHovered = false;
+		}
+	}
 	CP_Settings_TextAlignment(CP_TEXT_ALIGN_H_CENTER, CP_TEXT_ALIGN_V_MIDDLE);
-	CP_Settings_TextSize(100.0f);
-	CP_Font_DrawText("MENU", ww / 2, wh * 5 / 16);
-
-	drawButton(playText,
-		ww / 2 - buttonWidth / 2,
-		wh / 2 - buttonHeight / 2 - buttonHeight + 20,
-		buttonWidth, buttonHeight, buttonCornerRadius,
-		buttonDefaultColor, buttonHoverColor, buttonOnPressColor,
-		&playButtonHovered, buttonPlay);
+	drawText("MENU", s->ww / 2, s->wh * 5 / 16, 100, WHITE);
+
+	drawButton(s->runStarted ? "CONTINUE" : "PLAY!",
+		s->ww / 2 - ui->buttonWidth / 2,
+		s->wh / 2 - ui->buttonHeight / 2 - ui->buttonHeight + 20,
+		ui->buttonWidth, ui->buttonHeight, ui->buttonCornerRadius,
+		ui->buttonDefaultColor, ui->buttonHoverColor, ui->buttonOnPressColor,
+		&ui->playButtonHovered, s->attract ? buttonPlayForced : buttonPlay); //the demo has flown the world, play a fresh one
 	drawButton("RESET",
-		ww / 2 - buttonWidth / 2,
-		wh / 2 - buttonHeight / 2 + 40,
-		buttonWidth, buttonHeight, buttonCornerRadius,
-		buttonDefaultColor, buttonHoverColor, buttonOnPressColor,
-		&resetButtonHovered, buttonPlayForced);
+		s->ww / 2 - ui->buttonWidth / 2,
+		s->wh / 2 - ui->buttonHeight / 2 + 40,
+		ui->buttonWidth, ui->buttonHeight, ui->buttonCornerRadius,
+		ui->buttonDefaultColor, ui->buttonHoverColor, ui->buttonOnPressColor,
+		&ui->resetButtonHovered, buttonPlayForced);
 	drawButton("QUIT",
-		ww / 2 - buttonWidth / 2,
-		wh / 2 - buttonHeight / 2 + buttonHeight + 60,
-		buttonWidth, buttonHeight, buttonCornerRadius,
-		buttonDefaultColor, buttonHoverColor, buttonOnPressColor,
-		&quitButtonHovered, buttonQuit);
+		s->ww / 2 - ui->buttonWidth / 2,
+		s->wh / 2 - ui->buttonHeight / 2 + ui->buttonHeight + 60,
+		ui->buttonWidth, ui->buttonHeight, ui->buttonCornerRadius,
+		ui->buttonDefaultColor, ui->buttonHoverColor, ui->buttonOnPressColor,
+		&ui->quitButtonHovered, buttonQuit);
+}
+
+void pauseExit(GameContext* game) {
+	(void)game;
 }
 
-void pause_exit() {
-	sprintf_s(playText, _countof(playText), "CONTINUE");
+void freeGame(GameContext* game) {
+	GameSim* s = &game->sim;
+	free(s->activeClouds);
+	Collectibles_Free(&s->coins);
+	Minimap_Free(&s->minimap);
+	Particles_Free(&s->effects);
+	Autopilot_Free(&s->navigator);
+	Pipeline_Stop(&game->pipeline);
+	for (int i = 0; i < PIPELINE_PACKETS; i++) DrawList_Free(&game->packets[i].draws);
+	MipChain_Free(&game->cloudMips);
+	for (int i = 0; i < CLOUD_DRAW_LEVELS; i++) MipCanvas_Free(&game->cloudCanvases[i]);
+	for (int i = 0; i < CLOUD_LAYER_COUNT; i++) ParallaxLayer_Free(&game->cloudLayers[i]);
+	Snapshot_Free(&game->frameStartSnapshot);
+	Snapshot_Free(&game->currentSnapshot);
+	Snapshot_Free(&game->decodedSnapshot);
 }
 
+/* * * * * * * * * * * * * *
+* CPROCESSING GAME STATES *
+* * * * * * * * * * * * * */
+//CProcessing's states take no arguments; they all run the game on screen.
+void resume_init() { resumeInit(&mainGame); }
+void game_init() { gameInit(&mainGame); }
+void game_update() { gameUpdate(&mainGame); }
+void game_exit() { gameExit(&mainGame); }
+void death_init() { deathInit(&mainGame); }
+void death_update() { deathUpdate(&mainGame); }
+void death_exit() { deathExit(&mainGame); }
+void pause_init() { pauseInit(&mainGame); }
+void pause_update() { pauseUpdate(&mainGame); }
+void pause_exit() { pauseExit(&mainGame); }
+
 void forceQuit() {
 	if (CP_Input_KeyReleased(KEY_Q)) {
 		CP_Engine_Terminate();
@@ -823,7 +1778,24 @@ void forceQuit() {
 
 int main(void) {
 	CP_Engine_SetPreUpdateFunction(forceQuit);
-	CP_Engine_SetNextGameState(logo_init, logo_update, logo_exit);
+	//A run suspended from the pause menu skips the splash and goes straight back into play.
+	checkpointBytes = malloc(CHECKPOINT_MAX_SIZE);
+	checkpointSize = checkpointBytes ? Checkpoint_Load(CHECKPOINT_PATH, checkpointBytes, CHECKPOINT_MAX_SIZE) : -1;
+	if (checkpointSize > 0) {
+		CP_Engine_SetNextGameState(resume_init, game_update, game_exit);
+	} else {
+		free(checkpointBytes);
+		checkpointBytes = NULL;
+		CP_Engine_SetNextGameState(logo_init, logo_update, logo_exit);
+	}
 	CP_Engine_Run();
+	Pipeline_Stop(&mainGame.pipeline); //before the services the simulation thread uses
+	Audio_Shutdown();
+	Telemetry_Shutdown();
+	Leaderboard_StopService();
+	Checkpoint_Stop();
+	Tuning_StopWatching();
+	TextAtlas_Free(&hudFont);
+	freeGame(&mainGame);
 	return 0;
 }
@@ -0,0 +1,163 @@
+//---------------------------------------------------------
+// file:	minimap.c
+//
+// brief:	Minimap overlay of the whole world (see minimap.h).
+//---------------------------------------------------------
+
+#include "minimap.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+typedef CRITICAL_SECTION Lock;
+static void lockCreate(Lock* lock) { InitializeCriticalSection(lock); }
+static void lockEnter(Lock* lock) { EnterCriticalSection(lock); }
+static void lockLeave(Lock* lock) { LeaveCriticalSection(lock); }
+static void lockFree(Lock* lock) { DeleteCriticalSection(lock); }
+#else
+#include <pthread.h>
+typedef pthread_mutex_t Lock;
+static void lockCreate(Lock* lock) { pthread_mutex_init(lock, NULL); }
+static void lockEnter(Lock* lock) { pthread_mutex_lock(lock); }
+static void lockLeave(Lock* lock) { pthread_mutex_unlock(lock); }
+static void lockFree(Lock* lock) { pthread_mutex_destroy(lock); }
+#endif
+
+#define MINIMAP_BACKGROUND 0, 40, 90, 110
+#define MINIMAP_CLOUD 255, 255, 255, 220
+#define MINIMAP_COIN 255, 215, 0, 255
+#define MINIMAP_COIN_RADIUS 1.5f //pixels
+
+bool Minimap_Init(Minimap* map, int width, float worldWidth, float worldHeight) {
+	memset(map, 0, sizeof * map);
+	map->width = width;
+	map->height = (int)(width * worldHeight / worldWidth + 0.5f);
+	map->clouds = calloc(map->width * map->height, sizeof * map->clouds);
+	map->pixels = calloc(map->width * map->height, sizeof * map->pixels);
+	map->lock = malloc(sizeof(Lock));
+	if (!map->clouds || !map->pixels || !map->lock) {
+		Minimap_Free(map);
+		return false;
+	}
+	lockCreate(map->lock);
+	//CP_Color is four bytes, r g b a, the same layout CP_Image_CreateFromData reads
+	map->image = CP_Image_CreateFromData(map->width, map->height, (unsigned char*)map->pixels);
+	return map->image != NULL;
+}
+
+void Minimap_Free(Minimap* map) {
+	if (map->image) CP_Image_Free(&map->image);
+	if (map->lock && map->clouds && map->pixels) lockFree(map->lock);
+	free(map->lock);
+	free(map->clouds);
+	free(map->pixels);
+	memset(map, 0, sizeof * map);
+}
+
+void Minimap_BeginWorld(Minimap* map, float west, float north, float width, float height) {
+	map->west = west;
+	map->north = north;
+	map->scale = fminf(map->width / width, map->height / height);
+
+	CP_Color background = CP_Color_Create(MINIMAP_BACKGROUND);
+	for (int i = 0; i < map->width * map->height; i++) map->clouds[i] = background;
+	memcpy(map->pixels, map->clouds, map->width * map->height * sizeof * map->pixels);
+	map->dirty = true;
+}
+
+//Fills the ellipse inscribed in the rectangle, on both layers. Tiny clouds still get their center pixel.
+void Minimap_AddCloud(Minimap* map, float x, float y, float w, float h) {
+	float cx = (x + w / 2 - map->west) * map->scale;
+	float cy = (y + h / 2 - map->north) * map->scale;
+	float rx = fmaxf(w / 2 * map->scale, 0.5f);
+	float ry = fmaxf(h / 2 * map->scale, 0.5f);
+	CP_Color color = CP_Color_Create(MINIMAP_CLOUD);
+
+	int top = (int)fmaxf(floorf(cy - ry), 0);
+	int bottom = (int)fminf(ceilf(cy + ry), (float)map->height - 1);
+	for (int row = top; row <= bottom; row++) {
+		//half width of the ellipse at this row's pixel centers
+		float dy = (row + 0.5f - cy) / ry;
+		if (dy * dy > 1) continue;
+		float half = rx * sqrtf(1 - dy * dy);
+		int left = (int)fmaxf(floorf(cx - half + 0.5f), 0);
+		int right = (int)fminf(ceilf(cx + half - 0.5f), (float)map->width) - 1;
+		for (int col = left; col <= right; col++) {
+			map->clouds[row * map->width + col] = color;
+			map->pixels[row * map->width + col] = color;
+		}
+	}
+	//an ellipse narrower than a pixel can miss every pixel center
+	int col = (int)floorf(cx), row = (int)floorf(cy);
+	if (col >= 0 && col < map->width && row >= 0 && row < map->height) {
+		map->clouds[row * map->width + col] = color;
+		map->pixels[row * map->width + col] = color;
+	}
+	map->dirty = true;
+}
+
+//Stamps the coin dot, or copies the cloud layer back over it.
+static void coinDot(Minimap* map, float x, float y, bool visible) {
+	float cx = (x - map->west) * map->scale;
+	float cy = (y - map->north) * map->scale;
+	CP_Color color = CP_Color_Create(MINIMAP_COIN);
+	int r = (int)ceilf(MINIMAP_COIN_RADIUS);
+
+	for (int row = (int)cy - r; row <= (int)cy + r; row++) {
+		if (row < 0 || row >= map->height) continue;
+		for (int col = (int)cx - r; col <= (int)cx + r; col++) {
+			if (col < 0 || col >= map->width) continue;
+			float dx = col + 0.5f - cx;
+			float dy = row + 0.5f - cy;
+			if (dx * dx + dy * dy > MINIMAP_COIN_RADIUS * MINIMAP_COIN_RADIUS) continue;
+			int i = row * map->width + col;
+			map->pixels[i] = visible ? color : map->clouds[i];
+		}
+	}
+	map->dirty = true;
+}
+
+void Minimap_AddCoin(Minimap* map, float x, float y) {
+	coinDot(map, x, y, true);
+}
+
+void Minimap_RemoveCoin(Minimap* map, float x, float y) {
+	coinDot(map, x, y, false);
+}
+
+void Minimap_BeginEdit(Minimap* map) {
+	lockEnter(map->lock);
+}
+
+void Minimap_EndEdit(Minimap* map) {
+	lockLeave(map->lock);
+}
+
+void Minimap_Draw(Minimap* map, float x, float y, float playerX, float playerY, float viewX, float viewY, float viewW, float viewH) {
+	lockEnter(map->lock);
+	//the only pixel upload happens on frames where the world was rebuilt or a coin was collected
+	if (map->dirty) {
+		CP_Image_UpdatePixelData(map->image, map->pixels);
+		map->dirty = false;
+	}
+
+	CP_Settings_Save();
+	CP_Settings_ImageMode(CP_POSITION_CORNER);
+	CP_Settings_RectMode(CP_POSITION_CORNER);
+	CP_Image_Draw(map->image, x, y, (float)map->width, (float)map->height, 255);
+
+	//outline of what the window currently shows
+	CP_Settings_NoFill();
+	CP_Settings_Stroke(CP_Color_Create(255, 255, 255, 160));
+	CP_Settings_StrokeWeight(1);
+	CP_Graphics_DrawRect(x + (viewX - map->west) * map->scale, y + (viewY - map->north) * map->scale, viewW * map->scale, viewH * map->scale);
+
+	CP_Settings_NoStroke();
+	CP_Settings_Fill(CP_Color_Create(220, 17, 39, 255));
+	CP_Graphics_DrawCircle(x + (playerX - map->west) * map->scale, y + (playerY - map->north) * map->scale, 6);
+	CP_Settings_Restore();
+	lockLeave(map->lock);
+}
@@ -0,0 +1,45 @@
+//---------------------------------------------------------
+// file:	minimap.h
+//
+// brief:	Minimap overlay of the whole Bounds world. The
+//			clouds and coins are rasterized into a small image
+//			once per world; each frame only draws that image
+//			plus the player marker on top.
+//---------------------------------------------------------
+#pragma once
+
+#include "cprocessing.h"
+#include <stdbool.h>
+
+/***
+* Two pixel layers are kept: the clouds alone, and the clouds with the coins stamped on.
+* Collecting a coin copies its dot back from the cloud layer, so the image only has to be
+* uploaded again on the frames a coin was picked up.
+***/
+typedef struct {
+	int width, height; //minimap size in pixels
+	float west, north; //world position of the top left pixel
+	float scale; //minimap pixels per world unit
+	CP_Color* clouds; //cloud layer
+	CP_Color* pixels; //cloud layer + coins, what the image shows
+	CP_Image image;
+	bool dirty; //pixels changed since the last upload
+	void* lock; //held by Draw and between BeginEdit and EndEdit
+} Minimap;
+
+//The height follows from the aspect ratio of the world it will show.
+bool Minimap_Init(Minimap* map, int width, float worldWidth, float worldHeight);
+void Minimap_Free(Minimap* map);
+
+//The edits below may run on another thread than Draw (see pipeline.h). Wrap each
+//group of them in BeginEdit/EndEdit so a half finished one is never uploaded.
+void Minimap_BeginEdit(Minimap* map);
+void Minimap_EndEdit(Minimap* map);
+//Rebuild for a new world: clear, add every cloud, then every coin.
+void Minimap_BeginWorld(Minimap* map, float west, float north, float width, float height);
+void Minimap_AddCloud(Minimap* map, float x, float y, float w, float h); //top left corner and size, world units
+void Minimap_AddCoin(Minimap* map, float x, float y); //center, world units
+void Minimap_RemoveCoin(Minimap* map, float x, float y);
+
+//Draws the minimap with its top left corner at (x, y). viewX/viewY is the world position of the window's top left corner.
+void Minimap_Draw(Minimap* map, float x, float y, float playerX, float playerY, float viewX, float viewY, float viewW, float viewH);
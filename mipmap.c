@@ -0,0 +1,258 @@
+//---------------------------------------------------------
+// file:	mipmap.c
+//
+// brief:	Mip chains and low resolution canvases built from
+//			them (see mipmap.h).
+//---------------------------------------------------------
+
+#include "mipmap.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* * * * * * * * *
+* PIXEL HELPERS  *
+* * * * * * * * */
+static inline uint32_t div255(uint32_t x) {
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+static uint32_t premultiply(CP_Color c) {
+	return div255(c.r * c.a) | (div255(c.g * c.a) << 8) | (div255(c.b * c.a) << 16) | ((uint32_t)c.a << 24);
+}
+
+static CP_Color unpremultiply(uint32_t p) {
+	CP_Color c = { 0, 0, 0, 0 };
+	uint32_t a = p >> 24;
+	if (a == 0) return c;
+	c.r = (unsigned char)((((p & 0xFF) * 255) + a / 2) / a);
+	c.g = (unsigned char)(((((p >> 8) & 0xFF) * 255) + a / 2) / a);
+	c.b = (unsigned char)(((((p >> 16) & 0xFF) * 255) + a / 2) / a);
+	c.a = (unsigned char)a;
+	return c;
+}
+
+//Premultiplied s over d. Channels of s never exceed its alpha, so no channel can overflow.
+static inline uint32_t blendPixel(uint32_t d, uint32_t s) {
+	uint32_t inv = 255 - (s >> 24);
+	if (inv == 255) return d;
+	if (inv == 0) return s;
+	uint32_t out = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		out |= (((s >> shift) & 0xFF) + div255(((d >> shift) & 0xFF) * inv)) << shift;
+	}
+	return out;
+}
+
+/* * * * * * *
+* MIP CHAIN  *
+* * * * * * */
+/***
+* Filtering happens on premultiplied pixels. Averaging straight ones would let the color of
+* fully transparent pixels, whatever the PNG happened to store there, leak into the edges.
+* Odd sizes round down, the last row or column is averaged with itself.
+***/
+static void halve(const uint32_t* in, int width, int height, uint32_t* out, int outWidth, int outHeight) {
+	for (int y = 0; y < outHeight; y++) {
+		const uint32_t* row0 = in + (2 * y) * width;
+		const uint32_t* row1 = in + ((2 * y + 1 < height) ? 2 * y + 1 : 2 * y) * width;
+		for (int x = 0; x < outWidth; x++) {
+			int x0 = 2 * x;
+			int x1 = (x0 + 1 < width) ? x0 + 1 : x0;
+			uint32_t pixel = 0;
+			for (int shift = 0; shift < 32; shift += 8) {
+				uint32_t sum = ((row0[x0] >> shift) & 0xFF) + ((row0[x1] >> shift) & 0xFF) + ((row1[x0] >> shift) & 0xFF) + ((row1[x1] >> shift) & 0xFF);
+				pixel |= ((sum + 2) >> 2) << shift;
+			}
+			out[y * outWidth + x] = pixel;
+		}
+	}
+}
+
+bool MipChain_Build(MipChain* chain, CP_Image image, int levels) {
+	memset(chain, 0, sizeof * chain);
+	if (!image) return false;
+	if (levels > MIP_MAX_LEVELS) levels = MIP_MAX_LEVELS;
+	int width = CP_Image_GetWidth(image);
+	int height = CP_Image_GetHeight(image);
+	CP_Color* straight = malloc((size_t)width * height * sizeof * straight);
+	if (!straight) return false;
+	CP_Image_GetPixelData(image, straight);
+
+	chain->images[0] = image;
+	chain->widths[0] = width;
+	chain->heights[0] = height;
+	chain->pixels[0] = malloc((size_t)width * height * sizeof(uint32_t));
+	bool built = chain->pixels[0] != NULL;
+	if (built) {
+		for (int i = 0; i < width * height; i++) chain->pixels[0][i] = premultiply(straight[i]);
+		chain->levelCount = 1;
+	}
+
+	for (int level = 1; built && level < levels && (width > 1 || height > 1); level++) {
+		int outWidth = (width > 1) ? width / 2 : 1;
+		int outHeight = (height > 1) ? height / 2 : 1;
+		uint32_t* pixels = malloc((size_t)outWidth * outHeight * sizeof * pixels);
+		if (!pixels) {
+			built = false;
+			break;
+		}
+		halve(chain->pixels[level - 1], width, height, pixels, outWidth, outHeight);
+		//CP_Image_CreateFromData wants straight alpha, and straight is big enough for every level
+		for (int i = 0; i < outWidth * outHeight; i++) straight[i] = unpremultiply(pixels[i]);
+		chain->pixels[level] = pixels;
+		chain->images[level] = CP_Image_CreateFromData(outWidth, outHeight, (unsigned char*)straight);
+		chain->widths[level] = width = outWidth;
+		chain->heights[level] = height = outHeight;
+		chain->levelCount = level + 1;
+		built = chain->images[level] != NULL;
+	}
+	free(straight);
+	if (!built) MipChain_Free(chain);
+	return built;
+}
+
+void MipChain_Free(MipChain* chain) {
+	for (int level = 0; level < MIP_MAX_LEVELS; level++) {
+		if (level > 0 && chain->images[level]) CP_Image_Free(&chain->images[level]);
+		free(chain->pixels[level]);
+	}
+	memset(chain, 0, sizeof * chain);
+}
+
+int MipChain_SelectLevel(const MipChain* chain, float scale, float blur) {
+	if (chain->levelCount <= 1 || scale <= 0) return 0;
+	//How many pixels of the original end up in one screen pixel's worth of visible detail.
+	float footprint = fmaxf(blur, 1) / scale;
+	int level = (int)floorf(log2f(footprint));
+	if (level < 0) return 0;
+	return (level < chain->levelCount) ? level : chain->levelCount - 1;
+}
+
+/* * * * * * * *
+* MIP CANVAS   *
+* * * * * * * */
+static bool overlaps(MipRect a, MipRect b) {
+	return a.x0 < b.x1 && b.x0 < a.x1 && a.y0 < b.y1 && b.y0 < a.y1;
+}
+
+static MipRect merge(MipRect a, MipRect b) {
+	MipRect r = { (a.x0 < b.x0) ? a.x0 : b.x0, (a.y0 < b.y0) ? a.y0 : b.y0, (a.x1 > b.x1) ? a.x1 : b.x1, (a.y1 > b.y1) ? a.y1 : b.y1 };
+	return r;
+}
+
+//Adds rect to the list, merging it with every rect it overlaps until none do. A full list
+//grows its last rect instead, the canvas still gets drawn, only with more empty area.
+static void addRect(MipRect* rects, int* count, MipRect rect) {
+	for (int i = 0; i < *count;) {
+		if (overlaps(rects[i], rect)) {
+			rect = merge(rect, rects[i]);
+			rects[i] = rects[--*count];
+			i = 0; //the bigger rect may overlap ones already passed
+		} else {
+			i++;
+		}
+	}
+	if (*count < MIP_CANVAS_RECTS) {
+		rects[(*count)++] = rect;
+	} else {
+		rects[*count - 1] = merge(rects[*count - 1], rect);
+	}
+}
+
+bool MipCanvas_Init(MipCanvas* canvas, int screenWidth, int screenHeight, int level) {
+	memset(canvas, 0, sizeof * canvas);
+	canvas->level = level;
+	//rounded up, so the canvas covers the last few screen pixels too
+	canvas->width = (screenWidth + (1 << level) - 1) >> level;
+	canvas->height = (screenHeight + (1 << level) - 1) >> level;
+	canvas->pixels = calloc((size_t)canvas->width * canvas->height, sizeof * canvas->pixels);
+	canvas->straight = calloc((size_t)canvas->width * canvas->height, sizeof * canvas->straight);
+	if (!canvas->pixels || !canvas->straight) {
+		MipCanvas_Free(canvas);
+		return false;
+	}
+	canvas->image = CP_Image_CreateFromData(canvas->width, canvas->height, (unsigned char*)canvas->straight);
+	return canvas->image != NULL;
+}
+
+void MipCanvas_Free(MipCanvas* canvas) {
+	if (canvas->image) CP_Image_Free(&canvas->image);
+	free(canvas->pixels);
+	free(canvas->straight);
+	memset(canvas, 0, sizeof * canvas);
+}
+
+void MipCanvas_Clear(MipCanvas* canvas) {
+	for (int i = 0; i < canvas->rectCount; i++) {
+		MipRect r = canvas->rects[i];
+		for (int y = r.y0; y < r.y1; y++) memset(canvas->pixels + y * canvas->width + r.x0, 0, (r.x1 - r.x0) * sizeof * canvas->pixels);
+	}
+	canvas->rectCount = 0;
+	canvas->filled = 0;
+}
+
+void MipCanvas_Composite(MipCanvas* canvas, const MipChain* chain, float x, float y, float u0, float v0, float u1, float v1) {
+	int level = canvas->level;
+	if (level >= chain->levelCount) return;
+	float shrink = 1.0f / (1 << level);
+	int srcWidth = chain->widths[level];
+	int srcHeight = chain->heights[level];
+	int sx0 = (int)floorf(u0 * shrink);
+	int sy0 = (int)floorf(v0 * shrink);
+	int sx1 = (int)ceilf(u1 * shrink);
+	int sy1 = (int)ceilf(v1 * shrink);
+	if (sx1 > srcWidth) sx1 = srcWidth;
+	if (sy1 > srcHeight) sy1 = srcHeight;
+	int dx = (int)floorf(x * shrink + 0.5f) - sx0; //canvas position of source pixel 0
+	int dy = (int)floorf(y * shrink + 0.5f) - sy0;
+
+	//clip the source rectangle against the canvas
+	if (sx0 + dx < 0) sx0 = -dx;
+	if (sy0 + dy < 0) sy0 = -dy;
+	if (sx1 + dx > canvas->width) sx1 = canvas->width - dx;
+	if (sy1 + dy > canvas->height) sy1 = canvas->height - dy;
+	if (sx0 >= sx1 || sy0 >= sy1) return;
+
+	const uint32_t* src = chain->pixels[level];
+	for (int sy = sy0; sy < sy1; sy++) {
+		const uint32_t* in = src + sy * srcWidth;
+		uint32_t* out = canvas->pixels + (sy + dy) * canvas->width + dx;
+		for (int sx = sx0; sx < sx1; sx++) out[sx] = blendPixel(out[sx], in[sx]);
+	}
+	canvas->filled += (uint64_t)(sx1 - sx0) * (sy1 - sy0);
+	MipRect rect = { sx0 + dx, sy0 + dy, sx1 + dx, sy1 + dy };
+	addRect(canvas->rects, &canvas->rectCount, rect);
+}
+
+static void convert(MipCanvas* canvas, MipRect r) {
+	for (int y = r.y0; y < r.y1; y++) {
+		const uint32_t* in = canvas->pixels + y * canvas->width;
+		CP_Color* out = canvas->straight + y * canvas->width;
+		for (int x = r.x0; x < r.x1; x++) out[x] = unpremultiply(in[x]);
+	}
+}
+
+/***
+* The upload is the whole image either way, but only the rects composited into and the ones
+* left over from last time are converted (the old ones are zero by now, converting them
+* clears them).
+***/
+void MipCanvas_Upload(MipCanvas* canvas) {
+	for (int i = 0; i < canvas->drawnCount; i++) convert(canvas, canvas->drawn[i]);
+	for (int i = 0; i < canvas->rectCount; i++) convert(canvas, canvas->rects[i]);
+	if (canvas->drawnCount || canvas->rectCount) CP_Image_UpdatePixelData(canvas->image, canvas->straight);
+	memcpy(canvas->drawn, canvas->rects, canvas->rectCount * sizeof * canvas->rects);
+	canvas->drawnCount = canvas->rectCount;
+}
+
+//Only the rects are drawn, so the screen is filled about where the sprites are.
+void MipCanvas_Draw(MipCanvas* canvas, int alpha) {
+	MipCanvas_Upload(canvas);
+	float scale = (float)(1 << canvas->level);
+	for (int i = 0; i < canvas->rectCount; i++) {
+		MipRect r = canvas->rects[i];
+		CP_Image_DrawSubImage(canvas->image, r.x0 * scale, r.y0 * scale, (r.x1 - r.x0) * scale, (r.y1 - r.y0) * scale, (float)r.x0, (float)r.y0, (float)r.x1, (float)r.y1, alpha);
+	}
+}
@@ -0,0 +1,85 @@
+//---------------------------------------------------------
+// file:	mipmap.h
+//
+// brief:	Mip chains for images that are often drawn smaller
+//			or blurrier than their own pixels. Each level is
+//			the one before it box filtered to half the width
+//			and height, so a draw can pick the level whose
+//			pixels match what actually ends up on screen.
+//			A MipCanvas goes one step further: sprites are
+//			composited into it on the CPU at the resolution of
+//			one level, then drawn stretched over the screen a
+//			group of overlapping sprites per draw.
+//---------------------------------------------------------
+#pragma once
+
+#include "cprocessing.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MIP_MAX_LEVELS 4
+
+/***
+* Level n is 1/2^n of the image per side, so a sub image at (u, v) of the original is at
+* (u, v) / 2^n in it. Filtering averages blocks of 2^n pixels, so sub images of an atlas
+* only stay apart on a level if there are more than 2^n transparent pixels between them,
+* plus one pixel of that level for the bilinear filter drawing it.
+***/
+typedef struct {
+	int levelCount;
+	int widths[MIP_MAX_LEVELS], heights[MIP_MAX_LEVELS];
+	CP_Image images[MIP_MAX_LEVELS]; //[0] is the image Build was given, the chain doesn't own it
+	uint32_t* pixels[MIP_MAX_LEVELS]; //premultiplied, r in the low byte, for MipCanvas_Composite
+} MipChain;
+
+//Read image back and filter levels from it, at most levels of them counting the image itself.
+bool MipChain_Build(MipChain* chain, CP_Image image, int levels);
+//Frees every level but the first, which stays the caller's.
+void MipChain_Free(MipChain* chain);
+//The level to draw with when one pixel of the image covers scale screen pixels and detail is
+//smeared over blur screen pixels anyway (1 when nothing moves). Level n is right once a pixel
+//of the original shrinks to 1/2^n of a screen pixel, or detail blurs over 2^n of them.
+int MipChain_SelectLevel(const MipChain* chain, float scale, float blur);
+
+/***
+* A screen sized layer at 1/2^level of the screen's resolution. Sprites are blended into it
+* from the same level of a chain at one pixel per pixel, no scaling or filtering, snapped to
+* whole canvas pixels. Drawing it is one upload, then one draw per group of overlapping
+* sprites: where they overlap, the screen is only filled once.
+*
+* Only the main thread may Draw, and Init and Free create and free an image, so all of it
+* belongs there (a DrawList callback runs there).
+***/
+#define MIP_CANVAS_RECTS 64
+
+typedef struct {
+	int x0, y0, x1, y1; //canvas pixels, x1/y1 exclusive
+} MipRect;
+
+typedef struct {
+	int level;
+	int width, height; //canvas pixels
+	uint32_t* pixels; //premultiplied while compositing
+	CP_Color* straight; //what the image gets
+	CP_Image image;
+	MipRect rects[MIP_CANVAS_RECTS]; //composited since Clear, overlapping ones merged into their bounds
+	int rectCount;
+	MipRect drawn[MIP_CANVAS_RECTS]; //what straight held nonzero as of the last Draw
+	int drawnCount;
+	uint64_t filled; //pixels blended since Clear
+} MipCanvas;
+
+//The canvas covers screenWidth x screenHeight pixels of the chain's first level, drawn at 1:1
+//that is the screen. Sizes that aren't a multiple of 2^level are rounded up.
+bool MipCanvas_Init(MipCanvas* canvas, int screenWidth, int screenHeight, int level);
+void MipCanvas_Free(MipCanvas* canvas);
+//Start a frame. Only clears what the last one composited into.
+void MipCanvas_Clear(MipCanvas* canvas);
+//Blend the sub image (u0, v0) to (u1, v1), in pixels of the chain's first level, with its top
+//left corner at screen position (x, y). Comes from the chain's level canvas->level, so the
+//sprite is drawn at the size of the sub image; parts outside the screen are cut off.
+void MipCanvas_Composite(MipCanvas* canvas, const MipChain* chain, float x, float y, float u0, float v0, float u1, float v1);
+//Upload what was composited since Clear, for a caller that draws canvas->image itself.
+void MipCanvas_Upload(MipCanvas* canvas);
+//Upload, then draw what was composited over the screen.
+void MipCanvas_Draw(MipCanvas* canvas, int alpha);
@@ -0,0 +1,116 @@
+//---------------------------------------------------------
+// file:	parallax.c
+//
+// brief:	Depth layers of clouds (see parallax.h).
+//---------------------------------------------------------
+
+#include "parallax.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define PARALLAX_DRIFT 0.02f //fastest a scenery cloud drifts on its own, layer pixels per frame
+
+//v moved into [0, period)
+static float wrap(float v, float period) {
+	v = fmodf(v, period);
+	return (v < 0) ? v + period : v;
+}
+
+bool ParallaxLayer_Generate(ParallaxLayer* layer, const ParallaxLayerDesc* desc, const MipChain* chain, int screenWidth, int screenHeight, int stagger) {
+	memset(layer, 0, sizeof * layer);
+	layer->desc = *desc;
+	layer->stagger = stagger;
+	layer->renderedFrame = -1;
+	if (desc->collides) return true; //drawn live by the game, nothing to cache
+
+	int cell = 1 << desc->level;
+	layer->tileWidth = ceilf(screenWidth / desc->scale / cell) * cell;
+	layer->tileHeight = ceilf(screenHeight / desc->scale / cell) * cell;
+	layer->count = (int)(desc->density + 0.5f);
+	layer->clouds = malloc(layer->count * sizeof * layer->clouds);
+	layer->drift = malloc(layer->count * 2 * sizeof * layer->drift);
+	if (!layer->clouds || !layer->drift || desc->level >= chain->levelCount
+		|| !MipCanvas_Init(&layer->cache, (int)layer->tileWidth, (int)layer->tileHeight, desc->level)) {
+		ParallaxLayer_Free(layer);
+		return false;
+	}
+
+	for (int i = 0; i < layer->count; i++) {
+		layer->clouds[i].size = desc->scale;
+		layer->clouds[i].x = CP_Random_RangeFloat(0, layer->tileWidth);
+		layer->clouds[i].y = CP_Random_RangeFloat(0, layer->tileHeight);
+		layer->clouds[i].img_id = CP_Random_RangeInt(0, CLOUD_TEXTURE_COUNT - 1); //scenery never collides, the last one is fine here
+		layer->drift[2 * i] = CP_Random_RangeFloat(-PARALLAX_DRIFT, PARALLAX_DRIFT);
+		layer->drift[2 * i + 1] = CP_Random_RangeFloat(-PARALLAX_DRIFT, PARALLAX_DRIFT) / 2;
+	}
+	return true;
+}
+
+void ParallaxLayer_Free(ParallaxLayer* layer) {
+	MipCanvas_Free(&layer->cache);
+	free(layer->clouds);
+	free(layer->drift);
+	memset(layer, 0, sizeof * layer);
+}
+
+void ParallaxLayer_Scroll(const ParallaxLayer* layer, float* scrollX, float* scrollY, float dx, float dy) {
+	if (layer->desc.collides || !layer->tileWidth) return; //the gameplay layer scrolls with globalX/Y, a failed one never draws
+	*scrollX += dx * layer->desc.parallax;
+	*scrollY += dy * layer->desc.parallax;
+	*scrollX = wrap(*scrollX, layer->tileWidth * layer->desc.scale);
+	*scrollY = wrap(*scrollY, layer->tileHeight * layer->desc.scale);
+}
+
+//The clouds where they have drifted to by frame. One that hangs over the right or bottom
+//edge of the tile is composited again one tile to the left or up, where the next copy shows it.
+static void composite(ParallaxLayer* layer, const MipChain* chain, int frame) {
+	MipCanvas_Clear(&layer->cache);
+	for (int i = 0; i < layer->count; i++) {
+		TextureRect texture = CLOUD_TEXTURE_POSITIONS[layer->clouds[i].img_id];
+		float x = wrap(layer->clouds[i].x + layer->drift[2 * i] * frame, layer->tileWidth);
+		float y = wrap(layer->clouds[i].y + layer->drift[2 * i + 1] * frame, layer->tileHeight);
+		bool overRight = x + texture.w > layer->tileWidth;
+		bool overBottom = y + texture.h > layer->tileHeight;
+		MipCanvas_Composite(&layer->cache, chain, x, y, texture.x0, texture.y0, texture.x1, texture.y1);
+		if (overRight) MipCanvas_Composite(&layer->cache, chain, x - layer->tileWidth, y, texture.x0, texture.y0, texture.x1, texture.y1);
+		if (overBottom) MipCanvas_Composite(&layer->cache, chain, x, y - layer->tileHeight, texture.x0, texture.y0, texture.x1, texture.y1);
+		if (overRight && overBottom) MipCanvas_Composite(&layer->cache, chain, x - layer->tileWidth, y - layer->tileHeight, texture.x0, texture.y0, texture.x1, texture.y1);
+	}
+	MipCanvas_Upload(&layer->cache);
+}
+
+/***
+* The tile is repeated as often as it takes to cover the view, and each copy draws only the
+* cache's rects, cut to the view: one draw per group of overlapping clouds on screen, filling
+* about the pixels the clouds cover. Drawing whole copies would be four draws a layer, but
+* fill the entire screen again for every layer.
+***/
+void ParallaxLayer_Draw(ParallaxLayer* layer, const MipChain* chain, float scrollX, float scrollY, int frame, float viewWidth, float viewHeight) {
+	if (layer->desc.collides || !layer->cache.image) return;
+	int period = layer->desc.refreshFrames;
+	int refresh = (period > 0) ? frame - (int)wrap((float)(frame + layer->stagger), (float)period) : 0;
+	if (refresh != layer->renderedFrame) {
+		composite(layer, chain, refresh);
+		layer->renderedFrame = refresh;
+	}
+
+	float cell = (1 << layer->desc.level) * layer->desc.scale; //screen pixels per cache pixel
+	float tileWidth = layer->cache.width * cell;
+	float tileHeight = layer->cache.height * cell;
+	float originX = wrap(scrollX, tileWidth) - tileWidth;
+	float originY = wrap(scrollY, tileHeight) - tileHeight;
+	for (float y = originY; y < viewHeight; y += tileHeight) {
+		for (float x = originX; x < viewWidth; x += tileWidth) {
+			for (int i = 0; i < layer->cache.rectCount; i++) {
+				MipRect r = layer->cache.rects[i];
+				float x0 = fmaxf(x + r.x0 * cell, 0);
+				float y0 = fmaxf(y + r.y0 * cell, 0);
+				float x1 = fminf(x + r.x1 * cell, viewWidth);
+				float y1 = fminf(y + r.y1 * cell, viewHeight);
+				if (x1 <= x0 || y1 <= y0) continue;
+				CP_Image_DrawSubImage(layer->cache.image, x0, y0, x1 - x0, y1 - y0, (x0 - x) / cell, (y0 - y) / cell, (x1 - x) / cell, (y1 - y) / cell, layer->desc.alpha);
+			}
+		}
+	}
+}
@@ -0,0 +1,57 @@
+//---------------------------------------------------------
+// file:	parallax.h
+//
+// brief:	Depth layers of clouds. Each layer scrolls by its
+//			own fraction of the plane's movement and draws its
+//			clouds at its own scale. Scenery layers are a tile
+//			of one screen that repeats forever: its clouds are
+//			composited into a cached image once and only
+//			recomposited every so many frames, so a frame
+//			spends no time on the clouds themselves, only on
+//			drawing the cache.
+//---------------------------------------------------------
+#pragma once
+
+#include "mipmap.h"
+#include "world.h"
+#include <stdbool.h>
+
+typedef struct {
+	float parallax; //screen pixels the layer moves per pixel the world does, the gameplay layer is 1
+	float scale; //Cloud.size of the layer's clouds
+	float density; //clouds per screen
+	int alpha;
+	int level; //mip level the cache is composited from, drawn 2^level * scale screen pixels per cache pixel
+	int refreshFrames; //frames between recomposites that move the clouds along their drift, 0 never
+	bool collides; //drawn cloud by cloud and swept against the plane instead of cached, main.c's activeClouds
+} ParallaxLayerDesc;
+
+/***
+* Clouds live in layer pixels, where a cloud is as big as its rect in the atlas. The tile is
+* one screen divided by scale, rounded up to whole cache pixels so it wraps without a seam.
+* Each cloud drifts slowly on its own; refreshFrames is picked so no cloud moves more than
+* about a screen pixel between two recomposites, then nobody sees them jump.
+*
+* Generate, Free and Draw create, free and upload an image, so they belong to the main
+* thread. Scroll only reads what Generate wrote and may run anywhere.
+***/
+typedef struct {
+	ParallaxLayerDesc desc;
+	int count;
+	Cloud* clouds; //as of frame 0, inside the tile
+	float* drift; //x and y per cloud, layer pixels per frame
+	float tileWidth, tileHeight; //layer pixels
+	int stagger; //frames the refreshes are shifted by, so layers don't all refresh on one frame
+	MipCanvas cache;
+	int renderedFrame; //the refresh the cache shows, -1 before the first
+} ParallaxLayer;
+
+//Place density clouds at random, one screen's worth of tile, and make the cache.
+bool ParallaxLayer_Generate(ParallaxLayer* layer, const ParallaxLayerDesc* desc, const MipChain* chain, int screenWidth, int screenHeight, int stagger);
+void ParallaxLayer_Free(ParallaxLayer* layer);
+
+//Move a layer's scroll, screen pixels like globalX/Y, by its share of the world moving (dx, dy).
+//Kept inside one tile, so it never loses precision however long a run gets.
+void ParallaxLayer_Scroll(const ParallaxLayer* layer, float* scrollX, float* scrollY, float dx, float dy);
+//Recomposite the cache if frame reached a new refresh, then cover the view with the tile.
+void ParallaxLayer_Draw(ParallaxLayer* layer, const MipChain* chain, float scrollX, float scrollY, int frame, float viewWidth, float viewHeight);
@@ -0,0 +1,132 @@
+//---------------------------------------------------------
+// file:	particles.c
+//
+// brief:	Fixed-capacity particle pool (see particles.h).
+//---------------------------------------------------------
+
+#include "particles.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <xmmintrin.h>
+
+#define PI 3.14159265358979323846264
+
+bool Particles_Init(ParticlePool* pool, int capacity, float (*random)(void* state), void* randomState) {
+	memset(pool, 0, sizeof * pool);
+	//round up so the SIMD loop never needs a partial vector at the end of the arrays
+	capacity = (capacity + 3) & ~3;
+
+	pool->x = calloc(capacity, sizeof * pool->x);
+	pool->y = calloc(capacity, sizeof * pool->y);
+	pool->vx = calloc(capacity, sizeof * pool->vx);
+	pool->vy = calloc(capacity, sizeof * pool->vy);
+	pool->life = calloc(capacity, sizeof * pool->life);
+	pool->maxLife = calloc(capacity, sizeof * pool->maxLife);
+	pool->color = calloc(capacity, sizeof * pool->color);
+	if (!pool->x || !pool->y || !pool->vx || !pool->vy || !pool->life || !pool->maxLife || !pool->color) {
+		Particles_Free(pool);
+		return false;
+	}
+
+	pool->capacity = capacity;
+	pool->drag = 0.94f;
+	pool->gravity = 0.15f;
+	pool->random = random;
+	pool->randomState = randomState;
+	return true;
+}
+
+void Particles_Free(ParticlePool* pool) {
+	free(pool->x);
+	free(pool->y);
+	free(pool->vx);
+	free(pool->vy);
+	free(pool->life);
+	free(pool->maxLife);
+	free(pool->color);
+	memset(pool, 0, sizeof * pool);
+}
+
+void Particles_Clear(ParticlePool* pool) {
+	pool->count = 0;
+}
+
+int Particles_Burst(ParticlePool* pool, float x, float y, int count, float speedMin, float speedMax, float life, CP_Color color) {
+	int available = pool->capacity - pool->count;
+	count = (count > available) ? available : count;
+
+	for (int n = 0; n < count; n++) {
+		int i = pool->count++;
+		float angle = pool->random(pool->randomState) * 2 * (float)PI;
+		float velocity = speedMin + (speedMax - speedMin) * pool->random(pool->randomState);
+		pool->x[i] = x;
+		pool->y[i] = y;
+		pool->vx[i] = cosf(angle) * velocity;
+		pool->vy[i] = sinf(angle) * velocity;
+		//a little spread in lifetime so a burst fades out instead of vanishing all at once
+		pool->life[i] = life * (0.6f + 0.4f * pool->random(pool->randomState));
+		pool->maxLife[i] = pool->life[i];
+		pool->color[i] = color;
+	}
+	return count;
+}
+
+void Particles_Update(ParticlePool* pool) {
+	__m128 drag = _mm_set1_ps(pool->drag);
+	__m128 gravity = _mm_set1_ps(pool->gravity);
+	__m128 one = _mm_set1_ps(1.0f);
+
+	//Integrate four particles at a time. The arrays are padded to a multiple of 4,
+	//so the last vector may touch dead slots, which is harmless.
+	for (int i = 0; i < pool->count; i += 4) {
+		__m128 vx = _mm_mul_ps(_mm_loadu_ps(pool->vx + i), drag);
+		__m128 vy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(pool->vy + i), gravity), drag);
+		_mm_storeu_ps(pool->vx + i, vx);
+		_mm_storeu_ps(pool->vy + i, vy);
+		_mm_storeu_ps(pool->x + i, _mm_add_ps(_mm_loadu_ps(pool->x + i), vx));
+		_mm_storeu_ps(pool->y + i, _mm_add_ps(_mm_loadu_ps(pool->y + i), vy));
+		_mm_storeu_ps(pool->life + i, _mm_sub_ps(_mm_loadu_ps(pool->life + i), one));
+	}
+
+	//Remove dead particles by moving the last live one into the hole.
+	int i = 0;
+	while (i < pool->count) {
+		if (pool->life[i] > 0) {
+			i++;
+			continue;
+		}
+		int last = --pool->count;
+		pool->x[i] = pool->x[last];
+		pool->y[i] = pool->y[last];
+		pool->vx[i] = pool->vx[last];
+		pool->vy[i] = pool->vy[last];
+		pool->life[i] = pool->life[last];
+		pool->maxLife[i] = pool->maxLife[last];
+		pool->color[i] = pool->color[last];
+	}
+}
+
+void Particles_Move(ParticlePool* pool, float dx, float dy) {
+	for (int i = 0; i < pool->count; i++) {
+		pool->x[i] += dx;
+		pool->y[i] += dy;
+	}
+}
+
+void Particles_Draw(ParticlePool* pool, DrawList* list, int layer, float size) {
+	float left, top, right, bottom;
+	DrawList_ViewRect(list, layer, &left, &top, &right, &bottom);
+	DrawList_NoStroke(list);
+	for (int i = 0; i < pool->count; i++) {
+		float x = pool->x[i] - size / 2;
+		float y = pool->y[i] - size / 2;
+		if (x + size < left || y + size < top || x > right || y > bottom) continue; //before the fill, which costs more than the test
+
+		CP_Color c = pool->color[i];
+		//32 steps of fade instead of 256, so particles share fills and the draw list can group them
+		c.a = (unsigned char)((int)(c.a * pool->life[i] / pool->maxLife[i]) | 7);
+		DrawList_Fill(list, c);
+		DrawList_Rect(list, layer, x, y, size, size);
+	}
+}
@@ -0,0 +1,48 @@
+//---------------------------------------------------------
+// file:	particles.h
+//
+// brief:	Fixed-capacity particle pool for hit and coin feedback.
+//			All memory is allocated once in Particles_Init;
+//			bursting, updating and drawing never allocate.
+//---------------------------------------------------------
+#pragma once
+
+#include "cprocessing.h"
+#include "drawlist.h"
+#include <stdbool.h>
+
+/***
+* Struct-of-arrays layout: the update loop streams through each array once,
+* four particles at a time. Positions are in world space (the same space as
+* Cloud.x/y and the coin store) so particles drift with the world, not the screen.
+***/
+typedef struct {
+	int capacity;
+	int count; //live particles are always packed into [0, count)
+	float* x;
+	float* y;
+	float* vx;
+	float* vy;
+	float* life; //remaining frames
+	float* maxLife;
+	CP_Color* color;
+	float drag; //velocity multiplier per frame
+	float gravity; //added to vy per frame
+	float (*random)(void* state); //uniform in [0, 1), where bursts get their directions, speeds and lifetimes
+	void* randomState;
+} ParticlePool;
+
+//random is the owner's: the pool bursts on whatever thread its owner runs on.
+bool Particles_Init(ParticlePool* pool, int capacity, float (*random)(void* state), void* randomState);
+void Particles_Free(ParticlePool* pool);
+void Particles_Clear(ParticlePool* pool);
+
+//Spawn up to count particles at (x, y) flying outwards in random directions.
+//Particles beyond the pool capacity are dropped, never allocated.
+int Particles_Burst(ParticlePool* pool, float x, float y, int count, float speedMin, float speedMax, float life, CP_Color color);
+
+void Particles_Update(ParticlePool* pool);
+//Move every live particle by (dx, dy), for when the world's origin moves under them.
+void Particles_Move(ParticlePool* pool, float dx, float dy);
+//Records each particle on screen as a rect in layer, which the list has in world coordinates.
+void Particles_Draw(ParticlePool* pool, DrawList* list, int layer, float size);
@@ -0,0 +1,200 @@
+//---------------------------------------------------------
+// file:	pipeline.c
+//
+// brief:	Simulation worker thread and packet triple buffer
+//			(see pipeline.h).
+//---------------------------------------------------------
+
+#include "pipeline.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+typedef CRITICAL_SECTION Lock;
+typedef CONDITION_VARIABLE Condition;
+typedef volatile LONG AtomicSlot;
+#define THREAD_RESULT DWORD WINAPI
+static void lockCreate(Lock* lock) { InitializeCriticalSection(lock); }
+static void lockEnter(Lock* lock) { EnterCriticalSection(lock); }
+static void lockLeave(Lock* lock) { LeaveCriticalSection(lock); }
+static void lockFree(Lock* lock) { DeleteCriticalSection(lock); }
+static void conditionCreate(Condition* condition) { InitializeConditionVariable(condition); }
+static void conditionWait(Condition* condition, Lock* lock) { SleepConditionVariableCS(condition, lock, INFINITE); }
+static void conditionSignal(Condition* condition) { WakeAllConditionVariable(condition); }
+static void conditionFree(Condition* condition) { (void)condition; }
+static int loadSlot(AtomicSlot* slot) { return (int)InterlockedCompareExchange(slot, 0, 0); }
+static int exchangeSlot(AtomicSlot* slot, int value) { return (int)InterlockedExchange(slot, (LONG)value); }
+#else
+#include <pthread.h>
+typedef pthread_mutex_t Lock;
+typedef pthread_cond_t Condition;
+typedef volatile int AtomicSlot;
+#define THREAD_RESULT void*
+static void lockCreate(Lock* lock) { pthread_mutex_init(lock, NULL); }
+static void lockEnter(Lock* lock) { pthread_mutex_lock(lock); }
+static void lockLeave(Lock* lock) { pthread_mutex_unlock(lock); }
+static void lockFree(Lock* lock) { pthread_mutex_destroy(lock); }
+static void conditionCreate(Condition* condition) { pthread_cond_init(condition, NULL); }
+static void conditionWait(Condition* condition, Lock* lock) { pthread_cond_wait(condition, lock); }
+static void conditionSignal(Condition* condition) { pthread_cond_broadcast(condition); }
+static void conditionFree(Condition* condition) { pthread_cond_destroy(condition); }
+static int loadSlot(AtomicSlot* slot) { return __atomic_load_n(slot, __ATOMIC_ACQUIRE); }
+static int exchangeSlot(AtomicSlot* slot, int value) { return __atomic_exchange_n(slot, value, __ATOMIC_ACQ_REL); }
+#endif
+
+#define SLOT_FRESH 4 //set on the middle slot when the worker put a packet there that hasn't been acquired
+
+/***
+* The three packets rotate between three owners: the worker fills back, the drawing thread
+* reads front, and middle is the newest finished one. Publishing and acquiring are a single
+* atomic swap with middle each, so a slow side never blocks the other; when the worker is
+* faster, packets the drawing thread never saw are simply overwritten.
+*
+* Input goes the other way under a lock. That lock is never held while a tick runs or a
+* packet is drawn, only while the input is copied.
+***/
+struct Pipeline {
+	PipelineTick tick;
+	void* context;
+	void* packets[PIPELINE_PACKETS];
+	int inputSize;
+
+	AtomicSlot middle; //packet index, | SLOT_FRESH
+	int back; //worker's
+	int front; //drawing thread's, -1 before the first packet
+	PipelineStats stats;
+	uint64_t published; //written by the worker only, read under the lock
+
+	Lock lock;
+	Condition changed; //input posted, taken, or a tick finished
+	bool running;
+	bool queued; //input waits for the worker
+	bool busy; //a tick is running
+	unsigned char input[PIPELINE_MAX_INPUT];
+#ifdef _WIN32
+	HANDLE thread;
+#else
+	pthread_t thread;
+#endif
+};
+
+static THREAD_RESULT workerMain(void* param) {
+	Pipeline* pipeline = param;
+	unsigned char input[PIPELINE_MAX_INPUT];
+	for (;;) {
+		lockEnter(&pipeline->lock);
+		while (pipeline->running && !pipeline->queued) conditionWait(&pipeline->changed, &pipeline->lock);
+		if (!pipeline->queued) {
+			lockLeave(&pipeline->lock);
+			break; //stopped with nothing left to do
+		}
+		memcpy(input, pipeline->input, pipeline->inputSize);
+		pipeline->queued = false;
+		pipeline->busy = true;
+		conditionSignal(&pipeline->changed);
+		lockLeave(&pipeline->lock);
+
+		bool publish = pipeline->tick(pipeline->context, input, pipeline->packets[pipeline->back]);
+		int previous = 0;
+		if (publish) {
+			previous = exchangeSlot(&pipeline->middle, pipeline->back | SLOT_FRESH);
+			pipeline->back = previous & ~SLOT_FRESH;
+		}
+
+		lockEnter(&pipeline->lock);
+		pipeline->published += publish;
+		pipeline->stats.skipped += (previous & SLOT_FRESH) != 0;
+		pipeline->busy = false;
+		conditionSignal(&pipeline->changed);
+		lockLeave(&pipeline->lock);
+	}
+	return 0;
+}
+
+Pipeline* Pipeline_Start(PipelineTick tick, void* context, void* packets[PIPELINE_PACKETS], int inputSize) {
+	if (inputSize < 0 || inputSize > PIPELINE_MAX_INPUT) return NULL;
+	Pipeline* pipeline = calloc(1, sizeof * pipeline);
+	if (!pipeline) return NULL;
+	pipeline->tick = tick;
+	pipeline->context = context;
+	memcpy(pipeline->packets, packets, sizeof pipeline->packets);
+	pipeline->inputSize = inputSize;
+	pipeline->front = -1;
+	pipeline->back = 0;
+	pipeline->middle = 1;
+	lockCreate(&pipeline->lock);
+	conditionCreate(&pipeline->changed);
+	pipeline->running = true;
+#ifdef _WIN32
+	pipeline->thread = CreateThread(NULL, 0, workerMain, pipeline, 0, NULL);
+	bool started = pipeline->thread != NULL;
+#else
+	bool started = pthread_create(&pipeline->thread, NULL, workerMain, pipeline) == 0;
+#endif
+	if (!started) {
+		conditionFree(&pipeline->changed);
+		lockFree(&pipeline->lock);
+		free(pipeline);
+		return NULL;
+	}
+	return pipeline;
+}
+
+void Pipeline_Stop(Pipeline** pipeline) {
+	Pipeline* p = *pipeline;
+	if (!p) return;
+	lockEnter(&p->lock);
+	p->running = false;
+	conditionSignal(&p->changed);
+	lockLeave(&p->lock);
+#ifdef _WIN32
+	WaitForSingleObject(p->thread, INFINITE);
+	CloseHandle(p->thread);
+#else
+	pthread_join(p->thread, NULL);
+#endif
+	conditionFree(&p->changed);
+	lockFree(&p->lock);
+	free(p);
+	*pipeline = NULL;
+}
+
+bool Pipeline_Post(Pipeline* pipeline, const void* input) {
+	lockEnter(&pipeline->lock);
+	bool accepted = !pipeline->queued;
+	if (accepted) {
+		memcpy(pipeline->input, input, pipeline->inputSize);
+		pipeline->queued = true;
+		conditionSignal(&pipeline->changed);
+	}
+	lockLeave(&pipeline->lock);
+	return accepted;
+}
+
+void* Pipeline_Acquire(Pipeline* pipeline) {
+	pipeline->stats.acquires++;
+	if (!(loadSlot(&pipeline->middle) & SLOT_FRESH)) {
+		pipeline->stats.repeats++;
+	} else {
+		//the first time front is -1, so the spare index 2 goes to the middle instead
+		int previous = exchangeSlot(&pipeline->middle, (pipeline->front < 0) ? 2 : pipeline->front);
+		pipeline->front = previous & ~SLOT_FRESH;
+	}
+	return (pipeline->front < 0) ? NULL : pipeline->packets[pipeline->front];
+}
+
+void Pipeline_Drain(Pipeline* pipeline) {
+	lockEnter(&pipeline->lock);
+	while (pipeline->queued || pipeline->busy) conditionWait(&pipeline->changed, &pipeline->lock);
+	lockLeave(&pipeline->lock);
+}
+
+PipelineStats Pipeline_GetStats(Pipeline* pipeline) {
+	lockEnter(&pipeline->lock);
+	PipelineStats stats = pipeline->stats;
+	stats.ticks = pipeline->published;
+	lockLeave(&pipeline->lock);
+	return stats;
+}
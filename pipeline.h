@@ -0,0 +1,47 @@
+//---------------------------------------------------------
+// file:	pipeline.h
+//
+// brief:	Runs a game's simulation on a worker thread, one
+//			tick ahead of the thread that draws. Each tick fills
+//			a frame packet, and finished packets are handed to
+//			the drawing thread through a lock-free triple
+//			buffer, so neither side waits for the other to be
+//			done with a packet.
+//---------------------------------------------------------
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PIPELINE_PACKETS 3
+#define PIPELINE_MAX_INPUT 64 //bytes
+
+//Simulate one tick from input, filling packet. Runs on the worker thread. Returning false
+//drops the packet, the newest published one stays the newest.
+typedef bool (*PipelineTick)(void* context, const void* input, void* packet);
+
+typedef struct {
+	uint64_t ticks; //packets published, dropped ones don't count
+	uint64_t acquires; //Acquire calls
+	uint64_t repeats; //Acquire calls that found nothing newer than last time
+	uint64_t skipped; //packets replaced by a newer one before they were acquired
+} PipelineStats;
+
+typedef struct Pipeline Pipeline;
+
+//packets are the caller's, PIPELINE_PACKETS of them. Returns NULL if the thread can't be started.
+Pipeline* Pipeline_Start(PipelineTick tick, void* context, void* packets[PIPELINE_PACKETS], int inputSize);
+//Finish the tick in progress and the queued one, then stop the thread.
+void Pipeline_Stop(Pipeline** pipeline);
+
+//Queue one tick. Only one can wait: returns false if the last input hasn't been taken yet,
+//then the caller keeps its input and merges the next frame's into it.
+bool Pipeline_Post(Pipeline* pipeline, const void* input);
+//The newest finished packet, or NULL before the first. It stays the caller's, untouched by
+//the worker, until the next Acquire.
+void* Pipeline_Acquire(Pipeline* pipeline);
+//Wait until no tick is queued or running. Afterwards the caller may touch everything the
+//ticks do, until its next Post.
+void Pipeline_Drain(Pipeline* pipeline);
+
+PipelineStats Pipeline_GetStats(Pipeline* pipeline);
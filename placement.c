@@ -0,0 +1,231 @@
+//---------------------------------------------------------
+// file:	placement.c
+//
+// brief:	Poisson-disk cloud placement (see placement.h).
+//---------------------------------------------------------
+
+#include "placement.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define PI 3.14159265358979323846264
+
+#define PLACEMENT_ATTEMPTS 12 //candidates around a sample before it counts as surrounded, Bridson's k
+#define PLACEMENT_EPSILON 1.001f //candidates sit this much further out than touching, against rounding
+
+typedef struct {
+	float x, y; //stretched space
+	int type;
+} Sample;
+
+typedef struct {
+	int dx, dy; //cells
+	float gap; //shortest distance from anywhere in the center cell to anywhere in this one
+} Offset;
+
+typedef struct {
+	const CloudPlacement* placement;
+	float stretch; //y is multiplied by this
+	float radii[CLOUD_TEXTURE_COUNT]; //stretched space, around each type's hit shape
+	float safeRadii[CLOUD_TEXTURE_COUNT]; //unstretched, how far each type's center stays from the safe point
+	float maxRadius;
+	float top, bottom; //the area's, stretched
+	float cellSize;
+	int cols, rows;
+	int* grid; //sample in each cell, -1 for none
+	Offset* stencil; //every cell a neighbour can be in, nearest first
+	int stencilCount;
+	Sample* samples;
+	int count, capacity;
+	int* active; //samples that may still have room around them
+	int activeCount;
+} Sampler;
+
+static float randomRange(Sampler* s, float min, float max) {
+	return min + (max - min) * s->placement->random(s->placement->randomState);
+}
+
+static int randomIndex(Sampler* s, int count) {
+	int i = (int)(s->placement->random(s->placement->randomState) * (float)count);
+	return (i < count) ? i : count - 1;
+}
+
+static int byGap(const void* a, const void* b) {
+	float ga = ((const Offset*)a)->gap;
+	float gb = ((const Offset*)b)->gap;
+	return (ga > gb) - (ga < gb);
+}
+
+//Most candidates fail, and on a sample close by: checking near cells first finds it soonest.
+static bool buildStencil(Sampler* s) {
+	float reachDistance = 2 * s->maxRadius;
+	int reach = (int)ceilf(reachDistance / s->cellSize);
+	s->stencil = malloc((size_t)(2 * reach + 1) * (2 * reach + 1) * sizeof * s->stencil);
+	if (!s->stencil) return false;
+	for (int dy = -reach; dy <= reach; dy++) {
+		for (int dx = -reach; dx <= reach; dx++) {
+			float gapX = (abs(dx) > 1) ? (abs(dx) - 1) * s->cellSize : 0;
+			float gapY = (abs(dy) > 1) ? (abs(dy) - 1) * s->cellSize : 0;
+			Offset offset = { dx, dy, sqrtf(gapX * gapX + gapY * gapY) };
+			if (offset.gap < reachDistance) s->stencil[s->stencilCount++] = offset;
+		}
+	}
+	qsort(s->stencil, s->stencilCount, sizeof * s->stencil, byGap);
+	return true;
+}
+
+//Distances between points never shorter than two of the smallest radii, so a cell whose
+//diagonal is exactly that holds at most one point.
+static bool init(Sampler* s, const CloudPlacement* p) {
+	memset(s, 0, sizeof * s);
+	s->placement = p;
+	int types = (p->types < 1) ? 1 : (p->types > CLOUD_TEXTURE_COUNT) ? CLOUD_TEXTURE_COUNT : p->types;
+	float ratio = 0;
+	for (int i = 0; i < types; i++) {
+		TextureRect t = CLOUD_TEXTURE_POSITIONS[i];
+		ratio += (p->size * t.w * p->widthScalar / 2 + p->margin) / (p->size * t.h * p->heightScalar / 2 + p->margin);
+	}
+	s->stretch = ratio / (float)types;
+
+	float minRadius = 0;
+	for (int i = 0; i < types; i++) {
+		TextureRect t = CLOUD_TEXTURE_POSITIONS[i];
+		float a = p->size * t.w * p->widthScalar / 2 + p->margin;
+		float b = p->size * t.h * p->heightScalar / 2 + p->margin;
+		s->radii[i] = fmaxf(a, b * s->stretch) + p->gap / 2 * fmaxf(s->stretch, 1); //a gap in real space is at most stretch times longer here
+		s->safeRadii[i] = p->safeRadius + fmaxf(a, b);
+		minRadius = (i == 0) ? s->radii[i] : fminf(minRadius, s->radii[i]);
+		s->maxRadius = fmaxf(s->maxRadius, s->radii[i]);
+	}
+
+	s->top = p->top * s->stretch;
+	s->bottom = p->bottom * s->stretch;
+	s->cellSize = minRadius * sqrtf(2);
+	s->cols = (int)ceilf((p->right - p->left) / s->cellSize);
+	s->rows = (int)ceilf((s->bottom - s->top) / s->cellSize);
+	if (s->cols < 1 || s->rows < 1) return false;
+	s->capacity = s->cols * s->rows; //one per cell at most
+	s->grid = malloc((size_t)s->capacity * sizeof * s->grid);
+	s->samples = malloc((size_t)s->capacity * sizeof * s->samples);
+	s->active = malloc((size_t)s->capacity * sizeof * s->active);
+	if (!s->grid || !s->samples || !s->active) return false;
+	memset(s->grid, 0xff, (size_t)s->capacity * sizeof * s->grid); //-1 everywhere
+	return buildStencil(s);
+}
+
+static void freeSampler(Sampler* s) {
+	free(s->grid);
+	free(s->samples);
+	free(s->active);
+	free(s->stencil);
+}
+
+static void cellOf(const Sampler* s, float x, float y, int* col, int* row) {
+	*col = (int)((x - s->placement->left) / s->cellSize);
+	*row = (int)((y - s->top) / s->cellSize);
+	*col = (*col >= s->cols) ? s->cols - 1 : *col; //x just under right can round up to it
+	*row = (*row >= s->rows) ? s->rows - 1 : *row;
+}
+
+//Inside the area, clear of the safe point and of every sample whose circle overlaps this one.
+static bool fits(Sampler* s, float x, float y, int type) {
+	const CloudPlacement* p = s->placement;
+	if (x < p->left || x >= p->right || y < s->top || y >= s->bottom) return false;
+	float safeX = x - p->safeX;
+	float safeY = y / s->stretch - p->safeY;
+	if (safeX * safeX + safeY * safeY < s->safeRadii[type] * s->safeRadii[type]) return false;
+
+	int col, row;
+	cellOf(s, x, y, &col, &row);
+	float reach = s->radii[type] + s->maxRadius;
+	for (int i = 0; i < s->stencilCount && s->stencil[i].gap < reach; i++) {
+		int c = col + s->stencil[i].dx;
+		int r = row + s->stencil[i].dy;
+		if (c < 0 || c >= s->cols || r < 0 || r >= s->rows) continue;
+		int other = s->grid[r * s->cols + c];
+		if (other < 0) continue;
+		float dx = s->samples[other].x - x;
+		float dy = s->samples[other].y - y;
+		float spacing = s->radii[type] + s->radii[s->samples[other].type];
+		if (dx * dx + dy * dy < spacing * spacing) return false;
+	}
+	return true;
+}
+
+static void add(Sampler* s, float x, float y, int type) {
+	int col, row;
+	cellOf(s, x, y, &col, &row);
+	Sample sample = { x, y, type };
+	s->grid[row * s->cols + col] = s->count;
+	s->active[s->activeCount++] = s->count;
+	s->samples[s->count++] = sample;
+}
+
+/***
+* Bridson: take a random active sample and try candidates around it. The first that fits
+* is added, and if none does, the sample is full around and leaves the active list. Every
+* round either adds a sample or retires one, so it's all done after a fixed number of
+* candidates per sample.
+*
+* Bridson's candidates are random, anywhere from touching the sample to twice that far.
+* Here they are all just touching it, at even steps around from a random angle (Martin
+* Roberts' variant): it packs tighter, and 12 of them leave fewer holes than 30 random ones.
+*
+* When the list runs dry, a few darts thrown anywhere start another front, for parts of the
+* area the safe circle cut off from the rest.
+***/
+static void fill(Sampler* s) {
+	const CloudPlacement* p = s->placement;
+	int types = (p->types < 1) ? 1 : (p->types > CLOUD_TEXTURE_COUNT) ? CLOUD_TEXTURE_COUNT : p->types;
+	for (;;) {
+		for (int i = 0; i < PLACEMENT_ATTEMPTS && !s->activeCount; i++) {
+			float x = randomRange(s, p->left, p->right);
+			float y = randomRange(s, s->top, s->bottom);
+			int type = randomIndex(s, types);
+			if (fits(s, x, y, type)) add(s, x, y, type);
+		}
+		if (!s->activeCount) return;
+
+		while (s->activeCount) {
+			int slot = randomIndex(s, s->activeCount);
+			Sample from = s->samples[s->active[slot]];
+			bool added = false;
+			float start = randomRange(s, 0, 2 * (float)PI);
+			for (int i = 0; i < PLACEMENT_ATTEMPTS && !added; i++) {
+				int type = randomIndex(s, types);
+				float distance = (s->radii[from.type] + s->radii[type]) * PLACEMENT_EPSILON;
+				float angle = start + i * (2 * (float)PI / PLACEMENT_ATTEMPTS);
+				float x = from.x + cosf(angle) * distance;
+				float y = from.y + sinf(angle) * distance;
+				if (fits(s, x, y, type)) {
+					add(s, x, y, type);
+					added = true;
+				}
+			}
+			if (!added) s->active[slot] = s->active[--s->activeCount];
+		}
+	}
+}
+
+int Placement_Clouds(const CloudPlacement* placement, Cloud* clouds, int count) {
+	Sampler s;
+	int placed = 0;
+	if (init(&s, placement)) {
+		fill(&s);
+		//a partial shuffle picks count of them at random, any subset keeps the spacing
+		for (; placed < count && placed < s.count; placed++) {
+			int pick = placed + randomIndex(&s, s.count - placed);
+			Sample sample = s.samples[pick];
+			s.samples[pick] = s.samples[placed];
+			TextureRect t = CLOUD_TEXTURE_POSITIONS[sample.type];
+			clouds[placed].size = placement->size;
+			clouds[placed].x = sample.x - placement->size * t.w / 2;
+			clouds[placed].y = sample.y / s.stretch - placement->size * t.h / 2;
+			clouds[placed].img_id = sample.type;
+		}
+	}
+	freeSampler(&s);
+	return placed;
+}
@@ -0,0 +1,36 @@
+//---------------------------------------------------------
+// file:	placement.h
+//
+// brief:	Poisson-disk placement of clouds: spread evenly,
+//			no two hit shapes overlapping, so there is always
+//			a way between them, and none near the plane.
+//			Bridson's algorithm over a background grid, so it
+//			takes time in proportion to the clouds it places.
+//---------------------------------------------------------
+#pragma once
+
+#include "world.h"
+
+/***
+* Every cloud keeps its whole hit shape (see collision.h) clear of every other one's. The
+* shape is wider than tall, so spacing is measured with y stretched until an average shape
+* is round, and each img_id gets the circle around its shape in that space: the clouds pack
+* as tightly as their ellipses allow, not their widest side.
+*
+* The area is filled up completely, then count of those clouds are picked at random, so they
+* spread over the whole area however few are asked for.
+***/
+typedef struct {
+	float left, top, right, bottom; //where cloud centers may go
+	float size; //Cloud.size of every cloud
+	float widthScalar, heightScalar, margin; //the hit shape, like the collision loop's
+	float gap; //room left between two hit shapes, for the plane to fly through
+	int types; //img_ids 0 to types - 1 are used
+	float safeX, safeY, safeRadius; //no hit shape comes within safeRadius of this point
+	float (*random)(void* state); //uniform in [0, 1)
+	void* randomState;
+} CloudPlacement;
+
+//Places up to count clouds and returns how many fit, fewer only when the area is too small
+//or out of memory. The rest of clouds is left alone.
+int Placement_Clouds(const CloudPlacement* placement, Cloud* clouds, int count);
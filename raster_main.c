@@ -0,0 +1,410 @@
+//---------------------------------------------------------
+// file:	raster_main.c
+//
+// brief:	Entry point of the headless rasterizer tool. Draws
+//			a frame laid out like game_update's (sky, scenery
+//			and gameplay clouds, coins, particles, the plane,
+//			indicators, hit flash, HUD and minimap) with the
+//			software rasterizer in softraster.h, then either
+//			compares it with a golden image or times it.
+//			--golden FILE	compare a 320x180 frame with FILE
+//			--update FILE	write that frame to FILE instead
+//			--bench FRAMES	megapixels per second at 1080p and
+//							4K, on one thread and on every core
+//
+// usage:	HotAirRaster (--golden FILE | --update FILE |
+//			--bench FRAMES) [--threads N]
+//---------------------------------------------------------
+
+#include "softraster.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#define GOLDEN_WIDTH 320
+#define GOLDEN_HEIGHT 180
+#define GOLDEN_CHANNEL_SLACK 2 //trig differs by an ulp between C runtimes, which moves a few edges
+#define GOLDEN_PIXEL_SLACK 0.002 //fraction of pixels allowed past the channel slack
+
+#define LAYOUT_WIDTH 1920.0f //the frame is laid out at 1080p and scaled to the target
+#define SCENERY_LAYERS 3
+#define SCENERY_PER_LAYER 12
+#define GAMEPLAY_CLOUDS 24
+#define COINS 8
+#define PARTICLES 150
+#define INDICATORS 6
+
+static double nowSeconds() {
+#ifdef _WIN32
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (double)counter.QuadPart / frequency.QuadPart;
+#else
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+#endif
+}
+
+static int coreCount() {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count < 1) ? 1 : (int)count;
+#endif
+}
+
+static FILE* openFile(const char* path, const char* mode) {
+#ifdef _WIN32
+	FILE* file = NULL;
+	return (fopen_s(&file, path, mode) == 0) ? file : NULL;
+#else
+	return fopen(path, mode);
+#endif
+}
+
+//Same xorshift as camera.c, so the layout is identical on every platform.
+static uint32_t nextRandom(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static float randomRange(uint32_t* state, float min, float max) {
+	return min + (max - min) * (nextRandom(state) >> 8) / (float)(1 << 24);
+}
+
+/* * * * * * * * *
+*    TEXTURES    *
+* * * * * * * * */
+//A soft cloud: a few overlapping blobs whose alpha fades out towards their edges.
+static SR_Image* makeCloud(int w, int h) {
+	unsigned char* rgba = malloc((size_t)w * h * 4);
+	if (!rgba) return NULL;
+	const float blobX[4] = { 0.3f, 0.5f, 0.7f, 0.5f };
+	const float blobY[4] = { 0.6f, 0.4f, 0.6f, 0.65f };
+	const float blobR[4] = { 0.25f, 0.3f, 0.22f, 0.35f };
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			float cover = 0;
+			for (int b = 0; b < 4; b++) {
+				float dx = ((x + 0.5f) / w - blobX[b]) / blobR[b];
+				float dy = ((y + 0.5f) / h - blobY[b]) / blobR[b];
+				float inside = 1 - (dx * dx + dy * dy);
+				cover = (inside > cover) ? inside : cover;
+			}
+			unsigned char* p = rgba + ((size_t)y * w + x) * 4;
+			p[0] = 250;
+			p[1] = 250;
+			p[2] = (unsigned char)(235 + 20 * y / h);
+			p[3] = (unsigned char)(255 * ((cover > 1) ? 1 : cover));
+		}
+	}
+	SR_Image* img = SR_Image_CreateFromData(w, h, rgba);
+	free(rgba);
+	return img;
+}
+
+//A balloon: an envelope circle over a small basket, transparent around them.
+static SR_Image* makePlane(int size) {
+	unsigned char* rgba = calloc((size_t)size * size, 4);
+	if (!rgba) return NULL;
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			float fx = (x + 0.5f) / size - 0.5f;
+			float fy = (y + 0.5f) / size - 0.4f;
+			unsigned char* p = rgba + ((size_t)y * size + x) * 4;
+			if (fx * fx + fy * fy < 0.12f) {
+				p[0] = (unsigned char)((x / (size / 8)) % 2 ? 220 : 250);
+				p[1] = 60;
+				p[2] = 40;
+				p[3] = 255;
+			} else if (fx > -0.08f && fx < 0.08f && fy > 0.42f && fy < 0.56f) {
+				p[0] = 120;
+				p[1] = 80;
+				p[2] = 40;
+				p[3] = 255;
+			}
+		}
+	}
+	SR_Image* img = SR_Image_CreateFromData(size, size, rgba);
+	free(rgba);
+	return img;
+}
+
+/* * * * * * * * *
+*     FRAME      *
+* * * * * * * * */
+/***
+* Records one frame in the order game_update's draw list submits its layers. The layout is
+* at 1080p and scaled by the target's width, so every resolution draws the same picture and
+* only the pixel count changes. frame nudges everything a little so a benchmark doesn't draw
+* the same frame over and over.
+***/
+static void drawFrame(SR_Target* target, SR_Image* cloud, SR_Image* plane, int frame) {
+	float s = SR_Target_GetWidth(target) / LAYOUT_WIDTH;
+	float w = (float)SR_Target_GetWidth(target);
+	float h = (float)SR_Target_GetHeight(target);
+	float drift = (float)(frame % 120);
+	uint32_t rng = 0x9E3779B9u;
+
+	SR_Graphics_ClearBackground(target, (SR_Color) { 135, 206, 235, 255 });
+
+	//scenery, the faintest layer first
+	SR_Settings_ImageMode(target, SR_POSITION_CENTER);
+	for (int layer = 0; layer < SCENERY_LAYERS; layer++) {
+		int alpha = 60 + 40 * layer;
+		for (int i = 0; i < SCENERY_PER_LAYER; i++) {
+			float x = randomRange(&rng, 0, LAYOUT_WIDTH) - drift * (layer + 1) * 0.5f;
+			float y = randomRange(&rng, 0, 1080);
+			float size = randomRange(&rng, 180, 300) * (layer + 2) / 4;
+			SR_Image_Draw(target, cloud, x * s, y * s, size * 2 * s, size * s, alpha);
+		}
+	}
+
+	//gameplay clouds, a few of them turned
+	for (int i = 0; i < GAMEPLAY_CLOUDS; i++) {
+		float x = randomRange(&rng, 0, LAYOUT_WIDTH) - drift * 2;
+		float y = randomRange(&rng, 0, 1080);
+		float size = randomRange(&rng, 120, 260);
+		if (i % 4 == 0) SR_Image_DrawAdvanced(target, cloud, x * s, y * s, size * 2 * s, size * s, 255, randomRange(&rng, -30, 30));
+		else SR_Image_Draw(target, cloud, x * s, y * s, size * 2 * s, size * s, 255);
+	}
+
+	//coins
+	SR_Settings_Fill(target, (SR_Color) { 250, 200, 40, 255 });
+	SR_Settings_Stroke(target, (SR_Color) { 160, 110, 20, 255 });
+	SR_Settings_StrokeWeight(target, 3 * s);
+	for (int i = 0; i < COINS; i++) {
+		float x = randomRange(&rng, 100, 1820);
+		float y = randomRange(&rng, 100, 980);
+		SR_Graphics_DrawEllipseAdvanced(target, x * s, y * s, 40 * s, 40 * s, 0);
+	}
+
+	//particles: puffs and sparks
+	SR_Settings_NoStroke(target);
+	for (int i = 0; i < PARTICLES; i++) {
+		float x = randomRange(&rng, 760, 1160) + drift;
+		float y = randomRange(&rng, 440, 760);
+		float size = randomRange(&rng, 4, 18);
+		unsigned char alpha = (unsigned char)randomRange(&rng, 40, 220);
+		if (i % 5 == 0) {
+			SR_Settings_Fill(target, (SR_Color) { 255, 140, 40, alpha });
+			SR_Graphics_DrawRectAdvanced(target, x * s, y * s, size * s, size * 0.4f * s, randomRange(&rng, 0, 180), 0);
+		} else {
+			SR_Settings_Fill(target, (SR_Color) { 240, 240, 240, alpha });
+			SR_Graphics_DrawEllipseAdvanced(target, x * s, y * s, size * s, size * s, 0);
+		}
+	}
+
+	//the player
+	SR_Image_DrawAdvanced(target, plane, 960 * s, 540 * s, 96 * s, 96 * s, 255, 12);
+
+	//indicators at the screen edges pointing at off screen coins
+	SR_Settings_Fill(target, (SR_Color) { 255, 220, 60, 200 });
+	for (int i = 0; i < INDICATORS; i++) {
+		float x = (i % 2) ? 1880.0f : 40.0f;
+		float y = 180.0f + i * 140;
+		SR_Graphics_DrawTriangleAdvanced(target, (x - 14) * s, (y - 12) * s, (x + 14) * s, y * s, (x - 14) * s, (y + 12) * s, (i % 2) ? 0.0f : 180.0f);
+	}
+
+	//hit flash
+	SR_Settings_Fill(target, (SR_Color) { 255, 0, 0, 60 });
+	SR_Graphics_DrawRect(target, 0, 0, w, h);
+
+	//HUD panel and text
+	SR_Settings_Fill(target, (SR_Color) { 20, 30, 50, 160 });
+	SR_Settings_Stroke(target, (SR_Color) { 255, 255, 255, 200 });
+	SR_Settings_StrokeWeight(target, 2 * s);
+	SR_Graphics_DrawRectAdvanced(target, 20 * s, 20 * s, 360 * s, 130 * s, 0, 12 * s);
+	SR_Settings_Fill(target, (SR_Color) { 255, 255, 255, 255 });
+	SR_Settings_TextSize(target, 28 * s);
+	SR_Settings_TextAlignment(target, SR_TEXT_ALIGN_LEFT, SR_TEXT_ALIGN_TOP);
+	SR_Font_DrawText(target, "SCORE 012345", 40 * s, 36 * s);
+	SR_Font_DrawText(target, "LIVES 3  COINS 17", 40 * s, 76 * s);
+	SR_Settings_TextAlignment(target, SR_TEXT_ALIGN_CENTER, SR_TEXT_ALIGN_MIDDLE);
+	SR_Font_DrawText(target, "SPEED 4.2", 960 * s, 1040 * s);
+
+	//minimap: a corner of the cloud texture behind a frame and one dot per coin
+	SR_Settings_ImageMode(target, SR_POSITION_CORNER);
+	SR_Image_DrawSubImage(target, cloud, 1700 * s, 20 * s, 200 * s, 120 * s, 0, 0, 128, 64, 180);
+	SR_Settings_NoFill(target);
+	SR_Settings_StrokeWeight(target, 2 * s);
+	SR_Graphics_DrawRect(target, 1700 * s, 20 * s, 200 * s, 120 * s);
+	SR_Settings_Fill(target, (SR_Color) { 250, 200, 40, 255 });
+	SR_Settings_NoStroke(target);
+	for (int i = 0; i < COINS; i++) SR_Graphics_DrawRect(target, (1710 + i * 23) * s, (60 + (i % 3) * 25) * s, 6 * s, 6 * s);
+
+	SR_Target_Flush(target);
+}
+
+/* * * * * * * * *
+*  GOLDEN IMAGE  *
+* * * * * * * * */
+//Binary PPM, the background is opaque so the premultiplied pixels are the colors.
+static bool writeImage(const char* path, SR_Target* target) {
+	FILE* file = openFile(path, "wb");
+	if (!file) return false;
+	int w = SR_Target_GetWidth(target), h = SR_Target_GetHeight(target);
+	const uint32_t* pixels = SR_Target_GetPixels(target);
+	fprintf(file, "P6\n%d %d\n255\n", w, h);
+	for (int i = 0; i < w * h; i++) {
+		unsigned char rgb[3] = { (unsigned char)pixels[i], (unsigned char)(pixels[i] >> 8), (unsigned char)(pixels[i] >> 16) };
+		fwrite(rgb, 1, 3, file);
+	}
+	fclose(file);
+	return true;
+}
+
+static unsigned char* readImage(const char* path, int w, int h) {
+	FILE* file = openFile(path, "rb");
+	if (!file) return NULL;
+	//only files written by writeImage are read, so the header has to match it byte for byte
+	char expected[64], header[64];
+	int length = snprintf(expected, sizeof expected, "P6\n%d %d\n255\n", w, h);
+	unsigned char* rgb = NULL;
+	if (fread(header, 1, length, file) == (size_t)length && !memcmp(header, expected, length)) {
+		rgb = malloc((size_t)w * h * 3);
+		if (rgb && fread(rgb, 3, (size_t)w * h, file) != (size_t)w * h) {
+			free(rgb);
+			rgb = NULL;
+		}
+	}
+	fclose(file);
+	return rgb;
+}
+
+//Renders the golden frame single threaded and split into tiles; both have to match the file.
+static int runGolden(const char* path, bool update, int threads, SR_Image* cloud, SR_Image* plane) {
+	SR_Target* target = SR_Target_Create(GOLDEN_WIDTH, GOLDEN_HEIGHT);
+	SR_Target* tiled = SR_Target_Create(GOLDEN_WIDTH, GOLDEN_HEIGHT);
+	if (!target || !tiled) return 1;
+	drawFrame(target, cloud, plane, 0);
+	SR_Target_SetThreads(tiled, threads);
+	drawFrame(tiled, cloud, plane, 0);
+
+	int result = 0;
+	if (memcmp(SR_Target_GetPixels(target), SR_Target_GetPixels(tiled), (size_t)GOLDEN_WIDTH * GOLDEN_HEIGHT * sizeof(uint32_t))) {
+		printf("FAIL: %d threads drew a different frame than one\n", threads);
+		result = 1;
+	}
+
+	if (update) {
+		if (!writeImage(path, target)) {
+			printf("could not write %s\n", path);
+			result = 1;
+		} else {
+			printf("wrote %s\n", path);
+		}
+	} else {
+		unsigned char* golden = readImage(path, GOLDEN_WIDTH, GOLDEN_HEIGHT);
+		if (!golden) {
+			printf("could not read a %dx%d P6 image from %s\n", GOLDEN_WIDTH, GOLDEN_HEIGHT, path);
+			result = 1;
+		} else {
+			const uint32_t* pixels = SR_Target_GetPixels(target);
+			int off = 0, worst = 0;
+			for (int i = 0; i < GOLDEN_WIDTH * GOLDEN_HEIGHT; i++) {
+				int diff = 0;
+				for (int c = 0; c < 3; c++) {
+					int d = abs((int)((pixels[i] >> (c * 8)) & 0xFF) - golden[i * 3 + c]);
+					diff = (d > diff) ? d : diff;
+				}
+				off += diff > GOLDEN_CHANNEL_SLACK;
+				worst = (diff > worst) ? diff : worst;
+			}
+			int allowed = (int)(GOLDEN_WIDTH * GOLDEN_HEIGHT * GOLDEN_PIXEL_SLACK);
+			printf("%s: %d pixels off (%d allowed), largest channel difference %d\n", (off > allowed) ? "FAIL" : "OK", off, allowed, worst);
+			result |= off > allowed;
+			free(golden);
+		}
+	}
+	SR_Target_Free(&target);
+	SR_Target_Free(&tiled);
+	return result;
+}
+
+/* * * * * * * * *
+*   BENCHMARK    *
+* * * * * * * * */
+static void bench(int w, int h, int threads, int frames, SR_Image* cloud, SR_Image* plane) {
+	SR_Target* target = SR_Target_Create(w, h);
+	if (!target) return;
+	SR_Target_SetThreads(target, threads);
+	drawFrame(target, cloud, plane, 0); //warm the caches and page in the target
+	SR_Target_ResetStats(target);
+
+	double start = nowSeconds();
+	for (int i = 0; i < frames; i++) drawFrame(target, cloud, plane, i);
+	double elapsed = nowSeconds() - start;
+
+	SR_Stats stats = SR_Target_GetStats(target);
+	double ms = elapsed * 1000 / frames;
+	printf("%4dx%-4d | %2d threads | %7.2f ms/frame | %6.1f fps | %7.0f Mpx/s written | %5.1f px written per screen px\n",
+		w, h, threads, ms, frames / elapsed, stats.pixelsTouched / elapsed / 1e6, (double)stats.pixelsTouched / frames / ((double)w * h));
+	SR_Target_Free(&target);
+}
+
+int main(int argc, char** argv) {
+	const char* golden = NULL;
+	bool update = false;
+	int frames = 0;
+	int threads = coreCount();
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--golden") && hasValue) golden = argv[++i];
+		else if (!strcmp(argv[i], "--update") && hasValue) {
+			golden = argv[++i];
+			update = true;
+		}
+		else if (!strcmp(argv[i], "--bench") && hasValue) frames = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--threads") && hasValue) threads = atoi(argv[++i]);
+		else {
+			golden = NULL;
+			frames = 0;
+			break;
+		}
+	}
+	if (!golden && frames <= 0) {
+		printf("usage: %s (--golden FILE | --update FILE | --bench FRAMES) [--threads N]\n", argv[0]);
+		return 1;
+	}
+
+	SR_Image* cloud = makeCloud(256, 128);
+	SR_Image* plane = makePlane(64);
+	if (!cloud || !plane) return 1;
+
+	int result = 0;
+	if (golden) result = runGolden(golden, update, (threads > 1) ? threads : 4, cloud, plane);
+	if (frames > 0) {
+#if defined(__AVX2__)
+		printf("AVX2 spans, %d cores\n", coreCount());
+#else
+		printf("scalar spans, %d cores\n", coreCount());
+#endif
+		bench(1920, 1080, 1, frames, cloud, plane);
+		if (threads > 1) bench(1920, 1080, threads, frames, cloud, plane);
+		bench(3840, 2160, 1, frames, cloud, plane);
+		if (threads > 1) bench(3840, 2160, threads, frames, cloud, plane);
+	}
+
+	SR_Image_Free(&cloud);
+	SR_Image_Free(&plane);
+	return result;
+}
@@ -0,0 +1,94 @@
+//---------------------------------------------------------
+// file:	rollback.c
+//
+// brief:	Prediction and rollback (see rollback.h).
+//---------------------------------------------------------
+
+#include "rollback.h"
+#include <string.h>
+
+void Rollback_Init(RollbackClient* client, const SimConfig* config, uint32_t seed) {
+	memset(client, 0, sizeof * client);
+	client->config = *config;
+	Sim_Reset(&client->history[0], config, seed);
+}
+
+const SimSession* Rollback_Present(const RollbackClient* client) {
+	return &client->history[client->tick % ROLLBACK_TICKS];
+}
+
+int Rollback_Steps(RollbackClient* client) {
+	int steps = 1;
+	//nothing to go on until the server has answered once
+	if (client->confirmed) {
+		if (client->lead < ROLLBACK_MIN_LEAD) steps = 2;
+		else if (client->lead > ROLLBACK_MAX_LEAD) steps = 0;
+	}
+	client->lead += steps - 1;
+	client->adjust[client->tick % ROLLBACK_TICKS] += (int8_t)(steps - 1);
+	return steps;
+}
+
+void Rollback_Predict(RollbackClient* client, unsigned int input) {
+	uint32_t tick = client->tick;
+	SimSession* next = &client->history[(tick + 1) % ROLLBACK_TICKS];
+	client->inputs[tick % ROLLBACK_TICKS] = (uint8_t)input;
+	client->adjust[(tick + 1) % ROLLBACK_TICKS] = 0;
+	*next = client->history[tick % ROLLBACK_TICKS];
+	Sim_Tick(next, &client->config, input);
+	client->tick = tick + 1;
+	client->stats.predicted++;
+}
+
+int Rollback_Correct(RollbackClient* client, const SimState* state, int inputLead) {
+	uint32_t t = state->tick;
+	//states are sent after the server ticks, so there is never one for tick 0
+	if (t <= client->confirmed) {
+		client->stats.stale++;
+		return -1;
+	}
+	client->confirmed = t;
+
+	//The lead was measured when the server had inputs up to t + inputLead. Whatever
+	//Rollback_Steps changed after sending those hasn't reached the server yet.
+	client->lead = inputLead;
+	for (uint32_t u = t + inputLead + 1; (int32_t)(client->tick - u) >= 0 && client->tick - u < ROLLBACK_TICKS; u++) {
+		client->lead += client->adjust[u % ROLLBACK_TICKS];
+	}
+
+	SimSession* entry = &client->history[t % ROLLBACK_TICKS];
+	if (t > client->tick || client->tick - t >= ROLLBACK_TICKS) {
+		//too far ahead or behind to rewind to: jump straight to the server's state
+		const SimSession* present = Rollback_Present(client);
+		if (entry != present) *entry = *present; //for the world, if it is still the same one
+		Sim_SetState(entry, &client->config, state);
+		client->tick = t;
+		client->stats.resyncs++;
+		return -1;
+	}
+
+	client->stats.corrections++;
+	if (Sim_StateEqual(&entry->state, state)) return 0;
+
+	client->stats.mispredicted++;
+	Sim_SetState(entry, &client->config, state);
+	for (uint32_t i = t; i != client->tick; i++) {
+		SimSession* next = &client->history[(i + 1) % ROLLBACK_TICKS];
+		*next = client->history[i % ROLLBACK_TICKS];
+		Sim_Tick(next, &client->config, client->inputs[i % ROLLBACK_TICKS]);
+	}
+	int rewound = (int)(client->tick - t);
+	client->stats.resimulated += rewound;
+	if (rewound > client->stats.maxRewind) client->stats.maxRewind = rewound;
+	return rewound;
+}
+
+uint32_t Rollback_PackInputs(const RollbackClient* client, int count, uint32_t* newestTick) {
+	uint32_t packed = 0;
+	count = (count > 16) ? 16 : count;
+	for (int i = 0; i < count && (uint32_t)i < client->tick; i++) {
+		packed |= (uint32_t)client->inputs[(client->tick - 1 - i) % ROLLBACK_TICKS] << (2 * i);
+	}
+	*newestTick = client->tick ? client->tick - 1 : 0;
+	return packed;
+}
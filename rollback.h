@@ -0,0 +1,64 @@
+//---------------------------------------------------------
+// file:	rollback.h
+//
+// brief:	Client-side prediction for networked play. The
+//			client runs its own plane on local input straight
+//			away, keeps the last ROLLBACK_TICKS states, and
+//			when the server's state for a past tick disagrees
+//			it rewinds to that tick and re-simulates up to the
+//			present within the same frame.
+//---------------------------------------------------------
+#pragma once
+
+#include "sim.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ROLLBACK_TICKS 128 //about two seconds at SIM_TICK_RATE; corrections older than that resync
+//ticks the client aims to keep its inputs ahead of the server (see ServerMessage.inputLead)
+#define ROLLBACK_MIN_LEAD 2
+#define ROLLBACK_MAX_LEAD 6
+
+typedef struct {
+	uint64_t predicted; //ticks run on local input
+	uint64_t corrections; //server states compared against the prediction
+	uint64_t mispredicted; //...that disagreed and were rolled back
+	uint64_t resimulated; //ticks run again after a rollback
+	uint64_t stale; //corrections that came in older than one already applied
+	uint64_t resyncs; //corrections outside the history, taken as they are
+	int maxRewind; //most ticks re-simulated by one correction
+} RollbackStats;
+
+/***
+* history[t % ROLLBACK_TICKS] holds the session as it was at the start of tick t, and
+* inputs[t % ROLLBACK_TICKS] the input it was given. The present tick's entry is the state
+* to draw. Kept in one block with no pointers, like SimSession.
+***/
+typedef struct {
+	SimConfig config;
+	SimSession history[ROLLBACK_TICKS];
+	uint8_t inputs[ROLLBACK_TICKS];
+	int8_t adjust[ROLLBACK_TICKS]; //ticks Rollback_Steps added (+1) or held back (-1) at each tick
+	uint32_t tick; //present
+	uint32_t confirmed; //tick of the newest server state applied
+	int lead; //last inputLead from the server, adjusted for the ticks skipped or doubled since
+	RollbackStats stats;
+} RollbackClient;
+
+void Rollback_Init(RollbackClient* client, const SimConfig* config, uint32_t seed);
+
+//Ticks to predict this frame: 1 normally, 2 to catch up when inputs reach the server late,
+//0 to wait when they arrive needlessly early.
+int Rollback_Steps(RollbackClient* client);
+
+//Run the present tick on local input and move to the next one.
+void Rollback_Predict(RollbackClient* client, unsigned int input);
+
+//The server's state for some past tick. Returns the ticks re-simulated (0 when the
+//prediction was right), or -1 when the correction was stale or could only be taken as is.
+int Rollback_Correct(RollbackClient* client, const SimState* state, int inputLead);
+
+const SimSession* Rollback_Present(const RollbackClient* client);
+
+//Inputs of the newest SERVER_INPUT_HISTORY ticks packed for a MESSAGE_INPUT, newest at the bottom.
+uint32_t Rollback_PackInputs(const RollbackClient* client, int count, uint32_t* newestTick);
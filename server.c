@@ -0,0 +1,799 @@
+//---------------------------------------------------------
+// file:	server.c
+//
+// brief:	Authoritative multi-session server (see server.h).
+//---------------------------------------------------------
+
+#include "server.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <windows.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#define SESSION_SLOT_BITS 20
+#define SESSION_SLOT_MASK ((1u << SESSION_SLOT_BITS) - 1)
+
+/* * * * * * *
+* PLATFORM *
+* * * * * * */
+#ifdef _WIN32
+typedef HANDLE Thread;
+typedef HANDLE Semaphore;
+typedef CRITICAL_SECTION Lock;
+typedef SOCKET Socket;
+typedef volatile LONG AtomicInt;
+#define THREAD_RESULT DWORD WINAPI
+
+static bool threadStart(Thread* thread, LPTHREAD_START_ROUTINE main, void* arg) {
+	*thread = CreateThread(NULL, 0, main, arg, 0, NULL);
+	return *thread != NULL;
+}
+static void threadJoin(Thread thread) {
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+static bool semaphoreCreate(Semaphore* s) { return (*s = CreateSemaphoreA(NULL, 0, SERVER_MAX_WORKERS, NULL)) != NULL; }
+static void semaphorePost(Semaphore* s, int count) { ReleaseSemaphore(*s, count, NULL); }
+static void semaphoreWait(Semaphore* s) { WaitForSingleObject(*s, INFINITE); }
+static void semaphoreFree(Semaphore* s) { CloseHandle(*s); }
+static void lockCreate(Lock* lock) { InitializeCriticalSection(lock); }
+static void lockEnter(Lock* lock) { EnterCriticalSection(lock); }
+static void lockLeave(Lock* lock) { LeaveCriticalSection(lock); }
+static void lockFree(Lock* lock) { DeleteCriticalSection(lock); }
+static long atomicIncrement(AtomicInt* value) { return InterlockedIncrement(value); }
+static void atomicStore(AtomicInt* value, long n) { InterlockedExchange(value, n); }
+
+static double nowSeconds() {
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (double)counter.QuadPart / frequency.QuadPart;
+}
+#else
+typedef pthread_t Thread;
+typedef sem_t Semaphore;
+typedef pthread_mutex_t Lock;
+typedef int Socket;
+typedef volatile long AtomicInt;
+#define THREAD_RESULT void*
+#define INVALID_SOCKET -1
+#define closesocket close
+
+static bool threadStart(Thread* thread, void* (*main)(void*), void* arg) { return pthread_create(thread, NULL, main, arg) == 0; }
+static void threadJoin(Thread thread) { pthread_join(thread, NULL); }
+static bool semaphoreCreate(Semaphore* s) { return sem_init(s, 0, 0) == 0; }
+static void semaphorePost(Semaphore* s, int count) { while (count--) sem_post(s); }
+static void semaphoreWait(Semaphore* s) { while (sem_wait(s) != 0); }
+static void semaphoreFree(Semaphore* s) { sem_destroy(s); }
+static void lockCreate(Lock* lock) { pthread_mutex_init(lock, NULL); }
+static void lockEnter(Lock* lock) { pthread_mutex_lock(lock); }
+static void lockLeave(Lock* lock) { pthread_mutex_unlock(lock); }
+static void lockFree(Lock* lock) { pthread_mutex_destroy(lock); }
+static long atomicIncrement(AtomicInt* value) { return __atomic_add_fetch(value, 1, __ATOMIC_SEQ_CST); }
+static void atomicStore(AtomicInt* value, long n) { __atomic_store_n(value, n, __ATOMIC_SEQ_CST); }
+
+static double nowSeconds() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+#endif
+
+/* * * * * * * * *
+* UDP TRANSPORT *
+* * * * * * * * */
+static int udpSend(void* data, const ServerAddress* to, const void* bytes, int size) {
+	struct sockaddr_in address = { 0 };
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(to->host);
+	address.sin_port = htons(to->port);
+	return (int)sendto((Socket)(intptr_t)data, bytes, size, 0, (struct sockaddr*)&address, sizeof address);
+}
+
+static int udpReceive(void* data, ServerAddress* from, void* bytes, int capacity) {
+	struct sockaddr_in address;
+#ifdef _WIN32
+	int length = sizeof address;
+#else
+	socklen_t length = sizeof address;
+#endif
+	int size = (int)recvfrom((Socket)(intptr_t)data, bytes, capacity, 0, (struct sockaddr*)&address, &length);
+	if (size <= 0) return 0; //would block, or an ICMP error from a client that went away
+	from->host = ntohl(address.sin_addr.s_addr);
+	from->port = ntohs(address.sin_port);
+	return size;
+}
+
+static void udpClose(void* data) {
+	closesocket((Socket)(intptr_t)data);
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+ServerAddress Transport_LocalAddress(unsigned short port) {
+	ServerAddress address = { INADDR_LOOPBACK, port };
+	return address;
+}
+
+bool Transport_OpenUdp(ServerTransport* transport, unsigned short port) {
+#ifdef _WIN32
+	WSADATA wsa;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+#endif
+	Socket s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s == INVALID_SOCKET) return false;
+
+	struct sockaddr_in address = { 0 };
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+#ifdef _WIN32
+	u_long nonBlocking = 1;
+	bool ok = bind(s, (struct sockaddr*)&address, sizeof address) == 0 && ioctlsocket(s, FIONBIO, &nonBlocking) == 0;
+#else
+	bool ok = bind(s, (struct sockaddr*)&address, sizeof address) == 0 && fcntl(s, F_SETFL, O_NONBLOCK) == 0;
+#endif
+	if (!ok) {
+		udpClose((void*)(intptr_t)s);
+		return false;
+	}
+
+	transport->send = udpSend;
+	transport->receive = udpReceive;
+	transport->close = udpClose;
+	transport->data = (void*)(intptr_t)s;
+	return true;
+}
+
+/* * * * * * * * * * * *
+* LOOPBACK TRANSPORT *
+* * * * * * * * * * * */
+typedef struct {
+	ServerAddress from;
+	double deliverAt; //network time the packet arrives
+	int size;
+	unsigned char bytes[SERVER_MAX_PACKET];
+} LoopbackPacket;
+
+typedef struct {
+	LoopbackNetwork* network;
+	int index;
+	Lock lock;
+	int head, count;
+	LoopbackPacket* packets;
+	uint32_t rng; //for the packets this endpoint sends, only touched by its sending thread
+} LoopbackEndpoint;
+
+struct LoopbackNetwork {
+	int endpointCount;
+	int capacity; //packets per queue
+	LoopbackEndpoint* endpoints;
+	LoopbackPacket* packets;
+	LoopbackConditions conditions;
+	double now;
+};
+
+static float loopbackRandom(LoopbackEndpoint* endpoint) {
+	endpoint->rng ^= endpoint->rng << 13;
+	endpoint->rng ^= endpoint->rng >> 17;
+	endpoint->rng ^= endpoint->rng << 5;
+	return endpoint->rng * (1.0f / 4294967296.0f);
+}
+
+static int loopbackSend(void* data, const ServerAddress* to, const void* bytes, int size) {
+	LoopbackEndpoint* self = data;
+	LoopbackNetwork* network = self->network;
+	if (to->port >= network->endpointCount || size > SERVER_MAX_PACKET) return -1;
+
+	//lost packets still count as sent, the sender can't tell
+	const LoopbackConditions* conditions = &network->conditions;
+	if (conditions->loss > 0 && loopbackRandom(self) < conditions->loss) return size;
+	double deliverAt = network->now + conditions->latency;
+	if (conditions->jitter > 0) deliverAt += conditions->jitter * loopbackRandom(self);
+
+	LoopbackEndpoint* target = &network->endpoints[to->port];
+	lockEnter(&target->lock);
+	bool queued = target->count < network->capacity;
+	if (queued) {
+		//a full queue drops the packet, like a full socket buffer would
+		LoopbackPacket* packet = &target->packets[(target->head + target->count++) % network->capacity];
+		packet->from = Loopback_Address(self->index);
+		packet->deliverAt = deliverAt;
+		packet->size = size;
+		memcpy(packet->bytes, bytes, size);
+	}
+	lockLeave(&target->lock);
+	return queued ? size : -1;
+}
+
+static int loopbackReceive(void* data, ServerAddress* from, void* bytes, int capacity) {
+	LoopbackEndpoint* self = data;
+	LoopbackNetwork* network = self->network;
+	int size = 0;
+	lockEnter(&self->lock);
+	//the first packet that has arrived; with jitter that isn't always the oldest one
+	for (int i = 0; i < self->count; i++) {
+		LoopbackPacket* packet = &self->packets[(self->head + i) % network->capacity];
+		if (packet->deliverAt > network->now) continue;
+		size = (packet->size < capacity) ? packet->size : capacity;
+		*from = packet->from;
+		memcpy(bytes, packet->bytes, size);
+		//fill the hole with the head packet and pop that instead
+		*packet = self->packets[self->head];
+		self->head = (self->head + 1) % network->capacity;
+		self->count--;
+		break;
+	}
+	lockLeave(&self->lock);
+	return size;
+}
+
+static void loopbackClose(void* data) {
+	(void)data;
+	//the network owns every endpoint, Loopback_Free releases them
+}
+
+LoopbackNetwork* Loopback_Create(int endpoints, int queuedPackets) {
+	LoopbackNetwork* network = calloc(1, sizeof * network);
+	if (!network) return NULL;
+	network->endpoints = calloc(endpoints, sizeof * network->endpoints);
+	network->packets = calloc((size_t)endpoints * queuedPackets, sizeof * network->packets);
+	if (!network->endpoints || !network->packets) {
+		free(network->endpoints);
+		free(network->packets);
+		free(network);
+		return NULL;
+	}
+	network->endpointCount = endpoints;
+	network->capacity = queuedPackets;
+	for (int i = 0; i < endpoints; i++) {
+		network->endpoints[i].network = network;
+		network->endpoints[i].index = i;
+		network->endpoints[i].packets = network->packets + (size_t)i * queuedPackets;
+		network->endpoints[i].rng = 0x9E3779B9u * (i + 1);
+		lockCreate(&network->endpoints[i].lock);
+	}
+	return network;
+}
+
+void Loopback_SetConditions(LoopbackNetwork* network, const LoopbackConditions* conditions) {
+	network->conditions = *conditions;
+	for (int i = 0; i < network->endpointCount; i++) {
+		uint32_t seed = (conditions->seed + i) * 0x9E3779B9u;
+		network->endpoints[i].rng = seed ? seed : 1;
+	}
+}
+
+void Loopback_Advance(LoopbackNetwork* network, double seconds) {
+	network->now += seconds;
+}
+
+void Loopback_Free(LoopbackNetwork* network) {
+	if (!network) return;
+	for (int i = 0; i < network->endpointCount; i++) lockFree(&network->endpoints[i].lock);
+	free(network->endpoints);
+	free(network->packets);
+	free(network);
+}
+
+ServerTransport Loopback_Endpoint(LoopbackNetwork* network, int endpoint) {
+	ServerTransport transport = { loopbackSend, loopbackReceive, loopbackClose, &network->endpoints[endpoint] };
+	return transport;
+}
+
+ServerAddress Loopback_Address(int endpoint) {
+	ServerAddress address = { 0, (uint16_t)endpoint };
+	return address;
+}
+
+/* * * * * * *
+* PROTOCOL *
+* * * * * * */
+//Everything is little endian on the wire.
+static unsigned char* put32(unsigned char* p, uint32_t value) {
+	p[0] = (unsigned char)value;
+	p[1] = (unsigned char)(value >> 8);
+	p[2] = (unsigned char)(value >> 16);
+	p[3] = (unsigned char)(value >> 24);
+	return p + 4;
+}
+
+static uint32_t get32(const unsigned char* p) {
+	return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static unsigned char* putFloat(unsigned char* p, float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof bits);
+	return put32(p, bits);
+}
+
+static float getFloat(const unsigned char* p) {
+	uint32_t bits = get32(p);
+	float value;
+	memcpy(&value, &bits, sizeof value);
+	return value;
+}
+
+static unsigned char* putState(unsigned char* p, const SimState* state) {
+	p = put32(p, state->tick);
+	p = put32(p, state->rng);
+	p = put32(p, state->worldSeed);
+	*p++ = state->dead;
+	p = put32(p, (uint32_t)state->origin.chunkX);
+	p = put32(p, (uint32_t)state->origin.chunkY);
+	p = putFloat(p, state->globalX);
+	p = putFloat(p, state->globalY);
+	p = putFloat(p, state->lastGlobalX);
+	p = putFloat(p, state->lastGlobalY);
+	p = putFloat(p, state->directionX);
+	p = putFloat(p, state->directionY);
+	p = putFloat(p, state->rotationAngle);
+	p = putFloat(p, state->speed);
+	p = put32(p, (uint32_t)state->remainingLives);
+	p = put32(p, (uint32_t)state->score);
+	p = put32(p, (uint32_t)state->iFrameTicks);
+	p = put32(p, (uint32_t)state->coinsCollected);
+	return put32(p, (uint32_t)(state->coinsCollected >> 32));
+}
+
+static const unsigned char* getState(const unsigned char* p, SimState* state) {
+	state->tick = get32(p);
+	state->rng = get32(p + 4);
+	state->worldSeed = get32(p + 8);
+	state->dead = p[12] != 0;
+	state->origin.chunkX = (int32_t)get32(p + 13);
+	state->origin.chunkY = (int32_t)get32(p + 17);
+	p += 21;
+	state->globalX = getFloat(p);
+	state->globalY = getFloat(p + 4);
+	state->lastGlobalX = getFloat(p + 8);
+	state->lastGlobalY = getFloat(p + 12);
+	state->directionX = getFloat(p + 16);
+	state->directionY = getFloat(p + 20);
+	state->rotationAngle = getFloat(p + 24);
+	state->speed = getFloat(p + 28);
+	state->remainingLives = (int32_t)get32(p + 32);
+	state->score = (int32_t)get32(p + 36);
+	state->iFrameTicks = (int32_t)get32(p + 40);
+	state->coinsCollected = get32(p + 44) | (uint64_t)get32(p + 48) << 32;
+	return p + 52;
+}
+
+int Message_Encode(const ServerMessage* m, unsigned char* out) {
+	unsigned char* p = out;
+	*p++ = (unsigned char)m->type;
+	switch (m->type) {
+	case MESSAGE_JOIN:
+		p = put32(p, m->seed);
+		p = put32(p, m->nonce);
+		break;
+	case MESSAGE_WELCOME:
+		p = put32(p, m->session);
+		p = put32(p, m->seed);
+		p = put32(p, m->nonce);
+		break;
+	case MESSAGE_INPUT:
+		p = put32(p, m->session);
+		p = put32(p, m->tick);
+		p = put32(p, m->inputs);
+		break;
+	case MESSAGE_STATE:
+		p = put32(p, m->session);
+		p = putState(p, &m->state);
+		*p++ = (unsigned char)m->inputLead;
+		*p++ = (unsigned char)((uint16_t)m->inputLead >> 8);
+		break;
+	case MESSAGE_LEAVE:
+		p = put32(p, m->session);
+		break;
+	case MESSAGE_REJECT:
+		p = put32(p, m->nonce);
+		break;
+	}
+	return (int)(p - out);
+}
+
+bool Message_Decode(const unsigned char* data, int size, ServerMessage* m) {
+	static const int sizes[] = { 0, 9, 13, 13, 80, 5, 5 }; //by MessageType
+	if (size < 1 || data[0] < MESSAGE_JOIN || data[0] > MESSAGE_REJECT || size != sizes[data[0]]) return false;
+
+	memset(m, 0, sizeof * m);
+	m->type = (MessageType)data[0];
+	const unsigned char* p = data + 1;
+	switch (m->type) {
+	case MESSAGE_JOIN:
+		m->seed = get32(p);
+		m->nonce = get32(p + 4);
+		break;
+	case MESSAGE_WELCOME:
+		m->session = get32(p);
+		m->seed = get32(p + 4);
+		m->nonce = get32(p + 8);
+		break;
+	case MESSAGE_INPUT:
+		m->session = get32(p);
+		m->tick = get32(p + 4);
+		m->inputs = get32(p + 8);
+		break;
+	case MESSAGE_STATE:
+		m->session = get32(p);
+		p = getState(p + 4, &m->state);
+		m->inputLead = (int16_t)(p[0] | p[1] << 8);
+		break;
+	case MESSAGE_LEAVE:
+		m->session = get32(p);
+		break;
+	case MESSAGE_REJECT:
+		m->nonce = get32(p);
+		break;
+	}
+	return true;
+}
+
+/* * * * * *
+* SERVER *
+* * * * * */
+/***
+* Inputs arrive tagged with the session tick they are for, a few ticks before the server
+* gets there. A tick whose input hasn't come yet repeats the newest one the server has,
+* and the client hears about it through inputLead and rolls back.
+***/
+typedef struct {
+	uint32_t newest; //tick of the newest input received
+	uint8_t ticks[SERVER_INPUT_TICKS]; //by tick % SERVER_INPUT_TICKS
+} SessionInputs;
+
+static unsigned int inputFor(const SessionInputs* inputs, uint32_t tick) {
+	//ticks too old for the buffer (or from a client that doesn't count ticks) just hold the newest input
+	bool buffered = tick <= inputs->newest && inputs->newest - tick < SERVER_INPUT_TICKS;
+	return inputs->ticks[(buffered ? tick : inputs->newest) % SERVER_INPUT_TICKS];
+}
+
+//Cold per-session data, kept out of the array the workers stream through.
+typedef struct {
+	ServerAddress owner;
+	uint32_t session; //id handed to the client: generation << SESSION_SLOT_BITS | id
+	uint32_t lastHeard; //tick of the last packet from the owner
+	bool deathSent;
+} SessionInfo;
+
+typedef struct {
+	Server* server;
+	int index;
+	Thread thread;
+	//padded so workers adding up their busy time don't share a cache line
+	double busySeconds;
+	char padding[64 - sizeof(double)];
+} Worker;
+
+struct Server {
+	ServerConfig config;
+	SimConfig sim;
+	ServerTransport transport;
+	uint32_t tick;
+
+	//Live sessions are packed into [0, count) so a tick never skips holes.
+	//ids stay stable for clients: slotOfId maps them to wherever the session sits now.
+	int count;
+	SimSession* sessions;
+	SessionInputs* inputs;
+	SessionInfo* info;
+	int* slotOfId;
+	uint32_t* generations;
+	int* freeIds;
+	int freeCount;
+
+	Worker* workers;
+	Semaphore start, done;
+	AtomicInt nextBatch;
+	int batches;
+	bool running; //worker threads are up
+	double inlineBusySeconds; //time ticking on the calling thread when there are no workers
+
+	double latency[SERVER_LATENCY_HISTORY]; //seconds
+	int latencyCount;
+	uint64_t ticks, sessionTicks;
+	uint64_t packetsIn, packetsOut;
+};
+
+static double tickBatches(Server* server) {
+	double start = nowSeconds();
+	long batch;
+	while ((batch = atomicIncrement(&server->nextBatch) - 1) < server->batches) {
+		int first = batch * SERVER_BATCH_SESSIONS;
+		int last = (first + SERVER_BATCH_SESSIONS < server->count) ? first + SERVER_BATCH_SESSIONS : server->count;
+		for (int i = first; i < last; i++) {
+			SimSession* s = &server->sessions[i];
+			Sim_Tick(s, &server->sim, inputFor(&server->inputs[i], s->state.tick));
+		}
+	}
+	return nowSeconds() - start;
+}
+
+static THREAD_RESULT workerMain(void* param) {
+	Worker* worker = param;
+	Server* server = worker->server;
+	for (;;) {
+		semaphoreWait(&server->start);
+		if (!server->running) break;
+		worker->busySeconds += tickBatches(server);
+		semaphorePost(&server->done, 1);
+	}
+	return 0;
+}
+
+Server* Server_Create(const ServerConfig* config, ServerTransport transport) {
+	if (config->maxSessions <= 0 || config->maxSessions > SERVER_MAX_SESSIONS || config->workers < 0 || config->workers > SERVER_MAX_WORKERS) return NULL;
+	Server* server = calloc(1, sizeof * server);
+	if (!server) return NULL;
+	server->config = *config;
+	server->transport = transport;
+	Sim_Configure(&server->sim, config->viewWidth, config->viewHeight, &config->tuning);
+
+	int max = config->maxSessions;
+	server->sessions = malloc(max * sizeof * server->sessions);
+	server->inputs = calloc(max, sizeof * server->inputs);
+	server->info = calloc(max, sizeof * server->info);
+	server->slotOfId = malloc(max * sizeof * server->slotOfId);
+	server->generations = calloc(max, sizeof * server->generations);
+	server->freeIds = malloc(max * sizeof * server->freeIds);
+	server->workers = calloc(config->workers, sizeof * server->workers);
+	if (!server->sessions || !server->inputs || !server->info || !server->slotOfId || !server->generations || !server->freeIds || (config->workers && !server->workers)) {
+		Server_Free(server);
+		return NULL;
+	}
+	for (int id = 0; id < max; id++) {
+		server->slotOfId[id] = -1;
+		server->freeIds[id] = max - 1 - id; //low ids come off the stack first
+	}
+	server->freeCount = max;
+
+	if (!semaphoreCreate(&server->start)) {
+		Server_Free(server);
+		return NULL;
+	}
+	if (!semaphoreCreate(&server->done)) {
+		semaphoreFree(&server->start);
+		Server_Free(server);
+		return NULL;
+	}
+	server->running = true;
+	for (int i = 0; i < config->workers; i++) {
+		server->workers[i].server = server;
+		server->workers[i].index = i;
+		if (!threadStart(&server->workers[i].thread, workerMain, &server->workers[i])) {
+			//run with however many started
+			server->config.workers = i;
+			break;
+		}
+	}
+	return server;
+}
+
+void Server_Free(Server* server) {
+	if (!server) return;
+	if (server->running) {
+		server->running = false;
+		semaphorePost(&server->start, server->config.workers);
+		for (int i = 0; i < server->config.workers; i++) threadJoin(server->workers[i].thread);
+		semaphoreFree(&server->start);
+		semaphoreFree(&server->done);
+	}
+	if (server->transport.close) server->transport.close(server->transport.data);
+	free(server->sessions);
+	free(server->inputs);
+	free(server->info);
+	free(server->slotOfId);
+	free(server->generations);
+	free(server->freeIds);
+	free(server->workers);
+	free(server);
+}
+
+static void sendMessage(Server* server, const ServerAddress* to, const ServerMessage* message) {
+	unsigned char bytes[SERVER_MAX_PACKET];
+	int size = Message_Encode(message, bytes);
+	if (server->transport.send(server->transport.data, to, bytes, size) == size) server->packetsOut++;
+}
+
+static int findSession(Server* server, uint32_t session, const ServerAddress* from) {
+	uint32_t id = session & SESSION_SLOT_MASK;
+	if (id >= (uint32_t)server->config.maxSessions) return -1;
+	int slot = server->slotOfId[id];
+	if (slot < 0 || server->info[slot].session != session) return -1;
+	//only the client that joined may steer or end a session
+	if (server->info[slot].owner.host != from->host || server->info[slot].owner.port != from->port) return -1;
+	return slot;
+}
+
+static void removeSession(Server* server, int slot) {
+	uint32_t id = server->info[slot].session & SESSION_SLOT_MASK;
+	server->slotOfId[id] = -1;
+	server->generations[id]++;
+	server->freeIds[server->freeCount++] = id;
+
+	//move the last session into the hole to keep the array packed
+	int last = --server->count;
+	if (slot != last) {
+		server->sessions[slot] = server->sessions[last];
+		server->inputs[slot] = server->inputs[last];
+		server->info[slot] = server->info[last];
+		server->slotOfId[server->info[slot].session & SESSION_SLOT_MASK] = slot;
+	}
+}
+
+static void join(Server* server, const ServerAddress* from, const ServerMessage* request) {
+	ServerMessage reply = { 0 };
+	reply.nonce = request->nonce;
+	if (!server->freeCount) {
+		reply.type = MESSAGE_REJECT;
+		sendMessage(server, from, &reply);
+		return;
+	}
+
+	uint32_t id = server->freeIds[--server->freeCount];
+	int slot = server->count++;
+	Sim_Reset(&server->sessions[slot], &server->sim, request->seed);
+	memset(&server->inputs[slot], 0, sizeof server->inputs[slot]);
+	server->info[slot].owner = *from;
+	server->info[slot].session = (server->generations[id] << SESSION_SLOT_BITS) | id;
+	server->info[slot].lastHeard = server->tick;
+	server->info[slot].deathSent = false;
+	server->slotOfId[id] = slot;
+
+	reply.type = MESSAGE_WELCOME;
+	reply.session = server->info[slot].session;
+	reply.seed = request->seed;
+	sendMessage(server, from, &reply);
+}
+
+static void storeInputs(SessionInputs* inputs, const ServerMessage* message) {
+	//a packet overtaken by a newer one has nothing the newer one didn't repeat
+	if (message->tick < inputs->newest) return;
+	for (uint32_t i = 0; i < SERVER_INPUT_HISTORY && i <= message->tick; i++) {
+		unsigned int input = (message->inputs >> (2 * i)) & (SIM_INPUT_LEFT | SIM_INPUT_RIGHT);
+		inputs->ticks[(message->tick - i) % SERVER_INPUT_TICKS] = (uint8_t)input;
+	}
+	inputs->newest = message->tick;
+}
+
+void Server_Poll(Server* server) {
+	unsigned char bytes[SERVER_MAX_PACKET];
+	ServerAddress from;
+	ServerMessage message;
+	int size;
+	while ((size = server->transport.receive(server->transport.data, &from, bytes, sizeof bytes)) > 0) {
+		server->packetsIn++;
+		if (!Message_Decode(bytes, size, &message)) continue;
+
+		int slot;
+		switch (message.type) {
+		case MESSAGE_JOIN:
+			join(server, &from, &message);
+			break;
+		case MESSAGE_INPUT:
+			if ((slot = findSession(server, message.session, &from)) < 0) break;
+			server->info[slot].lastHeard = server->tick;
+			storeInputs(&server->inputs[slot], &message);
+			break;
+		case MESSAGE_LEAVE:
+			if ((slot = findSession(server, message.session, &from)) >= 0) removeSession(server, slot);
+			break;
+		default:
+			break; //server to client messages
+		}
+	}
+}
+
+void Server_Tick(Server* server) {
+	double start = nowSeconds();
+	server->batches = (server->count + SERVER_BATCH_SESSIONS - 1) / SERVER_BATCH_SESSIONS;
+	atomicStore(&server->nextBatch, 0);
+	if (server->config.workers) {
+		semaphorePost(&server->start, server->config.workers);
+		for (int i = 0; i < server->config.workers; i++) semaphoreWait(&server->done);
+	} else {
+		server->inlineBusySeconds += tickBatches(server);
+	}
+	double elapsed = nowSeconds() - start;
+
+	server->latency[server->ticks % SERVER_LATENCY_HISTORY] = elapsed;
+	server->latencyCount += (server->latencyCount < SERVER_LATENCY_HISTORY);
+	server->ticks++;
+	server->sessionTicks += server->count;
+	server->tick++;
+
+	//States are staggered so each tick only sends to 1/SERVER_STATE_INTERVAL of the clients.
+	//Walk backwards so removing a timed out session doesn't skip the one moved into its slot.
+	for (int i = server->count - 1; i >= 0; i--) {
+		SimSession* s = &server->sessions[i];
+		SessionInfo* info = &server->info[i];
+		if (server->tick - info->lastHeard > SERVER_TIMEOUT_TICKS) {
+			removeSession(server, i);
+			continue;
+		}
+		bool due = (server->tick + info->session) % SERVER_STATE_INTERVAL == 0;
+		if (!due && !(s->state.dead && !info->deathSent)) continue;
+		if (s->state.dead) {
+			if (info->deathSent) continue;
+			info->deathSent = true;
+		}
+
+		ServerMessage state = { .type = MESSAGE_STATE };
+		state.session = info->session;
+		state.state = s->state;
+		int lead = (int)(server->inputs[i].newest - s->state.tick);
+		state.inputLead = (int16_t)((lead < INT16_MIN) ? INT16_MIN : (lead > INT16_MAX) ? INT16_MAX : lead);
+		sendMessage(server, &info->owner, &state);
+	}
+}
+
+static int compareDoubles(const void* a, const void* b) {
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+void Server_GetMetrics(Server* server, ServerMetrics* metrics) {
+	memset(metrics, 0, sizeof * metrics);
+	metrics->sessions = server->count;
+	metrics->workers = server->config.workers;
+	metrics->ticks = server->ticks;
+	metrics->packetsIn = server->packetsIn;
+	metrics->packetsOut = server->packetsOut;
+
+	int n = server->latencyCount;
+	if (n) {
+		double sorted[SERVER_LATENCY_HISTORY];
+		memcpy(sorted, server->latency, n * sizeof * sorted);
+		qsort(sorted, n, sizeof * sorted, compareDoubles);
+		metrics->tickP50 = sorted[n * 50 / 100] * 1000;
+		metrics->tickP90 = sorted[n * 90 / 100] * 1000;
+		metrics->tickP99 = sorted[n * 99 / 100] * 1000;
+		metrics->tickMax = sorted[n - 1] * 1000;
+	}
+
+	double busy = server->inlineBusySeconds;
+	for (int i = 0; i < server->config.workers; i++) busy += server->workers[i].busySeconds;
+	if (busy > 0 && server->sessionTicks) metrics->sessionsPerCore = server->sessionTicks / busy / SIM_TICK_RATE;
+}
+
+double Server_Seconds() {
+	return nowSeconds();
+}
+
+void Server_Sleep(double seconds) {
+	if (seconds <= 0) return;
+#ifdef _WIN32
+	Sleep((DWORD)(seconds * 1000));
+#else
+	struct timespec t = { (time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9) };
+	nanosleep(&t, NULL);
+#endif
+}
+
+int Server_CoreCount() {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+#else
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return (cores > 0) ? (int)cores : 1;
+#endif
+}
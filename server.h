@@ -0,0 +1,137 @@
+//---------------------------------------------------------
+// file:	server.h
+//
+// brief:	Authoritative score-attack server. Hosts many
+//			independent game sessions (see sim.h) in one
+//			process, ticked in batches on a fixed pool of
+//			worker threads.
+//---------------------------------------------------------
+#pragma once
+
+#include "sim.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SERVER_MAX_WORKERS 64
+#define SERVER_MAX_SESSIONS (1 << 20) //session ids keep 20 bits for the slot
+#define SERVER_BATCH_SESSIONS 64 //sessions a worker takes at a time
+#define SERVER_STATE_INTERVAL 6 //ticks between state packets to each client
+#define SERVER_TIMEOUT_TICKS (10 * SIM_TICK_RATE) //sessions that stop sending inputs are dropped
+#define SERVER_LATENCY_HISTORY 4096 //ticks the latency percentiles are taken over
+#define SERVER_INPUT_TICKS 32 //ticks of input each session buffers ahead of its simulation
+#define SERVER_INPUT_HISTORY 16 //ticks of input repeated in every INPUT packet, to ride out loss
+#define SERVER_MAX_PACKET 96
+#define SERVER_DEFAULT_PORT 27960
+
+/* * * * * * *
+* TRANSPORT *
+* * * * * * */
+typedef struct {
+	uint32_t host; //IPv4, host byte order; 0 for loopback endpoints
+	uint16_t port; //UDP port, or the endpoint number on a loopback network
+} ServerAddress;
+
+/***
+* Packets go through a few function pointers so the same server runs over real UDP
+* sockets or over in-process queues, the way AudioDevice swaps waveOut for a null device.
+* receive never blocks: it returns 0 when nothing is waiting.
+***/
+typedef struct {
+	int (*send)(void* data, const ServerAddress* to, const void* bytes, int size);
+	int (*receive)(void* data, ServerAddress* from, void* bytes, int capacity);
+	void (*close)(void* data);
+	void* data;
+} ServerTransport;
+
+//Non-blocking UDP socket bound to 127.0.0.1. Port 0 picks any free port (for clients).
+bool Transport_OpenUdp(ServerTransport* transport, unsigned short port);
+ServerAddress Transport_LocalAddress(unsigned short port);
+
+//In-process network of endpoints with a packet queue each. Safe to use from several threads.
+typedef struct LoopbackNetwork LoopbackNetwork;
+LoopbackNetwork* Loopback_Create(int endpoints, int queuedPackets);
+void Loopback_Free(LoopbackNetwork* network);
+ServerTransport Loopback_Endpoint(LoopbackNetwork* network, int endpoint);
+ServerAddress Loopback_Address(int endpoint);
+
+/***
+* A bad connection to test against. Every packet is held back for latency plus up to
+* jitter seconds (so packets can overtake each other), and loss of them are dropped.
+* Time on the network only moves when Loopback_Advance is called, so a run can go faster
+* than real time, and the same seed drops and delays the same packets every run.
+***/
+typedef struct {
+	double latency, jitter; //seconds, one way
+	float loss; //0 to 1
+	uint32_t seed;
+} LoopbackConditions;
+
+void Loopback_SetConditions(LoopbackNetwork* network, const LoopbackConditions* conditions);
+void Loopback_Advance(LoopbackNetwork* network, double seconds);
+
+/* * * * * * *
+* PROTOCOL *
+* * * * * * */
+typedef enum {
+	MESSAGE_JOIN = 1, //client -> server: seed, nonce
+	MESSAGE_WELCOME, //server -> client: session, seed, nonce
+	MESSAGE_INPUT, //client -> server: session, tick, inputs
+	MESSAGE_STATE, //server -> client: session, state, inputLead
+	MESSAGE_LEAVE, //client -> server: session
+	MESSAGE_REJECT //server -> client: nonce; the server is full
+} MessageType;
+
+typedef struct {
+	MessageType type;
+	uint32_t session;
+	uint32_t seed;
+	uint32_t nonce; //picked by the client to match its WELCOME to its JOIN
+	uint32_t tick; //session tick of the newest input
+	//SIM_INPUT_ bits for tick, tick - 1 ... tick - (SERVER_INPUT_HISTORY - 1), 2 bits each from the bottom
+	uint32_t inputs;
+	SimState state; //the session as the server has it, for the client to correct its prediction with
+	//ticks the client's newest input was ahead of the server when the state was taken;
+	//negative when the server had to guess the input (see rollback.h)
+	int16_t inputLead;
+} ServerMessage;
+
+int Message_Encode(const ServerMessage* message, unsigned char* out); //out holds SERVER_MAX_PACKET bytes
+bool Message_Decode(const unsigned char* data, int size, ServerMessage* message);
+
+/* * * * * *
+* SERVER *
+* * * * * */
+typedef struct {
+	int maxSessions;
+	int workers; //threads ticking sessions; 0 ticks everything on the calling thread
+	float viewWidth, viewHeight; //window size the clients' worlds are built for
+	Tuning tuning; //the rules the clients play by
+} ServerConfig;
+
+typedef struct {
+	int sessions;
+	int workers;
+	uint64_t ticks;
+	uint64_t packetsIn, packetsOut;
+	//milliseconds to tick every session once, over the last SERVER_LATENCY_HISTORY ticks
+	double tickP50, tickP90, tickP99, tickMax;
+	//sessions one core could keep at SIM_TICK_RATE, from the time workers spent ticking
+	double sessionsPerCore;
+} ServerMetrics;
+
+typedef struct Server Server;
+
+Server* Server_Create(const ServerConfig* config, ServerTransport transport);
+void Server_Free(Server* server);
+
+//Handle every packet waiting on the transport.
+void Server_Poll(Server* server);
+//Advance every session one tick and send the states that are due.
+void Server_Tick(Server* server);
+
+void Server_GetMetrics(Server* server, ServerMetrics* metrics);
+
+//Clock and sleep for the tick loop, so callers need no platform code of their own.
+double Server_Seconds();
+void Server_Sleep(double seconds);
+int Server_CoreCount();
@@ -0,0 +1,553 @@
+//---------------------------------------------------------
+// file:	server_main.c
+//
+// brief:	Entry point of the headless score-attack server.
+//			Optionally drives simulated players (bots) against
+//			itself to measure how many sessions it can host.
+//			--rollback adds a predicting client on a loopback
+//			link with the given latency, jitter and loss, run
+//			in simulated time, and reports what rolling back
+//			its prediction cost. It then holds its input
+//			steady for a few seconds and exits with 1 unless
+//			every correction after that agrees with what it
+//			predicted. --autopilot plays games on
+//			the simulation alone, flown by the autopilot and
+//			by random bots, and compares how they score.
+//
+// usage:	HotAirServer [--port N] [--workers N] [--sessions N]
+//			[--bots N] [--loopback] [--seconds N] [--fast]
+//			[--rollback [--latency MS] [--jitter MS] [--loss %]]
+//			[--autopilot GAMES] [--tuning FILE]
+//
+//			--tuning reads the rules from the game's tuning
+//			file (Assets/tuning.cfg) instead of the defaults;
+//			the server has to play by the same ones as the
+//			clients, or it won't agree with their scores.
+//---------------------------------------------------------
+
+#include "server.h"
+#include "rollback.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BOT_JOINS_PER_TICK 256 //don't flood the socket buffer with joins at startup
+#define BOT_KEEPALIVE_TICKS SIM_TICK_RATE
+#define BOT_JOIN_RETRY_TICKS SIM_TICK_RATE
+
+#define COST_SAMPLES 65536
+#define SETTLE_TICKS (3 * SIM_TICK_RATE) //steady input at the end of --rollback...
+#define SETTLE_CHECK_TICKS SIM_TICK_RATE //...of which the last ones have to predict right
+#define BALANCE_MAX_TICKS (5 * 60 * SIM_TICK_RATE) //a game still going after five minutes is stopped there
+
+typedef struct {
+	uint32_t session;
+	bool joined;
+	uint32_t joinSentTick; //0 when no join is waiting for an answer
+	uint32_t joinedTick; //driver tick of the WELCOME, inputs are tagged relative to it
+	uint8_t input;
+	uint32_t lastInputTick;
+	int steerTicks; //ticks until the bot changes its steering
+	uint32_t rng;
+} Bot;
+
+typedef struct {
+	Bot* bots;
+	int count;
+	ServerTransport transport;
+	ServerAddress server;
+	uint32_t tick;
+	int games; //finished games
+	int bestScore;
+} BotDriver;
+
+static uint32_t botRandom(Bot* bot) {
+	bot->rng ^= bot->rng << 13;
+	bot->rng ^= bot->rng >> 17;
+	bot->rng ^= bot->rng << 5;
+	return bot->rng;
+}
+
+static void botSend(BotDriver* driver, const ServerMessage* message) {
+	unsigned char bytes[SERVER_MAX_PACKET];
+	int size = Message_Encode(message, bytes);
+	driver->transport.send(driver->transport.data, &driver->server, bytes, size);
+}
+
+//One frame of every bot: read what the server sent, then join, steer or keep alive.
+static void botsUpdate(BotDriver* driver) {
+	unsigned char bytes[SERVER_MAX_PACKET];
+	ServerAddress from;
+	ServerMessage message;
+	int size;
+	driver->tick++;
+
+	while ((size = driver->transport.receive(driver->transport.data, &from, bytes, sizeof bytes)) > 0) {
+		if (!Message_Decode(bytes, size, &message)) continue;
+		if (message.type == MESSAGE_WELCOME && message.nonce < (uint32_t)driver->count) {
+			Bot* bot = &driver->bots[message.nonce];
+			bot->session = message.session;
+			bot->joined = true;
+			bot->joinSentTick = 0;
+			bot->joinedTick = driver->tick;
+			bot->lastInputTick = driver->tick;
+		} else if (message.type == MESSAGE_REJECT && message.nonce < (uint32_t)driver->count) {
+			driver->bots[message.nonce].joinSentTick = 0;
+		} else if (message.type == MESSAGE_STATE && message.state.dead) {
+			//find the bot by its session and start it on a new game
+			for (int i = 0; i < driver->count; i++) {
+				Bot* bot = &driver->bots[i];
+				if (!bot->joined || bot->session != message.session) continue;
+				ServerMessage leave = { .type = MESSAGE_LEAVE };
+				leave.session = bot->session;
+				botSend(driver, &leave);
+				bot->joined = false;
+				driver->games++;
+				if (message.state.score > driver->bestScore) driver->bestScore = message.state.score;
+				break;
+			}
+		}
+	}
+
+	int joins = 0;
+	for (int i = 0; i < driver->count; i++) {
+		Bot* bot = &driver->bots[i];
+		if (!bot->joined) {
+			bool waiting = bot->joinSentTick && driver->tick - bot->joinSentTick < BOT_JOIN_RETRY_TICKS;
+			if (waiting || joins == BOT_JOINS_PER_TICK) continue;
+			ServerMessage join = { .type = MESSAGE_JOIN };
+			join.seed = botRandom(bot);
+			join.nonce = i;
+			botSend(driver, &join);
+			bot->joinSentTick = driver->tick;
+			joins++;
+			continue;
+		}
+
+		//hold a direction for a while, like a player holding a key
+		bool changed = false;
+		if (--bot->steerTicks <= 0) {
+			bot->input = botRandom(bot) % 3; //straight, left or right
+			bot->steerTicks = 10 + botRandom(bot) % 50;
+			changed = true;
+		}
+		if (changed || driver->tick - bot->lastInputTick >= BOT_KEEPALIVE_TICKS) {
+			ServerMessage input = { .type = MESSAGE_INPUT };
+			input.session = bot->session;
+			input.tick = driver->tick - bot->joinedTick;
+			input.inputs = bot->input * 0x55555555u; //the same key held for every tick of the history
+			botSend(driver, &input);
+			bot->lastInputTick = driver->tick;
+		}
+	}
+}
+
+static int compareSeconds(const void* a, const void* b) {
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+/* * * * * * * * * * *
+* PREDICTING CLIENT *
+* * * * * * * * * * */
+typedef struct {
+	RollbackClient rollback;
+	ServerTransport transport;
+	ServerAddress server;
+	SimConfig config;
+	uint32_t frame;
+	uint32_t session;
+	bool joined;
+	uint32_t joinSentFrame;
+	uint32_t deadFrames;
+	uint8_t input;
+	int steerTicks;
+	uint32_t rng;
+	int games;
+	RollbackStats total; //over every game played
+	double* costs; //seconds spent in each Rollback_Correct that re-simulated
+	int costCount;
+	double costSeconds;
+	bool settling; //no more steering, so the server can't have used an input the client didn't
+	bool checking; //late enough in settling that anything in flight from before has arrived
+	int checked; //corrections compared while checking
+	int disagreed; //...that rolled back or resynced
+} PredictingClient;
+
+static void clientSend(PredictingClient* client, const ServerMessage* message) {
+	unsigned char bytes[SERVER_MAX_PACKET];
+	int size = Message_Encode(message, bytes);
+	client->transport.send(client->transport.data, &client->server, bytes, size);
+}
+
+static void addStats(RollbackStats* total, const RollbackStats* game) {
+	total->predicted += game->predicted;
+	total->corrections += game->corrections;
+	total->mispredicted += game->mispredicted;
+	total->resimulated += game->resimulated;
+	total->stale += game->stale;
+	total->resyncs += game->resyncs;
+	if (game->maxRewind > total->maxRewind) total->maxRewind = game->maxRewind;
+}
+
+//One frame: apply the server's corrections, then predict and send however many ticks are due.
+static void clientUpdate(PredictingClient* client) {
+	unsigned char bytes[SERVER_MAX_PACKET];
+	ServerAddress from;
+	ServerMessage message;
+	int size;
+	client->frame++;
+
+	while ((size = client->transport.receive(client->transport.data, &from, bytes, sizeof bytes)) > 0) {
+		if (!Message_Decode(bytes, size, &message)) continue;
+		if (message.type == MESSAGE_WELCOME && !client->joined && client->joinSentFrame) {
+			client->session = message.session;
+			client->joined = true;
+			client->deadFrames = 0;
+			Rollback_Init(&client->rollback, &client->config, message.seed);
+		} else if (message.type == MESSAGE_STATE && client->joined && message.session == client->session) {
+			double start = Server_Seconds();
+			uint64_t stale = client->rollback.stats.stale;
+			int rewound = Rollback_Correct(&client->rollback, &message.state, message.inputLead);
+			double elapsed = Server_Seconds() - start;
+			if (rewound > 0) {
+				if (client->costCount < COST_SAMPLES) client->costs[client->costCount++] = elapsed;
+				client->costSeconds += elapsed;
+			}
+			if (client->checking && client->rollback.stats.stale == stale) {
+				client->checked++;
+				client->disagreed += (rewound != 0);
+			}
+		}
+	}
+
+	if (!client->joined) {
+		if (client->joinSentFrame && client->frame - client->joinSentFrame < BOT_JOIN_RETRY_TICKS) return;
+		ServerMessage join = { .type = MESSAGE_JOIN };
+		join.seed = client->rng;
+		clientSend(client, &join);
+		client->joinSentFrame = client->frame;
+		return;
+	}
+
+	//a game is over once the plane has been dead for a second, whether or not the server's word got through
+	if (Rollback_Present(&client->rollback)->state.dead && ++client->deadFrames > SIM_TICK_RATE) {
+		ServerMessage leave = { .type = MESSAGE_LEAVE };
+		leave.session = client->session;
+		clientSend(client, &leave);
+		addStats(&client->total, &client->rollback.stats);
+		client->games++;
+		client->joined = false;
+		client->joinSentFrame = 0;
+		client->rng = client->rng * 1664525u + 1013904223u;
+		return;
+	}
+
+	int steps = Rollback_Steps(&client->rollback);
+	for (int i = 0; i < steps; i++) {
+		if (client->settling) client->input = 0;
+		else if (--client->steerTicks <= 0) {
+			client->rng = client->rng * 1664525u + 1013904223u;
+			client->input = (client->rng >> 16) % 3;
+			client->steerTicks = 10 + (client->rng >> 8) % 50;
+		}
+		Rollback_Predict(&client->rollback, client->input);
+	}
+	if (steps) {
+		ServerMessage input = { .type = MESSAGE_INPUT };
+		input.session = client->session;
+		input.inputs = Rollback_PackInputs(&client->rollback, SERVER_INPUT_HISTORY, &input.tick);
+		clientSend(client, &input);
+	}
+}
+
+//Holding steady, the client has nothing left to mispredict: every correction should match.
+static bool converged(const PredictingClient* client) {
+	return client->checked > 0 && client->disagreed == 0;
+}
+
+static void printRollback(PredictingClient* client, const LoopbackConditions* conditions, double seconds) {
+	if (client->joined) addStats(&client->total, &client->rollback.stats);
+	RollbackStats* t = &client->total;
+	qsort(client->costs, client->costCount, sizeof * client->costs, compareSeconds);
+	double p50 = 0, p99 = 0, max = 0;
+	if (client->costCount) {
+		p50 = client->costs[client->costCount * 50 / 100] * 1e6;
+		p99 = client->costs[client->costCount * 99 / 100] * 1e6;
+		max = client->costs[client->costCount - 1] * 1e6;
+	}
+	printf("rollback over %.0f s at %.0f ms +%.0f ms jitter, %.1f%% loss: %d games, %llu ticks predicted\n",
+		seconds, conditions->latency * 1000, conditions->jitter * 1000, conditions->loss * 100.0, client->games + client->joined, (unsigned long long)t->predicted);
+	printf("  corrections %llu, mispredicted %llu (%.1f%%), stale %llu, resyncs %llu\n",
+		(unsigned long long)t->corrections, (unsigned long long)t->mispredicted, t->corrections ? 100.0 * t->mispredicted / t->corrections : 0.0,
+		(unsigned long long)t->stale, (unsigned long long)t->resyncs);
+	printf("  re-simulated %llu ticks, %.1f per rollback, at most %d\n",
+		(unsigned long long)t->resimulated, t->mispredicted ? (double)t->resimulated / t->mispredicted : 0.0, t->maxRewind);
+	printf("  rollback cost p50 %.1f us, p99 %.1f us, max %.1f us, %.3f us per re-simulated tick\n",
+		p50, p99, max, t->resimulated ? client->costSeconds * 1e6 / t->resimulated : 0.0);
+	printf("  settled: %d of %d corrections disagreed with the prediction%s\n", client->disagreed, client->checked, converged(client) ? "" : ", FAILED");
+}
+
+/* * * * * * *
+* AUTOPILOT *
+* * * * * * */
+typedef struct {
+	int* scores;
+	double* seconds; //survived
+	uint64_t coins, worlds;
+	double* costs[3]; //seconds per AutopilotUpdate kind, only REPAIRED and REBUILT are kept
+	int costCount[3];
+	double steerSeconds;
+	uint64_t steers;
+} BalanceStats;
+
+static int compareInts(const void* a, const void* b) {
+	int x = *(const int*)a, y = *(const int*)b;
+	return (x > y) - (x < y);
+}
+
+static void addCost(BalanceStats* stats, AutopilotUpdate kind, double seconds) {
+	if (kind == AUTOPILOT_IDLE || stats->costCount[kind] == COST_SAMPLES) return;
+	stats->costs[kind][stats->costCount[kind]++] = seconds;
+}
+
+//Play games from seed 1 up, steered by pilot, or like the bots hold random keys when it's NULL.
+static void balancePlay(BalanceStats* stats, int games, SimPilot* pilot, const SimConfig* config) {
+	SimSession* session = malloc(sizeof * session);
+	if (!session) return;
+	uint32_t rng = 12345;
+	for (int game = 0; game < games; game++) {
+		Sim_Reset(session, config, game + 1);
+		uint32_t worldSeed = 0;
+		unsigned int input = 0;
+		int steerTicks = 0;
+		while (!session->state.dead && session->state.tick < BALANCE_MAX_TICKS) {
+			if (session->state.worldSeed != worldSeed) {
+				worldSeed = session->state.worldSeed;
+				stats->worlds++;
+			}
+			if (pilot) {
+				double start = Server_Seconds();
+				AutopilotUpdate kind = Sim_PilotSync(pilot, session, config);
+				double synced = Server_Seconds();
+				input = Sim_PilotInput(pilot, session, config); //already in sync, so only the steering
+				addCost(stats, kind, synced - start);
+				stats->steerSeconds += Server_Seconds() - synced;
+				stats->steers++;
+			} else if (--steerTicks <= 0) {
+				rng ^= rng << 13;
+				rng ^= rng >> 17;
+				rng ^= rng << 5;
+				input = rng % 3;
+				steerTicks = 10 + rng / 3 % 50;
+			}
+			uint64_t collected = session->state.coinsCollected;
+			Sim_Tick(session, config, input);
+			for (uint64_t c = session->state.coinsCollected & ~collected; c; c &= c - 1) stats->coins++;
+		}
+		stats->scores[game] = session->state.score;
+		stats->seconds[game] = (double)session->state.tick / SIM_TICK_RATE;
+	}
+	free(session);
+}
+
+static void printBalance(const char* name, BalanceStats* stats, int games) {
+	qsort(stats->scores, games, sizeof * stats->scores, compareInts);
+	qsort(stats->seconds, games, sizeof * stats->seconds, compareSeconds);
+	double scoreSum = 0, secondsSum = 0;
+	for (int i = 0; i < games; i++) {
+		scoreSum += stats->scores[i];
+		secondsSum += stats->seconds[i];
+	}
+	printf("%s over %d games: score mean %.1f median %d p90 %d | survived mean %.1f s median %.1f s | %.1f coins, %.2f worlds per game\n",
+		name, games, scoreSum / games, stats->scores[games / 2], stats->scores[games * 90 / 100],
+		secondsSum / games, stats->seconds[games / 2], (double)stats->coins / games, (double)stats->worlds / games);
+	if (!stats->steers) return;
+	const char* names[3] = { "idle", "repairs", "rebuilds" };
+	for (int kind = AUTOPILOT_REPAIRED; kind <= AUTOPILOT_REBUILT; kind++) {
+		int count = stats->costCount[kind];
+		qsort(stats->costs[kind], count, sizeof * stats->costs[kind], compareSeconds);
+		printf("  %s %d, p50 %.1f us, p99 %.1f us\n", names[kind], count,
+			count ? stats->costs[kind][count * 50 / 100] * 1e6 : 0.0, count ? stats->costs[kind][count * 99 / 100] * 1e6 : 0.0);
+	}
+	printf("  steering %.2f us per tick\n", stats->steerSeconds * 1e6 / (double)stats->steers);
+}
+
+static int runBalance(int games, const Tuning* tuning) {
+	SimConfig config;
+	Sim_Configure(&config, 1920, 1080, tuning);
+	SimPilot pilot;
+	BalanceStats stats[2];
+	memset(stats, 0, sizeof stats);
+	bool ok = Sim_PilotInit(&pilot, &config);
+	for (int i = 0; i < 2; i++) {
+		stats[i].scores = malloc(games * sizeof * stats[i].scores);
+		stats[i].seconds = malloc(games * sizeof * stats[i].seconds);
+		stats[i].costs[AUTOPILOT_REPAIRED] = malloc(COST_SAMPLES * sizeof(double));
+		stats[i].costs[AUTOPILOT_REBUILT] = malloc(COST_SAMPLES * sizeof(double));
+		ok = ok && stats[i].scores && stats[i].seconds && stats[i].costs[AUTOPILOT_REPAIRED] && stats[i].costs[AUTOPILOT_REBUILT];
+	}
+	if (ok) {
+		balancePlay(&stats[0], games, &pilot, &config);
+		balancePlay(&stats[1], games, NULL, &config);
+		printBalance("autopilot", &stats[0], games);
+		printBalance("random bots", &stats[1], games);
+	} else {
+		printf("out of memory\n");
+	}
+	for (int i = 0; i < 2; i++) {
+		free(stats[i].scores);
+		free(stats[i].seconds);
+		free(stats[i].costs[AUTOPILOT_REPAIRED]);
+		free(stats[i].costs[AUTOPILOT_REBUILT]);
+	}
+	Sim_PilotFree(&pilot);
+	return ok ? 0 : 1;
+}
+
+static void printMetrics(Server* server, int joinedBots) {
+	ServerMetrics m;
+	Server_GetMetrics(server, &m);
+	printf("sessions %6d | workers %2d | tick p50 %.3f p90 %.3f p99 %.3f max %.3f ms | %8.0f sessions/core | packets in %llu out %llu",
+		m.sessions, m.workers, m.tickP50, m.tickP90, m.tickP99, m.tickMax, m.sessionsPerCore,
+		(unsigned long long)m.packetsIn, (unsigned long long)m.packetsOut);
+	if (joinedBots >= 0) printf(" | bots playing %d", joinedBots);
+	printf("\n");
+	fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+	int port = SERVER_DEFAULT_PORT;
+	int workers = Server_CoreCount() - 1; //the main thread keeps polling the network
+	int maxSessions = 16384;
+	int botCount = 0;
+	bool loopback = false;
+	bool fast = false; //tick back to back instead of at SIM_TICK_RATE
+	double seconds = 0; //0 runs forever
+	bool rollback = false;
+	int balanceGames = 0;
+	LoopbackConditions conditions = { 0.05, 0.02, 0.05f, 1 };
+	const char* tuningPath = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--port") && hasValue) port = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--workers") && hasValue) workers = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--sessions") && hasValue) maxSessions = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--bots") && hasValue) botCount = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seconds") && hasValue) seconds = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--loopback")) loopback = true;
+		else if (!strcmp(argv[i], "--fast")) fast = true;
+		else if (!strcmp(argv[i], "--rollback")) rollback = true;
+		else if (!strcmp(argv[i], "--latency") && hasValue) conditions.latency = atof(argv[++i]) / 1000;
+		else if (!strcmp(argv[i], "--jitter") && hasValue) conditions.jitter = atof(argv[++i]) / 1000;
+		else if (!strcmp(argv[i], "--loss") && hasValue) conditions.loss = (float)atof(argv[++i]) / 100;
+		else if (!strcmp(argv[i], "--autopilot") && hasValue) balanceGames = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--tuning") && hasValue) tuningPath = argv[++i];
+		else {
+			printf("usage: %s [--port N] [--workers N] [--sessions N] [--bots N] [--loopback] [--seconds N] [--fast]"
+				" [--rollback [--latency MS] [--jitter MS] [--loss %%]] [--autopilot GAMES] [--tuning FILE]\n", argv[0]);
+			return 1;
+		}
+	}
+	Tuning tuning;
+	Tuning_Defaults(&tuning);
+	if (tuningPath && !Tuning_Load(tuningPath, &tuning)) {
+		printf("could not read %s\n", tuningPath);
+		return 1;
+	}
+	if (balanceGames > 0) return runBalance(balanceGames, &tuning);
+	workers = (workers < 0) ? 0 : (workers > SERVER_MAX_WORKERS) ? SERVER_MAX_WORKERS : workers;
+	maxSessions = (maxSessions < botCount + 1) ? botCount + 1 : maxSessions;
+	if (rollback) {
+		//simulated time, so there's no waiting on the latency
+		loopback = true;
+		fast = true;
+		seconds = (seconds > 0) ? seconds : 60;
+	}
+
+	//Endpoint 0 is the server, endpoint 1 carries every bot, endpoint 2 the predicting client.
+	LoopbackNetwork* network = NULL;
+	ServerTransport serverTransport;
+	BotDriver driver = { 0 };
+	PredictingClient* client = NULL;
+	if (loopback) {
+		network = Loopback_Create(3, 2 * botCount + 64);
+		if (!network) return 1;
+		serverTransport = Loopback_Endpoint(network, 0);
+		driver.transport = Loopback_Endpoint(network, 1);
+		driver.server = Loopback_Address(0);
+		if (rollback) {
+			Loopback_SetConditions(network, &conditions);
+			client = calloc(1, sizeof * client);
+			if (!client || !(client->costs = malloc(COST_SAMPLES * sizeof * client->costs))) return 1;
+			client->transport = Loopback_Endpoint(network, 2);
+			client->server = Loopback_Address(0);
+			client->rng = 12345;
+			Sim_Configure(&client->config, 1920, 1080, &tuning);
+		}
+	} else {
+		if (!Transport_OpenUdp(&serverTransport, (unsigned short)port)) {
+			printf("could not open UDP port %d\n", port);
+			return 1;
+		}
+		if (botCount && !Transport_OpenUdp(&driver.transport, 0)) {
+			printf("could not open the bots' UDP socket\n");
+			return 1;
+		}
+		driver.server = Transport_LocalAddress((unsigned short)port);
+	}
+
+	ServerConfig config = { maxSessions, workers, 1920, 1080, tuning };
+	Server* server = Server_Create(&config, serverTransport);
+	if (!server) {
+		printf("could not start the server\n");
+		return 1;
+	}
+
+	driver.count = botCount;
+	driver.bots = calloc(botCount ? botCount : 1, sizeof * driver.bots);
+	for (int i = 0; i < botCount; i++) driver.bots[i].rng = 0x9E3779B9u * (i + 1);
+
+	printf("HotAirServer: %s, %d workers, up to %d sessions, %d bots\n", loopback ? "loopback" : "UDP 127.0.0.1", workers, maxSessions, botCount);
+	double start = Server_Seconds();
+	double nextTick = start;
+	double nextReport = start + 1;
+	uint32_t frames = (uint32_t)(seconds * SIM_TICK_RATE) + (rollback ? SETTLE_TICKS : 0);
+	for (uint32_t frame = 0; rollback ? frame < frames : (seconds <= 0 || Server_Seconds() - start < seconds); frame++) {
+		if (botCount) botsUpdate(&driver);
+		if (client) {
+			client->settling = frame >= frames - SETTLE_TICKS;
+			client->checking = frame >= frames - SETTLE_CHECK_TICKS;
+			clientUpdate(client);
+		}
+		Server_Poll(server);
+		Server_Tick(server);
+		if (rollback) Loopback_Advance(network, 1.0 / SIM_TICK_RATE);
+
+		if (!fast) {
+			nextTick += 1.0 / SIM_TICK_RATE;
+			Server_Sleep(nextTick - Server_Seconds());
+		}
+		if (Server_Seconds() >= nextReport) {
+			int playing = 0;
+			for (int i = 0; i < botCount; i++) playing += driver.bots[i].joined;
+			printMetrics(server, botCount ? playing : -1);
+			nextReport += 1;
+		}
+	}
+
+	if (botCount) printf("bots finished %d games, best score %d\n", driver.games, driver.bestScore);
+	bool ok = true;
+	if (client) {
+		printRollback(client, &conditions, seconds);
+		ok = converged(client);
+		free(client->costs);
+		free(client);
+	}
+	Server_Free(server);
+	if (driver.transport.close) driver.transport.close(driver.transport.data);
+	Loopback_Free(network);
+	free(driver.bots);
+	return ok ? 0 : 1;
+}
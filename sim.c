@@ -0,0 +1,260 @@
+//---------------------------------------------------------
+// file:	sim.c
+//
+// brief:	Headless game rules (see sim.h). Every step here
+//			mirrors a block of game_update in main.c, in the
+//			same order, with the same Tuning values.
+//---------------------------------------------------------
+
+#include "sim.h"
+#include "collision.h"
+#include "placement.h"
+#include <string.h>
+#include <math.h>
+
+//the ones main.c doesn't read from the tuning file either
+#define SIM_LIVES 3
+#define SIM_COIN_SIZE 80.0f
+#define SIM_BODY_OFFSET 10.0f
+
+/* * * * * * * * *
+* SESSION RANDOM *
+* * * * * * * * */
+//xorshift32, so a seed replays the same world on any machine
+static uint32_t nextRandom(uint32_t* rng) {
+	uint32_t x = *rng;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*rng = x;
+	return x;
+}
+
+static float randomRange(uint32_t* rng, float min, float max) {
+	return min + (max - min) * (nextRandom(rng) * (1.0f / 4294967296.0f));
+}
+
+static int randomInt(uint32_t* rng, int min, int max) {
+	return min + (int)(nextRandom(rng) % (uint32_t)(max - min + 1));
+}
+
+static float placementRandom(void* rng) {
+	return randomRange(rng, 0, 1);
+}
+
+void Sim_Configure(SimConfig* config, float viewWidth, float viewHeight, const Tuning* tuning) {
+	config->viewWidth = viewWidth;
+	config->viewHeight = viewHeight;
+	config->north = -viewHeight;
+	config->east = 2 * viewWidth;
+	config->south = 2 * viewHeight;
+	config->west = -viewWidth;
+	config->width = config->east - config->west;
+	config->height = config->south - config->north;
+
+	config->speedStart = tuning->speed;
+	config->speedMin = tuning->speedMin;
+	config->speedBonus = tuning->speedBonus;
+	config->rotationIncrement = tuning->rotationIncrement;
+	config->rotationCap = tuning->rotationCap;
+	config->iFrameTicks = (int)(tuning->iFrameDuration * SIM_TICK_RATE + 0.5f);
+	config->pickupRadius = tuning->pickupRadius;
+	config->cloudMargin = tuning->collisionMargin;
+	config->widthScalar = tuning->widthScalar;
+	config->heightScalar = tuning->heightScalar;
+}
+
+//createClouds and createCoins, from the session's worldSeed
+static void buildWorld(SimSession* session, const SimConfig* config) {
+	uint32_t rng = session->state.worldSeed ? session->state.worldSeed : 1; //xorshift never leaves 0
+	float left = config->west + config->viewWidth / 2;
+	float right = config->east - config->viewWidth / 2 - 200;
+	float top = config->north + config->viewHeight / 2;
+	float bottom = config->south - config->viewHeight / 2 - 100;
+
+	CloudPlacement placement;
+	placement.left = left;
+	placement.right = right;
+	placement.top = top;
+	placement.bottom = bottom;
+	placement.size = 1;
+	placement.widthScalar = config->widthScalar;
+	placement.heightScalar = config->heightScalar;
+	placement.margin = config->cloudMargin;
+	placement.gap = config->cloudMargin;
+	placement.types = 12;
+	//No safe circle around the plane: the world has to follow from worldSeed alone, and
+	//Sim_SetState rebuilds it wherever the plane happens to be by then.
+	placement.safeX = 0;
+	placement.safeY = 0;
+	placement.safeRadius = 0;
+	placement.random = placementRandom;
+	placement.randomState = &rng;
+	int placed = Placement_Clouds(&placement, session->clouds, SIM_CLOUDS);
+
+	for (int i = placed; i < SIM_CLOUDS; i++) {
+		session->clouds[i].size = 1;
+		session->clouds[i].x = randomRange(&rng, left, right);
+		session->clouds[i].y = randomRange(&rng, top, bottom);
+		session->clouds[i].img_id = randomInt(&rng, 0, 11);
+	}
+	for (int i = 0; i < SIM_COINS; i++) {
+		session->coinX[i] = randomRange(&rng, left, right) + SIM_COIN_SIZE;
+		session->coinY[i] = randomRange(&rng, top, bottom) + SIM_COIN_SIZE;
+	}
+}
+
+static void newWorld(SimSession* session, const SimConfig* config) {
+	session->state.worldSeed = nextRandom(&session->state.rng);
+	session->state.coinsCollected = 0;
+	buildWorld(session, config);
+}
+
+void Sim_Reset(SimSession* session, const SimConfig* config, uint32_t seed) {
+	memset(session, 0, sizeof * session);
+	session->state.rng = seed ? seed : 1;
+	session->state.directionY = 1;
+	session->state.speed = config->speedStart;
+	session->state.remainingLives = SIM_LIVES;
+	newWorld(session, config);
+}
+
+void Sim_SetState(SimSession* session, const SimConfig* config, const SimState* state) {
+	bool sameWorld = session->state.worldSeed == state->worldSeed;
+	session->state = *state;
+	if (!sameWorld) buildWorld(session, config);
+}
+
+bool Sim_StateEqual(const SimState* a, const SimState* b) {
+	//field by field, the struct has padding memcmp would trip over
+	return a->tick == b->tick && a->rng == b->rng && a->worldSeed == b->worldSeed && a->dead == b->dead
+		&& a->origin.chunkX == b->origin.chunkX && a->origin.chunkY == b->origin.chunkY
+		&& a->globalX == b->globalX && a->globalY == b->globalY
+		&& a->lastGlobalX == b->lastGlobalX && a->lastGlobalY == b->lastGlobalY
+		&& a->directionX == b->directionX && a->directionY == b->directionY
+		&& a->rotationAngle == b->rotationAngle && a->speed == b->speed
+		&& a->remainingLives == b->remainingLives && a->score == b->score
+		&& a->iFrameTicks == b->iFrameTicks && a->coinsCollected == b->coinsCollected;
+}
+
+void Sim_Tick(SimSession* s, const SimConfig* config, unsigned int input) {
+	SimState* p = &s->state;
+	p->tick++; //counts for dead sessions too, so a tick number always means the same frame
+	if (p->dead) return;
+
+	//the plane's world position (centerVector - globalX/Y)
+	float playerX = config->viewWidth / 2 - SIM_BODY_OFFSET * p->directionX;
+	float playerY = config->viewHeight / 2 - SIM_BODY_OFFSET * p->directionY;
+
+	//DRAW CLOUDS: the collision half of it
+	for (int i = 0; i < SIM_CLOUDS; i++) {
+		const TextureRect* texture = &CLOUD_TEXTURE_POSITIONS[s->clouds[i].img_id];
+		float a = texture->w * config->widthScalar / 2;
+		float b = texture->h * config->heightScalar / 2;
+		float cloudCenterX = s->clouds[i].x + texture->w / 2;
+		float cloudCenterY = s->clouds[i].y + texture->h / 2;
+		float startX = playerX - (cloudCenterX + p->lastGlobalX);
+		float startY = playerY - (cloudCenterY + p->lastGlobalY);
+		float endX = playerX - (cloudCenterX + p->globalX);
+		float endY = playerY - (cloudCenterY + p->globalY);
+
+		if (!p->iFrameTicks && Collision_SweepCloud(startX, startY, endX, endY, a, b, config->cloudMargin) >= 0) {
+			p->remainingLives--;
+			if (p->remainingLives <= 0) {
+				p->dead = true;
+				return;
+			}
+			p->speed *= 2;
+			p->iFrameTicks = config->iFrameTicks;
+		}
+	}
+	p->lastGlobalX = p->globalX;
+	p->lastGlobalY = p->globalY;
+
+	//DRAW COINS: the pickup half of it
+	float worldX = playerX - p->globalX;
+	float worldY = playerY - p->globalY;
+	float pickupSquared = config->pickupRadius * config->pickupRadius;
+	for (int i = 0; i < SIM_COINS; i++) {
+		float dx = s->coinX[i] - worldX;
+		float dy = s->coinY[i] - worldY;
+		if (dx * dx + dy * dy >= pickupSquared || (p->coinsCollected >> i & 1)) continue;
+		p->coinsCollected |= (uint64_t)1 << i;
+		p->score = (int)(p->score + p->speed);
+		p->speed += config->speedBonus;
+	}
+
+	//CALCULATE VELOCITY, POSITION, ROTATION, AND DIRECTION
+	float cosA = cosf(p->rotationAngle);
+	float sinA = sinf(p->rotationAngle);
+	float newX = cosA * p->directionX - sinA * p->directionY;
+	float newY = sinA * p->directionX + cosA * p->directionY;
+	float length = sqrtf(newX * newX + newY * newY);
+	p->directionX = newX / length;
+	p->directionY = newY / length;
+
+	p->rotationAngle = fminf(fmaxf(p->rotationAngle, -config->rotationCap), config->rotationCap);
+	p->speed = fmaxf(p->speed, config->speedMin);
+
+	p->globalX += p->directionX * p->speed;
+	p->globalY += p->directionY * p->speed;
+
+	float shiftX, shiftY;
+	if (WorldOrigin_Rebase(&p->origin, &p->globalX, &p->globalY, config->width, config->height, &shiftX, &shiftY)) {
+		if (shiftX) p->lastGlobalX = p->globalX;
+		if (shiftY) p->lastGlobalY = p->globalY;
+		newWorld(s, config);
+	}
+
+	//CONTROL
+	if (input & SIM_INPUT_LEFT) p->rotationAngle -= config->rotationIncrement;
+	else if (input & SIM_INPUT_RIGHT) p->rotationAngle += config->rotationIncrement;
+	else p->rotationAngle = 0;
+
+	//FEEDBACK
+	if (p->iFrameTicks) {
+		p->rotationAngle += randomRange(&p->rng, -1, 1) / 2;
+		if (--p->iFrameTicks == 0) p->speed /= 4;
+	}
+}
+
+/* * * * * * *
+* AUTOPILOT *
+* * * * * * */
+bool Sim_PilotInit(SimPilot* pilot, const SimConfig* config) {
+	pilot->worldSeed = 0;
+	pilot->coinsCollected = 0;
+	return Autopilot_Init(&pilot->pilot, config->west, config->north, config->width, config->height, SIM_PILOT_CELL, SIM_CLOUDS, SIM_COINS);
+}
+
+void Sim_PilotFree(SimPilot* pilot) {
+	Autopilot_Free(&pilot->pilot);
+}
+
+AutopilotUpdate Sim_PilotSync(SimPilot* pilot, const SimSession* session, const SimConfig* config) {
+	const SimState* p = &session->state;
+	if (p->worldSeed != pilot->worldSeed) Autopilot_SetClouds(&pilot->pilot, session->clouds, SIM_CLOUDS, config->widthScalar, config->heightScalar, config->cloudMargin);
+	//a new world, or SetState went back to before coins were collected
+	if (p->worldSeed != pilot->worldSeed || (pilot->coinsCollected & ~p->coinsCollected)) {
+		Autopilot_ClearGoals(&pilot->pilot);
+		for (int i = 0; i < SIM_COINS; i++) Autopilot_AddGoal(&pilot->pilot, session->coinX[i], session->coinY[i]);
+		pilot->worldSeed = p->worldSeed;
+		pilot->coinsCollected = 0;
+	}
+	uint64_t collected = p->coinsCollected & ~pilot->coinsCollected;
+	for (int i = 0; collected; i++, collected >>= 1) {
+		if (collected & 1) Autopilot_RemoveGoal(&pilot->pilot, i);
+	}
+	pilot->coinsCollected = p->coinsCollected;
+	return Autopilot_Update(&pilot->pilot);
+}
+
+unsigned int Sim_PilotInput(SimPilot* pilot, const SimSession* session, const SimConfig* config) {
+	const SimState* p = &session->state;
+	Sim_PilotSync(pilot, session, config);
+	//Tick moves the plane by -direction in world space, see globalX/Y
+	float playerX = config->viewWidth / 2 - SIM_BODY_OFFSET * p->directionX - p->globalX;
+	float playerY = config->viewHeight / 2 - SIM_BODY_OFFSET * p->directionY - p->globalY;
+	int key = Autopilot_Steer(&pilot->pilot, playerX, playerY, -p->directionX, -p->directionY, p->speed, p->rotationAngle, config->rotationIncrement, config->rotationCap);
+	return (key < 0) ? SIM_INPUT_LEFT : (key > 0) ? SIM_INPUT_RIGHT : 0;
+}
@@ -0,0 +1,101 @@
+//---------------------------------------------------------
+// file:	sim.h
+//
+// brief:	Headless copy of the game_update rules, for the
+//			server to replay a player's inputs and check their
+//			score. No CProcessing calls, no drawing.
+//---------------------------------------------------------
+#pragma once
+
+#include "world.h"
+#include "autopilot.h"
+#include "tuning.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SIM_CLOUDS 20 //CLOUD_ARR_SIZE
+#define SIM_COINS 40 //COIN_COUNT
+#define SIM_TICK_RATE 60
+
+#define SIM_INPUT_LEFT 1
+#define SIM_INPUT_RIGHT 2
+
+#define SIM_PILOT_CELL 64 //autopilot grid cell, world units
+
+//The world size follows from the window size, like initBounds, and the rules from the
+//same Tuning the game plays by, so the server scores a run the way the player's game did.
+typedef struct {
+	float viewWidth, viewHeight;
+	float north, south, east, west;
+	float width, height;
+
+	float speedStart, speedMin, speedBonus;
+	float rotationIncrement, rotationCap;
+	int iFrameTicks; //iFrameDuration in ticks
+	float pickupRadius;
+	float cloudMargin; //collisionMargin
+	float widthScalar, heightScalar;
+} SimConfig;
+
+/***
+* Everything that changes from tick to tick, apart from the world the plane flies through.
+* The world is a pure function of worldSeed, so this is all the server needs to send for a
+* client to take on its exact state (see rollback.h).
+***/
+typedef struct {
+	uint32_t tick; //Sim_Tick calls so far, dead or alive
+	uint32_t rng;
+	uint32_t worldSeed; //the clouds and coins of the current world are built from this
+	bool dead;
+
+	WorldOrigin origin; //chunk globalX/Y and the world are relative to
+	float globalX, globalY;
+	float lastGlobalX, lastGlobalY;
+	float directionX, directionY;
+	float rotationAngle;
+	float speed;
+	int remainingLives;
+	int score;
+	int iFrameTicks; //ticks of invincibility left, 0 when not iFraming
+	uint64_t coinsCollected; //bit per coin
+} SimState;
+
+/***
+* One player's whole game. It holds no pointers, so sessions can sit back to back in one
+* array and a batch of them is ticked by streaming through memory. Randomness comes from
+* the session's own seed, so replaying the same inputs gives the same score.
+***/
+typedef struct {
+	SimState state;
+	Cloud clouds[SIM_CLOUDS];
+	float coinX[SIM_COINS]; //coin centers in world space
+	float coinY[SIM_COINS];
+} SimSession;
+
+void Sim_Configure(SimConfig* config, float viewWidth, float viewHeight, const Tuning* tuning);
+
+void Sim_Reset(SimSession* session, const SimConfig* config, uint32_t seed);
+//Advance one frame with the player holding the given SIM_INPUT_ bits. Dead sessions don't move.
+void Sim_Tick(SimSession* s, const SimConfig* config, unsigned int input);
+
+//Take on a state sent by the server, rebuilding the world if it is a different one.
+void Sim_SetState(SimSession* session, const SimConfig* config, const SimState* state);
+bool Sim_StateEqual(const SimState* a, const SimState* b);
+
+/***
+* An autopilot following one session (see autopilot.h), for bots that play to score. It
+* notices a new world or a collected coin by comparing worldSeed and coinsCollected with
+* what it saw last.
+***/
+typedef struct {
+	Autopilot pilot;
+	uint32_t worldSeed; //the world pilot has, 0 before the first
+	uint64_t coinsCollected;
+} SimPilot;
+
+bool Sim_PilotInit(SimPilot* pilot, const SimConfig* config);
+void Sim_PilotFree(SimPilot* pilot);
+//Bring pilot up to date with the session's world. Input does this too, this times it apart.
+AutopilotUpdate Sim_PilotSync(SimPilot* pilot, const SimSession* session, const SimConfig* config);
+//The SIM_INPUT_ bits the autopilot would hold this tick.
+unsigned int Sim_PilotInput(SimPilot* pilot, const SimSession* session, const SimConfig* config);
@@ -0,0 +1,264 @@
+//---------------------------------------------------------
+// file:	snapshot.c
+//
+// brief:	Binary game-state snapshots (see snapshot.h).
+//---------------------------------------------------------
+
+#include "snapshot.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define PI 3.14159265358979323846264
+
+#define SNAPSHOT_HEADER_WORDS 15
+#define SNAPSHOT_CLOUD_WORDS 4
+#define SNAPSHOT_COIN_WORDS 3
+
+#define SNAPSHOT_KEYFRAME 0
+#define SNAPSHOT_DELTA 1
+
+static const unsigned char MAGIC[4] = { 'H', 'A', 'B', 'S' };
+
+/* * * * * * * * *
+* QUANTIZATION *
+* * * * * * * * */
+static uint32_t zigzag(int32_t n) {
+	return ((uint32_t)n << 1) ^ (uint32_t)(n >> 31);
+}
+
+static int32_t unzigzag(uint32_t n) {
+	return (int32_t)(n >> 1) ^ -(int32_t)(n & 1);
+}
+
+static uint32_t quantize(float value, float steps) {
+	//round half away from zero; cheaper than lrintf, which is a library call on most compilers
+	float scaled = value * steps;
+	return zigzag((int32_t)(scaled + copysignf(0.5f, scaled)));
+}
+
+static float dequantize(uint32_t word, float steps) {
+	return unzigzag(word) / steps;
+}
+
+static int wordsFor(int clouds, int coins) {
+	return SNAPSHOT_HEADER_WORDS + clouds * SNAPSHOT_CLOUD_WORDS + coins * SNAPSHOT_COIN_WORDS;
+}
+
+bool Snapshot_Init(Snapshot* snap, int maxClouds, int maxCoins) {
+	memset(snap, 0, sizeof * snap);
+	snap->wordCapacity = wordsFor(maxClouds, maxCoins);
+	snap->words = malloc(snap->wordCapacity * sizeof * snap->words);
+	if (!snap->words) {
+		snap->wordCapacity = 0;
+		return false;
+	}
+	return true;
+}
+
+void Snapshot_Free(Snapshot* snap) {
+	free(snap->words);
+	memset(snap, 0, sizeof * snap);
+}
+
+bool Snapshot_Capture(Snapshot* snap, const SnapshotState* state, uint32_t frame) {
+	int count = wordsFor(state->cloudCount, state->coinCount);
+	if (count > snap->wordCapacity) return false;
+
+	uint32_t* w = snap->words;
+	*w++ = zigzag(state->origin.chunkX);
+	*w++ = zigzag(state->origin.chunkY);
+	*w++ = quantize(state->globalX, SNAPSHOT_POSITION_STEPS);
+	*w++ = quantize(state->globalY, SNAPSHOT_POSITION_STEPS);
+	//the direction is always a unit vector, so its angle is all that needs storing
+	*w++ = quantize(atan2f(state->directionY, state->directionX) / (2 * (float)PI), SNAPSHOT_DIRECTION_STEPS);
+	*w++ = quantize(state->rotationAngle, SNAPSHOT_ANGLE_STEPS);
+	*w++ = quantize(state->speed, SNAPSHOT_SPEED_STEPS);
+	*w++ = zigzag(state->remainingLives);
+	*w++ = zigzag(state->score);
+	*w++ = state->isIFraming;
+	*w++ = quantize(state->gameTime, SNAPSHOT_TIME_STEPS);
+	*w++ = quantize(state->iFrameStart, SNAPSHOT_TIME_STEPS);
+	*w++ = quantize(state->flashAlpha, 1);
+	*w++ = quantize(state->coinYPos, SNAPSHOT_POSITION_STEPS);
+	*w++ = quantize(state->coinVelocity, SNAPSHOT_POSITION_STEPS);
+
+	for (int i = 0; i < state->cloudCount; i++) {
+		const Cloud* cloud = &state->clouds[i];
+		*w++ = quantize(cloud->x, SNAPSHOT_POSITION_STEPS);
+		*w++ = quantize(cloud->y, SNAPSHOT_POSITION_STEPS);
+		*w++ = quantize(cloud->size, SNAPSHOT_SIZE_STEPS);
+		*w++ = cloud->img_id;
+	}
+	for (int i = 0; i < state->coinCount; i++) {
+		const Collectible* coin = &state->coins[i];
+		*w++ = quantize(coin->x, SNAPSHOT_POSITION_STEPS);
+		*w++ = quantize(coin->y, SNAPSHOT_POSITION_STEPS);
+		*w++ = coin->collected;
+	}
+
+	snap->frame = frame;
+	snap->cloudCount = state->cloudCount;
+	snap->coinCount = state->coinCount;
+	snap->wordCount = count;
+	return true;
+}
+
+bool Snapshot_Restore(const Snapshot* snap, SnapshotState* state) {
+	if (snap->cloudCount > state->cloudCapacity || snap->coinCount > state->coinCapacity) return false;
+
+	const uint32_t* w = snap->words;
+	state->origin.chunkX = unzigzag(*w++);
+	state->origin.chunkY = unzigzag(*w++);
+	state->globalX = dequantize(*w++, SNAPSHOT_POSITION_STEPS);
+	state->globalY = dequantize(*w++, SNAPSHOT_POSITION_STEPS);
+	float direction = dequantize(*w++, SNAPSHOT_DIRECTION_STEPS) * 2 * (float)PI;
+	state->directionX = cosf(direction);
+	state->directionY = sinf(direction);
+	state->rotationAngle = dequantize(*w++, SNAPSHOT_ANGLE_STEPS);
+	state->speed = dequantize(*w++, SNAPSHOT_SPEED_STEPS);
+	state->remainingLives = unzigzag(*w++);
+	state->score = unzigzag(*w++);
+	state->isIFraming = *w++ != 0;
+	state->gameTime = dequantize(*w++, SNAPSHOT_TIME_STEPS);
+	state->iFrameStart = dequantize(*w++, SNAPSHOT_TIME_STEPS);
+	state->flashAlpha = dequantize(*w++, 1);
+	state->coinYPos = dequantize(*w++, SNAPSHOT_POSITION_STEPS);
+	state->coinVelocity = dequantize(*w++, SNAPSHOT_POSITION_STEPS);
+
+	for (int i = 0; i < snap->cloudCount; i++) {
+		Cloud* cloud = &state->clouds[i];
+		cloud->x = dequantize(*w++, SNAPSHOT_POSITION_STEPS);
+		cloud->y = dequantize(*w++, SNAPSHOT_POSITION_STEPS);
+		cloud->size = dequantize(*w++, SNAPSHOT_SIZE_STEPS);
+		cloud->img_id = (int)*w++;
+	}
+	for (int i = 0; i < snap->coinCount; i++) {
+		Collectible* coin = &state->coins[i];
+		coin->x = dequantize(*w++, SNAPSHOT_POSITION_STEPS);
+		coin->y = dequantize(*w++, SNAPSHOT_POSITION_STEPS);
+		coin->collected = *w++ != 0;
+	}
+
+	state->cloudCount = snap->cloudCount;
+	state->coinCount = snap->coinCount;
+	return true;
+}
+
+bool Snapshot_Equal(const Snapshot* a, const Snapshot* b) {
+	return a->cloudCount == b->cloudCount && a->coinCount == b->coinCount
+		&& memcmp(a->words, b->words, a->wordCount * sizeof * a->words) == 0;
+}
+
+/* * * * * * * *
+* VARINT CODEC *
+* * * * * * * */
+//7 bits per byte, low bits first, high bit set on every byte but the last.
+static unsigned char* writeVarint(unsigned char* p, uint32_t value) {
+	while (value >= 0x80) {
+		*p++ = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+	*p++ = (unsigned char)value;
+	return p;
+}
+
+static bool readVarint(const unsigned char** p, const unsigned char* end, uint32_t* value) {
+	uint32_t result = 0;
+	for (int shift = 0; shift < 35; shift += 7) {
+		if (*p >= end) return false;
+		unsigned char byte = *(*p)++;
+		result |= (uint32_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) {
+			*value = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+int Snapshot_MaxEncodedSize(const Snapshot* snap) {
+	//header: magic, version, kind and four varints; payload: a varint per word plus a run length per word for deltas
+	return sizeof MAGIC + 2 + 4 * 5 + snap->wordCount * 10 + 5;
+}
+
+/***
+* Keyframe payload: every word as a varint.
+* Delta payload: the words XORed with the baseline, as pairs of (run of unchanged words,
+* changed word). Between frames only a handful of header words change, so a world with
+* thousands of clouds still encodes to a few bytes.
+***/
+int Snapshot_Encode(const Snapshot* snap, const Snapshot* baseline, unsigned char* out, int capacity) {
+	if (capacity < Snapshot_MaxEncodedSize(snap)) return -1;
+	bool delta = baseline && baseline->cloudCount == snap->cloudCount && baseline->coinCount == snap->coinCount;
+
+	unsigned char* p = out;
+	memcpy(p, MAGIC, sizeof MAGIC);
+	p += sizeof MAGIC;
+	*p++ = SNAPSHOT_VERSION;
+	*p++ = delta ? SNAPSHOT_DELTA : SNAPSHOT_KEYFRAME;
+	p = writeVarint(p, snap->frame);
+	if (delta) p = writeVarint(p, baseline->frame);
+	p = writeVarint(p, snap->cloudCount);
+	p = writeVarint(p, snap->coinCount);
+
+	if (!delta) {
+		for (int i = 0; i < snap->wordCount; i++) p = writeVarint(p, snap->words[i]);
+		return (int)(p - out);
+	}
+
+	int i = 0;
+	while (i < snap->wordCount) {
+		int start = i;
+		while (i < snap->wordCount && snap->words[i] == baseline->words[i]) i++;
+		p = writeVarint(p, i - start);
+		if (i == snap->wordCount) break;
+		p = writeVarint(p, snap->words[i] ^ baseline->words[i]);
+		i++;
+	}
+	return (int)(p - out);
+}
+
+bool Snapshot_Decode(const unsigned char* data, int size, const Snapshot* baseline, Snapshot* snap) {
+	const unsigned char* p = data;
+	const unsigned char* end = data + size;
+	if (size < (int)sizeof MAGIC + 2 || memcmp(p, MAGIC, sizeof MAGIC) != 0) return false;
+	p += sizeof MAGIC;
+	if (*p++ != SNAPSHOT_VERSION) return false;
+	unsigned char kind = *p++;
+	if (kind != SNAPSHOT_KEYFRAME && kind != SNAPSHOT_DELTA) return false;
+
+	uint32_t frame, baselineFrame = 0, clouds, coins;
+	if (!readVarint(&p, end, &frame)) return false;
+	if (kind == SNAPSHOT_DELTA && !readVarint(&p, end, &baselineFrame)) return false;
+	if (!readVarint(&p, end, &clouds) || !readVarint(&p, end, &coins)) return false;
+	//checked separately so the word count below cannot overflow
+	if (clouds > (uint32_t)snap->wordCapacity || coins > (uint32_t)snap->wordCapacity) return false;
+	int count = wordsFor(clouds, coins);
+	if (count > snap->wordCapacity) return false;
+
+	if (kind == SNAPSHOT_KEYFRAME) {
+		for (int i = 0; i < count; i++) {
+			if (!readVarint(&p, end, &snap->words[i])) return false;
+		}
+	} else {
+		if (!baseline || baseline->frame != baselineFrame || baseline->cloudCount != (int)clouds || baseline->coinCount != (int)coins) return false;
+		if (snap != baseline) memcpy(snap->words, baseline->words, count * sizeof * snap->words);
+		uint32_t i = 0;
+		while (i < (uint32_t)count) {
+			uint32_t run, x;
+			if (!readVarint(&p, end, &run) || run > (uint32_t)count - i) return false;
+			i += run;
+			if (i == (uint32_t)count) break;
+			if (!readVarint(&p, end, &x)) return false;
+			snap->words[i++] ^= x;
+		}
+	}
+	if (p != end) return false;
+
+	snap->frame = frame;
+	snap->cloudCount = clouds;
+	snap->coinCount = coins;
+	snap->wordCount = count;
+	return true;
+}
@@ -0,0 +1,80 @@
+//---------------------------------------------------------
+// file:	snapshot.h
+//
+// brief:	Compact binary snapshots of the whole simulation
+//			state. Fields are quantized to fixed point, and a
+//			snapshot can be encoded on its own (keyframe) or as
+//			an XOR/varint delta against a baseline snapshot.
+//---------------------------------------------------------
+#pragma once
+
+#include "world.h"
+#include "collectibles.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SNAPSHOT_VERSION 2
+
+//Fixed point steps per unit for the quantized fields.
+#define SNAPSHOT_POSITION_STEPS 8.0f //1/8 pixel
+#define SNAPSHOT_DIRECTION_STEPS 65536.0f //per full turn
+#define SNAPSHOT_ANGLE_STEPS 65536.0f //per radian
+#define SNAPSHOT_SPEED_STEPS 256.0f
+#define SNAPSHOT_TIME_STEPS 1000.0f //milliseconds
+#define SNAPSHOT_SIZE_STEPS 256.0f //cloud scale
+
+/***
+* The game's state as loose fields, the way main.c keeps it. Times are seconds since the
+* restart so a snapshot does not depend on when the program was started. The cloud and
+* coin arrays are only read by Snapshot_Capture; Snapshot_Restore writes into them and
+* needs cloudCapacity/coinCapacity to know how much fits.
+***/
+typedef struct {
+	WorldOrigin origin;
+	float globalX, globalY;
+	float directionX, directionY;
+	float rotationAngle;
+	float speed;
+	int remainingLives;
+	int score;
+	bool isIFraming;
+	float gameTime;
+	float iFrameStart;
+	float flashAlpha;
+	float coinYPos, coinVelocity;
+
+	Cloud* clouds;
+	int cloudCount, cloudCapacity;
+	Collectible* coins;
+	int coinCount, coinCapacity;
+} SnapshotState;
+
+/***
+* A captured snapshot is the quantized state as a flat array of 32 bit words, every
+* signed value zigzag mapped so small magnitudes have small words. Capturing is a single
+* pass over the state with no allocation, and two snapshots of the same world line up
+* word for word, which is what the delta encoding relies on.
+***/
+typedef struct {
+	uint32_t frame; //set by the caller, deltas name the frame of their baseline
+	int cloudCount;
+	int coinCount;
+	int wordCount;
+	int wordCapacity;
+	uint32_t* words;
+} Snapshot;
+
+bool Snapshot_Init(Snapshot* snap, int maxClouds, int maxCoins);
+void Snapshot_Free(Snapshot* snap);
+
+bool Snapshot_Capture(Snapshot* snap, const SnapshotState* state, uint32_t frame);
+bool Snapshot_Restore(const Snapshot* snap, SnapshotState* state);
+bool Snapshot_Equal(const Snapshot* a, const Snapshot* b);
+
+//Largest possible encoding of snap, keyframe or delta.
+int Snapshot_MaxEncodedSize(const Snapshot* snap);
+//Pass a NULL baseline for a keyframe. A baseline of a different world (other counts) also gives a keyframe.
+//Returns the encoded size in bytes, or -1 if it does not fit in capacity.
+int Snapshot_Encode(const Snapshot* snap, const Snapshot* baseline, unsigned char* out, int capacity);
+//Deltas need the same baseline they were encoded against. Returns false on malformed or mismatched data.
+bool Snapshot_Decode(const unsigned char* data, int size, const Snapshot* baseline, Snapshot* snap);
@@ -0,0 +1,771 @@
+//---------------------------------------------------------
+// file:	softraster.c
+//
+// brief:	CPU software rasterizer (see softraster.h).
+//			Shapes are reduced to convex polygons or ellipses and
+//			filled one scanline span at a time. Span fills and
+//			premultiplied "source over" blends use AVX2 when the
+//			compiler targets it (/arch:AVX2 or -mavx2).
+//			There is no anti-aliasing: output is deterministic
+//			so it can be diffed against golden images.
+//---------------------------------------------------------
+
+#include "softraster.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#define SR_PI 3.14159265358979323846
+#define SR_MAX_POLY 40 //a rounded rect is 4 corners * 9 points
+#define SR_MAX_THREADS 64
+#define SR_CORNER_SEGMENTS 8
+#define SR_SPAN_CHUNK 256
+
+typedef enum {
+	SR_CMD_CLEAR,
+	SR_CMD_POLYGON,
+	SR_CMD_ELLIPSE,
+	SR_CMD_IMAGE
+} SR_CommandType;
+
+typedef struct {
+	SR_CommandType type;
+	uint32_t fill; //premultiplied
+	uint32_t stroke; //premultiplied
+	bool hasFill;
+	bool hasStroke;
+	float strokeWeight;
+	union {
+		struct {
+			int count;
+			float x[SR_MAX_POLY];
+			float y[SR_MAX_POLY];
+		} poly;
+		struct {
+			float cx, cy, a, b, radians;
+		} ellipse;
+		struct {
+			SR_Image* img;
+			float x, y, w, h; //destination, always corner mode
+			float u0, v0, u1, v1;
+			int alpha;
+			float radians;
+		} image;
+	};
+} SR_Command;
+
+struct SR_Target {
+	int w;
+	int h;
+	uint32_t* pixels;
+
+	SR_Command* commands;
+	int commandCount;
+	int commandCapacity;
+	int threads;
+
+	//current render state
+	uint32_t fill;
+	uint32_t stroke;
+	bool hasFill;
+	bool hasStroke;
+	float strokeWeight;
+	SR_PositionMode imageMode;
+	float textSize;
+	SR_TextAlignH textAlignH;
+	SR_TextAlignV textAlignV;
+
+	SR_Stats stats;
+};
+
+/* * * * * * * * *
+* PIXEL HELPERS  *
+* * * * * * * * */
+static inline uint32_t div255(uint32_t x) {
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+static uint32_t premultiply(SR_Color c) {
+	uint32_t r = div255(c.r * c.a);
+	uint32_t g = div255(c.g * c.a);
+	uint32_t b = div255(c.b * c.a);
+	return r | (g << 8) | (b << 16) | ((uint32_t)c.a << 24);
+}
+
+static inline uint32_t blendPixel(uint32_t d, uint32_t s) {
+	uint32_t inv = 255 - (s >> 24);
+	uint32_t out = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		uint32_t channel = ((s >> shift) & 0xFF) + div255(((d >> shift) & 0xFF) * inv);
+		out |= (channel > 255 ? 255 : channel) << shift;
+	}
+	return out;
+}
+
+static inline uint32_t scalePixel(uint32_t s, uint32_t alpha) {
+	uint32_t out = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		out |= div255(((s >> shift) & 0xFF) * alpha) << shift;
+	}
+	return out;
+}
+
+//Multiply every channel of n premultiplied pixels by alpha / 255.
+static void scaleSpan(uint32_t* px, int n, uint32_t alpha) {
+	int i = 0;
+#if defined(__AVX2__)
+	{
+		__m256i zero = _mm256_setzero_si256();
+		__m256i scale = _mm256_set1_epi16((short)alpha);
+		__m256i bias = _mm256_set1_epi16(128);
+		for (; i + 8 <= n; i += 8) {
+			__m256i p = _mm256_loadu_si256((__m256i*)(px + i));
+			__m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(p, zero), scale), bias);
+			__m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(p, zero), scale), bias);
+			lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+			hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+			_mm256_storeu_si256((__m256i*)(px + i), _mm256_packus_epi16(lo, hi));
+		}
+	}
+#endif
+	for (; i < n; i++) px[i] = scalePixel(px[i], alpha);
+}
+
+//Blend one constant premultiplied color over n pixels.
+static void fillSpan(uint32_t* dst, int n, uint32_t src) {
+	uint32_t a = src >> 24;
+	int i = 0;
+	if (a == 0) return;
+	if (a == 255) {
+#if defined(__AVX2__)
+		__m256i s = _mm256_set1_epi32((int)src);
+		for (; i + 8 <= n; i += 8) _mm256_storeu_si256((__m256i*)(dst + i), s);
+#endif
+		for (; i < n; i++) dst[i] = src;
+		return;
+	}
+#if defined(__AVX2__)
+	{
+		__m256i zero = _mm256_setzero_si256();
+		__m256i s = _mm256_set1_epi32((int)src);
+		__m256i inv = _mm256_set1_epi16((short)(255 - a));
+		__m256i bias = _mm256_set1_epi16(128);
+		for (; i + 8 <= n; i += 8) {
+			__m256i d = _mm256_loadu_si256((__m256i*)(dst + i));
+			__m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inv);
+			__m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inv);
+			lo = _mm256_add_epi16(lo, bias);
+			hi = _mm256_add_epi16(hi, bias);
+			lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+			hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+			_mm256_storeu_si256((__m256i*)(dst + i), _mm256_adds_epu8(_mm256_packus_epi16(lo, hi), s));
+		}
+	}
+#endif
+	for (; i < n; i++) dst[i] = blendPixel(dst[i], src);
+}
+
+//Blend n premultiplied source pixels over n destination pixels.
+static void blendSpan(uint32_t* dst, const uint32_t* src, int n) {
+	int i = 0;
+#if defined(__AVX2__)
+	{
+		__m256i zero = _mm256_setzero_si256();
+		__m256i full = _mm256_set1_epi16(255);
+		__m256i bias = _mm256_set1_epi16(128);
+		//replicate each pixel's 16-bit alpha word across its four channel words
+		__m256i alphaMask = _mm256_setr_epi8(
+			6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15,
+			6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15);
+		for (; i + 8 <= n; i += 8) {
+			__m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+			__m256i d = _mm256_loadu_si256((__m256i*)(dst + i));
+			__m256i invLo = _mm256_sub_epi16(full, _mm256_shuffle_epi8(_mm256_unpacklo_epi8(s, zero), alphaMask));
+			__m256i invHi = _mm256_sub_epi16(full, _mm256_shuffle_epi8(_mm256_unpackhi_epi8(s, zero), alphaMask));
+			__m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), invLo), bias);
+			__m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), invHi), bias);
+			lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+			hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+			_mm256_storeu_si256((__m256i*)(dst + i), _mm256_adds_epu8(_mm256_packus_epi16(lo, hi), s));
+		}
+	}
+#endif
+	for (; i < n; i++) dst[i] = blendPixel(dst[i], src[i]);
+}
+
+/* * * * * * * * * *
+* TARGET / STATE  *
+* * * * * * * * * */
+SR_Target* SR_Target_Create(int w, int h) {
+	SR_Target* t = calloc(1, sizeof * t);
+	if (!t) return NULL;
+	t->w = w;
+	t->h = h;
+	t->pixels = calloc((size_t)w * h, sizeof * t->pixels);
+	if (!t->pixels) {
+		free(t);
+		return NULL;
+	}
+	t->threads = 1;
+	t->fill = 0xFFFFFFFF;
+	t->stroke = 0xFF000000;
+	t->hasFill = true;
+	t->hasStroke = true;
+	t->strokeWeight = 1;
+	t->imageMode = SR_POSITION_CENTER; //CProcessing defaults
+	t->textSize = 20;
+	t->textAlignH = SR_TEXT_ALIGN_LEFT;
+	t->textAlignV = SR_TEXT_ALIGN_TOP;
+	return t;
+}
+
+void SR_Target_Free(SR_Target** target) {
+	if (!target || !*target) return;
+	free((*target)->pixels);
+	free((*target)->commands);
+	free(*target);
+	*target = NULL;
+}
+
+int SR_Target_GetWidth(SR_Target* target) { return target->w; }
+int SR_Target_GetHeight(SR_Target* target) { return target->h; }
+const uint32_t* SR_Target_GetPixels(SR_Target* target) { return target->pixels; }
+SR_Stats SR_Target_GetStats(SR_Target* target) { return target->stats; }
+void SR_Target_ResetStats(SR_Target* target) { memset(&target->stats, 0, sizeof target->stats); }
+
+void SR_Target_SetThreads(SR_Target* target, int threads) {
+	target->threads = (threads < 1) ? 1 : (threads > SR_MAX_THREADS) ? SR_MAX_THREADS : threads;
+}
+
+void SR_Settings_Fill(SR_Target* target, SR_Color c) { target->fill = premultiply(c); target->hasFill = true; }
+void SR_Settings_NoFill(SR_Target* target) { target->hasFill = false; }
+void SR_Settings_Stroke(SR_Target* target, SR_Color c) { target->stroke = premultiply(c); target->hasStroke = true; }
+void SR_Settings_NoStroke(SR_Target* target) { target->hasStroke = false; }
+void SR_Settings_StrokeWeight(SR_Target* target, float weight) { target->strokeWeight = weight; }
+void SR_Settings_ImageMode(SR_Target* target, SR_PositionMode mode) { target->imageMode = mode; }
+void SR_Settings_TextSize(SR_Target* target, float size) { target->textSize = size; }
+void SR_Settings_TextAlignment(SR_Target* target, SR_TextAlignH h, SR_TextAlignV v) {
+	target->textAlignH = h;
+	target->textAlignV = v;
+}
+
+static SR_Command* pushCommand(SR_Target* t, SR_CommandType type) {
+	if (t->commandCount == t->commandCapacity) {
+		int capacity = t->commandCapacity ? t->commandCapacity * 2 : 256;
+		SR_Command* grown = realloc(t->commands, capacity * sizeof * grown);
+		if (!grown) return NULL;
+		t->commands = grown;
+		t->commandCapacity = capacity;
+	}
+	SR_Command* cmd = &t->commands[t->commandCount++];
+	cmd->type = type;
+	cmd->fill = t->fill;
+	cmd->stroke = t->stroke;
+	cmd->hasFill = t->hasFill;
+	cmd->hasStroke = t->hasStroke && t->strokeWeight > 0;
+	cmd->strokeWeight = t->strokeWeight;
+	return cmd;
+}
+
+static void rotatePoints(float* x, float* y, int count, float cx, float cy, float degrees) {
+	if (degrees == 0) return;
+	float r = (float)(degrees * SR_PI / 180);
+	float c = cosf(r);
+	float s = sinf(r);
+	for (int i = 0; i < count; i++) {
+		float dx = x[i] - cx;
+		float dy = y[i] - cy;
+		x[i] = cx + dx * c - dy * s;
+		y[i] = cy + dx * s + dy * c;
+	}
+}
+
+/* * * * * * * * *
+* DRAW COMMANDS  *
+* * * * * * * * */
+void SR_Graphics_ClearBackground(SR_Target* target, SR_Color c) {
+	SR_Command* cmd = pushCommand(target, SR_CMD_CLEAR);
+	if (cmd) cmd->fill = premultiply(c);
+}
+
+void SR_Graphics_DrawRect(SR_Target* target, float x, float y, float w, float h) {
+	SR_Graphics_DrawRectAdvanced(target, x, y, w, h, 0, 0);
+}
+
+void SR_Graphics_DrawRectAdvanced(SR_Target* target, float x, float y, float w, float h, float degrees, float cornerRadius) {
+	SR_Command* cmd = pushCommand(target, SR_CMD_POLYGON);
+	if (!cmd) return;
+	float r = cornerRadius;
+	r = (r > w / 2) ? w / 2 : r;
+	r = (r > h / 2) ? h / 2 : r;
+	if (r <= 0) {
+		float px[4] = { x, x + w, x + w, x };
+		float py[4] = { y, y, y + h, y + h };
+		memcpy(cmd->poly.x, px, sizeof px);
+		memcpy(cmd->poly.y, py, sizeof py);
+		cmd->poly.count = 4;
+	} else {
+		//each corner is a quarter circle, walked clockwise starting at the top-left
+		float cornerX[4] = { x + r, x + w - r, x + w - r, x + r };
+		float cornerY[4] = { y + r, y + r, y + h - r, y + h - r };
+		int n = 0;
+		for (int corner = 0; corner < 4; corner++) {
+			double start = SR_PI + corner * SR_PI / 2;
+			for (int i = 0; i <= SR_CORNER_SEGMENTS; i++) {
+				double angle = start + i * (SR_PI / 2) / SR_CORNER_SEGMENTS;
+				cmd->poly.x[n] = cornerX[corner] + (float)(r * cos(angle));
+				cmd->poly.y[n] = cornerY[corner] + (float)(r * sin(angle));
+				n++;
+			}
+		}
+		cmd->poly.count = n;
+	}
+	rotatePoints(cmd->poly.x, cmd->poly.y, cmd->poly.count, x + w / 2, y + h / 2, degrees);
+}
+
+void SR_Graphics_DrawEllipseAdvanced(SR_Target* target, float x, float y, float w, float h, float degrees) {
+	SR_Command* cmd = pushCommand(target, SR_CMD_ELLIPSE);
+	if (!cmd) return;
+	cmd->ellipse.cx = x;
+	cmd->ellipse.cy = y;
+	cmd->ellipse.a = w / 2;
+	cmd->ellipse.b = h / 2;
+	cmd->ellipse.radians = (float)(degrees * SR_PI / 180);
+}
+
+void SR_Graphics_DrawTriangleAdvanced(SR_Target* target, float x1, float y1, float x2, float y2, float x3, float y3, float degrees) {
+	SR_Command* cmd = pushCommand(target, SR_CMD_POLYGON);
+	if (!cmd) return;
+	float px[3] = { x1, x2, x3 };
+	float py[3] = { y1, y2, y3 };
+	memcpy(cmd->poly.x, px, sizeof px);
+	memcpy(cmd->poly.y, py, sizeof py);
+	cmd->poly.count = 3;
+	rotatePoints(cmd->poly.x, cmd->poly.y, 3, (x1 + x2 + x3) / 3, (y1 + y2 + y3) / 3, degrees);
+}
+
+/***
+* There is no font rasterizer here: text is "greeked" into one solid bar per glyph
+* using the same advance and alignment rules for every string. That keeps text cost
+* and placement visible in profiles and golden images without shipping glyph data.
+***/
+void SR_Font_DrawText(SR_Target* target, const char* text, float x, float y) {
+	float advance = target->textSize * 0.55f;
+	float barW = advance * 0.8f;
+	float barH = target->textSize * 0.7f;
+	float totalW = strlen(text) * advance;
+
+	float left = (target->textAlignH == SR_TEXT_ALIGN_CENTER) ? x - totalW / 2 : (target->textAlignH == SR_TEXT_ALIGN_RIGHT) ? x - totalW : x;
+	float top = (target->textAlignV == SR_TEXT_ALIGN_MIDDLE) ? y - barH / 2 : (target->textAlignV == SR_TEXT_ALIGN_BOTTOM) ? y - barH : y;
+
+	bool hadStroke = target->hasStroke;
+	target->hasStroke = false;
+	for (int i = 0; text[i]; i++) {
+		if (text[i] != ' ') SR_Graphics_DrawRect(target, left + i * advance, top, barW, barH);
+	}
+	target->hasStroke = hadStroke;
+}
+
+SR_Image* SR_Image_CreateFromData(int w, int h, const unsigned char* rgba) {
+	SR_Image* img = malloc(sizeof * img);
+	if (!img) return NULL;
+	img->w = w;
+	img->h = h;
+	img->pixels = malloc((size_t)w * h * sizeof * img->pixels);
+	if (!img->pixels) {
+		free(img);
+		return NULL;
+	}
+	for (int i = 0; i < w * h; i++) {
+		SR_Color c = { rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2], rgba[i * 4 + 3] };
+		img->pixels[i] = premultiply(c);
+	}
+	return img;
+}
+
+void SR_Image_Free(SR_Image** img) {
+	if (!img || !*img) return;
+	free((*img)->pixels);
+	free(*img);
+	*img = NULL;
+}
+
+void SR_Image_DrawSubImage(SR_Target* target, SR_Image* img, float x, float y, float w, float h, float u0, float v0, float u1, float v1, int alpha) {
+	if (!img || alpha <= 0) return;
+	SR_Command* cmd = pushCommand(target, SR_CMD_IMAGE);
+	if (!cmd) return;
+	if (target->imageMode == SR_POSITION_CENTER) {
+		x -= w / 2;
+		y -= h / 2;
+	}
+	cmd->image.img = img;
+	cmd->image.x = x;
+	cmd->image.y = y;
+	cmd->image.w = w;
+	cmd->image.h = h;
+	cmd->image.u0 = u0;
+	cmd->image.v0 = v0;
+	cmd->image.u1 = u1;
+	cmd->image.v1 = v1;
+	cmd->image.alpha = (alpha > 255) ? 255 : alpha;
+	cmd->image.radians = 0;
+}
+
+void SR_Image_Draw(SR_Target* target, SR_Image* img, float x, float y, float w, float h, int alpha) {
+	if (!img) return;
+	SR_Image_DrawSubImage(target, img, x, y, w, h, 0, 0, (float)img->w, (float)img->h, alpha);
+}
+
+void SR_Image_DrawAdvanced(SR_Target* target, SR_Image* img, float x, float y, float w, float h, int alpha, float degrees) {
+	int before = target->commandCount;
+	SR_Image_Draw(target, img, x, y, w, h, alpha);
+	if (target->commandCount > before) {
+		target->commands[target->commandCount - 1].image.radians = (float)(degrees * SR_PI / 180);
+	}
+}
+
+/* * * * * * * * *
+* RASTERIZATION  *
+* * * * * * * * */
+typedef struct {
+	SR_Target* target;
+	int y0;
+	int y1;
+	uint64_t pixelsTouched;
+} SR_Band;
+
+static void clampSpan(int* x0, int* x1, int w) {
+	if (*x0 < 0) *x0 = 0;
+	if (*x1 > w) *x1 = w;
+}
+
+static void fillRow(SR_Band* band, int y, int x0, int x1, uint32_t color) {
+	clampSpan(&x0, &x1, band->target->w);
+	if (x1 <= x0) return;
+	fillSpan(band->target->pixels + (size_t)y * band->target->w, x1 - x0, color);
+	band->pixelsTouched += x1 - x0;
+}
+
+//Span covered by a convex polygon on the scanline through pixel centers at yc.
+//Pixels whose centers fall inside [minX, maxX) are covered.
+static bool polygonSpan(const float* px, const float* py, int count, float yc, int* x0, int* x1) {
+	float minX = 1e30f;
+	float maxX = -1e30f;
+	for (int i = 0; i < count; i++) {
+		int j = (i + 1) % count;
+		float ya = py[i];
+		float yb = py[j];
+		if ((yc < ya) == (yc < yb)) continue;
+		float ix = px[i] + (yc - ya) * (px[j] - px[i]) / (yb - ya);
+		minX = (ix < minX) ? ix : minX;
+		maxX = (ix > maxX) ? ix : maxX;
+	}
+	if (maxX < minX) return false;
+	*x0 = (int)ceilf(minX - 0.5f);
+	*x1 = (int)ceilf(maxX - 0.5f);
+	return *x1 > *x0;
+}
+
+//Offset every edge of a convex polygon by d along its outward normal (negative d shrinks).
+//Returns false if the polygon collapses.
+static bool offsetPolygon(const float* px, const float* py, int count, float d, float* ox, float* oy) {
+	float area = 0;
+	for (int i = 0; i < count; i++) {
+		int j = (i + 1) % count;
+		area += px[i] * py[j] - px[j] * py[i];
+	}
+	float sign = (area > 0) ? 1.0f : -1.0f;
+
+	for (int i = 0; i < count; i++) {
+		int prev = (i + count - 1) % count;
+		int next = (i + 1) % count;
+		float e0x = px[i] - px[prev], e0y = py[i] - py[prev];
+		float e1x = px[next] - px[i], e1y = py[next] - py[i];
+		float l0 = sqrtf(e0x * e0x + e0y * e0y);
+		float l1 = sqrtf(e1x * e1x + e1y * e1y);
+		if (l0 == 0 || l1 == 0) {
+			ox[i] = px[i];
+			oy[i] = py[i];
+			continue;
+		}
+		//outward normals of both edges meeting at this vertex
+		float n0x = sign * e0y / l0, n0y = -sign * e0x / l0;
+		float n1x = sign * e1y / l1, n1y = -sign * e1x / l1;
+		//miter direction, scaled so both offset edges pass through the new vertex
+		float mx = n0x + n1x, my = n0y + n1y;
+		float dot = mx * n1x + my * n1y;
+		if (dot < 1e-4f) {
+			ox[i] = px[i] + n1x * d;
+			oy[i] = py[i] + n1y * d;
+		} else {
+			ox[i] = px[i] + mx * d / dot;
+			oy[i] = py[i] + my * d / dot;
+		}
+	}
+
+	float newArea = 0;
+	for (int i = 0; i < count; i++) {
+		int j = (i + 1) % count;
+		newArea += ox[i] * oy[j] - ox[j] * oy[i];
+	}
+	return newArea * sign > 0 && (d >= 0 || fabsf(newArea) < fabsf(area));
+}
+
+//Fill the inside span with the fill color and the ring between inner and outer with the stroke.
+static void shadeRow(SR_Band* band, const SR_Command* cmd, int y, bool hasOuter, int o0, int o1, bool hasInner, int i0, int i1) {
+	if (!cmd->hasStroke) {
+		if (cmd->hasFill && hasInner) fillRow(band, y, i0, i1, cmd->fill);
+		return;
+	}
+	if (!hasOuter) return;
+	if (!hasInner) {
+		fillRow(band, y, o0, o1, cmd->stroke);
+		return;
+	}
+	fillRow(band, y, o0, i0, cmd->stroke);
+	if (cmd->hasFill) fillRow(band, y, i0, i1, cmd->fill);
+	fillRow(band, y, i1, o1, cmd->stroke);
+}
+
+static void rasterPolygon(SR_Band* band, const SR_Command* cmd) {
+	float outerX[SR_MAX_POLY], outerY[SR_MAX_POLY];
+	float innerX[SR_MAX_POLY], innerY[SR_MAX_POLY];
+	int n = cmd->poly.count;
+	const float* ox = cmd->poly.x;
+	const float* oy = cmd->poly.y;
+	const float* ix = cmd->poly.x;
+	const float* iy = cmd->poly.y;
+	bool innerValid = true;
+
+	if (cmd->hasStroke) {
+		float half = cmd->strokeWeight / 2;
+		offsetPolygon(cmd->poly.x, cmd->poly.y, n, half, outerX, outerY);
+		innerValid = offsetPolygon(cmd->poly.x, cmd->poly.y, n, -half, innerX, innerY);
+		ox = outerX;
+		oy = outerY;
+		ix = innerX;
+		iy = innerY;
+	}
+
+	float minY = oy[0], maxY = oy[0];
+	for (int i = 1; i < n; i++) {
+		minY = (oy[i] < minY) ? oy[i] : minY;
+		maxY = (oy[i] > maxY) ? oy[i] : maxY;
+	}
+	int y0 = (int)ceilf(minY - 0.5f);
+	int y1 = (int)ceilf(maxY - 0.5f);
+	y0 = (y0 < band->y0) ? band->y0 : y0;
+	y1 = (y1 > band->y1) ? band->y1 : y1;
+
+	for (int y = y0; y < y1; y++) {
+		float yc = y + 0.5f;
+		int o0 = 0, o1 = 0, i0 = 0, i1 = 0;
+		bool hasOuter = polygonSpan(ox, oy, n, yc, &o0, &o1);
+		bool hasInner = innerValid && polygonSpan(ix, iy, n, yc, &i0, &i1);
+		shadeRow(band, cmd, y, hasOuter, o0, o1, hasInner, i0, i1);
+	}
+}
+
+//Solve the rotated ellipse equation for x on the scanline dy below the center.
+static bool ellipseSpan(float cx, float a, float b, float c, float s, float dy, int* x0, int* x1) {
+	if (a <= 0 || b <= 0) return false;
+	double ia = 1.0 / (a * a);
+	double ib = 1.0 / (b * b);
+	double qa = c * c * ia + s * s * ib;
+	double qb = 2 * dy * c * s * (ia - ib);
+	double qc = dy * dy * (s * s * ia + c * c * ib) - 1;
+	double disc = qb * qb - 4 * qa * qc;
+	if (disc < 0) return false;
+	double root = sqrt(disc);
+	float minX = cx + (float)((-qb - root) / (2 * qa));
+	float maxX = cx + (float)((-qb + root) / (2 * qa));
+	*x0 = (int)ceilf(minX - 0.5f);
+	*x1 = (int)ceilf(maxX - 0.5f);
+	return *x1 > *x0;
+}
+
+static void rasterEllipse(SR_Band* band, const SR_Command* cmd) {
+	float half = cmd->hasStroke ? cmd->strokeWeight / 2 : 0;
+	float oa = cmd->ellipse.a + half, ob = cmd->ellipse.b + half;
+	float ia = cmd->ellipse.a - half, ib = cmd->ellipse.b - half;
+	float c = cosf(cmd->ellipse.radians);
+	float s = sinf(cmd->ellipse.radians);
+
+	float extent = (oa > ob) ? oa : ob;
+	int y0 = (int)ceilf(cmd->ellipse.cy - extent - 0.5f);
+	int y1 = (int)ceilf(cmd->ellipse.cy + extent - 0.5f);
+	y0 = (y0 < band->y0) ? band->y0 : y0;
+	y1 = (y1 > band->y1) ? band->y1 : y1;
+
+	for (int y = y0; y < y1; y++) {
+		float dy = y + 0.5f - cmd->ellipse.cy;
+		int o0 = 0, o1 = 0, i0 = 0, i1 = 0;
+		bool hasOuter = ellipseSpan(cmd->ellipse.cx, oa, ob, c, s, dy, &o0, &o1);
+		bool hasInner = ellipseSpan(cmd->ellipse.cx, ia, ib, c, s, dy, &i0, &i1);
+		shadeRow(band, cmd, y, hasOuter, o0, o1, hasInner, i0, i1);
+	}
+}
+
+static void rasterImage(SR_Band* band, const SR_Command* cmd) {
+	uint32_t scratch[SR_SPAN_CHUNK];
+	const SR_Image* img = cmd->image.img;
+	float x = cmd->image.x, y = cmd->image.y, w = cmd->image.w, h = cmd->image.h;
+	if (w <= 0 || h <= 0) return;
+
+	float px[4] = { x, x + w, x + w, x };
+	float py[4] = { y, y, y + h, y + h };
+	float cx = x + w / 2, cy = y + h / 2;
+	float c = cosf(cmd->image.radians);
+	float s = sinf(cmd->image.radians);
+	rotatePoints(px, py, 4, cx, cy, (float)(cmd->image.radians * 180 / SR_PI));
+
+	float minY = py[0], maxY = py[0];
+	for (int i = 1; i < 4; i++) {
+		minY = (py[i] < minY) ? py[i] : minY;
+		maxY = (py[i] > maxY) ? py[i] : maxY;
+	}
+	int y0 = (int)ceilf(minY - 0.5f);
+	int y1 = (int)ceilf(maxY - 0.5f);
+	y0 = (y0 < band->y0) ? band->y0 : y0;
+	y1 = (y1 > band->y1) ? band->y1 : y1;
+
+	float du = (cmd->image.u1 - cmd->image.u0) / w;
+	float dv = (cmd->image.v1 - cmd->image.v0) / h;
+
+	for (int row = y0; row < y1; row++) {
+		int x0, x1;
+		if (!polygonSpan(px, py, 4, row + 0.5f, &x0, &x1)) continue;
+		clampSpan(&x0, &x1, band->target->w);
+		uint32_t* dst = band->target->pixels + (size_t)row * band->target->w;
+
+		for (int start = x0; start < x1; start += SR_SPAN_CHUNK) {
+			int n = (x1 - start < SR_SPAN_CHUNK) ? x1 - start : SR_SPAN_CHUNK;
+			if (cmd->image.radians == 0) {
+				//axis aligned: one texel row per scanline and a 16.16 fixed point step along u
+				int v = (int)(cmd->image.v0 + (row + 0.5f - y) * dv);
+				v = (v < 0) ? 0 : (v >= img->h) ? img->h - 1 : v;
+				const uint32_t* texels = img->pixels + (size_t)v * img->w;
+				int32_t u = (int32_t)((cmd->image.u0 + (start + 0.5f - x) * du) * 65536);
+				int32_t step = (int32_t)(du * 65536);
+				for (int i = 0; i < n; i++, u += step) {
+					int ui = u >> 16;
+					ui = (ui < 0) ? 0 : (ui >= img->w) ? img->w - 1 : ui;
+					scratch[i] = texels[ui];
+				}
+				if (cmd->image.alpha != 255) scaleSpan(scratch, n, cmd->image.alpha);
+				blendSpan(dst + start, scratch, n);
+				band->pixelsTouched += n;
+				continue;
+			}
+			for (int i = 0; i < n; i++) {
+				//map the pixel center back into the unrotated destination rect, then into texels
+				float dx = start + i + 0.5f - cx;
+				float dy = row + 0.5f - cy;
+				float lx = dx * c + dy * s + w / 2;
+				float ly = -dx * s + dy * c + h / 2;
+				int u = (int)(cmd->image.u0 + lx * du);
+				int v = (int)(cmd->image.v0 + ly * dv);
+				u = (u < 0) ? 0 : (u >= img->w) ? img->w - 1 : u;
+				v = (v < 0) ? 0 : (v >= img->h) ? img->h - 1 : v;
+				uint32_t texel = img->pixels[(size_t)v * img->w + u];
+				scratch[i] = (cmd->image.alpha == 255) ? texel : scalePixel(texel, cmd->image.alpha);
+			}
+			blendSpan(dst + start, scratch, n);
+			band->pixelsTouched += n;
+		}
+	}
+}
+
+static void rasterBand(SR_Band* band) {
+	SR_Target* t = band->target;
+	for (int i = 0; i < t->commandCount; i++) {
+		const SR_Command* cmd = &t->commands[i];
+		switch (cmd->type) {
+		case SR_CMD_CLEAR:
+			for (int y = band->y0; y < band->y1; y++) {
+				uint32_t* row = t->pixels + (size_t)y * t->w;
+				for (int x = 0; x < t->w; x++) row[x] = cmd->fill;
+			}
+			band->pixelsTouched += (uint64_t)(band->y1 - band->y0) * t->w;
+			break;
+		case SR_CMD_POLYGON:
+			rasterPolygon(band, cmd);
+			break;
+		case SR_CMD_ELLIPSE:
+			rasterEllipse(band, cmd);
+			break;
+		case SR_CMD_IMAGE:
+			rasterImage(band, cmd);
+			break;
+		}
+	}
+}
+
+#ifdef _WIN32
+static DWORD WINAPI bandThread(LPVOID param) {
+	rasterBand(param);
+	return 0;
+}
+#else
+static void* bandThread(void* param) {
+	rasterBand(param);
+	return NULL;
+}
+#endif
+
+void SR_Target_Flush(SR_Target* target) {
+	SR_Band bands[SR_MAX_THREADS];
+	int count = (target->threads > target->h) ? target->h : target->threads;
+	count = (count < 1) ? 1 : count;
+
+	for (int i = 0; i < count; i++) {
+		bands[i].target = target;
+		bands[i].y0 = target->h * i / count;
+		bands[i].y1 = target->h * (i + 1) / count;
+		bands[i].pixelsTouched = 0;
+	}
+
+	if (count == 1) {
+		rasterBand(&bands[0]);
+	} else {
+		//the calling thread takes the first tile itself
+#ifdef _WIN32
+		HANDLE workers[SR_MAX_THREADS];
+		for (int i = 1; i < count; i++) workers[i] = CreateThread(NULL, 0, bandThread, &bands[i], 0, NULL);
+		rasterBand(&bands[0]);
+		for (int i = 1; i < count; i++) {
+			if (workers[i]) {
+				WaitForSingleObject(workers[i], INFINITE);
+				CloseHandle(workers[i]);
+			} else {
+				rasterBand(&bands[i]);
+			}
+		}
+#else
+		pthread_t workers[SR_MAX_THREADS];
+		bool started[SR_MAX_THREADS] = { 0 };
+		for (int i = 1; i < count; i++) started[i] = pthread_create(&workers[i], NULL, bandThread, &bands[i]) == 0;
+		rasterBand(&bands[0]);
+		for (int i = 1; i < count; i++) {
+			if (started[i]) pthread_join(workers[i], NULL);
+			else rasterBand(&bands[i]);
+		}
+#endif
+	}
+
+	for (int i = 0; i < count; i++) target->stats.pixelsTouched += bands[i].pixelsTouched;
+	target->stats.commands += target->commandCount;
+	target->commandCount = 0;
+}
@@ -0,0 +1,93 @@
+//---------------------------------------------------------
+// file:	softraster.h
+//
+// brief:	CPU software rasterizer that mirrors the subset of
+//			CProcessing drawing calls used by main.c.
+//			It has no window or GPU dependency, so frames can be
+//			rendered headless (golden images, pixel profiling).
+//			HotAirRaster (raster_main.c) is that headless tool;
+//			the game itself still draws through CProcessing.
+//---------------------------------------------------------
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/***
+* Pixels are stored as premultiplied RGBA8, packed little-endian into a uint32_t
+* (r in the low byte, a in the high byte). Colors passed into the API are straight
+* (non-premultiplied) just like CP_Color, and get premultiplied on the way in.
+***/
+typedef struct {
+	unsigned char r, g, b, a;
+} SR_Color;
+
+typedef struct {
+	int w;
+	int h;
+	uint32_t* pixels; //premultiplied
+} SR_Image;
+
+typedef enum {
+	SR_POSITION_CORNER,
+	SR_POSITION_CENTER
+} SR_PositionMode;
+
+typedef enum {
+	SR_TEXT_ALIGN_LEFT,
+	SR_TEXT_ALIGN_CENTER,
+	SR_TEXT_ALIGN_RIGHT
+} SR_TextAlignH;
+
+typedef enum {
+	SR_TEXT_ALIGN_TOP,
+	SR_TEXT_ALIGN_MIDDLE,
+	SR_TEXT_ALIGN_BOTTOM
+} SR_TextAlignV;
+
+typedef struct {
+	uint64_t pixelsTouched; //every pixel written by a fill or blend since the last reset
+	uint64_t commands;
+} SR_Stats;
+
+typedef struct SR_Target SR_Target;
+
+SR_Target* SR_Target_Create(int w, int h);
+void SR_Target_Free(SR_Target** target);
+int SR_Target_GetWidth(SR_Target* target);
+int SR_Target_GetHeight(SR_Target* target);
+const uint32_t* SR_Target_GetPixels(SR_Target* target);
+
+//Draw calls are recorded and only rasterized on Flush.
+//With threads > 1 the frame is split into horizontal tiles and each worker replays
+//the whole command list clipped to its own tile, so no two workers touch the same pixel.
+void SR_Target_SetThreads(SR_Target* target, int threads);
+void SR_Target_Flush(SR_Target* target);
+
+SR_Stats SR_Target_GetStats(SR_Target* target);
+void SR_Target_ResetStats(SR_Target* target);
+
+//Render state (same meaning as the CP_Settings_* equivalents)
+void SR_Settings_Fill(SR_Target* target, SR_Color c);
+void SR_Settings_NoFill(SR_Target* target);
+void SR_Settings_Stroke(SR_Target* target, SR_Color c);
+void SR_Settings_NoStroke(SR_Target* target);
+void SR_Settings_StrokeWeight(SR_Target* target, float weight);
+void SR_Settings_ImageMode(SR_Target* target, SR_PositionMode mode);
+void SR_Settings_TextSize(SR_Target* target, float size);
+void SR_Settings_TextAlignment(SR_Target* target, SR_TextAlignH h, SR_TextAlignV v);
+
+//Drawing
+void SR_Graphics_ClearBackground(SR_Target* target, SR_Color c);
+void SR_Graphics_DrawRect(SR_Target* target, float x, float y, float w, float h);
+void SR_Graphics_DrawRectAdvanced(SR_Target* target, float x, float y, float w, float h, float degrees, float cornerRadius);
+void SR_Graphics_DrawEllipseAdvanced(SR_Target* target, float x, float y, float w, float h, float degrees);
+void SR_Graphics_DrawTriangleAdvanced(SR_Target* target, float x1, float y1, float x2, float y2, float x3, float y3, float degrees);
+void SR_Font_DrawText(SR_Target* target, const char* text, float x, float y);
+
+//Images
+SR_Image* SR_Image_CreateFromData(int w, int h, const unsigned char* rgba); //straight RGBA8, same as CP_Image_CreateFromData
+void SR_Image_Free(SR_Image** img);
+void SR_Image_Draw(SR_Target* target, SR_Image* img, float x, float y, float w, float h, int alpha);
+void SR_Image_DrawAdvanced(SR_Target* target, SR_Image* img, float x, float y, float w, float h, int alpha, float degrees);
+void SR_Image_DrawSubImage(SR_Target* target, SR_Image* img, float x, float y, float w, float h, float u0, float v0, float u1, float v1, int alpha);
@@ -0,0 +1,198 @@
+//---------------------------------------------------------
+// file:	telemetry.c
+//
+// brief:	Event queue and log writer thread (see telemetry.h).
+//---------------------------------------------------------
+
+#include "telemetry.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+typedef volatile LONG AtomicIndex;
+#define THREAD_RESULT DWORD WINAPI
+static LONG loadIndex(AtomicIndex* index) { return InterlockedCompareExchange(index, 0, 0); }
+static void storeIndex(AtomicIndex* index, LONG value) { InterlockedExchange(index, value); }
+static void sleepMs(int ms) { Sleep(ms); }
+static double nowSeconds() {
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (double)counter.QuadPart / frequency.QuadPart;
+}
+static void syncFile(FILE* file) { _commit(_fileno(file)); }
+#else
+#include <pthread.h>
+#include <unistd.h>
+typedef volatile long AtomicIndex;
+#define THREAD_RESULT void*
+static long loadIndex(AtomicIndex* index) { return __atomic_load_n(index, __ATOMIC_ACQUIRE); }
+static void storeIndex(AtomicIndex* index, long value) { __atomic_store_n(index, value, __ATOMIC_RELEASE); }
+static void sleepMs(int ms) {
+	struct timespec t = { ms / 1000, (ms % 1000) * 1000000L };
+	nanosleep(&t, NULL);
+}
+static double nowSeconds() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+static void syncFile(FILE* file) { fsync(fileno(file)); }
+#endif
+
+static const char MAGIC[4] = { 'H', 'A', 'T', 'L' };
+
+/***
+* Single producer (game thread), single consumer (writer thread) ring, like the audio queue.
+* Everything an emit reads or writes besides the slot itself sits in one cache line, and the
+* game keeps its own copy of where the writer was, only reading the shared head again when
+* that copy says the ring is full. So a normal emit touches two cache lines, and neither is
+* one the writer writes to.
+***/
+typedef struct {
+	struct {
+		AtomicIndex tail; //written by the game
+		long cachedHead; //the game's last look at head
+		bool open;
+		uint64_t emitted, dropped;
+	} game;
+	char padding[64];
+	AtomicIndex head; //written by the writer
+	TelemetryEvent slots[TELEMETRY_QUEUE_SIZE];
+} TelemetryQueue;
+
+static TelemetryQueue queue;
+static TelemetryEvent batch[TELEMETRY_QUEUE_SIZE];
+static FILE* logFile;
+static uint32_t session;
+static AtomicIndex writerRunning;
+static TelemetryStats stats; //the writer's half of the counters
+
+#ifdef _WIN32
+static HANDLE writerThread;
+#else
+static pthread_t writerThread;
+static bool writerStarted;
+#endif
+
+/* * * * * * *
+* WRITER    *
+* * * * * * */
+//Move everything queued into one block at the end of the log.
+static void writeBatch(void) {
+	long head = queue.head;
+	long tail = loadIndex(&queue.game.tail);
+	uint32_t count = 0;
+	while (head != tail) batch[count++] = queue.slots[head++ & (TELEMETRY_QUEUE_SIZE - 1)];
+	storeIndex(&queue.head, head);
+	if (!count) return;
+
+	TelemetryBlockHeader header;
+	memcpy(header.magic, MAGIC, sizeof MAGIC);
+	header.version = TELEMETRY_VERSION;
+	header.eventSize = sizeof(TelemetryEvent);
+	header.session = session;
+	header.count = count;
+	//blocks only ever go on the end, so a torn write can only cut the last one short
+	fwrite(&header, sizeof header, 1, logFile);
+	fwrite(batch, sizeof * batch, count, logFile);
+	stats.written += count;
+	stats.blocks++;
+}
+
+static void syncLog(void) {
+	fflush(logFile);
+	syncFile(logFile);
+	stats.syncs++;
+}
+
+static THREAD_RESULT writerMain(void* param) {
+	(void)param;
+	double lastSync = nowSeconds();
+	while (loadIndex(&writerRunning)) {
+		sleepMs(TELEMETRY_FLUSH_MS);
+		writeBatch();
+		if (nowSeconds() - lastSync >= TELEMETRY_SYNC_SECONDS) {
+			syncLog();
+			lastSync = nowSeconds();
+		}
+	}
+	return 0;
+}
+
+/* * * * * * *
+* PUBLIC API *
+* * * * * * */
+bool Telemetry_Init(const char* path) {
+	if (logFile) return true;
+#ifdef _WIN32
+	if (fopen_s(&logFile, path, "ab") != 0) logFile = NULL;
+#else
+	logFile = fopen(path, "ab");
+#endif
+	if (!logFile) return false;
+
+	session = (uint32_t)time(NULL);
+	memset(&queue.game, 0, sizeof queue.game);
+	queue.head = 0;
+	memset(&stats, 0, sizeof stats);
+	writerRunning = 1;
+#ifdef _WIN32
+	writerThread = CreateThread(NULL, 0, writerMain, NULL, 0, NULL);
+	bool started = writerThread != NULL;
+#else
+	bool started = writerStarted = pthread_create(&writerThread, NULL, writerMain, NULL) == 0;
+#endif
+	if (!started) {
+		writerRunning = 0;
+		fclose(logFile);
+		logFile = NULL;
+		return false;
+	}
+	queue.game.open = true;
+	return true;
+}
+
+void Telemetry_Shutdown(void) {
+	if (!logFile) return;
+	queue.game.open = false;
+	storeIndex(&writerRunning, 0);
+#ifdef _WIN32
+	WaitForSingleObject(writerThread, INFINITE);
+	CloseHandle(writerThread);
+	writerThread = NULL;
+#else
+	if (writerStarted) pthread_join(writerThread, NULL);
+	writerStarted = false;
+#endif
+	writeBatch();
+	syncLog();
+	fclose(logFile);
+	logFile = NULL;
+}
+
+bool Telemetry_Emit(const TelemetryEvent* event) {
+	if (!queue.game.open) return false;
+	long tail = queue.game.tail;
+	if (tail - queue.game.cachedHead >= TELEMETRY_QUEUE_SIZE) {
+		queue.game.cachedHead = loadIndex(&queue.head);
+		if (tail - queue.game.cachedHead >= TELEMETRY_QUEUE_SIZE) {
+			queue.game.dropped++; //full, drop the event rather than wait
+			return false;
+		}
+	}
+	queue.slots[tail & (TELEMETRY_QUEUE_SIZE - 1)] = *event;
+	storeIndex(&queue.game.tail, tail + 1); //publishes the slot
+	queue.game.emitted++;
+	return true;
+}
+
+void Telemetry_GetStats(TelemetryStats* out) {
+	*out = stats;
+	out->emitted = queue.game.emitted;
+	out->dropped = queue.game.dropped;
+}
@@ -0,0 +1,73 @@
+//---------------------------------------------------------
+// file:	telemetry.h
+//
+// brief:	Per-run analytics. Gameplay code emits fixed-size
+//			event records into a wait-free queue; a background
+//			thread appends them to a binary log in batches and
+//			forces the log to disk every few seconds. The
+//			HotAirTelemetry tool (telemetry_csv.c) turns logs
+//			into CSV.
+//---------------------------------------------------------
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TELEMETRY_QUEUE_SIZE 4096 //must be a power of two
+#define TELEMETRY_FLUSH_MS 100 //how often the writer drains the queue
+#define TELEMETRY_SYNC_SECONDS 5 //how often the log is forced to disk
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_PATH "telemetry.bin"
+
+typedef enum {
+	TELEMETRY_RUN_START = 1,
+	TELEMETRY_HIT, //a cloud took a life
+	TELEMETRY_DEATH, //a cloud took the last life
+	TELEMETRY_COIN,
+	TELEMETRY_SPEED, //sampled every SPEED_SAMPLE_SECONDS of game time
+	TELEMETRY_WORLD, //flew off the edge into a new world
+	TELEMETRY_RUN_END,
+	TELEMETRY_EVENT_COUNT
+} TelemetryEventType;
+
+//32 bytes, written to the log exactly as laid out here.
+typedef struct {
+	uint16_t type;
+	int16_t cloud; //img_id of the cloud for HIT and DEATH, -1 otherwise
+	uint32_t run; //counts up from 1 every time the game is started
+	float time; //seconds since the run started
+	float speed;
+	int32_t score;
+	int32_t lives;
+	float x, y; //globalX, globalY
+} TelemetryEvent;
+
+/***
+* The log is a sequence of blocks, one per writer batch, each a header followed by count
+* events. A crash can only ever leave the last block short, and readers drop it.
+***/
+typedef struct {
+	char magic[4]; //"HATL"
+	uint16_t version;
+	uint16_t eventSize; //sizeof(TelemetryEvent)
+	uint32_t session; //seconds since 1970 when the game started, to tell runs of different launches apart
+	uint32_t count;
+} TelemetryBlockHeader;
+
+typedef struct {
+	uint64_t emitted;
+	uint64_t dropped; //the queue was full; the writer fell more than TELEMETRY_QUEUE_SIZE events behind
+	uint64_t written;
+	uint64_t blocks;
+	uint64_t syncs;
+} TelemetryStats;
+
+//Open (or append to) the log and start the writer thread. Telemetry_Emit is a no-op until this succeeds.
+bool Telemetry_Init(const char* path);
+//Write out everything still queued, force it to disk and stop the writer.
+void Telemetry_Shutdown(void);
+
+//Queue an event from the game thread. Never blocks; returns false if the queue is full.
+bool Telemetry_Emit(const TelemetryEvent* event);
+
+void Telemetry_GetStats(TelemetryStats* stats);
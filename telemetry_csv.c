@@ -0,0 +1,190 @@
+//---------------------------------------------------------
+// file:	telemetry_csv.c
+//
+// brief:	Entry point of the offline telemetry tool. Reads
+//			one or more telemetry logs (see telemetry.h) and
+//			writes three CSV files next to each other:
+//			PREFIX_runs.csv		one row per run
+//			PREFIX_clouds.csv	hits and deaths per cloud img_id
+//			PREFIX_timeline.csv	every coin, hit and speed sample
+//
+// usage:	HotAirTelemetry [--out PREFIX] LOG...
+//---------------------------------------------------------
+
+#include "telemetry.h"
+#include "world.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+	uint32_t session;
+	uint32_t run;
+	float seconds;
+	int score;
+	int coins;
+	int hits;
+	int deathCloud; //-1 when the run didn't end in a cloud
+	int worlds;
+	float maxSpeed;
+	double speedSum;
+	int speedSamples;
+	bool ended;
+} RunSummary;
+
+typedef struct {
+	RunSummary* runs;
+	int count, capacity;
+	int cloudHits[CLOUD_TEXTURE_COUNT];
+	int cloudDeaths[CLOUD_TEXTURE_COUNT];
+	FILE* timeline;
+	uint64_t events;
+	int truncated; //logs whose last block was cut short
+} Aggregate;
+
+static const char* EVENT_NAMES[TELEMETRY_EVENT_COUNT] = { "", "run_start", "hit", "death", "coin", "speed", "world", "run_end" };
+
+static FILE* openFile(const char* path, const char* mode) {
+#ifdef _WIN32
+	FILE* file = NULL;
+	return (fopen_s(&file, path, mode) == 0) ? file : NULL;
+#else
+	return fopen(path, mode);
+#endif
+}
+
+static RunSummary* findRun(Aggregate* a, uint32_t session, uint32_t run) {
+	//events of a run come together, so the newest run is almost always the one wanted
+	for (int i = a->count - 1; i >= 0; i--) {
+		if (a->runs[i].session == session && a->runs[i].run == run) return &a->runs[i];
+	}
+	if (a->count == a->capacity) {
+		int capacity = a->capacity ? a->capacity * 2 : 64;
+		RunSummary* runs = realloc(a->runs, capacity * sizeof * runs);
+		if (!runs) return NULL;
+		a->runs = runs;
+		a->capacity = capacity;
+	}
+	RunSummary* r = &a->runs[a->count++];
+	memset(r, 0, sizeof * r);
+	r->session = session;
+	r->run = run;
+	r->deathCloud = -1;
+	return r;
+}
+
+static void addEvent(Aggregate* a, uint32_t session, const TelemetryEvent* e) {
+	if (e->type < TELEMETRY_RUN_START || e->type >= TELEMETRY_EVENT_COUNT) return;
+	RunSummary* r = findRun(a, session, e->run);
+	if (!r) return;
+	a->events++;
+
+	if (e->time > r->seconds) r->seconds = e->time;
+	r->score = e->score;
+	bool validCloud = e->cloud >= 0 && e->cloud < CLOUD_TEXTURE_COUNT;
+	switch (e->type) {
+	case TELEMETRY_HIT:
+		r->hits++;
+		if (validCloud) a->cloudHits[e->cloud]++;
+		break;
+	case TELEMETRY_DEATH:
+		r->hits++;
+		r->deathCloud = e->cloud;
+		if (validCloud) {
+			a->cloudHits[e->cloud]++;
+			a->cloudDeaths[e->cloud]++;
+		}
+		break;
+	case TELEMETRY_COIN:
+		r->coins++;
+		break;
+	case TELEMETRY_SPEED:
+		r->speedSum += e->speed;
+		r->speedSamples++;
+		break;
+	case TELEMETRY_WORLD:
+		r->worlds++;
+		break;
+	case TELEMETRY_RUN_END:
+		r->ended = true;
+		r->seconds = e->time;
+		break;
+	}
+	if (e->speed > r->maxSpeed) r->maxSpeed = e->speed;
+
+	if (e->type != TELEMETRY_RUN_START && e->type != TELEMETRY_RUN_END) {
+		fprintf(a->timeline, "%u,%u,%.3f,%s,%d,%.2f,%d,%d,%.1f,%.1f\n",
+			session, e->run, e->time, EVENT_NAMES[e->type], e->cloud, e->speed, e->score, e->lives, e->x, e->y);
+	}
+}
+
+static bool readLog(Aggregate* a, const char* path) {
+	FILE* file = openFile(path, "rb");
+	if (!file) return false;
+
+	TelemetryBlockHeader header;
+	TelemetryEvent* events = malloc(TELEMETRY_QUEUE_SIZE * sizeof * events);
+	while (events && fread(&header, sizeof header, 1, file) == 1) {
+		bool valid = !memcmp(header.magic, "HATL", 4) && header.version == TELEMETRY_VERSION
+			&& header.eventSize == sizeof(TelemetryEvent) && header.count <= TELEMETRY_QUEUE_SIZE;
+		if (!valid || fread(events, sizeof * events, header.count, file) != header.count) {
+			//a crash mid-write; everything before it is intact
+			a->truncated++;
+			break;
+		}
+		for (uint32_t i = 0; i < header.count; i++) addEvent(a, header.session, &events[i]);
+	}
+	free(events);
+	fclose(file);
+	return true;
+}
+
+static FILE* openOutput(const char* prefix, const char* name) {
+	char path[512];
+	snprintf(path, sizeof path, "%s_%s.csv", prefix, name);
+	FILE* file = openFile(path, "w");
+	if (!file) printf("could not write %s\n", path);
+	return file;
+}
+
+int main(int argc, char** argv) {
+	const char* prefix = "telemetry";
+	int firstLog = 1;
+	if (argc >= 3 && !strcmp(argv[1], "--out")) {
+		prefix = argv[2];
+		firstLog = 3;
+	}
+	if (firstLog >= argc) {
+		printf("usage: %s [--out PREFIX] LOG...\n", argv[0]);
+		return 1;
+	}
+
+	Aggregate a = { 0 };
+	a.timeline = openOutput(prefix, "timeline");
+	if (!a.timeline) return 1;
+	fprintf(a.timeline, "session,run,time,event,cloud,speed,score,lives,x,y\n");
+	for (int i = firstLog; i < argc; i++) {
+		if (!readLog(&a, argv[i])) printf("could not read %s\n", argv[i]);
+	}
+	fclose(a.timeline);
+
+	FILE* runs = openOutput(prefix, "runs");
+	if (!runs) return 1;
+	fprintf(runs, "session,run,seconds,score,coins,hits,death_cloud,worlds,max_speed,mean_speed,ended\n");
+	for (int i = 0; i < a.count; i++) {
+		RunSummary* r = &a.runs[i];
+		fprintf(runs, "%u,%u,%.2f,%d,%d,%d,%d,%d,%.2f,%.2f,%d\n", r->session, r->run, r->seconds, r->score, r->coins, r->hits,
+			r->deathCloud, r->worlds, r->maxSpeed, r->speedSamples ? r->speedSum / r->speedSamples : 0.0, r->ended);
+	}
+	fclose(runs);
+
+	FILE* clouds = openOutput(prefix, "clouds");
+	if (!clouds) return 1;
+	fprintf(clouds, "img_id,hits,deaths\n");
+	for (int i = 0; i < CLOUD_TEXTURE_COUNT; i++) fprintf(clouds, "%d,%d,%d\n", i, a.cloudHits[i], a.cloudDeaths[i]);
+	fclose(clouds);
+
+	printf("%llu events, %d runs%s\n", (unsigned long long)a.events, a.count, a.truncated ? ", ignored a truncated tail" : "");
+	free(a.runs);
+	return 0;
+}
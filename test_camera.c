@@ -0,0 +1,291 @@
+//---------------------------------------------------------
+// file:	test_camera.c
+//
+// brief:	The camera (camera.h) and the world layers of the
+//			draw list, on headless CProcessing: the transform,
+//			Camera_ToScreen and the view rect agree, shake
+//			stays within its amplitude and wears off, and
+//			Submit applies one matrix a frame however much is
+//			drawn through it. The benchmark records and submits
+//			a frame of clouds, coins and particles through the
+//			camera, with offsets added per object as before it,
+//			and with zoom and shake worked out per object.
+//---------------------------------------------------------
+
+#include "tests.h"
+#include "cprocessing_stub.h"
+#include "camera.h"
+#include "drawlist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#define VIEW_WIDTH 1920.0f
+#define VIEW_HEIGHT 1080.0f
+//a screen layer, the world layers, and another screen layer over them
+#define LAYER_BACK 0
+#define LAYER_WORLD_FIRST 1
+#define LAYER_WORLD_LAST 3
+#define LAYER_FRONT 4
+
+//Same xorshift as camera.c.
+static uint32_t nextRandom(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static float randomRange(uint32_t* state, float min, float max) {
+	return min + (max - min) * (float)(nextRandom(state) >> 8) / (float)(1 << 24);
+}
+
+static bool near(float a, float b, float tolerance) {
+	return fabsf(a - b) <= tolerance;
+}
+
+//Camera_ToScreen is the transform the draw list applies, point for point.
+static void testTransform() {
+	Camera camera;
+	Camera_Init(&camera, VIEW_WIDTH, VIEW_HEIGHT);
+	uint32_t rng = 7;
+	int mismatches = 0;
+	for (int frame = 0; frame < 200; frame++) {
+		if (frame % 50 == 0) Camera_Shake(&camera, 0.8f);
+		Camera_Update(&camera, randomRange(&rng, -3000, 3000), randomRange(&rng, -2000, 2000), randomRange(&rng, 0.25f, 3), 30);
+		DrawTransform transform = Camera_Transform(&camera);
+		for (int i = 0; i < 20; i++) {
+			float x = randomRange(&rng, -5000, 5000), y = randomRange(&rng, -3000, 3000);
+			float screenX, screenY;
+			Camera_ToScreen(&camera, x, y, &screenX, &screenY);
+			mismatches += !near(screenX, x * transform.scale + transform.offsetX, 0.01f) || !near(screenY, y * transform.scale + transform.offsetY, 0.01f);
+		}
+	}
+	CHECK(mismatches == 0);
+
+	//the view rect's corners are the screen's corners, and the draw list culls against the same rect
+	DrawList list;
+	if (!CHECK(DrawList_Init(&list, 64))) return;
+	Camera_Update(&camera, 1234, -567, 1.5f, 0);
+	CHECK(camera.shakeX == 0 && camera.shakeY == 0); //amplitude 0 never shakes
+	float left, top, width, height;
+	Camera_ViewRect(&camera, &left, &top, &width, &height);
+	float screenX, screenY;
+	Camera_ToScreen(&camera, left, top, &screenX, &screenY);
+	CHECK(near(screenX, 0, 0.01f) && near(screenY, 0, 0.01f));
+	Camera_ToScreen(&camera, left + width, top + height, &screenX, &screenY);
+	CHECK(near(screenX, VIEW_WIDTH, 0.01f) && near(screenY, VIEW_HEIGHT, 0.01f));
+
+	DrawList_Begin(&list, VIEW_WIDTH, VIEW_HEIGHT);
+	DrawList_SetCamera(&list, Camera_Transform(&camera), LAYER_WORLD_FIRST, LAYER_WORLD_LAST);
+	float worldLeft, worldTop, worldRight, worldBottom;
+	DrawList_ViewRect(&list, LAYER_WORLD_FIRST + 1, &worldLeft, &worldTop, &worldRight, &worldBottom);
+	CHECK(near(worldLeft, left, 0.01f) && near(worldTop, top, 0.01f));
+	CHECK(near(worldRight, left + width, 0.01f) && near(worldBottom, top + height, 0.01f));
+	DrawList_ViewRect(&list, LAYER_FRONT, &worldLeft, &worldTop, &worldRight, &worldBottom);
+	CHECK(worldLeft == 0 && worldTop == 0 && worldRight == VIEW_WIDTH && worldBottom == VIEW_HEIGHT);
+	DrawList_Free(&list);
+}
+
+static void testShake() {
+	Camera camera;
+	Camera_Init(&camera, VIEW_WIDTH, VIEW_HEIGHT);
+	Camera_Shake(&camera, 0.7f);
+	Camera_Shake(&camera, 0.7f);
+	CHECK(camera.trauma == 1); //hits add up, to full trauma at most
+
+	//the offset is never more than amplitude * trauma^2, and a full shake settles in 34 frames
+	float amplitude = 40;
+	int over = 0, moved = 0, frames = 0;
+	while (camera.trauma > 0 && frames < 100) {
+		float limit = amplitude * camera.trauma * camera.trauma;
+		Camera_Update(&camera, 0, 0, 1, amplitude);
+		over += fabsf(camera.shakeX) > limit || fabsf(camera.shakeY) > limit;
+		moved += camera.shakeX != 0 || camera.shakeY != 0;
+		frames++;
+	}
+	CHECK(over == 0);
+	CHECK(moved > frames / 2);
+	CHECK(frames == 34);
+	Camera_Update(&camera, 0, 0, 1, amplitude);
+	CHECK(camera.shakeX == 0 && camera.shakeY == 0);
+
+	//shake moves the whole view, not what it looks at
+	Camera_Shake(&camera, 1);
+	Camera_Update(&camera, 100, 200, 2, amplitude);
+	float left, top, width, height;
+	Camera_ViewRect(&camera, &left, &top, &width, &height);
+	CHECK(camera.x == 100 && camera.y == 200);
+	CHECK(near(left, 100 - VIEW_WIDTH / 4, 0.01f) && near(top, 200 - VIEW_HEIGHT / 4, 0.01f));
+	DrawTransform transform = Camera_Transform(&camera);
+	CHECK(near(transform.offsetX, VIEW_WIDTH / 2 + camera.shakeX - 200, 0.01f));
+}
+
+//One ApplyMatrix a frame around the world layers, whatever is drawn in them, and culling in world coordinates.
+static void testSubmit() {
+	DrawList list;
+	if (!CHECK(DrawList_Init(&list, 4096))) return;
+	Camera camera;
+	Camera_Init(&camera, VIEW_WIDTH, VIEW_HEIGHT);
+	Camera_Update(&camera, 5000, 3000, 0.5f, 0);
+	float left, top, width, height;
+	Camera_ViewRect(&camera, &left, &top, &width, &height);
+
+	DrawList_Begin(&list, VIEW_WIDTH, VIEW_HEIGHT);
+	DrawList_SetCamera(&list, Camera_Transform(&camera), LAYER_WORLD_FIRST, LAYER_WORLD_LAST);
+	DrawList_Rect(&list, LAYER_BACK, 0, 0, VIEW_WIDTH, VIEW_HEIGHT);
+	for (int i = 0; i < 1000; i++) {
+		DrawList_Rect(&list, LAYER_WORLD_FIRST + i % 3, left + i, top + i, 10, 10);
+	}
+	DrawList_Rect(&list, LAYER_WORLD_FIRST, left - 50, top, 10, 10); //left of the view
+	DrawList_Rect(&list, LAYER_WORLD_LAST, left, top + height + 1, 10, 10); //below it
+	DrawList_Rect(&list, LAYER_FRONT, left, top, 10, 10); //world coordinates on a screen layer, far off screen
+	DrawList_Rect(&list, LAYER_FRONT, 10, 10, 10, 10);
+	CHECK(list.stats.culled == 3);
+	CHECK(list.count == 1002);
+
+	Stub_Reset();
+	DrawList_Submit(&list);
+	CHECK(stubCounts.matrices == 1);
+	CHECK(stubCounts.draws == 1002);
+	CHECK(list.stats.drawCalls == 1002);
+
+	//no world draws, no matrix
+	DrawList_Begin(&list, VIEW_WIDTH, VIEW_HEIGHT);
+	DrawList_SetCamera(&list, Camera_Transform(&camera), LAYER_WORLD_FIRST, LAYER_WORLD_LAST);
+	DrawList_Rect(&list, LAYER_BACK, 0, 0, 10, 10);
+	DrawList_Rect(&list, LAYER_FRONT, 0, 0, 10, 10);
+	Stub_Reset();
+	DrawList_Submit(&list);
+	CHECK(stubCounts.matrices == 0);
+	CHECK(stubCounts.draws == 2);
+	DrawList_Free(&list);
+}
+
+void CameraTest_Run() {
+	testTransform();
+	testShake();
+	testSubmit();
+}
+
+/* * * * * * *
+* BENCHMARK *
+* * * * * * */
+#define BENCH_CLOUDS 20
+#define BENCH_COINS 40
+#define BENCH_PARTICLES 1200
+#define BENCH_COLORS 8 //Particles_Draw's color steps
+
+typedef enum {
+	THROUGH_CAMERA, //world positions, one matrix
+	PER_OBJECT_OFFSET, //globalX/Y added to every draw, no zoom or shake
+	PER_OBJECT_TRANSFORM //zoom and shake without the matrix: every draw through Camera_ToScreen
+} BenchMode;
+
+typedef struct {
+	float x, y, w, h;
+} BenchObject;
+
+typedef struct {
+	BenchObject clouds[BENCH_CLOUDS], coins[BENCH_COINS], particles[BENCH_PARTICLES];
+	CP_Image atlas, coin;
+	CP_Color colors[BENCH_COLORS];
+} BenchScene;
+
+static void benchPlace(BenchObject* objects, int count, uint32_t* rng, float size) {
+	for (int i = 0; i < count; i++) {
+		objects[i].x = randomRange(rng, -VIEW_WIDTH / 2, VIEW_WIDTH / 2);
+		objects[i].y = randomRange(rng, -VIEW_HEIGHT / 2, VIEW_HEIGHT / 2);
+		objects[i].w = objects[i].h = size * randomRange(rng, 0.5f, 1.5f);
+	}
+}
+
+static void benchPosition(BenchMode mode, const Camera* camera, const BenchObject* object, float* x, float* y, float* w, float* h) {
+	switch (mode) {
+	case THROUGH_CAMERA:
+		*x = object->x;
+		*y = object->y;
+		*w = object->w;
+		*h = object->h;
+		break;
+	case PER_OBJECT_OFFSET:
+		*x = object->x - camera->x + VIEW_WIDTH / 2;
+		*y = object->y - camera->y + VIEW_HEIGHT / 2;
+		*w = object->w;
+		*h = object->h;
+		break;
+	case PER_OBJECT_TRANSFORM:
+		Camera_ToScreen(camera, object->x, object->y, x, y);
+		*w = object->w * camera->zoom;
+		*h = object->h * camera->zoom;
+		break;
+	}
+}
+
+static void benchRecord(DrawList* list, const BenchScene* scene, Camera* camera, BenchMode mode, int frame) {
+	Camera_Update(camera, (float)(frame % 200), 0, (mode == PER_OBJECT_OFFSET) ? 1 : 1.25f, (mode == PER_OBJECT_OFFSET) ? 0 : 20);
+	DrawList_Begin(list, VIEW_WIDTH, VIEW_HEIGHT);
+	int first = (mode == THROUGH_CAMERA) ? LAYER_WORLD_FIRST : LAYER_FRONT;
+	if (mode == THROUGH_CAMERA) DrawList_SetCamera(list, Camera_Transform(camera), LAYER_WORLD_FIRST, LAYER_WORLD_LAST);
+	float x, y, w, h;
+	for (int i = 0; i < BENCH_CLOUDS; i++) {
+		benchPosition(mode, camera, &scene->clouds[i], &x, &y, &w, &h);
+		DrawList_SubImage(list, first, scene->atlas, x, y, w, h, 0, 0, 256, 128, 255);
+	}
+	for (int i = 0; i < BENCH_COINS; i++) {
+		benchPosition(mode, camera, &scene->coins[i], &x, &y, &w, &h);
+		DrawList_Image(list, first + 1, scene->coin, x, y, w, h, 255);
+	}
+	for (int i = 0; i < BENCH_PARTICLES; i++) {
+		benchPosition(mode, camera, &scene->particles[i], &x, &y, &w, &h);
+		DrawList_Fill(list, scene->colors[i % BENCH_COLORS]);
+		DrawList_Ellipse(list, first + 2, x, y, w, h, 0);
+	}
+}
+
+void CameraTest_Bench() {
+	DrawList list;
+	if (!DrawList_Init(&list, 4096)) return;
+	BenchScene scene;
+	uint32_t rng = 99;
+	benchPlace(scene.clouds, BENCH_CLOUDS, &rng, 200);
+	benchPlace(scene.coins, BENCH_COINS, &rng, 60);
+	benchPlace(scene.particles, BENCH_PARTICLES, &rng, 8);
+	static CP_Color pixels[64 * 64];
+	scene.atlas = CP_Image_CreateFromData(64, 64, (unsigned char*)pixels);
+	scene.coin = CP_Image_CreateFromData(16, 16, (unsigned char*)pixels);
+	for (int i = 0; i < BENCH_COLORS; i++) scene.colors[i] = CP_Color_Create(255, 255 - 30 * i, 0, 255 - 25 * i);
+
+	static const char* names[] = { "through the camera:    ", "offset per object:     ", "zoom+shake per object: " };
+	int frames = 20000;
+	Camera cameras[3];
+	double recording[3] = { 0 }, submitting[3] = { 0 };
+	for (int mode = THROUGH_CAMERA; mode <= PER_OBJECT_TRANSFORM; mode++) Camera_Init(&cameras[mode], VIEW_WIDTH, VIEW_HEIGHT);
+	//the three take turns a frame at a time, so the clock and the caches treat them alike
+	for (int frame = 0; frame < frames; frame++) {
+		for (int mode = THROUGH_CAMERA; mode <= PER_OBJECT_TRANSFORM; mode++) {
+			if (frame % 30 == 0) Camera_Shake(&cameras[mode], 1); //keep it shaking
+			double start = Test_Seconds();
+			benchRecord(&list, &scene, &cameras[mode], (BenchMode)mode, frame);
+			double recorded = Test_Seconds();
+			DrawList_Submit(&list);
+			recording[mode] += recorded - start;
+			submitting[mode] += Test_Seconds() - recorded;
+		}
+	}
+	printf("  %d clouds, %d coins, %d particles a frame, CProcessing calls stubbed:\n", BENCH_CLOUDS, BENCH_COINS, BENCH_PARTICLES);
+	for (int mode = THROUGH_CAMERA; mode <= PER_OBJECT_TRANSFORM; mode++) {
+		benchRecord(&list, &scene, &cameras[mode], (BenchMode)mode, frames);
+		Stub_Reset();
+		DrawList_Submit(&list);
+		printf("    %srecord %.2f us, submit %.2f us, %d CP calls (%d matrices)\n", names[mode], recording[mode] * 1e6 / frames, submitting[mode] * 1e6 / frames,
+			stubCounts.settings + stubCounts.draws, stubCounts.matrices);
+	}
+	printf("    saved per frame by the camera over per-object zoom and shake: %.2f us\n", (recording[PER_OBJECT_TRANSFORM] - recording[THROUGH_CAMERA]) * 1e6 / frames);
+	CP_Image_Free(&scene.atlas);
+	CP_Image_Free(&scene.coin);
+	DrawList_Free(&list);
+}
@@ -0,0 +1,277 @@
+//---------------------------------------------------------
+// file:	test_collectibles.c
+//
+// brief:	The grid-indexed coin store (collectibles.h)
+//			against a linear scan: rectangle, radius and
+//			k-nearest queries over random and clustered fields
+//			with collected items, empty cells and query points
+//			off the grid. The benchmark reports build and query
+//			costs from 10 to 100k coins.
+//---------------------------------------------------------
+
+#include "tests.h"
+#include "collectibles.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+//the game's world for a 1920x1080 window, and its COIN_CELL_SIZE
+#define WORLD_WEST -1920.0f
+#define WORLD_NORTH -1080.0f
+#define WORLD_WIDTH 5760.0f
+#define WORLD_HEIGHT 3240.0f
+#define CELL_SIZE 256.0f
+#define QUERIES 300
+#define MAX_ITEMS 5000
+#define BENCH_QUERIES 20000
+
+//Same xorshift as camera.c.
+static uint32_t nextRandom(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static float randomRange(uint32_t* state, float min, float max) {
+	return min + (max - min) * (float)(nextRandom(state) >> 8) / (float)(1 << 24);
+}
+
+static int byIndex(const void* a, const void* b) {
+	return *(const int*)a - *(const int*)b;
+}
+
+static int byDistance(const void* a, const void* b) {
+	float da = *(const float*)a, db = *(const float*)b;
+	return (da > db) - (da < db);
+}
+
+static float distanceSquared(const Collectible* item, float x, float y) {
+	float dx = item->x - x;
+	float dy = item->y - y;
+	return dx * dx + dy * dy;
+}
+
+//The same items, in any order.
+static bool sameSet(int* found, int foundCount, int* expected, int expectedCount) {
+	if (foundCount != expectedCount) return false;
+	qsort(found, foundCount, sizeof * found, byIndex);
+	qsort(expected, expectedCount, sizeof * expected, byIndex);
+	for (int i = 0; i < foundCount; i++) {
+		if (found[i] != expected[i]) return false;
+	}
+	return true;
+}
+
+/***
+* Fills the store: uniform over the world, or packed into a few clusters so most cells are
+* empty. A few items sit right on cell and world edges, and about a third get collected.
+***/
+static void fill(CollectibleStore* store, uint32_t* rng, int count, bool clustered) {
+	Collectibles_Clear(store);
+	float clusterX[4], clusterY[4];
+	for (int c = 0; c < 4; c++) {
+		clusterX[c] = randomRange(rng, WORLD_WEST, WORLD_WEST + WORLD_WIDTH);
+		clusterY[c] = randomRange(rng, WORLD_NORTH, WORLD_NORTH + WORLD_HEIGHT);
+	}
+	for (int i = 0; i < count; i++) {
+		float x, y;
+		if (i % 50 == 7) {
+			//exactly on a cell corner, or on the world's far edge
+			x = WORLD_WEST + CELL_SIZE * (float)(nextRandom(rng) % 23);
+			y = (i % 100 == 7) ? WORLD_NORTH + WORLD_HEIGHT : WORLD_NORTH + CELL_SIZE * (float)(nextRandom(rng) % 13);
+		} else if (clustered) {
+			int c = nextRandom(rng) % 4;
+			x = fminf(fmaxf(clusterX[c] + randomRange(rng, -150, 150), WORLD_WEST), WORLD_WEST + WORLD_WIDTH);
+			y = fminf(fmaxf(clusterY[c] + randomRange(rng, -150, 150), WORLD_NORTH), WORLD_NORTH + WORLD_HEIGHT);
+		} else {
+			x = randomRange(rng, WORLD_WEST, WORLD_WEST + WORLD_WIDTH);
+			y = randomRange(rng, WORLD_NORTH, WORLD_NORTH + WORLD_HEIGHT);
+		}
+		Collectibles_Add(store, x, y);
+	}
+	Collectibles_Build(store, WORLD_WEST, WORLD_NORTH, WORLD_WIDTH, WORLD_HEIGHT, CELL_SIZE);
+	for (int i = 0; i < count; i++) {
+		if (nextRandom(rng) % 3 == 0) Collectibles_Collect(store, i);
+	}
+}
+
+//Anywhere in the world, and now and then a little way off it.
+static void queryPoint(uint32_t* rng, float* x, float* y) {
+	*x = randomRange(rng, WORLD_WEST - 400, WORLD_WEST + WORLD_WIDTH + 400);
+	*y = randomRange(rng, WORLD_NORTH - 400, WORLD_NORTH + WORLD_HEIGHT + 400);
+}
+
+static void checkQueries(CollectibleStore* store, uint32_t* rng) {
+	static int found[MAX_ITEMS], expected[MAX_ITEMS];
+	static float expectedDistance[MAX_ITEMS];
+	int failures = 0;
+	for (int q = 0; q < QUERIES && failures < 5; q++) {
+		float x, y;
+		queryPoint(rng, &x, &y);
+
+		//rectangle
+		float w = randomRange(rng, 0, 1500), h = randomRange(rng, 0, 900);
+		int count = Collectibles_QueryRect(store, x, y, x + w, y + h, found, MAX_ITEMS);
+		int expectedCount = 0;
+		for (int i = 0; i < store->count; i++) {
+			const Collectible* item = &store->items[i];
+			if (!item->collected && item->x >= x && item->x <= x + w && item->y >= y && item->y <= y + h) expected[expectedCount++] = i;
+		}
+		if (!CHECK(sameSet(found, count, expected, expectedCount))) {
+			printf("\trect (%.1f, %.1f) %.1fx%.1f: %d found, %d expected\n", x, y, w, h, count, expectedCount);
+			failures++;
+		}
+
+		//radius
+		float radius = randomRange(rng, 1, 600);
+		count = Collectibles_QueryRadius(store, x, y, radius, found, MAX_ITEMS);
+		expectedCount = 0;
+		for (int i = 0; i < store->count; i++) {
+			if (!store->items[i].collected && distanceSquared(&store->items[i], x, y) < radius * radius) expected[expectedCount++] = i;
+		}
+		if (!CHECK(sameSet(found, count, expected, expectedCount))) {
+			printf("\tradius %.1f at (%.1f, %.1f): %d found, %d expected\n", radius, x, y, count, expectedCount);
+			failures++;
+		}
+
+		//k nearest: the same distances as the k smallest of a full scan, closest first
+		int k = (q % 4 == 0) ? 1 : (q % 4 == 1) ? 3 : (q % 4 == 2) ? 8 : 64;
+		count = Collectibles_Nearest(store, x, y, k, found);
+		expectedCount = 0;
+		for (int i = 0; i < store->count; i++) {
+			if (!store->items[i].collected) expectedDistance[expectedCount++] = distanceSquared(&store->items[i], x, y);
+		}
+		qsort(expectedDistance, expectedCount, sizeof * expectedDistance, byDistance);
+		bool same = count == ((expectedCount < k) ? expectedCount : k);
+		for (int i = 0; same && i < count; i++) {
+			same = !store->items[found[i]].collected && distanceSquared(&store->items[found[i]], x, y) == expectedDistance[i];
+		}
+		if (!CHECK(same)) {
+			printf("\t%d nearest to (%.1f, %.1f): %d found of %d remaining\n", k, x, y, count, expectedCount);
+			failures++;
+		}
+	}
+}
+
+static void testAgainstScan() {
+	CollectibleStore store;
+	if (!CHECK(Collectibles_Init(&store, MAX_ITEMS))) return;
+	uint32_t rng = 0x9E3779B9u;
+	const int counts[] = { 0, 1, 2, 40, 300, MAX_ITEMS };
+	for (int c = 0; c < 6; c++) {
+		fill(&store, &rng, counts[c], false);
+		checkQueries(&store, &rng);
+		fill(&store, &rng, counts[c], true);
+		checkQueries(&store, &rng);
+	}
+	Collectibles_Free(&store);
+}
+
+static void testEdgeCases() {
+	CollectibleStore store;
+	if (!CHECK(Collectibles_Init(&store, 8))) return;
+	int out[8];
+
+	//queries before anything is built
+	CHECK(Collectibles_Nearest(&store, 0, 0, 3, out) == 0);
+	CHECK(Collectibles_QueryRadius(&store, 0, 0, 100, out, 8) == 0);
+
+	for (int i = 0; i < 8; i++) CHECK(Collectibles_Add(&store, 100.0f * i, 50) == i);
+	CHECK(Collectibles_Add(&store, 0, 0) == -1); //full
+	CHECK(Collectibles_Build(&store, WORLD_WEST, WORLD_NORTH, WORLD_WIDTH, WORLD_HEIGHT, CELL_SIZE));
+	CHECK(store.remaining == 8);
+
+	//maxOut stops the query, what it found is still right
+	int count = Collectibles_QueryRect(&store, -10, 0, 1000, 100, out, 3);
+	CHECK(count == 3);
+	for (int i = 0; i < count; i++) CHECK(out[i] >= 0 && out[i] < 8);
+
+	Collectibles_Collect(&store, 2);
+	Collectibles_Collect(&store, 2); //twice counts once
+	Collectibles_Collect(&store, 99);
+	CHECK(store.remaining == 7);
+	CHECK(Collectibles_Nearest(&store, 210, 50, 1, out) == 1 && out[0] == 3);
+	CHECK(Collectibles_Nearest(&store, 190, 50, 2, out) == 2 && out[0] == 1 && out[1] == 3);
+	CHECK(Collectibles_QueryRadius(&store, 200, 50, 50, out, 8) == 0);
+
+	for (int i = 0; i < 8; i++) Collectibles_Collect(&store, i);
+	CHECK(store.remaining == 0);
+	CHECK(Collectibles_Nearest(&store, 0, 0, 3, out) == 0);
+	CHECK(Collectibles_QueryRect(&store, WORLD_WEST, WORLD_NORTH, 0, 0, out, 8) == 0);
+
+	Collectibles_Clear(&store);
+	CHECK(store.count == 0 && store.remaining == 0);
+	Collectibles_Free(&store);
+}
+
+void CollectiblesTest_Run() {
+	testAgainstScan();
+	testEdgeCases();
+}
+
+//Per query, over BENCH_QUERIES points, with nothing collected.
+void CollectiblesTest_Bench() {
+	CollectibleStore store;
+	if (!Collectibles_Init(&store, 100000)) return;
+	uint32_t rng = 42;
+	float* xs = malloc(BENCH_QUERIES * sizeof * xs);
+	float* ys = malloc(BENCH_QUERIES * sizeof * ys);
+	if (!xs || !ys) {
+		free(xs);
+		free(ys);
+		Collectibles_Free(&store);
+		return;
+	}
+	for (int q = 0; q < BENCH_QUERIES; q++) {
+		xs[q] = randomRange(&rng, WORLD_WEST, WORLD_WEST + WORLD_WIDTH);
+		ys[q] = randomRange(&rng, WORLD_NORTH, WORLD_NORTH + WORLD_HEIGHT);
+	}
+
+	printf("  %8s %10s %12s %12s %16s\n", "coins", "build ms", "nearest-3 us", "radius-75 us", "scan nearest us");
+	const int counts[] = { 10, 100, 1000, 10000, 100000 };
+	int out[64];
+	volatile int sink = 0;
+	for (int c = 0; c < 5; c++) {
+		Collectibles_Clear(&store);
+		for (int i = 0; i < counts[c]; i++) {
+			Collectibles_Add(&store, randomRange(&rng, WORLD_WEST, WORLD_WEST + WORLD_WIDTH), randomRange(&rng, WORLD_NORTH, WORLD_NORTH + WORLD_HEIGHT));
+		}
+		double start = Test_Seconds();
+		int builds = 20;
+		for (int b = 0; b < builds; b++) Collectibles_Build(&store, WORLD_WEST, WORLD_NORTH, WORLD_WIDTH, WORLD_HEIGHT, CELL_SIZE);
+		double buildMs = (Test_Seconds() - start) * 1000 / builds;
+
+		start = Test_Seconds();
+		for (int q = 0; q < BENCH_QUERIES; q++) sink += Collectibles_Nearest(&store, xs[q], ys[q], 3, out);
+		double nearestUs = (Test_Seconds() - start) * 1e6 / BENCH_QUERIES;
+
+		start = Test_Seconds();
+		for (int q = 0; q < BENCH_QUERIES; q++) sink += Collectibles_QueryRadius(&store, xs[q], ys[q], 75, out, 64);
+		double radiusUs = (Test_Seconds() - start) * 1e6 / BENCH_QUERIES;
+
+		//what Nearest replaces: a pass over every coin for the closest
+		int scans = (counts[c] > 1000) ? BENCH_QUERIES / 20 : BENCH_QUERIES;
+		start = Test_Seconds();
+		for (int q = 0; q < scans; q++) {
+			int best = -1;
+			float bestDistance = INFINITY;
+			for (int i = 0; i < store.count; i++) {
+				float d = distanceSquared(&store.items[i], xs[q], ys[q]);
+				if (!store.items[i].collected && d < bestDistance) {
+					bestDistance = d;
+					best = i;
+				}
+			}
+			sink += best;
+		}
+		double scanUs = (Test_Seconds() - start) * 1e6 / scans;
+		printf("  %8d %10.3f %12.2f %12.2f %16.2f\n", counts[c], buildMs, nearestUs, radiusUs, scanUs);
+	}
+	free(xs);
+	free(ys);
+	Collectibles_Free(&store);
+}
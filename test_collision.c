@@ -0,0 +1,72 @@
+//---------------------------------------------------------
+// file:	test_collision.c
+//
+// brief:	Swept cloud collision (collision.h) against a
+//			brute force walk along the same motion.
+//---------------------------------------------------------
+
+#include "tests.h"
+#include "collision.h"
+#include <math.h>
+#include <stdio.h>
+
+#define CLOUD_MARGIN 35.0f //the margin game_update and the sim use
+#define BRUTE_STEP 0.25f //pixels between brute force samples
+
+//Fraction of the motion at which a fine walk first lands in the cloud, or -1.
+static float bruteForce(float startX, float startY, float endX, float endY, float a, float b) {
+	float dx = endX - startX, dy = endY - startY;
+	float length = sqrtf(dx * dx + dy * dy);
+	int steps = (int)(length / BRUTE_STEP) + 1;
+	for (int i = 0; i <= steps; i++) {
+		float t = (float)i / steps;
+		if (Collision_PointInCloud(startX + dx * t, startY + dy * t, a, b, CLOUD_MARGIN)) return t;
+	}
+	return -1;
+}
+
+//The sweep has to agree with the walk on whether it hits, and may only be early or late
+//by about its own 2px minimum step.
+static void checkAgainstBruteForce(float startX, float startY, float endX, float endY, float a, float b) {
+	float swept = Collision_SweepCloud(startX, startY, endX, endY, a, b, CLOUD_MARGIN);
+	float brute = bruteForce(startX, startY, endX, endY, a, b);
+	float dx = endX - startX, dy = endY - startY;
+	float slack = 3 / sqrtf(dx * dx + dy * dy);
+	if (!CHECK((swept >= 0) == (brute >= 0))) {
+		printf("\t(%.1f, %.1f) to (%.1f, %.1f) against %.0fx%.0f: swept %f, brute force %f\n", startX, startY, endX, endY, a, b, swept, brute);
+		return;
+	}
+	if (brute >= 0) CHECK(fabsf(swept - brute) <= slack);
+}
+
+void CollisionTest_Run() {
+	//Long grazing motions along the flat side of a wide cloud. The sweep used to give up
+	//after 64 steps and only test the end point, which missed all of these.
+	for (float y = 90; y <= 96; y += 0.5f) {
+		checkAgainstBruteForce(-3000, y, 3000, y, 400, 60);
+		checkAgainstBruteForce(3000, -y, -3000, -y, 400, 60);
+	}
+	for (float x = 90; x <= 96; x += 0.5f) checkAgainstBruteForce(x, -3000, x, 3000, 60, 400);
+	CHECK(Collision_SweepCloud(-3000, 94, 3000, 94, 400, 60, CLOUD_MARGIN) >= 0);
+
+	//a fast motion straight through the middle hits where it enters
+	float t = Collision_SweepCloud(-1000, 0, 1000, 0, 100, 80, CLOUD_MARGIN);
+	CHECK(t >= 0 && fabsf(-1000 + 2000 * t + 135) <= 3);
+
+	//starting inside hits at once, and a motion that stops short misses
+	CHECK(Collision_SweepCloud(0, 0, 500, 500, 100, 80, CLOUD_MARGIN) == 0);
+	CHECK(Collision_SweepCloud(-1000, 0, -200, 0, 100, 80, CLOUD_MARGIN) < 0);
+	checkAgainstBruteForce(-1000, 0, -200, 0, 100, 80);
+
+	//standing still
+	CHECK(Collision_SweepCloud(50, 0, 50, 0, 100, 80, CLOUD_MARGIN) == 0);
+	CHECK(Collision_SweepCloud(500, 0, 500, 0, 100, 80, CLOUD_MARGIN) < 0);
+
+	//diagonal motions across clouds of every proportion
+	for (int i = 0; i < 40; i++) {
+		float a = 40.0f + 20 * (i % 7);
+		float b = 40.0f + 25 * (i % 5);
+		float offset = -250.0f + 12.5f * i;
+		checkAgainstBruteForce(-800, offset - 400, 800, offset + 400, a, b);
+	}
+}
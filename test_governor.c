@@ -0,0 +1,226 @@
+//---------------------------------------------------------
+// file:	test_governor.c
+//
+// brief:	The frame budget governor (governor.h) fed
+//			synthetic frame times: a weak laptop under vsync,
+//			whose work shrinks with each quality level. It must
+//			settle instead of flipping between levels, never
+//			step back up sooner than raiseWait after a change,
+//			and shrug off single hitches. The benchmark runs
+//			ten minutes of that laptop against a plain
+//			controller with the same thresholds.
+//---------------------------------------------------------
+
+#include "tests.h"
+#include "governor.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define BUDGET 0.017f //tuning's frameBudget
+#define VSYNC (1 / 60.0f)
+#define TEN_MINUTES (10 * 60 * 60)
+#define SCENE_FRAMES (30 * 60) //how long a scene lasts in the alternating trace
+
+//Same xorshift as camera.c.
+static uint32_t nextRandom(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static float randomRange(uint32_t* state, float min, float max) {
+	return min + (max - min) * (float)(nextRandom(state) >> 8) / (float)(1 << 24);
+}
+
+/***
+* A weak laptop in fullscreen: 24 ms of work at full quality down to 10 ms at the lowest,
+* +-3 ms of noise, and vsync rounding every frame up to a whole number of refreshes. light
+* scales the work, for scenes with less on screen.
+***/
+typedef struct {
+	uint32_t rng;
+	int missed; //frames that took more than one refresh
+} Laptop;
+
+static float laptopFrame(Laptop* laptop, int level, float light) {
+	float work = (0.024f - 0.014f * level / (GOVERNOR_LEVELS - 1)) * light + randomRange(&laptop->rng, -0.003f, 0.003f);
+	float refreshes = fmaxf(ceilf(work / VSYNC), 1);
+	laptop->missed += refreshes > 1;
+	return refreshes * VSYNC;
+}
+
+//What a trace did to the governor.
+typedef struct {
+	int changes;
+	int raisesTooSoon; //steps up fewer than raiseWait frames after the change before
+	int flipFlops; //a step one way, then back the other way within raiseWait
+	int finalLevel;
+	int missed;
+} TraceResult;
+
+//Ten minutes of the laptop, steady, or alternating between a heavy and a light scene.
+static TraceResult runTrace(bool alternating, uint32_t seed) {
+	Governor governor;
+	Governor_Init(&governor, BUDGET);
+	Laptop laptop = { seed, 0 };
+	TraceResult result = { 0 };
+	GovernorDecision last = GOVERNOR_HOLD;
+	int lastChange = 0;
+	for (int frame = 1; frame <= TEN_MINUTES; frame++) {
+		float light = (alternating && (frame / SCENE_FRAMES) % 2) ? 0.6f : 1;
+		int raiseWait = governor.raiseWait;
+		GovernorDecision decision = Governor_Frame(&governor, laptopFrame(&laptop, governor.level, light));
+		if (decision == GOVERNOR_HOLD) continue;
+		int since = frame - lastChange;
+		result.changes++;
+		result.raisesTooSoon += decision == GOVERNOR_RAISE && since < raiseWait;
+		//a probe that didn't hold is taken back at once, what must not happen is the reverse
+		result.flipFlops += decision == GOVERNOR_RAISE && last == GOVERNOR_LOWER && since < raiseWait;
+		last = decision;
+		lastChange = frame;
+	}
+	result.finalLevel = governor.level;
+	result.missed = laptop.missed;
+	return result;
+}
+
+static void testSteady() {
+	for (uint32_t seed = 1; seed <= 5; seed++) {
+		TraceResult result = runTrace(false, seed * 0x9E3779B9u);
+		//down to the level the laptop holds, then a probe up every so often with the wait doubling
+		CHECK(result.changes <= 40);
+		CHECK(result.raisesTooSoon == 0);
+		CHECK(result.flipFlops == 0);
+		CHECK(result.finalLevel >= 3 && result.finalLevel <= 5);
+		CHECK(result.missed < TEN_MINUTES / 50);
+	}
+}
+
+static void testAlternating() {
+	for (uint32_t seed = 1; seed <= 5; seed++) {
+		TraceResult result = runTrace(true, seed * 0x85EBCA6Bu);
+		//20 scenes: a few steps each way per scene at most
+		CHECK(result.changes <= 20 * 8);
+		CHECK(result.raisesTooSoon == 0);
+		CHECK(result.flipFlops == 0);
+	}
+}
+
+//A probe up that doesn't hold doubles the wait before the next one.
+static void testProbe() {
+	Governor governor;
+	Governor_Init(&governor, BUDGET);
+	int frame = 0;
+	while (governor.level == 0 && frame < 1000) {
+		Governor_Frame(&governor, 2 * VSYNC);
+		frame++;
+	}
+	if (!CHECK(governor.level == 1)) return;
+	int wait = governor.raiseWait;
+	frame = 0;
+	while (governor.level == 1 && frame < 1000) {
+		Governor_Frame(&governor, VSYNC);
+		frame++;
+	}
+	CHECK(governor.level == 0 && governor.lastDecision == GOVERNOR_RAISE);
+	CHECK(frame >= wait);
+	while (governor.level == 0) Governor_Frame(&governor, 2 * VSYNC);
+	CHECK(governor.raiseWait == 2 * wait);
+
+	//held past the probe, it's back to the short wait
+	frame = 0;
+	while (governor.level == 1 && frame < 2000) {
+		Governor_Frame(&governor, VSYNC);
+		frame++;
+	}
+	CHECK(frame >= 2 * wait);
+	int changes = 0;
+	for (int i = 0; i < 1000; i++) changes += Governor_Frame(&governor, VSYNC) != GOVERNOR_HOLD;
+	CHECK(changes == 0);
+	CHECK(governor.level == 0 && governor.raiseWait == wait);
+}
+
+static void testHitches() {
+	Governor governor;
+	Governor_Init(&governor, BUDGET);
+	//a load or a dragged window every second is not the scene being too slow
+	int changes = 0;
+	for (int frame = 0; frame < TEN_MINUTES; frame++) changes += Governor_Frame(&governor, (frame % 60) ? VSYNC : 0.5f) != GOVERNOR_HOLD;
+	CHECK(changes == 0);
+	CHECK(governor.level == 0);
+
+	//no budget, nothing is judged
+	Governor_Init(&governor, 0);
+	for (int frame = 0; frame < 1000; frame++) changes += Governor_Frame(&governor, 1) != GOVERNOR_HOLD;
+	CHECK(changes == 0);
+	CHECK(governor.level == 0);
+}
+
+//Every step turns something down and nothing back up.
+static void testLevers() {
+	Governor governor;
+	Governor_Init(&governor, BUDGET);
+	QualityLevers last = Governor_Levers(&governor);
+	CHECK(last.sceneryDropped == 0 && last.effects == 1 && last.fullFlash && last.hudDetail && last.cloudLevel == 0);
+	for (int level = 1; level < GOVERNOR_LEVELS; level++) {
+		governor.level = level;
+		QualityLevers levers = Governor_Levers(&governor);
+		CHECK(levers.sceneryDropped >= last.sceneryDropped && levers.effects <= last.effects && levers.cloudLevel >= last.cloudLevel);
+		CHECK(levers.fullFlash <= last.fullFlash && levers.hudDetail <= last.hudDetail);
+		CHECK(memcmp(&levers, &last, sizeof levers) != 0);
+		last = levers;
+	}
+}
+
+void GovernorTest_Run() {
+	testSteady();
+	testAlternating();
+	testProbe();
+	testHitches();
+	testLevers();
+}
+
+/***
+* What the governor is measured against: the same thresholds judged on every frame, with no
+* window, settling or wait.
+***/
+static TraceResult runPlain(bool alternating, uint32_t seed) {
+	Laptop laptop = { seed, 0 };
+	TraceResult result = { 0 };
+	int level = 0;
+	for (int frame = 1; frame <= TEN_MINUTES; frame++) {
+		float light = (alternating && (frame / SCENE_FRAMES) % 2) ? 0.6f : 1;
+		float seconds = laptopFrame(&laptop, level, light);
+		if (seconds > BUDGET * 1.2f && level < GOVERNOR_LEVELS - 1) level++, result.changes++;
+		else if (seconds < BUDGET * 1.05f && level > 0) level--, result.changes++;
+	}
+	result.finalLevel = level;
+	result.missed = laptop.missed;
+	return result;
+}
+
+void GovernorTest_Bench() {
+	printf("  ten minutes of a weak laptop at 60 Hz vsync, %.0f ms budget:\n", BUDGET * 1000);
+	for (int alternating = 0; alternating < 2; alternating++) {
+		TraceResult plain = runPlain(alternating, 42);
+		TraceResult governed = runTrace(alternating, 42);
+		printf("    %s\n", alternating ? "heavy and light scenes, 30 s each:" : "steady load:");
+		printf("      plain controller: %5d changes, %4.1f%% vsyncs missed\n", plain.changes, 100.0 * plain.missed / TEN_MINUTES);
+		printf("      governor:         %5d changes, %4.1f%% vsyncs missed, level %d at the end\n", governed.changes, 100.0 * governed.missed / TEN_MINUTES, governed.finalLevel);
+	}
+
+	Governor governor;
+	Governor_Init(&governor, BUDGET);
+	Laptop laptop = { 7, 0 };
+	int frames = 1000000;
+	float times[256];
+	for (int i = 0; i < 256; i++) times[i] = laptopFrame(&laptop, 3, 1);
+	double start = Test_Seconds();
+	for (int i = 0; i < frames; i++) Governor_Frame(&governor, times[i & 255]);
+	printf("    Governor_Frame: %.0f ns\n", (Test_Seconds() - start) * 1e9 / frames);
+}
@@ -0,0 +1,182 @@
+//---------------------------------------------------------
+// file:	test_minimap.c
+//
+// brief:	The minimap (minimap.h) on headless CProcessing:
+//			collecting a coin puts back exactly the clouds it
+//			covered, the image is uploaded only on frames that
+//			changed it, and clouds and coins at the edges stay
+//			inside the image. The benchmark times a world of
+//			10k clouds: building it once, a steady frame, a
+//			frame with a pickup, and redrawing every cloud.
+//---------------------------------------------------------
+
+#include "tests.h"
+#include "cprocessing_stub.h"
+#include "minimap.h"
+#include "world.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+//the game's Bounds for a 1920x1080 window, and its MINIMAP_WIDTH
+#define WORLD_WEST -1920.0f
+#define WORLD_NORTH -1080.0f
+#define WORLD_WIDTH 5760.0f
+#define WORLD_HEIGHT 3240.0f
+#define MAP_WIDTH 240
+#define COINS 40
+
+//Same xorshift as camera.c.
+static uint32_t nextRandom(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static float randomRange(uint32_t* state, float min, float max) {
+	return min + (max - min) * (float)(nextRandom(state) >> 8) / (float)(1 << 24);
+}
+
+static bool samePixels(const CP_Color* a, const CP_Color* b, int count) {
+	return !memcmp(a, b, count * sizeof * a);
+}
+
+//A world like buildMinimap's: clouds from the atlas at their sizes, then coins.
+static void buildWorld(Minimap* map, uint32_t* rng, int clouds, float* coinX, float* coinY) {
+	Minimap_BeginWorld(map, WORLD_WEST, WORLD_NORTH, WORLD_WIDTH, WORLD_HEIGHT);
+	for (int i = 0; i < clouds; i++) {
+		TextureRect t = CLOUD_TEXTURE_POSITIONS[nextRandom(rng) % CLOUD_TEXTURE_COUNT];
+		float size = randomRange(rng, 0.5f, 1.5f);
+		Minimap_AddCloud(map, randomRange(rng, WORLD_WEST - 200, WORLD_WEST + WORLD_WIDTH), randomRange(rng, WORLD_NORTH - 100, WORLD_NORTH + WORLD_HEIGHT), size * t.w, size * t.h);
+	}
+	for (int i = 0; i < COINS; i++) {
+		coinX[i] = randomRange(rng, WORLD_WEST, WORLD_WEST + WORLD_WIDTH);
+		coinY[i] = randomRange(rng, WORLD_NORTH, WORLD_NORTH + WORLD_HEIGHT);
+		Minimap_AddCoin(map, coinX[i], coinY[i]);
+	}
+}
+
+static void testCoins() {
+	Minimap map;
+	if (!CHECK(Minimap_Init(&map, MAP_WIDTH, WORLD_WIDTH, WORLD_HEIGHT))) return;
+	CHECK(map.height == 135);
+	int pixels = map.width * map.height;
+	uint32_t rng = 0x9E3779B9u;
+	float coinX[COINS], coinY[COINS];
+	buildWorld(&map, &rng, 20, coinX, coinY);
+	CHECK(!samePixels(map.pixels, map.clouds, pixels)); //the coins are on it
+
+	//collected one by one, in another order, until only the clouds are left
+	for (int i = 0; i < COINS; i++) {
+		int coin = (i * 7) % COINS;
+		Minimap_RemoveCoin(&map, coinX[coin], coinY[coin]);
+	}
+	CHECK(samePixels(map.pixels, map.clouds, pixels));
+
+	//at the very edges a coin is cut off, not written past the image
+	float edges[][2] = { { WORLD_WEST, WORLD_NORTH }, { WORLD_WEST + WORLD_WIDTH, WORLD_NORTH + WORLD_HEIGHT }, { WORLD_WEST - 50, 0 }, { 0, WORLD_NORTH + WORLD_HEIGHT + 50 } };
+	for (int i = 0; i < 4; i++) Minimap_AddCoin(&map, edges[i][0], edges[i][1]);
+	CHECK(!samePixels(map.pixels, map.clouds, pixels));
+	CP_Color gold = CP_Color_Create(255, 215, 0, 255);
+	CHECK(samePixels(map.pixels + pixels - 1, &gold, 1)); //the far corner
+	for (int i = 0; i < 4; i++) Minimap_RemoveCoin(&map, edges[i][0], edges[i][1]);
+	CHECK(samePixels(map.pixels, map.clouds, pixels));
+	Minimap_Free(&map);
+}
+
+static void testClouds() {
+	Minimap map;
+	if (!CHECK(Minimap_Init(&map, MAP_WIDTH, WORLD_WIDTH, WORLD_HEIGHT))) return;
+	int pixels = map.width * map.height;
+	Minimap_BeginWorld(&map, WORLD_WEST, WORLD_NORTH, WORLD_WIDTH, WORLD_HEIGHT);
+	CP_Color background = map.clouds[0];
+
+	//one far smaller than a pixel still shows
+	Minimap_AddCloud(&map, 0, 0, 2, 2);
+	int covered = 0;
+	for (int i = 0; i < pixels; i++) covered += !samePixels(&map.clouds[i], &background, 1);
+	CHECK(covered == 1);
+
+	//one past every edge covers everything and nothing more
+	Minimap_AddCloud(&map, WORLD_WEST - WORLD_WIDTH, WORLD_NORTH - WORLD_HEIGHT, 3 * WORLD_WIDTH, 3 * WORLD_HEIGHT);
+	covered = 0;
+	for (int i = 0; i < pixels; i++) covered += !samePixels(&map.clouds[i], &background, 1);
+	CHECK(covered == pixels);
+	CHECK(samePixels(map.pixels, map.clouds, pixels));
+	Minimap_Free(&map);
+}
+
+//The image goes up once per world and once per pickup, never on a frame that changed nothing.
+static void testUploads() {
+	Minimap map;
+	Stub_Reset();
+	if (!CHECK(Minimap_Init(&map, MAP_WIDTH, WORLD_WIDTH, WORLD_HEIGHT))) return;
+	uint32_t rng = 5;
+	float coinX[COINS], coinY[COINS];
+	buildWorld(&map, &rng, 20, coinX, coinY);
+	Stub_Reset();
+	Minimap_Draw(&map, 1660, 925, 0, 0, 0, 0, 1920, 1080);
+	CHECK(stubCounts.uploads == 1);
+	int draws = stubCounts.draws;
+	CHECK(draws == 3); //the image, the view and the player
+
+	for (int frame = 0; frame < 10; frame++) Minimap_Draw(&map, 1660, 925, (float)frame, 0, (float)frame, 0, 1920, 1080);
+	CHECK(stubCounts.uploads == 1);
+	CHECK(stubCounts.draws == 11 * draws);
+
+	Minimap_RemoveCoin(&map, coinX[3], coinY[3]);
+	Minimap_Draw(&map, 1660, 925, 0, 0, 0, 0, 1920, 1080);
+	Minimap_Draw(&map, 1660, 925, 0, 0, 0, 0, 1920, 1080);
+	CHECK(stubCounts.uploads == 2);
+	CHECK(stubCounts.uploadedPixels == 2 * map.width * map.height);
+	Minimap_Free(&map);
+}
+
+void MinimapTest_Run() {
+	testCoins();
+	testClouds();
+	testUploads();
+}
+
+void MinimapTest_Bench() {
+	Minimap map;
+	if (!Minimap_Init(&map, MAP_WIDTH, WORLD_WIDTH, WORLD_HEIGHT)) return;
+	uint32_t rng = 42;
+	float coinX[COINS], coinY[COINS];
+	int clouds = 10000;
+	int builds = 20, frames = 100000, pickups = 2000;
+
+	double start = Test_Seconds();
+	for (int i = 0; i < builds; i++) buildWorld(&map, &rng, clouds, coinX, coinY);
+	double buildMs = (Test_Seconds() - start) * 1000 / builds;
+
+	//what drawing every cloud each frame would cost: building the world again, then uploading it
+	start = Test_Seconds();
+	for (int i = 0; i < builds; i++) {
+		buildWorld(&map, &rng, clouds, coinX, coinY);
+		Minimap_Draw(&map, 1660, 925, 0, 0, 0, 0, 1920, 1080);
+	}
+	double redrawMs = (Test_Seconds() - start) * 1000 / builds;
+
+	start = Test_Seconds();
+	for (int i = 0; i < frames; i++) Minimap_Draw(&map, 1660, 925, (float)(i % 100), 0, (float)(i % 100), 0, 1920, 1080);
+	double steadyUs = (Test_Seconds() - start) * 1e6 / frames;
+
+	start = Test_Seconds();
+	for (int i = 0; i < pickups; i++) {
+		Minimap_RemoveCoin(&map, coinX[i % COINS], coinY[i % COINS]);
+		Minimap_Draw(&map, 1660, 925, 0, 0, 0, 0, 1920, 1080);
+	}
+	double pickupUs = (Test_Seconds() - start) * 1e6 / pickups;
+
+	printf("  %d clouds on a %dx%d minimap, CProcessing calls stubbed, an upload is a copy:\n", clouds, map.width, map.height);
+	printf("    built once per world:   %.2f ms\n", buildMs);
+	printf("    steady frame:           %.3f us\n", steadyUs);
+	printf("    frame with a pickup:    %.2f us\n", pickupUs);
+	printf("    every cloud each frame: %.2f ms\n", redrawMs);
+	Minimap_Free(&map);
+}
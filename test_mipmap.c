@@ -0,0 +1,271 @@
+//---------------------------------------------------------
+// file:	test_mipmap.c
+//
+// brief:	Mip chains and canvases (mipmap.h) on headless
+//			CProcessing: levels are box filtered without the
+//			color of transparent pixels bleeding into edges,
+//			SelectLevel follows scale and blur, and a canvas
+//			holds what was composited where it was put. The
+//			benchmark draws the game's clouds from random views
+//			at each speed and counts the pixels filled and the
+//			texels read, per cloud and through the canvas.
+//---------------------------------------------------------
+
+#include "tests.h"
+#include "cprocessing_stub.h"
+#include "mipmap.h"
+#include "world.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+//what main.c builds and draws with
+#define CLOUD_MIP_LEVELS 4
+#define CLOUD_DRAW_LEVELS 3
+#define CLOUD_LOD_SPEED 15.0f //the tuning file's cloudLodSpeed
+#define SCREEN_WIDTH 1920
+#define SCREEN_HEIGHT 1080
+#define CLOUDS 20
+
+//Same xorshift as camera.c.
+static uint32_t nextRandom(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static float randomRange(uint32_t* state, float min, float max) {
+	return min + (max - min) * (float)(nextRandom(state) >> 8) / (float)(1 << 24);
+}
+
+/***
+* A stand-in for CloudTextures.png: every rect of CLOUD_TEXTURE_POSITIONS holds an opaque
+* white ellipse with a soft edge, and the transparent pixels around them are stored as red,
+* the way a PNG may keep whatever color was painted there last.
+***/
+static CP_Image cloudAtlas() {
+	int width = 0, height = 0;
+	for (int i = 0; i < CLOUD_TEXTURE_COUNT; i++) {
+		width = (int)fmaxf((float)width, CLOUD_TEXTURE_POSITIONS[i].x1 + 8);
+		height = (int)fmaxf((float)height, CLOUD_TEXTURE_POSITIONS[i].y1 + 8);
+	}
+	CP_Color* pixels = malloc((size_t)width * height * sizeof * pixels);
+	if (!pixels) return NULL;
+	CP_Color red = CP_Color_Create(255, 0, 0, 0);
+	for (int i = 0; i < width * height; i++) pixels[i] = red;
+	for (int i = 0; i < CLOUD_TEXTURE_COUNT; i++) {
+		TextureRect t = CLOUD_TEXTURE_POSITIONS[i];
+		float cx = (t.x0 + t.x1) / 2, cy = (t.y0 + t.y1) / 2;
+		float rx = (t.x1 - t.x0) / 2, ry = (t.y1 - t.y0) / 2;
+		for (int y = (int)t.y0; y < (int)t.y1; y++) {
+			for (int x = (int)t.x0; x < (int)t.x1; x++) {
+				float dx = (x + 0.5f - cx) / rx, dy = (y + 0.5f - cy) / ry;
+				float edge = 1 - sqrtf(dx * dx + dy * dy); //0 at the rim
+				if (edge > 0) pixels[y * width + x] = CP_Color_Create(255, 255, 255, (int)fminf(edge * 8 * 255, 255));
+			}
+		}
+	}
+	CP_Image image = CP_Image_CreateFromData(width, height, (unsigned char*)pixels);
+	free(pixels);
+	return image;
+}
+
+static void testChain() {
+	CP_Image atlas = cloudAtlas();
+	MipChain chain;
+	if (!CHECK(atlas && MipChain_Build(&chain, atlas, CLOUD_MIP_LEVELS))) return;
+	CHECK(chain.levelCount == CLOUD_MIP_LEVELS);
+	CHECK(chain.images[0] == atlas);
+	int failures = 0;
+	for (int level = 1; level < chain.levelCount; level++) {
+		CHECK(chain.widths[level] == chain.widths[level - 1] / 2 && chain.heights[level] == chain.heights[level - 1] / 2);
+		CP_Color* pixels = malloc((size_t)chain.widths[level] * chain.heights[level] * sizeof * pixels);
+		if (!pixels) break;
+		CP_Image_GetPixelData(chain.images[level], pixels);
+		for (int i = 0; i < chain.widths[level] * chain.heights[level] && failures < 5; i++) {
+			//white stays white however little of it is left: no red, no dark fringe
+			CP_Color c = pixels[i];
+			if (c.a && !CHECK(c.r == 255 && c.g >= 253 && c.b >= 253)) {
+				printf("\tlevel %d pixel %d: %d %d %d %d\n", level, i, c.r, c.g, c.b, c.a);
+				failures++;
+			}
+			//each premultiplied pixel is the rounded average of the four below it
+			int x = i % chain.widths[level], y = i / chain.widths[level], below = chain.widths[level - 1];
+			const uint32_t* up = chain.pixels[level - 1] + 2 * y * below + 2 * x;
+			uint32_t alpha = ((up[0] >> 24) + (up[1] >> 24) + (up[below] >> 24) + (up[below + 1] >> 24) + 2) / 4;
+			if (!CHECK(chain.pixels[level][i] >> 24 == alpha && c.a == alpha)) failures++;
+		}
+		free(pixels);
+	}
+	MipChain_Free(&chain);
+	CP_Image_Free(&atlas);
+
+	//odd sizes round down, and it stops at one pixel
+	CP_Color odd[5 * 3] = { { { 0 } } };
+	CP_Image small = CP_Image_CreateFromData(5, 3, (unsigned char*)odd);
+	if (!CHECK(MipChain_Build(&chain, small, CLOUD_MIP_LEVELS))) return;
+	CHECK(chain.levelCount == 3);
+	CHECK(chain.widths[1] == 2 && chain.heights[1] == 1 && chain.widths[2] == 1 && chain.heights[2] == 1);
+	MipChain_Free(&chain);
+	CP_Image_Free(&small);
+	CHECK(!MipChain_Build(&chain, NULL, CLOUD_MIP_LEVELS));
+}
+
+static void testSelectLevel() {
+	MipChain chain = { 0 };
+	chain.levelCount = CLOUD_MIP_LEVELS;
+	CHECK(MipChain_SelectLevel(&chain, 1, 1) == 0);
+	CHECK(MipChain_SelectLevel(&chain, 1, 1.9f) == 0);
+	CHECK(MipChain_SelectLevel(&chain, 1, 2) == 1);
+	CHECK(MipChain_SelectLevel(&chain, 1, 4) == 2);
+	CHECK(MipChain_SelectLevel(&chain, 1, 1000) == CLOUD_MIP_LEVELS - 1);
+	CHECK(MipChain_SelectLevel(&chain, 0.5f, 1) == 1); //drawn at half size
+	CHECK(MipChain_SelectLevel(&chain, 2, 2) == 0); //drawn at twice the size, blurred over two
+	CHECK(MipChain_SelectLevel(&chain, 1, 0) == 0);
+	CHECK(MipChain_SelectLevel(&chain, 0, 8) == 0);
+	int last = 0;
+	bool rising = true;
+	for (float speed = 0; speed < 200; speed += 0.5f) {
+		int level = MipChain_SelectLevel(&chain, 1, speed / CLOUD_LOD_SPEED);
+		rising = rising && level >= last;
+		last = level;
+	}
+	CHECK(rising);
+	chain.levelCount = 1;
+	CHECK(MipChain_SelectLevel(&chain, 1, 8) == 0);
+}
+
+static void testCanvas() {
+	CP_Image atlas = cloudAtlas();
+	MipChain chain;
+	MipCanvas canvas;
+	if (!CHECK(atlas && MipChain_Build(&chain, atlas, CLOUD_MIP_LEVELS))) return;
+	if (!CHECK(MipCanvas_Init(&canvas, SCREEN_WIDTH + 1, SCREEN_HEIGHT, 1))) return;
+	CHECK(canvas.width == SCREEN_WIDTH / 2 + 1 && canvas.height == SCREEN_HEIGHT / 2);
+
+	//a cloud at an even position lands on the canvas pixel for pixel
+	TextureRect t = CLOUD_TEXTURE_POSITIONS[4];
+	MipCanvas_Clear(&canvas);
+	MipCanvas_Composite(&canvas, &chain, 100, 60, t.x0, t.y0, t.x1, t.y1);
+	int sx0 = (int)floorf(t.x0 / 2), sy0 = (int)floorf(t.y0 / 2), sx1 = (int)ceilf(t.x1 / 2), sy1 = (int)ceilf(t.y1 / 2);
+	bool same = true;
+	for (int y = sy0; y < sy1; y++) {
+		for (int x = sx0; x < sx1; x++) same = same && canvas.pixels[(y - sy0 + 30) * canvas.width + x - sx0 + 50] == chain.pixels[1][y * chain.widths[1] + x];
+	}
+	CHECK(same);
+	CHECK(canvas.filled == (uint64_t)(sx1 - sx0) * (sy1 - sy0));
+
+	//overlapping clouds merge into one rect, apart ones don't, off screen ones are cut off
+	MipCanvas_Composite(&canvas, &chain, 150, 80, t.x0, t.y0, t.x1, t.y1);
+	MipCanvas_Composite(&canvas, &chain, 1000, 600, t.x0, t.y0, t.x1, t.y1);
+	MipCanvas_Composite(&canvas, &chain, -120, -70, t.x0, t.y0, t.x1, t.y1);
+	MipCanvas_Composite(&canvas, &chain, 5000, 100, t.x0, t.y0, t.x1, t.y1);
+	CHECK(canvas.rectCount == 3);
+	for (int i = 0; i < canvas.rectCount; i++) {
+		MipRect r = canvas.rects[i];
+		CHECK(r.x0 >= 0 && r.y0 >= 0 && r.x1 <= canvas.width && r.y1 <= canvas.height);
+	}
+
+	//one upload and one draw per rect; the next frame clears what this one left
+	Stub_Reset();
+	MipCanvas_Draw(&canvas, 255);
+	CHECK(stubCounts.uploads == 1 && stubCounts.draws == 3);
+	MipCanvas_Clear(&canvas);
+	MipCanvas_Draw(&canvas, 255);
+	CHECK(stubCounts.uploads == 2 && stubCounts.draws == 3);
+	bool empty = true;
+	for (int i = 0; i < canvas.width * canvas.height; i++) empty = empty && canvas.pixels[i] == 0 && canvas.straight[i].a == 0;
+	CHECK(empty);
+	MipCanvas_Draw(&canvas, 255);
+	CHECK(stubCounts.uploads == 2); //nothing then, nothing now
+
+	MipCanvas_Free(&canvas);
+	MipChain_Free(&chain);
+	CP_Image_Free(&atlas);
+}
+
+void MipmapTest_Run() {
+	testChain();
+	testSelectLevel();
+	testCanvas();
+}
+
+/***
+* The game's CLOUDS clouds at size 1 in its 3x3 screen world, seen from random views at each
+* speed. Each visible cloud is drawn as drawClouds draws it, from the level its speed picks:
+* that fills its pixels on screen and reads the texels of that level under them. Then all of
+* them go through a canvas at that level, counted by the stubbed draws.
+***/
+void MipmapTest_Bench() {
+	CP_Image atlas = cloudAtlas();
+	MipChain chain;
+	double start = Test_Seconds();
+	if (!atlas || !MipChain_Build(&chain, atlas, CLOUD_MIP_LEVELS)) return;
+	printf("  chain of %dx%d built in %.2f ms\n", chain.widths[0], chain.heights[0], (Test_Seconds() - start) * 1000);
+
+	MipCanvas canvases[CLOUD_DRAW_LEVELS] = { 0 };
+	for (int level = 1; level < CLOUD_DRAW_LEVELS; level++) MipCanvas_Init(&canvases[level], SCREEN_WIDTH, SCREEN_HEIGHT, level);
+
+	uint32_t rng = 42;
+	int frames = 5000;
+	const float speeds[] = { 15, 30, 45, 60, 90 };
+	printf("  %5s %5s %9s %9s %9s %9s %9s %9s\n", "speed", "level", "GPU px", "texels", "canvas", "GPU px", "CPU px", "ms");
+	for (int s = 0; s < 5; s++) {
+		int level = MipChain_SelectLevel(&chain, 1, speeds[s] / CLOUD_LOD_SPEED);
+		if (level >= CLOUD_DRAW_LEVELS) level = CLOUD_DRAW_LEVELS - 1;
+		float shrink = 1.0f / (1 << level);
+		double pixels = 0, texels = 0, canvasPixels = 0, cpuPixels = 0, canvasSeconds = 0;
+		for (int frame = 0; frame < frames; frame++) {
+			//one world per frame, seen from anywhere the plane can be
+			Cloud clouds[CLOUDS];
+			for (int i = 0; i < CLOUDS; i++) {
+				clouds[i].size = 1;
+				clouds[i].img_id = nextRandom(&rng) % CLOUD_TEXTURE_COUNT;
+				clouds[i].x = randomRange(&rng, -SCREEN_WIDTH, 2 * SCREEN_WIDTH);
+				clouds[i].y = randomRange(&rng, -SCREEN_HEIGHT, 2 * SCREEN_HEIGHT);
+			}
+			float left = randomRange(&rng, -SCREEN_WIDTH, SCREEN_WIDTH), top = randomRange(&rng, -SCREEN_HEIGHT, SCREEN_HEIGHT);
+
+			//only what is on screen gets filled, and only the texels under it are read
+			for (int i = 0; i < CLOUDS; i++) {
+				TextureRect t = CLOUD_TEXTURE_POSITIONS[clouds[i].img_id];
+				float x0 = fmaxf(clouds[i].x - left, 0), x1 = fminf(clouds[i].x - left + t.w, SCREEN_WIDTH);
+				float y0 = fmaxf(clouds[i].y - top, 0), y1 = fminf(clouds[i].y - top + t.h, SCREEN_HEIGHT);
+				if (x0 >= x1 || y0 >= y1) continue;
+				float visible = (x1 - x0) * (y1 - y0);
+				pixels += visible;
+				texels += visible / (t.w * t.h) * (t.x1 - t.x0) * shrink * (t.y1 - t.y0) * shrink;
+			}
+
+			if (level == 0) continue;
+			MipCanvas* canvas = &canvases[level];
+			Stub_Reset();
+			double canvasStart = Test_Seconds();
+			MipCanvas_Clear(canvas);
+			for (int i = 0; i < CLOUDS; i++) {
+				TextureRect t = CLOUD_TEXTURE_POSITIONS[clouds[i].img_id];
+				MipCanvas_Composite(canvas, &chain, clouds[i].x - left, clouds[i].y - top, t.x0, t.y0, t.x1, t.y1);
+			}
+			MipCanvas_Draw(canvas, 255);
+			canvasSeconds += Test_Seconds() - canvasStart;
+			canvasPixels += stubCounts.pixelsCovered;
+			cpuPixels += (double)canvas->filled;
+		}
+		if (level == 0) {
+			printf("  %5.0f %5d %9.0f %9.0f %9s\n", speeds[s], level, pixels / frames, texels / frames, "-");
+		} else {
+			printf("  %5.0f %5d %9.0f %9.0f %9s %9.0f %9.0f %9.3f\n", speeds[s], level, pixels / frames, texels / frames, "",
+				canvasPixels / frames, cpuPixels / frames, canvasSeconds * 1000 / frames);
+		}
+	}
+	printf("  per frame: GPU px filled and atlas texels read drawing each cloud; the canvas fills GPU px\n"
+		"  after compositing CPU px on the main thread, in ms, uploading the whole canvas each time\n");
+
+	for (int level = 1; level < CLOUD_DRAW_LEVELS; level++) MipCanvas_Free(&canvases[level]);
+	MipChain_Free(&chain);
+	CP_Image_Free(&atlas);
+}
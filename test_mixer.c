@@ -0,0 +1,149 @@
+//---------------------------------------------------------
+// file:	test_mixer.c
+//
+// brief:	The audio mixer (audio.h) run a block at a time
+//			with no device: voices start and end, the oldest
+//			voice is stolen when all are busy, and sounds are
+//			dropped rather than queued once the queue is full.
+//			Loads the samples from Assets/, so run it from the
+//			project directory. The benchmark reports the cost
+//			of a block with every voice playing.
+//---------------------------------------------------------
+
+#include "tests.h"
+#include "audio.h"
+#include <stdio.h>
+
+#define BENCH_BLOCKS 2000
+
+//Every sound but the last, AUDIO_MAX_VOICES of them, all long enough to outlast a few blocks.
+static const SoundId VOICES[AUDIO_MAX_VOICES] = {
+	SOUND_NOTE_A, SOUND_NOTE_B, SOUND_NOTE_C, SOUND_NOTE_D, SOUND_NOTE_E, SOUND_NOTE_F, SOUND_NOTE_G,
+	SOUND_PIANO_A, SOUND_PIANO_B, SOUND_PIANO_C, SOUND_PIANO_D, SOUND_PIANO_E, SOUND_PIANO_F, SOUND_PIANO_G,
+	SOUND_CLAP, SOUND_SNARE
+};
+
+static short block[AUDIO_BLOCK_FRAMES * AUDIO_CHANNELS];
+
+static int loudest() {
+	int peak = 0;
+	for (int i = 0; i < AUDIO_BLOCK_FRAMES * AUDIO_CHANNELS; i++) {
+		int magnitude = (block[i] < 0) ? -block[i] : block[i];
+		peak = (magnitude > peak) ? magnitude : peak;
+	}
+	return peak;
+}
+
+static void testPlayAndEnd() {
+	if (!CHECK(Audio_Open())) return;
+	Audio_Mix(block);
+	CHECK(loudest() == 0);
+	CHECK(Audio_GetActiveVoices() == 0);
+
+	CHECK(Audio_Play(SOUND_COWBELL, 1, 1));
+	CHECK(!Audio_IsPlaying(SOUND_COWBELL)); //queued, not started before the next block
+	Audio_Mix(block);
+	CHECK(Audio_IsPlaying(SOUND_COWBELL));
+	CHECK(Audio_GetActiveVoices() == 1);
+	CHECK(loudest() > 0);
+
+	int blocks = 1;
+	while (Audio_GetActiveVoices() > 0 && blocks < 10 * AUDIO_SAMPLE_RATE / AUDIO_BLOCK_FRAMES) {
+		Audio_Mix(block);
+		blocks++;
+	}
+	CHECK(Audio_GetActiveVoices() == 0);
+	CHECK(!Audio_IsPlaying(SOUND_COWBELL));
+	Audio_Mix(block);
+	CHECK(loudest() == 0);
+	Audio_Shutdown();
+	CHECK(!Audio_Play(SOUND_COWBELL, 1, 1));
+}
+
+static void testVoiceStealing() {
+	if (!CHECK(Audio_Open())) return;
+	//the first one a block earlier, so it is the oldest
+	Audio_Play(VOICES[0], 1, 1);
+	Audio_Mix(block);
+	for (int i = 1; i < AUDIO_MAX_VOICES; i++) Audio_Play(VOICES[i], 1, 1);
+	Audio_Mix(block);
+	CHECK(Audio_GetActiveVoices() == AUDIO_MAX_VOICES);
+	for (int i = 0; i < AUDIO_MAX_VOICES; i++) CHECK(Audio_IsPlaying(VOICES[i]));
+
+	Audio_Play(SOUND_COWBELL, 1, 1);
+	Audio_Mix(block);
+	CHECK(Audio_GetActiveVoices() == AUDIO_MAX_VOICES);
+	CHECK(Audio_IsPlaying(SOUND_COWBELL));
+	CHECK(!Audio_IsPlaying(VOICES[0]));
+	for (int i = 1; i < AUDIO_MAX_VOICES; i++) CHECK(Audio_IsPlaying(VOICES[i]));
+
+	//the rest started together, the first voice of them goes next
+	Audio_Play(SOUND_HIHAT, 1, 1);
+	Audio_Mix(block);
+	CHECK(Audio_IsPlaying(SOUND_HIHAT));
+	CHECK(Audio_IsPlaying(SOUND_COWBELL));
+	CHECK(!Audio_IsPlaying(VOICES[1]));
+	for (int i = 2; i < AUDIO_MAX_VOICES; i++) CHECK(Audio_IsPlaying(VOICES[i]));
+	Audio_Shutdown();
+}
+
+static void testQueueDrops() {
+	if (!CHECK(Audio_Open())) return;
+	int queued = 0;
+	for (int i = 0; i < AUDIO_QUEUE_SIZE; i++) queued += Audio_Play(VOICES[i % AUDIO_MAX_VOICES], 0.1f, 1);
+	CHECK(queued == AUDIO_QUEUE_SIZE);
+	CHECK(!Audio_Play(SOUND_COWBELL, 1, 1));
+	CHECK(!Audio_Play(SOUND_COWBELL, 1, 1));
+
+	//one block starts them all, each steals from the ones before, and makes room again
+	Audio_Mix(block);
+	CHECK(Audio_GetActiveVoices() == AUDIO_MAX_VOICES);
+	CHECK(!Audio_IsPlaying(SOUND_COWBELL));
+	CHECK(Audio_Play(SOUND_COWBELL, 1, 1));
+	Audio_Mix(block);
+	CHECK(Audio_IsPlaying(SOUND_COWBELL));
+
+	//a full queue again after the wrap
+	queued = 0;
+	for (int i = 0; i < AUDIO_QUEUE_SIZE + 8; i++) queued += Audio_Play(SOUND_HIHAT, 0.1f, 1);
+	CHECK(queued == AUDIO_QUEUE_SIZE);
+	Audio_Shutdown();
+}
+
+//The same mixer behind its thread, writing to a null device.
+static void testThreaded() {
+	NullAudioDevice output = { false, 0, 0 };
+	if (!CHECK(Audio_Init(Audio_NullDevice(&output)))) return;
+	CHECK(Audio_Play(SOUND_COWBELL, 1, 1));
+	double start = Test_Seconds();
+	while (output.peak == 0 && Test_Seconds() - start < 2) {}
+	CHECK(output.peak > 0);
+	CHECK(output.framesWritten > 0);
+	Audio_Mix(block); //the thread's job, nothing happens
+	Audio_Shutdown();
+	CHECK(!Audio_Play(SOUND_COWBELL, 1, 1));
+}
+
+void MixerTest_Run() {
+	testPlayAndEnd();
+	testVoiceStealing();
+	testQueueDrops();
+	testThreaded();
+}
+
+void MixerTest_Bench() {
+	if (!Audio_Open()) return;
+	double seconds = 0;
+	for (int n = 0; n < BENCH_BLOCKS; n++) {
+		//keep every voice busy, restarting them as they end
+		if (Audio_GetActiveVoices() < AUDIO_MAX_VOICES) {
+			for (int i = 0; i < AUDIO_MAX_VOICES; i++) Audio_Play(VOICES[i], 0.1f, 1.0f + i * 0.05f);
+		}
+		double start = Test_Seconds();
+		Audio_Mix(block);
+		seconds += Test_Seconds() - start;
+	}
+	Audio_Shutdown();
+	double blockMs = 1000.0 * AUDIO_BLOCK_FRAMES / AUDIO_SAMPLE_RATE;
+	printf("  %d voices: %.1f us per block of %.1f ms\n", AUDIO_MAX_VOICES, seconds * 1e6 / BENCH_BLOCKS, blockMs);
+}
@@ -0,0 +1,189 @@
+//---------------------------------------------------------
+// file:	test_pipeline.c
+//
+// brief:	The simulation pipeline (pipeline.h) driven the
+//			way gameUpdate drives it, with a tick that counts
+//			instead of simulating: no packet is ever in both
+//			threads' hands, packets come out newest first and
+//			unchanged while held, Drain leaves nothing queued
+//			or running, and PipelineStats adds up.
+//---------------------------------------------------------
+
+#include "tests.h"
+#include "pipeline.h"
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+typedef volatile LONG Counter;
+static long addCounter(Counter* counter, long amount) { return InterlockedExchangeAdd(counter, amount) + amount; }
+#else
+typedef volatile long Counter;
+static long addCounter(Counter* counter, long amount) { return __atomic_add_fetch(counter, amount, __ATOMIC_ACQ_REL); }
+#endif
+
+#define FRAMES 20000
+
+typedef struct {
+	Counter holders; //threads that have the packet right now, never more than 1
+	uint32_t tick; //which tick filled it
+	uint32_t input;
+} TestPacket;
+
+typedef struct {
+	TestPacket packets[PIPELINE_PACKETS];
+	uint32_t ticks; //run, dropped ones too; the worker's alone while ticks run
+	uint32_t published;
+	uint32_t newest; //tick of the newest published packet
+	int shared; //ticks that found their packet held by the drawing thread
+	int dropEvery; //return false on every nth tick, 0 never
+	Counter gate; //ticks spin while it is 0
+} TestContext;
+
+//Same xorshift as camera.c.
+static uint32_t nextRandom(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+//Some work of varying length, so either thread sometimes gets ahead of the other.
+static void spin(uint32_t amount) {
+	volatile uint32_t sink = 0;
+	for (uint32_t i = 0; i < amount; i++) sink += i;
+}
+
+static bool countingTick(void* context, const void* input, void* packet) {
+	TestContext* c = context;
+	TestPacket* p = packet;
+	while (!addCounter(&c->gate, 0)) spin(100);
+	if (addCounter(&p->holders, 1) != 1) c->shared++;
+	c->ticks++;
+	uint32_t value = *(const uint32_t*)input;
+	bool publish = !c->dropEvery || c->ticks % c->dropEvery;
+	p->tick = c->ticks;
+	p->input = value;
+	spin(value % 2000);
+	c->published += publish;
+	if (publish) c->newest = c->ticks;
+	addCounter(&p->holders, -1);
+	return publish;
+}
+
+static Pipeline* start(TestContext* c, int dropEvery) {
+	for (int i = 0; i < PIPELINE_PACKETS; i++) {
+		c->packets[i].holders = 0;
+		c->packets[i].tick = 0;
+	}
+	c->ticks = c->published = c->newest = 0;
+	c->shared = 0;
+	c->dropEvery = dropEvery;
+	c->gate = 1;
+	void* packets[PIPELINE_PACKETS] = { &c->packets[0], &c->packets[1], &c->packets[2] };
+	return Pipeline_Start(countingTick, c, packets, sizeof(uint32_t));
+}
+
+/***
+* Posts and acquires once a frame like gameUpdate, drawing for a random while in between,
+* and now and then drains like the F9 benchmark does. The held packet is marked, so a tick
+* writing into it is counted in shared.
+***/
+static void testHandOff(int dropEvery) {
+	TestContext c;
+	Pipeline* pipeline = start(&c, dropEvery);
+	if (!CHECK(pipeline)) return;
+
+	uint32_t rng = 0x9E3779B9u;
+	uint32_t accepted = 0, fresh = 0, seen = 0;
+	TestPacket* held = NULL;
+	int failures = 0;
+	for (uint32_t frame = 1; frame <= FRAMES && failures < 5; frame++) {
+		uint32_t input = nextRandom(&rng);
+		accepted += Pipeline_Post(pipeline, &input);
+
+		TestPacket* packet = Pipeline_Acquire(pipeline);
+		if (packet != held) {
+			if (held) addCounter(&held->holders, -1);
+			if (packet && !CHECK(addCounter(&packet->holders, 1) == 1)) failures++;
+		}
+		if (packet) {
+			//newer than the last one, or the same one untouched
+			bool newer = packet->tick > seen;
+			if (!CHECK(newer || (packet == held && packet->tick == seen))) {
+				printf("\tframe %u: packet of tick %u after tick %u\n", frame, packet->tick, seen);
+				failures++;
+			}
+			if (newer) fresh++;
+			//dropped ticks are never handed out
+			if (!CHECK(!dropEvery || packet->tick % dropEvery)) failures++;
+			seen = packet->tick;
+		}
+		held = packet;
+		spin(nextRandom(&rng) % 3000);
+
+		if (frame % 1000 == 0) {
+			Pipeline_Drain(pipeline);
+			//everything posted has run, and the newest published packet is waiting
+			PipelineStats stats = Pipeline_GetStats(pipeline);
+			if (!CHECK(c.ticks == accepted && stats.ticks == c.published)) failures++;
+			if (!CHECK(Pipeline_Post(pipeline, &input))) failures++; //nothing queued
+			accepted++;
+			Pipeline_Drain(pipeline);
+			if (!CHECK(c.ticks == accepted)) failures++;
+		}
+	}
+	Pipeline_Drain(pipeline);
+	TestPacket* last = Pipeline_Acquire(pipeline);
+	if (last != held) {
+		if (held) addCounter(&held->holders, -1);
+		if (last && last->tick > seen) fresh++;
+	}
+	uint32_t frames = FRAMES + 1;
+	PipelineStats stats = Pipeline_GetStats(pipeline);
+	CHECK(c.shared == 0);
+	CHECK(c.ticks == accepted);
+	CHECK(stats.ticks == c.published);
+	CHECK(stats.acquires == frames);
+	CHECK(stats.acquires - stats.repeats == fresh);
+	//every published packet was either handed out or replaced before it could be
+	CHECK(stats.skipped + fresh == stats.ticks);
+	CHECK(last && last->tick == c.newest);
+	Pipeline_Stop(&pipeline);
+	CHECK(pipeline == NULL);
+}
+
+//With the worker held inside a tick, one input can wait and a second can't.
+static void testQueue() {
+	TestContext c;
+	Pipeline* pipeline = start(&c, 0);
+	if (!CHECK(pipeline)) return;
+	CHECK(Pipeline_Acquire(pipeline) == NULL); //nothing published yet
+
+	c.gate = 0;
+	uint32_t input = 1;
+	CHECK(Pipeline_Post(pipeline, &input));
+	for (int i = 0; i < 1000000 && Pipeline_Post(pipeline, &input) == false; i++) spin(100); //the worker took the first
+	input = 2;
+	CHECK(!Pipeline_Post(pipeline, &input));
+	addCounter(&c.gate, 1);
+	Pipeline_Drain(pipeline);
+	CHECK(c.ticks == 2);
+
+	//Stop finishes a queued tick before it returns
+	input = 3;
+	CHECK(Pipeline_Post(pipeline, &input));
+	Pipeline_Stop(&pipeline);
+	CHECK(c.ticks == 3 && c.published == 3);
+	CHECK(c.shared == 0);
+}
+
+void PipelineTest_Run() {
+	testHandOff(0);
+	testHandOff(7);
+	testQueue();
+}
@@ -0,0 +1,237 @@
+//---------------------------------------------------------
+// file:	test_placement.c
+//
+// brief:	Poisson-disk cloud placement (placement.h) against
+//			brute force: every pair of hit shapes at least gap
+//			apart, none within safeRadius of the safe point,
+//			all inside the area. The benchmark places 1k to 1M
+//			clouds in areas sized to hold them.
+//---------------------------------------------------------
+
+#include "tests.h"
+#include "placement.h"
+#include "collision.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PI 3.14159265358979323846264
+
+#define CLOUD_MARGIN 35.0f //the tuning file's collisionMargin, also the game's gap
+#define WIDTH_SCALAR 0.8f
+#define HEIGHT_SCALAR 0.7f
+#define CLOUD_TYPES 12 //what the game and the sim use
+#define OUTLINE_POINTS 90 //per hit shape for the brute force distances
+
+typedef struct {
+	float x, y; //center
+	float a, b; //ellipse semi-axes, the margin goes on top
+} Shape;
+
+//Same xorshift as camera.c.
+static float nextRandom(void* state) {
+	uint32_t* x = state;
+	*x ^= *x << 13;
+	*x ^= *x >> 17;
+	*x ^= *x << 5;
+	return (float)(*x >> 8) / (float)(1 << 24);
+}
+
+static CloudPlacement gamePlacement(uint32_t* rng) {
+	//the game's Bounds for a 1920x1080 window, as createClouds fills it
+	CloudPlacement p;
+	p.left = -1920 + 960;
+	p.right = 3840 - 960 - 200;
+	p.top = -1080 + 540;
+	p.bottom = 2160 - 540 - 100;
+	p.size = 1;
+	p.widthScalar = WIDTH_SCALAR;
+	p.heightScalar = HEIGHT_SCALAR;
+	p.margin = CLOUD_MARGIN;
+	p.gap = CLOUD_MARGIN;
+	p.types = CLOUD_TYPES;
+	p.safeX = 960;
+	p.safeY = 540;
+	p.safeRadius = 300;
+	p.random = nextRandom;
+	p.randomState = rng;
+	return p;
+}
+
+static Shape shapeOf(const CloudPlacement* p, const Cloud* cloud) {
+	TextureRect t = CLOUD_TEXTURE_POSITIONS[cloud->img_id];
+	Shape shape = {
+		cloud->x + cloud->size * t.w / 2, cloud->y + cloud->size * t.h / 2,
+		cloud->size * t.w * p->widthScalar / 2, cloud->size * t.h * p->heightScalar / 2
+	};
+	return shape;
+}
+
+//The outline of the hit shape: the ellipse pushed out along every ray by the margin.
+static void outline(const Shape* shape, float margin, float* xs, float* ys) {
+	for (int i = 0; i < OUTLINE_POINTS; i++) {
+		float angle = i * 2 * (float)PI / OUTLINE_POINTS;
+		float c = cosf(angle), s = sinf(angle);
+		float r = shape->a * shape->b / sqrtf(shape->b * c * shape->b * c + shape->a * s * shape->a * s) + margin;
+		xs[i] = shape->x + c * r;
+		ys[i] = shape->y + s * r;
+	}
+}
+
+//Neighbouring outline points are at most this far apart, so a distance between two outlines
+//can only be this much shorter than the one measured between their points.
+static float outlineSlack(const Shape* shape, float margin) {
+	return 2 * (float)PI * (fmaxf(shape->a, shape->b) + margin) / OUTLINE_POINTS;
+}
+
+//Checks every pair and every shape, returns the closest two outlines came.
+static float checkSpacing(const CloudPlacement* p, const Cloud* clouds, int count) {
+	Shape* shapes = malloc((size_t)count * sizeof * shapes);
+	float closest = INFINITY;
+	if (!shapes) return closest;
+	for (int i = 0; i < count; i++) shapes[i] = shapeOf(p, &clouds[i]);
+
+	float xa[OUTLINE_POINTS], ya[OUTLINE_POINTS], xb[OUTLINE_POINTS], yb[OUTLINE_POINTS];
+	int failures = 0;
+	for (int i = 0; i < count && failures < 5; i++) {
+		const Shape* a = &shapes[i];
+		bool inside = a->x >= p->left && a->x < p->right && a->y >= p->top && a->y < p->bottom;
+		if (!CHECK(inside)) failures++;
+
+		//safe circle: outside the shape, and the outline no closer than safeRadius
+		outline(a, p->margin, xa, ya);
+		float slackA = outlineSlack(a, p->margin);
+		if (p->safeRadius > 0) {
+			float nearest = INFINITY;
+			for (int k = 0; k < OUTLINE_POINTS; k++) nearest = fminf(nearest, hypotf(xa[k] - p->safeX, ya[k] - p->safeY));
+			bool clear = !Collision_PointInCloud(p->safeX - a->x, p->safeY - a->y, a->a, a->b, p->margin) && nearest >= p->safeRadius - slackA;
+			if (!CHECK(clear)) {
+				printf("\tcloud %d at (%.1f, %.1f) comes within %.1f of the safe point\n", i, a->x, a->y, nearest);
+				failures++;
+			}
+		}
+
+		for (int j = i + 1; j < count; j++) {
+			const Shape* b = &shapes[j];
+			float reach = fmaxf(a->a, a->b) + fmaxf(b->a, b->b) + 2 * p->margin + p->gap;
+			float centers = hypotf(a->x - b->x, a->y - b->y);
+			if (centers >= reach) {
+				closest = fminf(closest, centers - reach + p->gap); //a lower bound, no outline needed
+				continue;
+			}
+			outline(b, p->margin, xb, yb);
+			float distance = INFINITY;
+			for (int m = 0; m < OUTLINE_POINTS; m++) {
+				for (int n = 0; n < OUTLINE_POINTS; n++) distance = fminf(distance, hypotf(xa[m] - xb[n], ya[m] - yb[n]));
+			}
+			bool apart = !Collision_PointInCloud(b->x - a->x, b->y - a->y, a->a, a->b, p->margin) &&
+				!Collision_PointInCloud(a->x - b->x, a->y - b->y, b->a, b->b, p->margin) &&
+				distance >= p->gap - (slackA + outlineSlack(b, p->margin)) / 2;
+			if (!CHECK(apart)) {
+				printf("\tclouds %d and %d are %.1f apart, gap %.1f\n", i, j, distance, p->gap);
+				failures++;
+			}
+			closest = fminf(closest, distance);
+		}
+	}
+	free(shapes);
+	return closest;
+}
+
+static void testGameWorld() {
+	uint32_t rng = 0x9E3779B9u;
+	for (int world = 0; world < 50; world++) {
+		CloudPlacement p = gamePlacement(&rng);
+		p.safeRadius = (world & 1) ? 300 : 900; //30 frames at speed 30
+		Cloud clouds[20];
+		if (!CHECK(Placement_Clouds(&p, clouds, 20) == 20)) return;
+		checkSpacing(&p, clouds, 20);
+		for (int i = 0; i < 20; i++) CHECK(clouds[i].img_id >= 0 && clouds[i].img_id < CLOUD_TYPES);
+	}
+}
+
+//The whole area filled, the densest it ever packs.
+static void testFull() {
+	uint32_t rng = 12345;
+	CloudPlacement p = gamePlacement(&rng);
+	p.left = 0;
+	p.top = 0;
+	p.right = 6000;
+	p.bottom = 4000;
+	p.safeX = 3000;
+	p.safeY = 2000;
+	int capacity = 20000;
+	Cloud* clouds = malloc((size_t)capacity * sizeof * clouds);
+	if (!clouds) return;
+	int placed = Placement_Clouds(&p, clouds, capacity);
+	CHECK(placed > 100 && placed < capacity);
+	float closest = checkSpacing(&p, clouds, placed);
+	CHECK(closest >= p.gap * 0.9f);
+	//and a wider gap is kept too
+	p.gap = 150;
+	placed = Placement_Clouds(&p, clouds, capacity);
+	CHECK(placed > 50);
+	checkSpacing(&p, clouds, placed);
+	free(clouds);
+}
+
+static void testEdgeCases() {
+	uint32_t rng = 7, again = 7;
+	CloudPlacement p = gamePlacement(&rng);
+	Cloud first[20], second[20];
+	int placed = Placement_Clouds(&p, first, 20);
+	p.randomState = &again;
+	CHECK(Placement_Clouds(&p, second, 20) == placed);
+	bool same = true;
+	for (int i = 0; i < placed; i++) same = same && first[i].x == second[i].x && first[i].y == second[i].y && first[i].img_id == second[i].img_id;
+	CHECK(same); //a pure function of the random stream, as the sim needs
+
+	//no room: nothing placed, nothing touched
+	p.right = p.left;
+	first[0].img_id = -7;
+	CHECK(Placement_Clouds(&p, first, 20) == 0);
+	CHECK(first[0].img_id == -7);
+
+	//a safe circle over the whole area leaves nowhere to go
+	p = gamePlacement(&rng);
+	p.safeRadius = 10000;
+	CHECK(Placement_Clouds(&p, first, 20) == 0);
+}
+
+void PlacementTest_Run() {
+	testGameWorld();
+	testFull();
+	testEdgeCases();
+}
+
+void PlacementTest_Bench() {
+	//how densely a filled area packs, to size each area to hold its count
+	uint32_t rng = 99;
+	CloudPlacement p = gamePlacement(&rng);
+	p.left = p.top = 0;
+	p.right = p.bottom = 10000;
+	p.safeX = p.safeY = 5000;
+	Cloud* clouds = malloc(1000000 * sizeof * clouds);
+	if (!clouds) return;
+	double perPixel = Placement_Clouds(&p, clouds, 1000000) / 1e8;
+
+	p = gamePlacement(&rng);
+	Cloud game[20];
+	int runs = 200;
+	double start = Test_Seconds();
+	for (int i = 0; i < runs; i++) Placement_Clouds(&p, game, 20);
+	printf("  game world, 20 clouds: %.3f ms\n", (Test_Seconds() - start) * 1000 / runs);
+
+	const int counts[] = { 1000, 10000, 100000, 1000000 };
+	for (int c = 0; c < 4; c++) {
+		float side = (float)sqrt(counts[c] / perPixel * 1.1);
+		p.left = p.top = 0;
+		p.right = p.bottom = side;
+		p.safeX = p.safeY = side / 2;
+		start = Test_Seconds();
+		int placed = Placement_Clouds(&p, clouds, counts[c]);
+		double seconds = Test_Seconds() - start;
+		printf("  %7d clouds in %.0f px square: %d placed, %.1f ms, %.2f us per cloud\n", counts[c], side, placed, seconds * 1000, seconds * 1e6 / placed);
+	}
+	free(clouds);
+}
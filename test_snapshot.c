@@ -0,0 +1,294 @@
+//---------------------------------------------------------
+// file:	test_snapshot.c
+//
+// brief:	Snapshot capture, restore and both encodings
+//			(snapshot.h): round trips, every truncation and
+//			mismatched baselines. The benchmark reports bytes
+//			per snapshot over a stretch of simulated play.
+//---------------------------------------------------------
+
+#include "tests.h"
+#include "snapshot.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GAME_CLOUDS 20 //CLOUD_ARR_SIZE
+#define GAME_COINS 40 //COIN_COUNT, one world's worth
+#define BIG_CLOUDS 2000
+#define BIG_COINS 4000
+#define BENCH_FRAMES 3600 //a minute at 60 fps
+
+typedef struct {
+	SnapshotState state;
+	Cloud* clouds;
+	Collectible* coins;
+	uint32_t rng;
+} TestWorld;
+
+//Same xorshift as camera.c.
+static uint32_t nextRandom(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static float randomRange(uint32_t* state, float min, float max) {
+	return min + (max - min) * (nextRandom(state) >> 8) / (float)(1 << 24);
+}
+
+static bool worldInit(TestWorld* world, int clouds, int coins, uint32_t seed) {
+	memset(world, 0, sizeof * world);
+	world->clouds = malloc(clouds * sizeof * world->clouds);
+	world->coins = malloc((coins ? coins : 1) * sizeof * world->coins);
+	if (!world->clouds || !world->coins) return false;
+	world->rng = seed;
+
+	SnapshotState* s = &world->state;
+	s->origin.chunkX = -3;
+	s->origin.chunkY = 7;
+	s->globalX = randomRange(&world->rng, -960, 960);
+	s->globalY = randomRange(&world->rng, -540, 540);
+	float direction = randomRange(&world->rng, 0, 6.28f);
+	s->directionX = cosf(direction);
+	s->directionY = sinf(direction);
+	s->speed = 4;
+	s->remainingLives = 3;
+	s->coinVelocity = 0.25f;
+	s->clouds = world->clouds;
+	s->cloudCount = s->cloudCapacity = clouds;
+	s->coins = world->coins;
+	s->coinCount = s->coinCapacity = coins;
+	for (int i = 0; i < clouds; i++) {
+		world->clouds[i].x = randomRange(&world->rng, -2880, 2880);
+		world->clouds[i].y = randomRange(&world->rng, -1620, 1620);
+		world->clouds[i].size = randomRange(&world->rng, 0.5f, 2);
+		world->clouds[i].img_id = nextRandom(&world->rng) % CLOUD_TEXTURE_COUNT;
+	}
+	for (int i = 0; i < coins; i++) {
+		world->coins[i].x = randomRange(&world->rng, -2880, 2880);
+		world->coins[i].y = randomRange(&world->rng, -1620, 1620);
+		world->coins[i].collected = false;
+	}
+	return true;
+}
+
+static void worldFree(TestWorld* world) {
+	free(world->clouds);
+	free(world->coins);
+}
+
+//One frame of play the way the game changes its state: the plane moves and turns, time
+//passes, the coins bob, and now and then a coin is picked up or a cloud hit.
+static void worldStep(TestWorld* world) {
+	SnapshotState* s = &world->state;
+	s->rotationAngle = randomRange(&world->rng, -0.05f, 0.05f);
+	float c = cosf(s->rotationAngle), sn = sinf(s->rotationAngle);
+	float x = s->directionX * c - s->directionY * sn;
+	s->directionY = s->directionX * sn + s->directionY * c;
+	s->directionX = x;
+	s->globalX -= s->directionX * s->speed;
+	s->globalY -= s->directionY * s->speed;
+	s->gameTime += 1 / 60.0f;
+	s->coinYPos += s->coinVelocity;
+	if (fabsf(s->coinYPos) > 10) s->coinVelocity = -s->coinVelocity;
+	s->flashAlpha = (s->flashAlpha > 5) ? s->flashAlpha - 5 : 0;
+
+	uint32_t event = nextRandom(&world->rng) % 240;
+	if (event == 0 && s->coinCount) {
+		s->coins[nextRandom(&world->rng) % s->coinCount].collected = true;
+		s->score++;
+	} else if (event == 1) {
+		s->isIFraming = true;
+		s->iFrameStart = s->gameTime;
+		s->flashAlpha = 255;
+		s->speed *= 2;
+	} else if (s->isIFraming && s->gameTime - s->iFrameStart > 1) {
+		s->isIFraming = false;
+	}
+}
+
+//Every field has to come back within half a quantization step.
+static void checkRestored(const SnapshotState* a, const SnapshotState* b) {
+	CHECK(a->origin.chunkX == b->origin.chunkX && a->origin.chunkY == b->origin.chunkY);
+	CHECK(fabsf(a->globalX - b->globalX) <= 0.5f / SNAPSHOT_POSITION_STEPS + 1e-3f);
+	CHECK(fabsf(a->globalY - b->globalY) <= 0.5f / SNAPSHOT_POSITION_STEPS + 1e-3f);
+	CHECK(fabsf(a->directionX - b->directionX) < 1e-3f && fabsf(a->directionY - b->directionY) < 1e-3f);
+	CHECK(fabsf(a->speed - b->speed) <= 0.5f / SNAPSHOT_SPEED_STEPS);
+	CHECK(a->remainingLives == b->remainingLives && a->score == b->score && a->isIFraming == b->isIFraming);
+	CHECK(fabsf(a->gameTime - b->gameTime) <= 0.5f / SNAPSHOT_TIME_STEPS + 1e-4f);
+	CHECK(a->cloudCount == b->cloudCount && a->coinCount == b->coinCount);
+	for (int i = 0; i < a->cloudCount && i < b->cloudCount; i++) {
+		if (!CHECK(a->clouds[i].img_id == b->clouds[i].img_id && fabsf(a->clouds[i].x - b->clouds[i].x) <= 0.07f
+			&& fabsf(a->clouds[i].size - b->clouds[i].size) <= 0.5f / SNAPSHOT_SIZE_STEPS)) break;
+	}
+	for (int i = 0; i < a->coinCount && i < b->coinCount; i++) {
+		if (!CHECK(a->coins[i].collected == b->coins[i].collected && fabsf(a->coins[i].y - b->coins[i].y) <= 0.07f)) break;
+	}
+}
+
+//Decoding any strict prefix of an encoding has to fail, not read past it or accept half a snapshot.
+static void checkPrefixesRejected(const unsigned char* bytes, int size, const Snapshot* baseline, Snapshot* out) {
+	//a copy of exactly the prefix, so reading past it would show up under a memory checker
+	unsigned char* prefix = malloc(size);
+	if (!CHECK(prefix != NULL)) return;
+	int accepted = 0;
+	for (int length = 0; length < size; length++) {
+		memcpy(prefix, bytes, length);
+		accepted += Snapshot_Decode(prefix, length, baseline, out);
+	}
+	CHECK(accepted == 0);
+	free(prefix);
+}
+
+static void testRoundTrips(int clouds, int coins) {
+	TestWorld world, restored;
+	Snapshot base, current, decoded, again;
+	if (!CHECK(worldInit(&world, clouds, coins, 12345) && worldInit(&restored, clouds, coins, 1))) return;
+	CHECK(Snapshot_Init(&base, clouds, coins) && Snapshot_Init(&current, clouds, coins));
+	CHECK(Snapshot_Init(&decoded, clouds, coins) && Snapshot_Init(&again, clouds, coins));
+
+	CHECK(Snapshot_Capture(&base, &world.state, 100));
+	for (int i = 0; i < 30; i++) worldStep(&world);
+	world.state.coins[3].collected = true;
+	CHECK(Snapshot_Capture(&current, &world.state, 130));
+
+	//capture, restore and capture again gives the same words
+	CHECK(Snapshot_Restore(&current, &restored.state));
+	checkRestored(&world.state, &restored.state);
+	CHECK(Snapshot_Capture(&again, &restored.state, 130));
+	CHECK(Snapshot_Equal(&again, &current));
+
+	int capacity = Snapshot_MaxEncodedSize(&current);
+	unsigned char* bytes = malloc(capacity);
+	if (!CHECK(bytes != NULL)) return;
+
+	//keyframe
+	int keyframeSize = Snapshot_Encode(&current, NULL, bytes, capacity);
+	CHECK(keyframeSize > 0);
+	CHECK(Snapshot_Decode(bytes, keyframeSize, NULL, &decoded) && Snapshot_Equal(&decoded, &current) && decoded.frame == 130);
+	CHECK(Snapshot_Decode(bytes, keyframeSize, &base, &decoded) && Snapshot_Equal(&decoded, &current)); //keyframes ignore the baseline
+	checkPrefixesRejected(bytes, keyframeSize, NULL, &decoded);
+
+	//delta
+	int deltaSize = Snapshot_Encode(&current, &base, bytes, capacity);
+	CHECK(deltaSize > 0 && deltaSize < keyframeSize);
+	CHECK(Snapshot_Decode(bytes, deltaSize, &base, &decoded) && Snapshot_Equal(&decoded, &current) && decoded.frame == 130);
+	checkPrefixesRejected(bytes, deltaSize, &base, &decoded);
+
+	//decoding in place over a copy of the baseline
+	CHECK(Snapshot_Restore(&base, &restored.state) && Snapshot_Capture(&again, &restored.state, 100));
+	CHECK(Snapshot_Equal(&again, &base));
+	CHECK(Snapshot_Decode(bytes, deltaSize, &again, &again) && Snapshot_Equal(&again, &current));
+
+	//a delta needs the baseline it was made against
+	CHECK(!Snapshot_Decode(bytes, deltaSize, NULL, &decoded));
+	base.frame = 99;
+	CHECK(!Snapshot_Decode(bytes, deltaSize, &base, &decoded));
+	base.frame = 100;
+	CHECK(!Snapshot_Decode(bytes, deltaSize, &current, &decoded)); //right counts, wrong frame
+
+	//a baseline of another world (other counts) is rejected too, and encoding against one gives a keyframe
+	TestWorld other;
+	Snapshot otherSnap;
+	if (CHECK(worldInit(&other, clouds, coins + 1, 777) && Snapshot_Init(&otherSnap, clouds, coins + 1))) {
+		CHECK(Snapshot_Capture(&otherSnap, &other.state, 100));
+		CHECK(!Snapshot_Decode(bytes, deltaSize, &otherSnap, &decoded));
+		int size = Snapshot_Encode(&current, &otherSnap, bytes, capacity);
+		CHECK(size == keyframeSize && Snapshot_Decode(bytes, size, NULL, &decoded) && Snapshot_Equal(&decoded, &current));
+		Snapshot_Free(&otherSnap);
+	}
+	worldFree(&other);
+
+	//damaged or mislabeled data
+	keyframeSize = Snapshot_Encode(&current, NULL, bytes, capacity);
+	bytes[4] = SNAPSHOT_VERSION + 1;
+	CHECK(!Snapshot_Decode(bytes, keyframeSize, NULL, &decoded));
+	bytes[4] = SNAPSHOT_VERSION;
+	bytes[0] = 'X';
+	CHECK(!Snapshot_Decode(bytes, keyframeSize, NULL, &decoded));
+	bytes[0] = 'H';
+	bytes[5] = 7;
+	CHECK(!Snapshot_Decode(bytes, keyframeSize, NULL, &decoded));
+	keyframeSize = Snapshot_Encode(&current, NULL, bytes, capacity);
+	CHECK(!Snapshot_Decode(bytes, keyframeSize + 1, NULL, &decoded)); //trailing byte
+
+	//too little room, to encode or to decode into
+	CHECK(Snapshot_Encode(&current, NULL, bytes, capacity - 1) == -1);
+	Snapshot small;
+	if (CHECK(Snapshot_Init(&small, clouds - 1, coins))) {
+		CHECK(!Snapshot_Decode(bytes, keyframeSize, NULL, &small));
+		Snapshot_Free(&small);
+	}
+	restored.state.cloudCapacity = clouds - 1;
+	CHECK(!Snapshot_Restore(&current, &restored.state));
+
+	free(bytes);
+	Snapshot_Free(&base);
+	Snapshot_Free(&current);
+	Snapshot_Free(&decoded);
+	Snapshot_Free(&again);
+	worldFree(&world);
+	worldFree(&restored);
+}
+
+void SnapshotTest_Run() {
+	testRoundTrips(GAME_CLOUDS, GAME_COINS);
+	testRoundTrips(BIG_CLOUDS, BIG_COINS);
+	testRoundTrips(1, 0);
+}
+
+//Bytes per snapshot over a minute of play, as keyframes and as deltas against the frame before.
+static void benchWorld(const char* name, int clouds, int coins) {
+	TestWorld world;
+	Snapshot previous, current, decoded;
+	if (!worldInit(&world, clouds, coins, 4242) || !Snapshot_Init(&previous, clouds, coins)
+		|| !Snapshot_Init(&current, clouds, coins) || !Snapshot_Init(&decoded, clouds, coins)) return;
+	Snapshot_Capture(&previous, &world.state, 0);
+	int capacity = Snapshot_MaxEncodedSize(&previous); //every frame has the same counts
+	unsigned char* bytes = malloc(capacity);
+	if (!bytes) return;
+
+	double keyframeBytes = 0, deltaBytes = 0, encodeSeconds = 0, decodeSeconds = 0;
+	int deltaMax = 0;
+	bool ok = true;
+	for (uint32_t frame = 1; frame <= BENCH_FRAMES; frame++) {
+		worldStep(&world);
+		Snapshot_Capture(&current, &world.state, frame);
+		keyframeBytes += Snapshot_Encode(&current, NULL, bytes, capacity);
+
+		double start = Test_Seconds();
+		int size = Snapshot_Encode(&current, &previous, bytes, capacity);
+		double encoded = Test_Seconds();
+		ok &= Snapshot_Decode(bytes, size, &previous, &decoded);
+		decodeSeconds += Test_Seconds() - encoded;
+		encodeSeconds += encoded - start;
+		ok &= Snapshot_Equal(&decoded, &current);
+		deltaBytes += size;
+		deltaMax = (size > deltaMax) ? size : deltaMax;
+
+		Snapshot swap = previous;
+		previous = current;
+		current = swap;
+	}
+	CHECK(ok);
+	printf("\t%-6s %5d clouds %5d coins | raw %6d B | keyframe %7.1f B | delta %5.1f B (max %d) | encode %6.2f us, decode %6.2f us\n",
+		name, clouds, coins, (int)(sizeof(SnapshotState) + clouds * sizeof(Cloud) + coins * sizeof(Collectible)),
+		keyframeBytes / BENCH_FRAMES, deltaBytes / BENCH_FRAMES, deltaMax,
+		encodeSeconds * 1e6 / BENCH_FRAMES, decodeSeconds * 1e6 / BENCH_FRAMES);
+
+	free(bytes);
+	Snapshot_Free(&previous);
+	Snapshot_Free(&current);
+	Snapshot_Free(&decoded);
+	worldFree(&world);
+}
+
+void SnapshotTest_Bench() {
+	benchWorld("game", GAME_CLOUDS, GAME_COINS);
+	benchWorld("big", BIG_CLOUDS, BIG_COINS);
+}
@@ -0,0 +1,37 @@
+//---------------------------------------------------------
+// file:	tests.h
+//
+// brief:	Checks shared by the HotAirTests suites. Each
+//			test_*.c file holds one suite and tests_main.c
+//			lists them; a failed check prints where it was
+//			and makes the run exit with 1.
+//---------------------------------------------------------
+#pragma once
+
+#include <stdbool.h>
+
+#define CHECK(condition) Test_Check((condition), #condition, __FILE__, __LINE__)
+
+//Returns condition, so a suite can skip what depends on a failed check.
+bool Test_Check(bool condition, const char* text, const char* file, int line);
+double Test_Seconds();
+
+//Suites, one per test_*.c file. Benchmarks only run with --bench.
+void CameraTest_Run();
+void CameraTest_Bench();
+void CollectiblesTest_Run();
+void CollectiblesTest_Bench();
+void CollisionTest_Run();
+void GovernorTest_Run();
+void GovernorTest_Bench();
+void MinimapTest_Run();
+void MinimapTest_Bench();
+void MipmapTest_Run();
+void MipmapTest_Bench();
+void MixerTest_Run();
+void MixerTest_Bench();
+void PipelineTest_Run();
+void PlacementTest_Run();
+void PlacementTest_Bench();
+void SnapshotTest_Run();
+void SnapshotTest_Bench();
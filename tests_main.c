@@ -0,0 +1,97 @@
+//---------------------------------------------------------
+// file:	tests_main.c
+//
+// brief:	Entry point of the headless test runner. Runs
+//			every suite, or only the ones named, and exits
+//			with 1 if any check failed. The post-build step
+//			runs it, so a failing check fails the build.
+//
+// usage:	HotAirTests [--bench] [SUITE...]
+//---------------------------------------------------------
+
+#include "tests.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+typedef struct {
+	const char* name;
+	void (*run)();
+	void (*bench)(); //NULL for suites without one
+} TestSuite;
+
+static const TestSuite SUITES[] = {
+	{ "camera", CameraTest_Run, CameraTest_Bench },
+	{ "collectibles", CollectiblesTest_Run, CollectiblesTest_Bench },
+	{ "collision", CollisionTest_Run, NULL },
+	{ "governor", GovernorTest_Run, GovernorTest_Bench },
+	{ "minimap", MinimapTest_Run, MinimapTest_Bench },
+	{ "mipmap", MipmapTest_Run, MipmapTest_Bench },
+	{ "mixer", MixerTest_Run, MixerTest_Bench },
+	{ "pipeline", PipelineTest_Run, NULL },
+	{ "placement", PlacementTest_Run, PlacementTest_Bench },
+	{ "snapshot", SnapshotTest_Run, SnapshotTest_Bench },
+};
+#define SUITE_COUNT (int)(sizeof SUITES / sizeof SUITES[0])
+
+static int checks = 0;
+static int failures = 0;
+
+bool Test_Check(bool condition, const char* text, const char* file, int line) {
+	checks++;
+	if (!condition) {
+		failures++;
+		printf("%s(%d): FAILED %s\n", file, line, text);
+	}
+	return condition;
+}
+
+double Test_Seconds() {
+#ifdef _WIN32
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (double)counter.QuadPart / frequency.QuadPart;
+#else
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+#endif
+}
+
+static bool selected(const TestSuite* suite, int argc, char** argv) {
+	bool named = false;
+	for (int i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') continue;
+		if (!strcmp(argv[i], suite->name)) return true;
+		named = true;
+	}
+	return !named;
+}
+
+int main(int argc, char** argv) {
+	bool bench = false;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--bench")) bench = true;
+		else if (argv[i][0] == '-') {
+			printf("usage: %s [--bench] [SUITE...]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	for (int i = 0; i < SUITE_COUNT; i++) {
+		if (!selected(&SUITES[i], argc, argv)) continue;
+		int failedBefore = failures;
+		SUITES[i].run();
+		printf("%-10s %s\n", SUITES[i].name, (failures > failedBefore) ? "FAILED" : "ok");
+		if (bench && SUITES[i].bench) SUITES[i].bench();
+	}
+	printf("%d checks, %d failed\n", checks, failures);
+	return failures ? 1 : 0;
+}
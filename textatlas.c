@@ -0,0 +1,442 @@
+//---------------------------------------------------------
+// file:	textatlas.c
+//
+// brief:	Signed distance field glyph atlas (see textatlas.h).
+//---------------------------------------------------------
+
+#include "textatlas.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <windows.h>
+#pragma comment(lib, "gdi32.lib")
+
+#define ATLAS_WIDTH 1024
+#define GDI_GRAY_LEVELS 64 //GGO_GRAY8_BITMAP coverage runs from 0 to 64
+
+/* * * * * * * * * * * *
+* DISTANCE TRANSFORM   *
+* * * * * * * * * * * */
+//Dead reckoning distance transform: two raster passes that carry the nearest
+//"target" pixel along, giving near-Euclidean distances in linear time.
+static void nearestDistance(const unsigned char* inside, bool target, int w, int h, float* dist, int* nearestX, int* nearestY) {
+	const int dx[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+	const int dy[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+
+	for (int i = 0; i < w * h; i++) {
+		bool hit = (inside[i] != 0) == target;
+		dist[i] = hit ? 0 : 1e20f;
+		nearestX[i] = hit ? i % w : -1;
+		nearestY[i] = hit ? i / w : -1;
+	}
+
+	for (int pass = 0; pass < 2; pass++) {
+		//forward pass looks at the four neighbours above/left, backward at the four below/right
+		int first = (pass == 0) ? 0 : 4;
+		for (int k = 0; k < w * h; k++) {
+			int i = (pass == 0) ? k : w * h - 1 - k;
+			int x = i % w;
+			int y = i / w;
+			for (int n = first; n < first + 4; n++) {
+				int nx = x + dx[n], ny = y + dy[n];
+				if (nx < 0 || ny < 0 || nx >= w || ny >= h) continue;
+				int j = ny * w + nx;
+				if (nearestX[j] < 0) continue;
+				float ox = (float)(x - nearestX[j]);
+				float oy = (float)(y - nearestY[j]);
+				float d = sqrtf(ox * ox + oy * oy);
+				if (d < dist[i]) {
+					dist[i] = d;
+					nearestX[i] = nearestX[j];
+					nearestY[i] = nearestY[j];
+				}
+			}
+		}
+	}
+}
+
+//Turn a padded coverage bitmap into 8-bit signed distance, written straight into the atlas.
+static void buildDistanceField(const unsigned char* inside, int w, int h, unsigned char* out, int outStride) {
+	float* toInside = malloc(w * h * sizeof * toInside);
+	float* toOutside = malloc(w * h * sizeof * toOutside);
+	int* nearestX = malloc(w * h * sizeof * nearestX);
+	int* nearestY = malloc(w * h * sizeof * nearestY);
+	if (toInside && toOutside && nearestX && nearestY) {
+		nearestDistance(inside, true, w, h, toInside, nearestX, nearestY);
+		nearestDistance(inside, false, w, h, toOutside, nearestX, nearestY);
+		for (int y = 0; y < h; y++) {
+			for (int x = 0; x < w; x++) {
+				int i = y * w + x;
+				//the edge sits half a pixel between an inside and an outside pixel
+				float d = inside[i] ? toOutside[i] - 0.5f : -(toInside[i] - 0.5f);
+				float v = 128 + d * 127 / TEXT_ATLAS_SPREAD;
+				out[y * outStride + x] = (unsigned char)((v < 0) ? 0 : (v > 255) ? 255 : v);
+			}
+		}
+	}
+	free(toInside);
+	free(toOutside);
+	free(nearestX);
+	free(nearestY);
+}
+
+/* * * * * * * * *
+* ATLAS BUILDING *
+* * * * * * * * */
+bool TextAtlas_Load(TextAtlas* atlas, const char* fontPath, const char* faceName) {
+	memset(atlas, 0, sizeof * atlas);
+	if (!AddFontResourceExA(fontPath, FR_PRIVATE, 0)) return false;
+
+	HDC dc = CreateCompatibleDC(NULL);
+	HFONT font = CreateFontA(-TEXT_ATLAS_REF_SIZE, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+		OUT_TT_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH, faceName);
+	if (!dc || !font) {
+		if (font) DeleteObject(font);
+		if (dc) DeleteDC(dc);
+		RemoveFontResourceExA(fontPath, FR_PRIVATE, 0);
+		return false;
+	}
+	HGDIOBJ previous = SelectObject(dc, font);
+
+	TEXTMETRICA metrics;
+	GetTextMetricsA(dc, &metrics);
+	atlas->ascent = (float)metrics.tmAscent;
+	atlas->descent = (float)metrics.tmDescent;
+
+	//Shelf-pack every glyph's box (plus SPREAD padding on each side) into rows of ATLAS_WIDTH.
+	//First pass only measures, so the atlas can be allocated at its final height.
+	MAT2 identity = { {0, 1}, {0, 0}, {0, 0}, {0, 1} };
+	GLYPHMETRICS glyphMetrics[TEXT_ATLAS_GLYPHS];
+	int penX = 0, penY = 0, rowHeight = 0;
+	for (int i = 0; i < TEXT_ATLAS_GLYPHS; i++) {
+		GlyphInfo* g = &atlas->glyphs[i];
+		GLYPHMETRICS* gm = &glyphMetrics[i];
+		DWORD bytes = GetGlyphOutlineA(dc, TEXT_ATLAS_FIRST_CHAR + i, GGO_GRAY8_BITMAP, gm, 0, NULL, &identity);
+		g->advance = (bytes == GDI_ERROR) ? 0 : gm->gmCellIncX;
+		if (bytes == 0 || bytes == GDI_ERROR) continue; //spaces have no bitmap
+
+		g->w = gm->gmBlackBoxX + 2 * TEXT_ATLAS_SPREAD;
+		g->h = gm->gmBlackBoxY + 2 * TEXT_ATLAS_SPREAD;
+		g->left = (float)(gm->gmptGlyphOrigin.x - TEXT_ATLAS_SPREAD);
+		g->top = (float)(gm->gmptGlyphOrigin.y + TEXT_ATLAS_SPREAD);
+		if (penX + g->w > ATLAS_WIDTH) {
+			penX = 0;
+			penY += rowHeight;
+			rowHeight = 0;
+		}
+		g->x = penX;
+		g->y = penY;
+		penX += g->w;
+		rowHeight = (g->h > rowHeight) ? g->h : rowHeight;
+	}
+
+	atlas->width = ATLAS_WIDTH;
+	atlas->height = penY + rowHeight;
+	atlas->distance = calloc((size_t)atlas->width * atlas->height, 1);
+
+	//Second pass rasterizes each glyph and writes its distance field into its slot.
+	for (int i = 0; atlas->distance && i < TEXT_ATLAS_GLYPHS; i++) {
+		GlyphInfo* g = &atlas->glyphs[i];
+		if (g->w == 0) continue;
+		DWORD bytes = GetGlyphOutlineA(dc, TEXT_ATLAS_FIRST_CHAR + i, GGO_GRAY8_BITMAP, &glyphMetrics[i], 0, NULL, &identity);
+		unsigned char* bitmap = malloc(bytes);
+		unsigned char* inside = calloc((size_t)g->w * g->h, 1);
+		if (bitmap && inside && GetGlyphOutlineA(dc, TEXT_ATLAS_FIRST_CHAR + i, GGO_GRAY8_BITMAP, &glyphMetrics[i], bytes, bitmap, &identity) != GDI_ERROR) {
+			int pitch = (glyphMetrics[i].gmBlackBoxX + 3) & ~3; //GDI rows are DWORD aligned
+			for (unsigned int y = 0; y < glyphMetrics[i].gmBlackBoxY; y++) {
+				for (unsigned int x = 0; x < glyphMetrics[i].gmBlackBoxX; x++) {
+					inside[(y + TEXT_ATLAS_SPREAD) * g->w + x + TEXT_ATLAS_SPREAD] = bitmap[y * pitch + x] >= GDI_GRAY_LEVELS / 2;
+				}
+			}
+			buildDistanceField(inside, g->w, g->h, atlas->distance + (size_t)g->y * atlas->width + g->x, atlas->width);
+		}
+		free(bitmap);
+		free(inside);
+	}
+
+	SelectObject(dc, previous);
+	DeleteObject(font);
+	DeleteDC(dc);
+	RemoveFontResourceExA(fontPath, FR_PRIVATE, 0);
+
+	atlas->loaded = atlas->distance != NULL;
+	return atlas->loaded;
+}
+
+void TextAtlas_Free(TextAtlas* atlas) {
+	if (atlas->resolve.thread) {
+		WaitForSingleObject(atlas->resolve.thread, INFINITE);
+		CloseHandle(atlas->resolve.thread);
+	}
+	free(atlas->resolve.pixels);
+	for (int i = 0; i < TEXT_ATLAS_CACHED_VARIANTS; i++) {
+		if (atlas->variants[i].size) CP_Image_Free(&atlas->variants[i].image);
+	}
+	free(atlas->distance);
+	memset(atlas, 0, sizeof * atlas);
+}
+
+/* * * * * * * * * * * *
+* SIZE / COLOR CACHE   *
+* * * * * * * * * * * */
+static double nowMs(void) {
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return counter.QuadPart * 1000.0 / frequency.QuadPart;
+}
+
+//Sizes resolve in steps at most an eighth of the size apart.
+static int sizeStep(float size) {
+	int step = (size >= 40) ? 10 : (size >= 20) ? 5 : (size >= 8) ? 2 : 1;
+	int key = (int)(size / step + 0.5f) * step;
+	return (key < step) ? step : key;
+}
+
+//Resolve the distance field into coverage pixels at one scale: bilinear sample the
+//distance, convert it to output pixels, and give the edge a one pixel wide ramp. Touches
+//nothing but the distance field, so it can run on any thread.
+static unsigned char* resolvePixels(const TextAtlas* atlas, float scale, CP_Color color, int* width, int* height) {
+	int w = (int)ceilf(atlas->width * scale);
+	int h = (int)ceilf(atlas->height * scale);
+	unsigned char* pixels = malloc((size_t)w * h * 4);
+	if (!pixels) return NULL;
+	*width = w;
+	*height = h;
+
+	float toPixels = (float)TEXT_ATLAS_SPREAD / 127 * scale;
+	for (int y = 0; y < h; y++) {
+		float sy = (y + 0.5f) / scale - 0.5f;
+		int y0 = (int)floorf(sy);
+		float fy = sy - y0;
+		y0 = (y0 < 0) ? 0 : (y0 > atlas->height - 1) ? atlas->height - 1 : y0;
+		int y1 = (y0 + 1 > atlas->height - 1) ? atlas->height - 1 : y0 + 1;
+		const unsigned char* row0 = atlas->distance + (size_t)y0 * atlas->width;
+		const unsigned char* row1 = atlas->distance + (size_t)y1 * atlas->width;
+
+		for (int x = 0; x < w; x++) {
+			float sx = (x + 0.5f) / scale - 0.5f;
+			int x0 = (int)floorf(sx);
+			float fx = sx - x0;
+			x0 = (x0 < 0) ? 0 : (x0 > atlas->width - 1) ? atlas->width - 1 : x0;
+			int x1 = (x0 + 1 > atlas->width - 1) ? atlas->width - 1 : x0 + 1;
+
+			float top = row0[x0] + (row0[x1] - row0[x0]) * fx;
+			float bottom = row1[x0] + (row1[x1] - row1[x0]) * fx;
+			float distance = (top + (bottom - top) * fy - 128) * toPixels;
+			float coverage = distance + 0.5f;
+			coverage = (coverage < 0) ? 0 : (coverage > 1) ? 1 : coverage;
+
+			unsigned char* p = pixels + ((size_t)y * w + x) * 4;
+			p[0] = color.r;
+			p[1] = color.g;
+			p[2] = color.b;
+			p[3] = (unsigned char)(coverage * 255);
+		}
+	}
+	return pixels;
+}
+
+static CP_Image resolveVariant(const TextAtlas* atlas, float scale, CP_Color color) {
+	int w = 0, h = 0;
+	unsigned char* pixels = resolvePixels(atlas, scale, color, &w, &h);
+	if (!pixels) return NULL;
+	CP_Image image = CP_Image_CreateFromData(w, h, pixels);
+	free(pixels);
+	return image;
+}
+
+static bool sameColor(const TextAtlasVariant* v, CP_Color color) {
+	return v->r == color.r && v->g == color.g && v->b == color.b;
+}
+
+static TextAtlasVariant* findVariant(TextAtlas* atlas, int key, CP_Color color) {
+	for (int i = 0; i < TEXT_ATLAS_CACHED_VARIANTS; i++) {
+		TextAtlasVariant* v = &atlas->variants[i];
+		if (v->size == key && sameColor(v, color)) {
+			v->lastUsed = ++atlas->useCounter;
+			return v;
+		}
+	}
+	return NULL;
+}
+
+//The cached size of this color closest to key, or NULL if the color has none.
+static TextAtlasVariant* nearestVariant(TextAtlas* atlas, int key, CP_Color color) {
+	TextAtlasVariant* nearest = NULL;
+	for (int i = 0; i < TEXT_ATLAS_CACHED_VARIANTS; i++) {
+		TextAtlasVariant* v = &atlas->variants[i];
+		if (!v->size || !sameColor(v, color)) continue;
+		if (!nearest || abs(v->size - key) < abs(nearest->size - key)) nearest = v;
+	}
+	if (nearest) nearest->lastUsed = ++atlas->useCounter;
+	return nearest;
+}
+
+//Into the least recently used slot.
+static void storeVariant(TextAtlas* atlas, int key, CP_Color color, CP_Image image) {
+	TextAtlasVariant* oldest = &atlas->variants[0];
+	for (int i = 1; i < TEXT_ATLAS_CACHED_VARIANTS; i++) {
+		if (atlas->variants[i].lastUsed < oldest->lastUsed) oldest = &atlas->variants[i];
+	}
+	if (oldest->size) CP_Image_Free(&oldest->image);
+	oldest->size = key;
+	oldest->r = color.r;
+	oldest->g = color.g;
+	oldest->b = color.b;
+	oldest->image = image;
+	oldest->scale = (float)key / TEXT_ATLAS_REF_SIZE;
+	oldest->lastUsed = ++atlas->useCounter;
+}
+
+void TextAtlas_Prepare(TextAtlas* atlas, float size, CP_Color color) {
+	if (!atlas->loaded) return;
+	int key = sizeStep(size);
+	if (findVariant(atlas, key, color)) return;
+	CP_Image image = resolveVariant(atlas, (float)key / TEXT_ATLAS_REF_SIZE, color);
+	if (image) storeVariant(atlas, key, color, image);
+}
+
+/* * * * * * * * * * * *
+* BACKGROUND RESOLVE   *
+* * * * * * * * * * * */
+static DWORD WINAPI resolveMain(LPVOID param) {
+	TextAtlasResolve* resolve = &((TextAtlas*)param)->resolve;
+	double start = nowMs();
+	resolve->pixels = resolvePixels(param, (float)resolve->size / TEXT_ATLAS_REF_SIZE, resolve->color, &resolve->width, &resolve->height);
+	resolve->resolveMs = (float)(nowMs() - start);
+	return 0;
+}
+
+//Only one resolve runs at a time; other misses start theirs on a later draw.
+static void startResolve(TextAtlas* atlas, int key, CP_Color color) {
+	TextAtlasResolve* resolve = &atlas->resolve;
+	if (resolve->thread) return;
+	resolve->size = key;
+	resolve->color = color;
+	resolve->pixels = NULL;
+	resolve->thread = CreateThread(NULL, 0, resolveMain, atlas, 0, NULL);
+	if (!resolve->thread) {
+		//no thread to be had, pay for it here as before
+		CP_Image image = resolveVariant(atlas, (float)key / TEXT_ATLAS_REF_SIZE, color);
+		if (image) storeVariant(atlas, key, color, image);
+	}
+}
+
+//Cache the finished resolve, if there is one. Creating the image has to happen on this thread.
+static void collectResolve(TextAtlas* atlas) {
+	TextAtlasResolve* resolve = &atlas->resolve;
+	if (!resolve->thread || WaitForSingleObject(resolve->thread, 0) != WAIT_OBJECT_0) return;
+	CloseHandle(resolve->thread);
+	resolve->thread = NULL;
+	if (!resolve->pixels) return;
+
+	double start = nowMs();
+	CP_Image image = CP_Image_CreateFromData(resolve->width, resolve->height, resolve->pixels);
+	atlas->stats.uploadMs = (float)(nowMs() - start);
+	atlas->stats.resolveMs = resolve->resolveMs;
+	free(resolve->pixels);
+	resolve->pixels = NULL;
+	if (image && !findVariant(atlas, resolve->size, resolve->color)) storeVariant(atlas, resolve->size, resolve->color, image);
+	else if (image) CP_Image_Free(&image); //prepared meanwhile
+}
+
+/* * * * * * *
+* DRAW TEXT  *
+* * * * * * */
+float TextAtlas_MeasureText(TextAtlas* atlas, const char* text, float size) {
+	float width = 0;
+	for (const char* c = text; *c; c++) {
+		if (*c < TEXT_ATLAS_FIRST_CHAR || *c > TEXT_ATLAS_LAST_CHAR) continue;
+		width += atlas->glyphs[*c - TEXT_ATLAS_FIRST_CHAR].advance;
+	}
+	return width * size / TEXT_ATLAS_REF_SIZE;
+}
+
+void TextAtlas_DrawText(TextAtlas* atlas, const char* text, float x, float y, float size, CP_Color color, CP_TEXT_ALIGN_HORIZONTAL h, CP_TEXT_ALIGN_VERTICAL v) {
+	if (!atlas->loaded) return;
+	collectResolve(atlas);
+	int key = sizeStep(size);
+	TextAtlasVariant* variant = findVariant(atlas, key, color);
+	if (!variant) {
+		atlas->stats.misses++;
+		startResolve(atlas, key, color);
+		variant = findVariant(atlas, key, color); //resolved here if the thread couldn't start
+		if (!variant) variant = nearestVariant(atlas, key, color);
+	}
+	if (!variant) {
+		atlas->stats.fallbacks++;
+		CP_Settings_Save();
+		CP_Settings_Fill(color);
+		CP_Settings_TextSize(size);
+		CP_Settings_TextAlignment(h, v);
+		CP_Font_DrawText(text, x, y);
+		CP_Settings_Restore();
+		return;
+	}
+	float scale = size / TEXT_ATLAS_REF_SIZE; //on screen
+	float imageScale = variant->scale; //in the image, the size step it was resolved at
+
+	float width = TextAtlas_MeasureText(atlas, text, size);
+	float penX = (h == CP_TEXT_ALIGN_H_CENTER) ? x - width / 2 : (h == CP_TEXT_ALIGN_H_RIGHT) ? x - width : x;
+	float baseline = (v == CP_TEXT_ALIGN_V_MIDDLE) ? y + (atlas->ascent - atlas->descent) / 2 * scale :
+		(v == CP_TEXT_ALIGN_V_TOP) ? y + atlas->ascent * scale :
+		(v == CP_TEXT_ALIGN_V_BOTTOM) ? y - atlas->descent * scale : y;
+
+	//All glyphs come from the same image, so the renderer can batch the whole run.
+	CP_Settings_Save();
+	CP_Settings_ImageMode(CP_POSITION_CORNER);
+	for (const char* c = text; *c; c++) {
+		if (*c < TEXT_ATLAS_FIRST_CHAR || *c > TEXT_ATLAS_LAST_CHAR) continue;
+		const GlyphInfo* g = &atlas->glyphs[*c - TEXT_ATLAS_FIRST_CHAR];
+		if (g->w) {
+			float u0 = g->x * imageScale, v0 = g->y * imageScale;
+			float u1 = (g->x + g->w) * imageScale, v1 = (g->y + g->h) * imageScale;
+			CP_Image_DrawSubImage(variant->image, penX + g->left * scale, baseline - g->top * scale, g->w * scale, g->h * scale, u0, v0, u1, v1, color.a);
+		}
+		penX += g->advance * scale;
+	}
+	CP_Settings_Restore();
+}
+
+/* * * * * * *
+* BENCHMARK  *
+* * * * * * */
+//Both paths only record draw calls here and are flushed at the end of the frame,
+//so this measures the CPU cost the game thread pays per glyph.
+void TextAtlas_Benchmark(TextAtlas* atlas, int iterations, double* atlasGlyphsPerMs, double* fontGlyphsPerMs, double* missMs) {
+	//the HUD strings game_update draws every frame, at the sizes the game uses
+	const char* strings[] = { "Speed: 10", "Direction: 180", "Game Time: 12.3", "Score: 40", "Lives: 3", "Collect the coin for points!" };
+	const float sizes[] = { 40, 40, 40, 40, 40, 60 };
+	const int count = sizeof strings / sizeof * strings;
+	CP_Color white = CP_Color_Create(255, 255, 255, 255);
+	long long glyphs = 0;
+	for (int i = 0; i < count; i++) glyphs += strlen(strings[i]);
+	glyphs *= iterations;
+
+	for (int i = 0; i < count; i++) TextAtlas_Prepare(atlas, sizes[i], white);
+	double start = nowMs();
+	for (int n = 0; n < iterations; n++) {
+		for (int i = 0; i < count; i++) TextAtlas_DrawText(atlas, strings[i], 200, 50.0f + 50 * i, sizes[i], white, CP_TEXT_ALIGN_H_CENTER, CP_TEXT_ALIGN_V_MIDDLE);
+	}
+	double atlasMs = nowMs() - start;
+
+	CP_Settings_Fill(white);
+	start = nowMs();
+	for (int n = 0; n < iterations; n++) {
+		for (int i = 0; i < count; i++) {
+			CP_Settings_TextSize(sizes[i]);
+			CP_Font_DrawText(strings[i], 200, 50.0f + 50 * i);
+		}
+	}
+	double fontMs = nowMs() - start;
+
+	//A miss as it used to be paid in the middle of a frame, at the biggest HUD size.
+	start = nowMs();
+	CP_Image missed = resolveVariant(atlas, 60.0f / TEXT_ATLAS_REF_SIZE, white);
+	*missMs = nowMs() - start;
+	if (missed) CP_Image_Free(&missed);
+
+	*atlasGlyphsPerMs = (atlasMs > 0) ? glyphs / atlasMs : 0;
+	*fontGlyphsPerMs = (fontMs > 0) ? glyphs / fontMs : 0;
+}
@@ -0,0 +1,89 @@
+//---------------------------------------------------------
+// file:	textatlas.h
+//
+// brief:	Text drawn from one signed distance field glyph
+//			atlas per font. Every string is one run of quads cut
+//			from a single image, at any text size.
+//---------------------------------------------------------
+#pragma once
+
+#include "cprocessing.h"
+#include <stdbool.h>
+
+#define TEXT_ATLAS_FIRST_CHAR 32
+#define TEXT_ATLAS_LAST_CHAR 126
+#define TEXT_ATLAS_GLYPHS (TEXT_ATLAS_LAST_CHAR - TEXT_ATLAS_FIRST_CHAR + 1)
+#define TEXT_ATLAS_REF_SIZE 64 //em size in pixels the distance field is built at
+#define TEXT_ATLAS_SPREAD 8 //distance field range in reference pixels, also the glyph padding
+#define TEXT_ATLAS_CACHED_VARIANTS 12
+
+typedef struct {
+	//all in reference pixels (TEXT_ATLAS_REF_SIZE em)
+	int x, y, w, h; //rect inside the atlas, padding included
+	float left; //pen position to the left edge of the rect
+	float top; //baseline to the top edge of the rect
+	float advance;
+} GlyphInfo;
+
+/***
+* CProcessing has no shader hook, so the distance field can't be thresholded on the GPU.
+* Instead each text size and color gets its own coverage image, resolved from the distance
+* field on the CPU and cached. Edges stay sharp at any size, and every string is still
+* drawn from a single image.
+*
+* Sizes are resolved in steps no more than an eighth apart and drawn scaled from the
+* nearest one. Resolving takes milliseconds (TextAtlas_Benchmark reports how many), so a
+* draw that finds no image for its size and color doesn't wait for one: a thread resolves
+* it while the text is drawn from the nearest size of that color, or with CP_Font_DrawText
+* when there is none, until it is done.
+***/
+typedef struct {
+	int size; //text size step in pixels, 0 if the slot is empty
+	unsigned char r, g, b;
+	CP_Image image;
+	float scale; //size / TEXT_ATLAS_REF_SIZE
+	unsigned int lastUsed;
+} TextAtlasVariant;
+
+//One resolve off the drawing thread at a time.
+typedef struct {
+	void* thread; //NULL when idle
+	int size;
+	CP_Color color;
+	unsigned char* pixels; //the worker's result, width x height RGBA
+	int width, height;
+	float resolveMs;
+} TextAtlasResolve;
+
+typedef struct {
+	int misses; //draws that found no image of their own
+	int fallbacks; //of those, drawn with CP_Font_DrawText because no size of their color was ready
+	float resolveMs; //the latest resolve, on the worker
+	float uploadMs; //turning its pixels into an image, on the drawing thread
+} TextAtlasStats;
+
+typedef struct {
+	bool loaded;
+	int width, height; //distance field dimensions
+	unsigned char* distance; //128 is the glyph edge, higher is inside
+	GlyphInfo glyphs[TEXT_ATLAS_GLYPHS];
+	float ascent, descent; //reference pixels
+	TextAtlasVariant variants[TEXT_ATLAS_CACHED_VARIANTS];
+	unsigned int useCounter;
+	TextAtlasResolve resolve;
+	TextAtlasStats stats;
+} TextAtlas;
+
+//Rasterize the font through GDI and build its distance field. faceName is the font's family name.
+bool TextAtlas_Load(TextAtlas* atlas, const char* fontPath, const char* faceName);
+void TextAtlas_Free(TextAtlas* atlas);
+
+//Build the coverage image for a size and color now, so no frame draws it from another size first.
+void TextAtlas_Prepare(TextAtlas* atlas, float size, CP_Color color);
+
+float TextAtlas_MeasureText(TextAtlas* atlas, const char* text, float size);
+void TextAtlas_DrawText(TextAtlas* atlas, const char* text, float x, float y, float size, CP_Color color, CP_TEXT_ALIGN_HORIZONTAL h, CP_TEXT_ALIGN_VERTICAL v);
+
+//Draws the same strings with both paths and returns glyphs per millisecond for each, and
+//what a miss costs when resolved on the spot: milliseconds to build and upload one image.
+void TextAtlas_Benchmark(TextAtlas* atlas, int iterations, double* atlasGlyphsPerMs, double* fontGlyphsPerMs, double* missMs);
@@ -0,0 +1,306 @@
+//---------------------------------------------------------
+// file:	texture.c
+//
+// brief:	Preprocessed image format and its LZ4 block codec
+//			(see texture.h).
+//---------------------------------------------------------
+
+#include "texture.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAGIC "HATX"
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5 //a block always ends with at least this many literals
+#define LZ4_MATCH_LIMIT 12 //and no match starts closer than this to its end
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_HASH_BITS 16
+
+#define FNV_OFFSET 14695981039346656037ull
+#define FNV_PRIME 1099511628211ull
+
+typedef struct {
+	char magic[4];
+	uint16_t version;
+	uint16_t encoding;
+	uint32_t width, height;
+	uint32_t dataSize; //bytes after the header
+	uint32_t sourceSize; //bytes in the image file the pixels came from
+	uint64_t sourceHash; //Texture_HashSource of that file
+} TextureHeader;
+
+/* * * * * * * *
+* LZ4 BLOCKS   *
+* * * * * * * */
+//Only the block format: a run of sequences, each some literals then a copy from earlier output.
+//See https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+static int lz4Bound(int size) { return size + size / 255 + 16; }
+
+static uint32_t read32(const unsigned char* p) {
+	uint32_t value;
+	memcpy(&value, p, sizeof value);
+	return value;
+}
+
+static unsigned char* writeLength(unsigned char* out, int length) {
+	for (; length >= 255; length -= 255) *out++ = 255;
+	*out++ = (unsigned char)length;
+	return out;
+}
+
+//matchLength 0 writes the literals-only sequence that ends a block.
+static unsigned char* writeSequence(unsigned char* out, const unsigned char* literals, int literalCount, int offset, int matchLength) {
+	unsigned char* token = out++;
+	*token = (unsigned char)(((literalCount < 15) ? literalCount : 15) << 4);
+	if (literalCount >= 15) out = writeLength(out, literalCount - 15);
+	memcpy(out, literals, literalCount);
+	out += literalCount;
+	if (matchLength) {
+		*out++ = (unsigned char)(offset & 255);
+		*out++ = (unsigned char)(offset >> 8);
+		int length = matchLength - LZ4_MIN_MATCH;
+		*token |= (unsigned char)((length < 15) ? length : 15);
+		if (length >= 15) out = writeLength(out, length - 15);
+	}
+	return out;
+}
+
+static int matchLength(const unsigned char* in, int size, int from, int at) {
+	int length = LZ4_MIN_MATCH;
+	while (at + length < size - LZ4_LAST_LITERALS && in[from + length] == in[at + length]) length++;
+	return length;
+}
+
+//Greedy, one hash table slot per 4 byte sequence. Much slower than the real LZ4's
+//compressor, but only the converter runs it; any LZ4 decoder reads the result.
+static int lz4Compress(const unsigned char* in, int size, unsigned char* out) {
+	int* table = malloc(sizeof(int) << LZ4_HASH_BITS);
+	if (!table) return -1;
+	memset(table, 0xff, sizeof(int) << LZ4_HASH_BITS); //-1, nothing seen yet
+	unsigned char* o = out;
+	int anchor = 0;
+	for (int i = 0; i < size - LZ4_MATCH_LIMIT;) {
+		uint32_t hash = (read32(in + i) * 2654435761u) >> (32 - LZ4_HASH_BITS);
+		int candidate = table[hash];
+		table[hash] = i;
+		if (candidate < 0 || i - candidate > LZ4_MAX_OFFSET || read32(in + candidate) != read32(in + i)) {
+			i++;
+			continue;
+		}
+		int length = matchLength(in, size, candidate, i);
+		//One step of lazy matching: if the match starting a byte later is longer, take that one.
+		if (i + 1 < size - LZ4_MATCH_LIMIT) {
+			uint32_t nextHash = (read32(in + i + 1) * 2654435761u) >> (32 - LZ4_HASH_BITS);
+			int next = table[nextHash];
+			table[nextHash] = i + 1;
+			if (next >= 0 && i + 1 - next <= LZ4_MAX_OFFSET && read32(in + next) == read32(in + i + 1)) {
+				int nextLength = matchLength(in, size, next, i + 1);
+				if (nextLength > length + 1) {
+					i++;
+					candidate = next;
+					length = nextLength;
+				}
+			}
+		}
+		o = writeSequence(o, in + anchor, i - anchor, i - candidate, length);
+		i += length;
+		anchor = i;
+	}
+	o = writeSequence(o, in + anchor, size - anchor, 0, 0);
+	free(table);
+	return (int)(o - out);
+}
+
+static bool readLength(const unsigned char** in, const unsigned char* end, int* length) {
+	int byte;
+	do {
+		if (*in == end) return false;
+		byte = *(*in)++;
+		*length += byte;
+	} while (byte == 255);
+	return true;
+}
+
+//Checks every length and offset, a damaged file fails instead of writing outside out.
+static bool lz4Decompress(const unsigned char* in, int size, unsigned char* out, int outSize) {
+	const unsigned char* end = in + size;
+	unsigned char* o = out;
+	unsigned char* outEnd = out + outSize;
+	while (in < end) {
+		int token = *in++;
+		int literals = token >> 4;
+		if (literals == 15 && !readLength(&in, end, &literals)) return false;
+		if (literals > end - in || literals > outEnd - o) return false;
+		//Most runs are short. Away from the ends, copy a fixed 16 bytes, which the compiler
+		//turns into two moves instead of a call; the bytes past the run get overwritten next.
+		if (literals <= 16 && end - in >= 16 && outEnd - o >= 16) {
+			memcpy(o, in, 16);
+		} else {
+			memcpy(o, in, literals);
+		}
+		in += literals;
+		o += literals;
+		if (in == end) break; //the last sequence has no match
+
+		if (end - in < 2) return false;
+		int offset = in[0] | (in[1] << 8);
+		in += 2;
+		int length = token & 15;
+		if (length == 15 && !readLength(&in, end, &length)) return false;
+		length += LZ4_MIN_MATCH;
+		if (offset == 0 || offset > o - out || length > outEnd - o) return false;
+		if (offset >= 16 && length <= 32 && outEnd - o >= 32) {
+			//same for short matches, in 16 byte steps that never read what they write
+			memcpy(o, o - offset, 16);
+			memcpy(o + 16, o - offset + 16, 16);
+			o += length;
+			continue;
+		}
+		//A match may overlap itself (a run of one color is offset 4), so the output repeats every
+		//offset bytes. Copy 8 at a time from span back, a whole number of periods and at least 8,
+		//once the bytes between o - offset and o - offset + span exist.
+		int span = (8 + offset - 1) / offset * offset;
+		int done = 0;
+		for (; done < span - offset && done < length; done++) o[done] = o[done - offset];
+		if (outEnd - o >= length + 8) {
+			for (; done < length; done += 8) memcpy(o + done, o + done - span, 8);
+		} else {
+			for (; done + 8 <= length; done += 8) memcpy(o + done, o + done - span, 8);
+			for (; done < length; done++) o[done] = o[done - offset];
+		}
+		o += length;
+	}
+	return o == outEnd;
+}
+
+/* * * * * * * * *
+* TEXTURE FILES  *
+* * * * * * * * */
+uint64_t Texture_HashSource(const unsigned char* source, int sourceSize) {
+	uint64_t hash = FNV_OFFSET;
+	for (int i = 0; i < sourceSize; i++) hash = (hash ^ source[i]) * FNV_PRIME;
+	return hash;
+}
+
+int Texture_MaxEncodedSize(int width, int height) {
+	return (int)sizeof(TextureHeader) + lz4Bound(width * height * 4);
+}
+
+int Texture_Encode(const CP_Color* pixels, int width, int height, TextureEncoding encoding, const unsigned char* source, int sourceSize, unsigned char* out, int capacity) {
+	if (width <= 0 || height <= 0 || width > TEXTURE_MAX_SIZE || height > TEXTURE_MAX_SIZE) return -1;
+	int rawSize = width * height * 4;
+	if (capacity < Texture_MaxEncodedSize(width, height)) return -1;
+
+	TextureHeader header = { 0 };
+	memcpy(header.magic, MAGIC, sizeof header.magic);
+	header.version = TEXTURE_VERSION;
+	header.width = width;
+	header.height = height;
+	header.sourceSize = sourceSize;
+	header.sourceHash = Texture_HashSource(source, sourceSize);
+	unsigned char* data = out + sizeof header;
+	int dataSize = (encoding == TEXTURE_LZ4) ? lz4Compress((const unsigned char*)pixels, rawSize, data) : -1;
+	if (dataSize >= 0 && dataSize < rawSize) {
+		header.encoding = TEXTURE_LZ4;
+	} else {
+		//asked for raw, or nothing to gain from LZ4
+		header.encoding = TEXTURE_RAW;
+		dataSize = rawSize;
+		memcpy(data, pixels, rawSize);
+	}
+	header.dataSize = dataSize;
+	memcpy(out, &header, sizeof header);
+	return (int)sizeof header + dataSize;
+}
+
+bool Texture_Info(const unsigned char* bytes, int size, int* width, int* height, TextureEncoding* encoding) {
+	TextureHeader header;
+	if (size < (int)sizeof header) return false;
+	memcpy(&header, bytes, sizeof header);
+	if (memcmp(header.magic, MAGIC, sizeof header.magic) || header.version != TEXTURE_VERSION) return false;
+	if (header.width == 0 || header.height == 0 || header.width > TEXTURE_MAX_SIZE || header.height > TEXTURE_MAX_SIZE) return false;
+	if (header.dataSize != (uint32_t)(size - (int)sizeof header)) return false;
+	if (header.encoding == TEXTURE_RAW ? header.dataSize != header.width * header.height * 4 : header.encoding != TEXTURE_LZ4) return false;
+	*width = (int)header.width;
+	*height = (int)header.height;
+	*encoding = (TextureEncoding)header.encoding;
+	return true;
+}
+
+bool Texture_MadeFrom(const unsigned char* bytes, int size, const unsigned char* source, int sourceSize) {
+	TextureHeader header;
+	if (size < (int)sizeof header) return false;
+	memcpy(&header, bytes, sizeof header);
+	//the size first, most edits change it and then there is nothing to hash
+	return header.sourceSize == (uint32_t)sourceSize && header.sourceHash == Texture_HashSource(source, sourceSize);
+}
+
+bool Texture_Decode(const unsigned char* bytes, int size, unsigned char* pixels) {
+	int width, height;
+	TextureEncoding encoding;
+	if (!Texture_Info(bytes, size, &width, &height, &encoding)) return false;
+	const unsigned char* data = bytes + sizeof(TextureHeader);
+	int dataSize = size - (int)sizeof(TextureHeader);
+	if (encoding == TEXTURE_RAW) {
+		memcpy(pixels, data, dataSize);
+		return true;
+	}
+	return lz4Decompress(data, dataSize, pixels, width * height * 4);
+}
+
+void Texture_PackedPath(const char* path, char* out, int capacity) {
+	const char* dot = strrchr(path, '.');
+	const char* slash = strrchr(path, '/');
+	const char* backslash = strrchr(path, '\\');
+	if (backslash > slash) slash = backslash;
+	int stem = (dot && dot > slash) ? (int)(dot - path) : (int)strlen(path);
+	sprintf_s(out, capacity, "%.*s%s", stem, path, TEXTURE_EXTENSION);
+}
+
+static CP_Image createImage(unsigned char* bytes, int size) {
+	int width, height;
+	TextureEncoding encoding;
+	if (!Texture_Info(bytes, size, &width, &height, &encoding)) return NULL;
+	//A raw file already holds what CreateFromData wants; only LZ4 needs somewhere to decode to.
+	if (encoding == TEXTURE_RAW) return CP_Image_CreateFromData(width, height, bytes + sizeof(TextureHeader));
+	unsigned char* pixels = malloc((size_t)width * height * 4);
+	CP_Image image = (pixels && Texture_Decode(bytes, size, pixels)) ? CP_Image_CreateFromData(width, height, pixels) : NULL;
+	free(pixels);
+	return image;
+}
+
+//The whole file, or NULL if it can't be read.
+static unsigned char* readFile(const char* path, int* size) {
+	FILE* file = NULL;
+	if (fopen_s(&file, path, "rb") != 0 || !file) return NULL;
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	unsigned char* bytes = (length > 0) ? malloc(length) : NULL;
+	if (bytes && fread(bytes, 1, length, file) != (size_t)length) {
+		free(bytes);
+		bytes = NULL;
+	}
+	fclose(file);
+	*size = (int)length;
+	return bytes;
+}
+
+CP_Image Texture_Load(const char* path) {
+	char packedPath[260];
+	Texture_PackedPath(path, packedPath, sizeof packedPath);
+	CP_Image image = NULL;
+	int size = 0, sourceSize = 0;
+	unsigned char* bytes = readFile(packedPath, &size);
+	if (bytes) {
+		unsigned char* source = readFile(path, &sourceSize);
+		if (!source || Texture_MadeFrom(bytes, size, source, sourceSize)) image = createImage(bytes, size);
+		free(source);
+		free(bytes);
+	}
+	//No .tex, one written by another version of this file, or one from before the image last
+	//changed: the original still loads.
+	return image ? image : CP_Image_Load(path);
+}
@@ -0,0 +1,52 @@
+//---------------------------------------------------------
+// file:	texture.h
+//
+// brief:	Preprocessed images. HotAirTextures (texture_pack.c)
+//			decodes an asset once, offline, and writes its
+//			pixels next to it as a .tex: a small header, then
+//			the RGBA bytes either raw or LZ4 compressed. Loading
+//			one is a file read and at most an LZ4 decode, handed
+//			straight to CP_Image_CreateFromData. The header
+//			records the size and a hash of the image it was made
+//			from, so a .tex left behind by an edited image is
+//			never used in its place.
+//---------------------------------------------------------
+#pragma once
+
+#include "cprocessing.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TEXTURE_EXTENSION ".tex"
+#define TEXTURE_VERSION 2
+#define TEXTURE_MAX_SIZE 8192 //pixels per side
+
+typedef enum {
+	TEXTURE_RAW, //width * height * 4 bytes as they are
+	TEXTURE_LZ4 //the same bytes as one LZ4 block
+} TextureEncoding;
+
+//FNV-1a over the bytes of an image file, what a .tex remembers its source by.
+uint64_t Texture_HashSource(const unsigned char* source, int sourceSize);
+
+//Bytes Texture_Encode needs at most for a width x height image.
+int Texture_MaxEncodedSize(int width, int height);
+//pixels are width * height colors with straight alpha, as CP_Image_GetPixelData returns them and
+//CP_Image_CreateFromData takes them; source is the file they were loaded from. Returns the size
+//of the .tex, or -1 if it doesn't fit in capacity.
+int Texture_Encode(const CP_Color* pixels, int width, int height, TextureEncoding encoding, const unsigned char* source, int sourceSize, unsigned char* out, int capacity);
+//Check the header: false if bytes aren't a .tex of this version.
+bool Texture_Info(const unsigned char* bytes, int size, int* width, int* height, TextureEncoding* encoding);
+//Whether the .tex in bytes was made from exactly this source file.
+bool Texture_MadeFrom(const unsigned char* bytes, int size, const unsigned char* source, int sourceSize);
+//Fills width * height * 4 bytes of pixels. False if the data is damaged.
+bool Texture_Decode(const unsigned char* bytes, int size, unsigned char* pixels);
+
+//"Assets/redhit.png" becomes "Assets/redhit.tex".
+void Texture_PackedPath(const char* path, char* out, int capacity);
+/***
+* The image at path, from its .tex when there is a readable one made from the file at path as
+* it is now, and through CP_Image_Load otherwise. Checking costs reading and hashing the
+* compressed file, a fraction of decoding it. When only the .tex is there, it is used as is.
+***/
+CP_Image Texture_Load(const char* path);
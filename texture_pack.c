@@ -0,0 +1,148 @@
+//---------------------------------------------------------
+// file:	texture_pack.c
+//
+// brief:	Entry point of the offline texture converter. Loads
+//			each image through CP_Image_Load, so the pixels are
+//			exactly the ones the game would get, and writes them
+//			next to it as a .tex (see texture.h). Afterwards it
+//			times loading every image both ways.
+//
+// usage:	HotAirTextures [--raw] [IMAGE...]
+//			--raw	store the pixels uncompressed, not LZ4
+//			Without an IMAGE, converts every image main.c loads.
+//			Run it from the project directory after changing
+//			anything in Assets/; until then the game notices
+//			the .tex is out of date and loads the image itself.
+//---------------------------------------------------------
+
+#include "cprocessing.h"
+#include "texture.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCHMARK_RUNS 5 //per image and format, the fastest counts
+
+static const char* GAME_IMAGES[] = { "Assets/DigiPen_BLACK.png", "Assets/cloudtextures.png", "Assets/redhit.png", "Assets/coin.png" };
+
+static const char** images = GAME_IMAGES;
+static int imageCount = sizeof GAME_IMAGES / sizeof * GAME_IMAGES;
+static TextureEncoding encoding = TEXTURE_LZ4;
+static int exitCode;
+
+static double nowMs(void) {
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return counter.QuadPart * 1000.0 / frequency.QuadPart;
+}
+
+static long fileSize(const char* path) {
+	FILE* file = NULL;
+	if (fopen_s(&file, path, "rb") != 0 || !file) return -1;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fclose(file);
+	return size;
+}
+
+static unsigned char* readFile(const char* path, int* size) {
+	long length = fileSize(path);
+	FILE* file = NULL;
+	if (length <= 0 || fopen_s(&file, path, "rb") != 0 || !file) return NULL;
+	unsigned char* bytes = malloc(length);
+	if (bytes && fread(bytes, 1, length, file) != (size_t)length) {
+		free(bytes);
+		bytes = NULL;
+	}
+	fclose(file);
+	*size = (int)length;
+	return bytes;
+}
+
+static bool convert(const char* path) {
+	int sourceSize = 0;
+	unsigned char* source = readFile(path, &sourceSize);
+	CP_Image image = source ? CP_Image_Load(path) : NULL;
+	if (!image) {
+		free(source);
+		return false;
+	}
+	int width = CP_Image_GetWidth(image);
+	int height = CP_Image_GetHeight(image);
+	int capacity = Texture_MaxEncodedSize(width, height);
+	CP_Color* pixels = malloc((size_t)width * height * sizeof * pixels);
+	unsigned char* bytes = malloc(capacity);
+	int size = -1;
+	if (pixels && bytes) {
+		CP_Image_GetPixelData(image, pixels);
+		size = Texture_Encode(pixels, width, height, encoding, source, sourceSize, bytes, capacity);
+	}
+	CP_Image_Free(&image);
+
+	char packedPath[260];
+	Texture_PackedPath(path, packedPath, sizeof packedPath);
+	FILE* file = NULL;
+	bool written = size > 0 && fopen_s(&file, packedPath, "wb") == 0 && file && fwrite(bytes, 1, size, file) == (size_t)size;
+	if (file && fclose(file) != 0) written = false;
+	free(pixels);
+	free(bytes);
+	free(source);
+	return written;
+}
+
+//The whole cost the game pays per image at startup: read, decode and upload.
+static double fastestLoad(const char* path, bool packed) {
+	double best = 1e30;
+	for (int run = 0; run < BENCHMARK_RUNS; run++) {
+		double start = nowMs();
+		CP_Image image = packed ? Texture_Load(path) : CP_Image_Load(path);
+		double ms = nowMs() - start;
+		if (image) CP_Image_Free(&image);
+		if (ms < best) best = ms;
+	}
+	return best;
+}
+
+static void convertAll(void) {
+	CP_System_SetWindowSize(320, 240);
+	for (int i = 0; i < imageCount; i++) {
+		if (!convert(images[i])) {
+			printf("could not convert %s\n", images[i]);
+			exitCode = 1;
+		}
+	}
+
+	printf("%-32s %10s %10s %10s %10s\n", "image", "png ms", "tex ms", "png KB", "tex KB");
+	double pngTotal = 0, packedTotal = 0;
+	for (int i = 0; i < imageCount; i++) {
+		char packedPath[260];
+		Texture_PackedPath(images[i], packedPath, sizeof packedPath);
+		double pngMs = fastestLoad(images[i], false);
+		double packedMs = fastestLoad(images[i], true);
+		pngTotal += pngMs;
+		packedTotal += packedMs;
+		printf("%-32s %10.2f %10.2f %10ld %10ld\n", images[i], pngMs, packedMs, fileSize(images[i]) / 1024, fileSize(packedPath) / 1024);
+	}
+	printf("%-32s %10.2f %10.2f\n", "total", pngTotal, packedTotal);
+	CP_Engine_Terminate();
+}
+
+static void idle(void) {
+
+}
+
+int main(int argc, char** argv) {
+	int first = 1;
+	if (argc > 1 && !strcmp(argv[1], "--raw")) {
+		encoding = TEXTURE_RAW;
+		first = 2;
+	}
+	if (first < argc) {
+		images = (const char**)argv + first;
+		imageCount = argc - first;
+	}
+	CP_Engine_SetNextGameState(convertAll, idle, idle);
+	CP_Engine_Run();
+	return exitCode;
+}
@@ -0,0 +1,269 @@
+//---------------------------------------------------------
+// file:	tuning.c
+//
+// brief:	Tuning file parser and watcher thread (see tuning.h).
+//---------------------------------------------------------
+
+#include "tuning.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+typedef volatile LONG AtomicVersion;
+#define THREAD_RESULT DWORD WINAPI
+static uint32_t loadVersion(AtomicVersion* version) { return (uint32_t)InterlockedCompareExchange(version, 0, 0); }
+static void storeVersion(AtomicVersion* version, uint32_t value) { InterlockedExchange(version, (LONG)value); }
+static FILE* openFile(const char* path, const char* mode) {
+	FILE* file = NULL;
+	return (fopen_s(&file, path, mode) == 0) ? file : NULL;
+}
+#else
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+typedef volatile uint32_t AtomicVersion;
+#define THREAD_RESULT void*
+static uint32_t loadVersion(AtomicVersion* version) { return __atomic_load_n(version, __ATOMIC_ACQUIRE); }
+static void storeVersion(AtomicVersion* version, uint32_t value) { __atomic_store_n(version, value, __ATOMIC_RELEASE); }
+static FILE* openFile(const char* path, const char* mode) { return fopen(path, mode); }
+#endif
+
+static const struct {
+	const char* name;
+	size_t offset;
+} FIELDS[] = {
+	{ "speed", offsetof(Tuning, speed) },
+	{ "speedMin", offsetof(Tuning, speedMin) },
+	{ "speedBonus", offsetof(Tuning, speedBonus) },
+	{ "rotationIncrement", offsetof(Tuning, rotationIncrement) },
+	{ "rotationCap", offsetof(Tuning, rotationCap) },
+	{ "iFrameDuration", offsetof(Tuning, iFrameDuration) },
+	{ "coinCap", offsetof(Tuning, coinCap) },
+	{ "pickupRadius", offsetof(Tuning, pickupRadius) },
+	{ "collisionMargin", offsetof(Tuning, collisionMargin) },
+	{ "widthScalar", offsetof(Tuning, widthScalar) },
+	{ "heightScalar", offsetof(Tuning, heightScalar) },
+	{ "cloudLodSpeed", offsetof(Tuning, cloudLodSpeed) },
+	{ "cloudLowResSpeed", offsetof(Tuning, cloudLowResSpeed) },
+	{ "cameraZoom", offsetof(Tuning, cameraZoom) },
+	{ "cameraShake", offsetof(Tuning, cameraShake) },
+	{ "frameBudget", offsetof(Tuning, frameBudget) },
+};
+#define FIELD_COUNT (int)(sizeof FIELDS / sizeof * FIELDS)
+
+/* * * * * * *
+* PARSING   *
+* * * * * * */
+void Tuning_Defaults(Tuning* tuning) {
+	//what the game shipped with before the file existed
+	tuning->speed = 10;
+	tuning->speedMin = 8;
+	tuning->speedBonus = 3;
+	tuning->rotationIncrement = 0.03f;
+	tuning->rotationCap = 0.06f;
+	tuning->iFrameDuration = 1;
+	tuning->coinCap = 10;
+	tuning->pickupRadius = 75;
+	tuning->collisionMargin = 35;
+	tuning->widthScalar = 0.8f;
+	tuning->heightScalar = 0.7f;
+	tuning->cloudLodSpeed = 15;
+	tuning->cloudLowResSpeed = 0;
+	tuning->cameraZoom = 1;
+	tuning->cameraShake = 16;
+	tuning->frameBudget = 17;
+}
+
+bool Tuning_Load(const char* path, Tuning* tuning) {
+	Tuning_Defaults(tuning);
+	FILE* file = openFile(path, "r");
+	if (!file) return false;
+	char line[256];
+	while (fgets(line, sizeof line, file)) {
+		char* comment = strchr(line, '#');
+		if (comment) *comment = 0;
+		char* name = line + strspn(line, " \t");
+		size_t nameLength = strspn(name, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz");
+		char* equals = name + nameLength + strspn(name + nameLength, " \t");
+		if (!nameLength || *equals != '=') continue;
+		char* end;
+		float value = strtof(equals + 1, &end);
+		if (end == equals + 1) continue;
+		for (int i = 0; i < FIELD_COUNT; i++) {
+			if (strlen(FIELDS[i].name) == nameLength && !strncmp(name, FIELDS[i].name, nameLength)) {
+				*(float*)((char*)tuning + FIELDS[i].offset) = value;
+			}
+		}
+	}
+	fclose(file);
+	return true;
+}
+
+/* * * * * * *
+* WATCHER   *
+* * * * * * */
+/***
+* The watcher publishes into current under the lock and then bumps version, so a frame
+* where nothing changed costs the game one atomic load. Editors save in different ways
+* (rewrite in place, or write a new file and rename it over), so the watcher listens to
+* the whole directory, re-reads the file, and only publishes if the values differ.
+***/
+static struct {
+	bool started;
+	char path[260];
+	char directory[260];
+	const char* fileName;
+	AtomicVersion version;
+	Tuning current;
+#ifdef _WIN32
+	CRITICAL_SECTION lock;
+	HANDLE thread;
+	HANDLE stop;
+#else
+	pthread_mutex_t lock;
+	pthread_t thread;
+	int stop[2]; //pipe; writing to it wakes the watcher to quit
+#endif
+} watcher;
+
+static void reload(void) {
+	Tuning tuning;
+	if (!Tuning_Load(watcher.path, &tuning)) return; //mid-rename, the next event will have it
+	if (!memcmp(&tuning, &watcher.current, sizeof tuning)) return;
+#ifdef _WIN32
+	EnterCriticalSection(&watcher.lock);
+	watcher.current = tuning;
+	LeaveCriticalSection(&watcher.lock);
+#else
+	pthread_mutex_lock(&watcher.lock);
+	watcher.current = tuning;
+	pthread_mutex_unlock(&watcher.lock);
+#endif
+	storeVersion(&watcher.version, loadVersion(&watcher.version) + 1);
+}
+
+#ifdef _WIN32
+static THREAD_RESULT watcherMain(void* param) {
+	(void)param;
+	HANDLE change = FindFirstChangeNotificationA(watcher.directory, FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+	if (change == INVALID_HANDLE_VALUE) return 0;
+	HANDLE handles[2] = { watcher.stop, change };
+	while (WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1) {
+		//the notification doesn't say which file changed
+		reload();
+		if (!FindNextChangeNotification(change)) break;
+	}
+	FindCloseChangeNotification(change);
+	return 0;
+}
+#else
+static THREAD_RESULT watcherMain(void* param) {
+	(void)param;
+	int notify = inotify_init();
+	if (notify < 0) return 0;
+	if (inotify_add_watch(notify, watcher.directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		close(notify);
+		return 0;
+	}
+	char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	struct pollfd fds[2] = { { watcher.stop[0], POLLIN, 0 }, { notify, POLLIN, 0 } };
+	while (poll(fds, 2, -1) >= 0 && !fds[0].revents) {
+		if (!(fds[1].revents & POLLIN)) continue;
+		ssize_t length = read(notify, events, sizeof events);
+		bool ours = false;
+		for (char* p = events; length > 0 && p < events + length; ) {
+			struct inotify_event* event = (struct inotify_event*)p;
+			if (event->len && !strcmp(event->name, watcher.fileName)) ours = true;
+			p += sizeof * event + event->len;
+		}
+		if (ours) reload();
+	}
+	close(notify);
+	return 0;
+}
+#endif
+
+bool Tuning_Watch(const char* path, const Tuning* initial) {
+	if (watcher.started) return true;
+	size_t length = strlen(path);
+	if (length >= sizeof watcher.path) return false;
+	memcpy(watcher.path, path, length + 1);
+	memcpy(watcher.directory, path, length + 1);
+	char* slash = strrchr(watcher.directory, '/');
+	char* backslash = strrchr(watcher.directory, '\\');
+	if (backslash > slash) slash = backslash;
+	if (slash) {
+		*slash = 0;
+		watcher.fileName = watcher.path + (slash - watcher.directory) + 1;
+	} else {
+		memcpy(watcher.directory, ".", 2);
+		watcher.fileName = watcher.path;
+	}
+	watcher.current = *initial;
+	watcher.version = 0;
+
+#ifdef _WIN32
+	InitializeCriticalSection(&watcher.lock);
+	watcher.stop = CreateEventA(NULL, TRUE, FALSE, NULL);
+	watcher.thread = watcher.stop ? CreateThread(NULL, 0, watcherMain, NULL, 0, NULL) : NULL;
+	if (!watcher.thread) {
+		if (watcher.stop) CloseHandle(watcher.stop);
+		DeleteCriticalSection(&watcher.lock);
+		return false;
+	}
+#else
+	pthread_mutex_init(&watcher.lock, NULL);
+	if (pipe(watcher.stop) != 0) {
+		pthread_mutex_destroy(&watcher.lock);
+		return false;
+	}
+	if (pthread_create(&watcher.thread, NULL, watcherMain, NULL) != 0) {
+		close(watcher.stop[0]);
+		close(watcher.stop[1]);
+		pthread_mutex_destroy(&watcher.lock);
+		return false;
+	}
+#endif
+	watcher.started = true;
+	return true;
+}
+
+void Tuning_StopWatching(void) {
+	if (!watcher.started) return;
+#ifdef _WIN32
+	SetEvent(watcher.stop);
+	WaitForSingleObject(watcher.thread, INFINITE);
+	CloseHandle(watcher.thread);
+	CloseHandle(watcher.stop);
+	DeleteCriticalSection(&watcher.lock);
+#else
+	char quit = 1;
+	if (write(watcher.stop[1], &quit, 1) == 1) pthread_join(watcher.thread, NULL);
+	close(watcher.stop[0]);
+	close(watcher.stop[1]);
+	pthread_mutex_destroy(&watcher.lock);
+#endif
+	watcher.started = false;
+}
+
+bool Tuning_Poll(uint32_t* version, Tuning* tuning) {
+	if (!watcher.started) return false;
+	uint32_t newest = loadVersion(&watcher.version);
+	if (newest == *version) return false;
+#ifdef _WIN32
+	EnterCriticalSection(&watcher.lock);
+	*tuning = watcher.current;
+	LeaveCriticalSection(&watcher.lock);
+#else
+	pthread_mutex_lock(&watcher.lock);
+	*tuning = watcher.current;
+	pthread_mutex_unlock(&watcher.lock);
+#endif
+	*version = newest;
+	return true;
+}
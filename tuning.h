@@ -0,0 +1,47 @@
+//---------------------------------------------------------
+// file:	tuning.h
+//
+// brief:	Gameplay constants read from a text file, and
+//			re-read whenever it changes. A watcher thread
+//			sleeps on the OS's change notifications and
+//			parses the file; the game thread only checks a
+//			version number each frame and copies the values
+//			when it moved.
+//
+// format:	One "name = value" per line, '#' starts a
+//			comment. Missing names keep their defaults.
+//---------------------------------------------------------
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TUNING_PATH "Assets/tuning.cfg"
+
+typedef struct {
+	float speed; //starting speed of a run
+	float speedMin;
+	float speedBonus; //added per coin
+	float rotationIncrement; //per frame while turning
+	float rotationCap;
+	float iFrameDuration; //seconds
+	float coinCap; //how far coins bob up and down
+	float pickupRadius; //how close the plane has to get to a coin
+	float collisionMargin; //added to the cloud ellipse, roughly the plane's radius
+	float widthScalar, heightScalar; //cloud ellipse size, as a fraction of the texture
+	float cloudLodSpeed; //clouds are drawn from a half size mip level from twice this speed on, 0 keeps them sharp
+	float cloudLowResSpeed; //from this speed the cloud layer goes through a low resolution canvas, 0 never
+	float cameraZoom; //screen pixels per world pixel
+	float cameraShake; //how far a hard hit shakes the view, pixels, 0 never
+	float frameBudget; //milliseconds a frame may take before the governor lowers quality, 0 never
+} Tuning;
+
+void Tuning_Defaults(Tuning* tuning);
+//Parse the file over the defaults. Returns false, leaving the defaults, if it can't be read.
+bool Tuning_Load(const char* path, Tuning* tuning);
+
+//Start watching path, beginning from the values in initial.
+bool Tuning_Watch(const char* path, const Tuning* initial);
+void Tuning_StopWatching(void);
+//Copy the newest values if they are newer than *version. Never touches the file system.
+bool Tuning_Poll(uint32_t* version, Tuning* tuning);
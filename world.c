@@ -0,0 +1,46 @@
+//---------------------------------------------------------
+// file:	world.c
+//
+// brief:	World data shared by the game and the server.
+//---------------------------------------------------------
+
+#include "world.h"
+#include <math.h>
+
+TextureRect CLOUD_TEXTURE_POSITIONS[CLOUD_TEXTURE_COUNT] = {
+	{111,  73,   5,  18, 116,  91},	//0
+	{122,  58, 142,  23, 264,  81},	//1
+	{ 90,  48, 288,  26, 378,  74},	//2
+	{104,  46, 410,  30, 514,  76},	//3
+	{135,  86, 543,  10, 678,  96},	//4
+	{ 91,  69, 724,  13, 815,  82},	//5
+	{112,  59,   8, 120, 120, 179},	//6
+	{176,  70, 138, 112, 314, 182},	//7
+	{126,  69, 342, 115, 468, 184},	//8
+	{199, 100, 494, 112, 693, 183},	//9
+	{137,  70, 718, 110, 845, 180}, //10
+	{187,  93,  10, 209, 287, 302},	//11
+	{184,  84, 339, 203, 523, 287}	//12
+};
+
+//How many whole chunks offset lies past the chunk's center, rounded to nearest, and at least
+//1 or -1 once it is past an edge, so a plane that overshoots lands inside the next chunk
+//instead of past the far edge.
+static int chunksPast(float offset, float size) {
+	if (offset <= size / 2 && offset >= -size / 2) return 0;
+	int chunks = (int)floorf(offset / size + 0.5f);
+	return chunks ? chunks : (offset > 0) ? 1 : -1;
+}
+
+bool WorldOrigin_Rebase(WorldOrigin* origin, float* globalX, float* globalY, float chunkWidth, float chunkHeight, float* shiftX, float* shiftY) {
+	//globalX grows as the plane flies west, so it's the chunks to the west that are counted
+	int westward = chunksPast(*globalX, chunkWidth);
+	int northward = chunksPast(*globalY, chunkHeight);
+	origin->chunkX -= westward;
+	origin->chunkY -= northward;
+	*shiftX = -westward * chunkWidth;
+	*shiftY = -northward * chunkHeight;
+	*globalX += *shiftX;
+	*globalY += *shiftY;
+	return westward || northward;
+}
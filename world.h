@@ -0,0 +1,50 @@
+//---------------------------------------------------------
+// file:	world.h
+//
+// brief:	Types describing the game world that modules
+//			outside main.c need to read or write.
+//---------------------------------------------------------
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+	float size;
+	float x;
+	float y;
+	int img_id; //0 to 12 variations
+} Cloud;
+
+typedef struct {
+	float w;
+	float h;
+	float x0;
+	float y0;
+	float x1;
+	float y1;
+} TextureRect;
+
+#define CLOUD_TEXTURE_COUNT 13
+
+//These values "cut" the CloudTextures.png image into subimages to randomize clouds
+extern TextureRect CLOUD_TEXTURE_POSITIONS[CLOUD_TEXTURE_COUNT];
+
+/***
+* Floating origin. Float positions are relative to the chunk the plane is in, one Bounds
+* world, so they never grow much past a chunk and keep sub-pixel precision however far it
+* flies. The whole chunks it crossed to get there are counted here, as integers.
+***/
+typedef struct {
+	int32_t chunkX, chunkY;
+} WorldOrigin;
+
+/***
+* globalX/Y are the plane's offset from the middle of the chunk, negated, the way the game
+* keeps them. Once one is past half a chunk, the origin moves by the whole chunks it went
+* over and globalX/Y are put back inside. Returns false when nothing moved; otherwise
+* anything that should stay where it is gets (shiftX, shiftY) subtracted from its position.
+* That's only what outlives the move, so the cost follows what's around the plane, not
+* the size of the world.
+***/
+bool WorldOrigin_Rebase(WorldOrigin* origin, float* globalX, float* globalY, float chunkWidth, float chunkHeight, float* shiftX, float* shiftY);